@@ -0,0 +1,139 @@
+#ifndef __ADDRESSMAP_H__
+#define __ADDRESSMAP_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <vector>
+
+// Fixed size hash table from addresses to objects, for lookups from any thread while another one adds entries
+// (e.g. hooks that may be called before the patching is done). Lookups don't take any lock; insertions are
+// lock-free too. An erased entry keeps its slot, which only the same key can use again. The table can't grow,
+// Insert fails once it is full. nullptr can't be a key or a value.
+template<typename T>
+class AddressMap
+{
+private:
+
+    struct Slot
+    {
+        std::atomic<const void *> key;
+        std::atomic<T *> value;
+    };
+
+    std::vector<Slot> slots;
+    size_t mask;
+    std::atomic<size_t> count;
+
+    AddressMap(const AddressMap &);
+    AddressMap &operator=(const AddressMap &);
+
+    static inline size_t Hash(const void *key)
+    {
+        uint64_t h = (uint64_t)(uintptr_t)key;
+
+        // Functions are aligned, the low bits alone would cluster
+        h ^= h >> 33;
+        h *= 0xFF51AFD7ED558CCDULL;
+        h ^= h >> 33;
+        return (size_t)h;
+    }
+
+    static inline size_t TableSize(size_t capacity)
+    {
+        size_t size = 4;
+
+        while (size < capacity*2)
+            size <<= 1;
+
+        return size;
+    }
+
+public:
+
+    // Room for at least capacity entries. The table is kept at most half full, to keep the probes short.
+    AddressMap(size_t capacity=128) : slots(TableSize(capacity)), mask(slots.size()-1), count(0)
+    {
+        for (Slot &slot : slots)
+        {
+            slot.key.store(nullptr, std::memory_order_relaxed);
+            slot.value.store(nullptr, std::memory_order_relaxed);
+        }
+    }
+
+    inline size_t GetCount() const { return count.load(std::memory_order_relaxed); }
+
+    // Returns false if the key was already there (the old value is kept) or the table is full
+    bool Insert(const void *key, T *value)
+    {
+        if (!key || !value)
+            return false;
+
+        for (size_t i = Hash(key), n = 0; n < slots.size(); i++, n++)
+        {
+            Slot &slot = slots[i & mask];
+            const void *k = slot.key.load(std::memory_order_acquire);
+            T *none = nullptr;
+
+            if (!k)
+            {
+                if (count.fetch_add(1, std::memory_order_relaxed) >= slots.size() / 2)
+                {
+                    count.fetch_sub(1, std::memory_order_relaxed);
+                    return false;
+                }
+
+                if (slot.key.compare_exchange_strong(k, key, std::memory_order_acq_rel))
+                    return slot.value.compare_exchange_strong(none, value, std::memory_order_acq_rel);
+
+                // Taken meanwhile
+                count.fetch_sub(1, std::memory_order_relaxed);
+            }
+
+            // Also an erased entry of the same key, whose slot is reused
+            if (k == key)
+                return slot.value.compare_exchange_strong(none, value, std::memory_order_acq_rel);
+        }
+
+        return false;
+    }
+
+    // Returns the value that was there, or nullptr. A Find running at the same time may still return it,
+    // so the caller can only free it when no lookup can be using it anymore.
+    T *Erase(const void *key)
+    {
+        for (size_t i = Hash(key), n = 0; n < slots.size(); i++, n++)
+        {
+            Slot &slot = slots[i & mask];
+            const void *k = slot.key.load(std::memory_order_acquire);
+
+            if (k == key)
+                return slot.value.exchange(nullptr, std::memory_order_acq_rel);
+
+            if (!k)
+                break;
+        }
+
+        return nullptr;
+    }
+
+    // nullptr if not found. A concurrent Insert of the same key may be seen or not.
+    inline T *Find(const void *key) const
+    {
+        for (size_t i = Hash(key), n = 0; n < slots.size(); i++, n++)
+        {
+            const Slot &slot = slots[i & mask];
+            const void *k = slot.key.load(std::memory_order_acquire);
+
+            if (k == key)
+                return slot.value.load(std::memory_order_acquire);
+
+            if (!k)
+                break;
+        }
+
+        return nullptr;
+    }
+};
+
+#endif // __ADDRESSMAP_H__
@@ -0,0 +1,128 @@
+#include <string.h>
+
+#include "Arena.h"
+
+Arena::Arena(size_t block_size) : block_size(block_size)
+{
+    if (this->block_size < 256)
+        this->block_size = 256;
+
+    current = pos = 0;
+    last_alloc = nullptr;
+    num_allocations = bytes_allocated = 0;
+}
+
+Arena::~Arena()
+{
+    Release();
+}
+
+void Arena::NextBlock(size_t size, size_t alignment)
+{
+    size_t needed = size + alignment - 1;
+    size_t next = (blocks.empty()) ? 0 : current+1;
+
+    // After a rewind, the blocks of the previous round are reused as long as they are big enough
+    if (next >= blocks.size() || blocks[next].size < needed)
+    {
+        Block block;
+
+        block.size = (needed > block_size) ? needed : block_size;
+        block.mem = new uint8_t[block.size];
+        blocks.insert(blocks.begin()+next, block);
+    }
+
+    current = next;
+    pos = 0;
+}
+
+void *Arena::Allocate(size_t size, size_t alignment)
+{
+    if (size == 0)
+        size = 1;
+
+    if (alignment == 0 || (alignment & (alignment-1)) != 0 || size > (size_t)-1 - alignment)
+        throw std::bad_alloc();
+
+    for (int i = 0; i < 2; i++)
+    {
+        if (current < blocks.size())
+        {
+            const Block &block = blocks[current];
+            uintptr_t top = (uintptr_t)block.mem + pos;
+            size_t start = pos + (size_t)(((top + alignment - 1) & ~(uintptr_t)(alignment-1)) - top);
+
+            if (start <= block.size && size <= block.size - start)
+            {
+                pos = start + size;
+                last_alloc = block.mem + start;
+                num_allocations++;
+                bytes_allocated += size;
+                return last_alloc;
+            }
+        }
+
+        NextBlock(size, alignment);
+    }
+
+    // NextBlock always provides enough space
+    throw std::bad_alloc();
+}
+
+void Arena::Deallocate(void *ptr, size_t size)
+{
+    if (!ptr || ptr != last_alloc || current >= blocks.size())
+        return;
+
+    const Block &block = blocks[current];
+    size_t start = (size_t)((uint8_t *)ptr - block.mem);
+
+    if (start + size == pos)
+    {
+        pos = start;
+        last_alloc = nullptr;
+    }
+}
+
+char *Arena::StrDup(const char *str, size_t len)
+{
+    char *ret = (char *)Allocate(len+1, 1);
+
+    memcpy(ret, str, len);
+    ret[len] = 0;
+    return ret;
+}
+
+void Arena::Rewind(const Arena::Mark &mark)
+{
+    current = mark.block;
+    pos = mark.pos;
+    last_alloc = nullptr;
+}
+
+void Arena::Rewind()
+{
+    current = pos = 0;
+    last_alloc = nullptr;
+}
+
+void Arena::Release()
+{
+    for (Block &block : blocks)
+        delete[] block.mem;
+
+    blocks.clear();
+    current = pos = 0;
+    last_alloc = nullptr;
+    num_allocations = bytes_allocated = 0;
+}
+
+size_t Arena::GetCapacity() const
+{
+    size_t capacity = 0;
+
+    for (const Block &block : blocks)
+        capacity += block.size;
+
+    return capacity;
+}
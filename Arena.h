@@ -0,0 +1,205 @@
+#ifndef __ARENA_H__
+#define __ARENA_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+#include <limits>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#if defined(__has_include) && ((defined(_MSVC_LANG) && _MSVC_LANG >= 201703L) || __cplusplus >= 201703L)
+#if __has_include(<memory_resource>)
+#include <memory_resource>
+#define ARENA_HAS_PMR
+#endif
+#endif
+
+#define ARENA_DEFAULT_BLOCK_SIZE    (64*1024)
+
+// Monotonic (bump) allocator. Memory is taken from big blocks and is only given back all at once, with Rewind
+// (blocks are kept for reuse) or Release (blocks are freed). Deallocate only reclaims the last allocation,
+// which is enough for growing containers.
+// Nothing allocated here gets its destructor called by the arena, so objects with non trivial destructors must be
+// destroyed by their owner (containers using ArenaAllocator do it) before rewinding.
+class Arena
+{
+private:
+
+    struct Block
+    {
+        uint8_t *mem;
+        size_t size;
+    };
+
+    std::vector<Block> blocks;
+    size_t current; // Index in blocks
+    size_t pos; // Offset in blocks[current]
+    size_t block_size;
+
+    void *last_alloc;
+
+    uint64_t num_allocations;
+    uint64_t bytes_allocated;
+
+    void NextBlock(size_t size, size_t alignment);
+
+    Arena(const Arena &);
+    Arena &operator=(const Arena &);
+
+public:
+
+    // A point to go back to with Rewind(Mark)
+    struct Mark
+    {
+        size_t block;
+        size_t pos;
+    };
+
+    Arena(size_t block_size=ARENA_DEFAULT_BLOCK_SIZE);
+    ~Arena();
+
+    // Never returns nullptr, throws std::bad_alloc like operator new
+    void *Allocate(size_t size, size_t alignment=alignof(max_align_t));
+    void Deallocate(void *ptr, size_t size);
+
+    // Uninitialized storage for count elements of T
+    template<typename T>
+    inline T *AllocateArray(size_t count) { return (T *)Allocate(count*sizeof(T), alignof(T)); }
+
+    // Null terminated copy of str
+    char *StrDup(const char *str, size_t len);
+    inline char *StrDup(const std::string &str) { return StrDup(str.c_str(), str.length()); }
+
+    inline Mark GetMark() const { Mark m; m.block = current; m.pos = pos; return m; }
+    void Rewind(const Mark &mark);
+    void Rewind();
+    void Release();
+
+    // Statistics since the construction or the last Release
+    inline uint64_t GetNumAllocations() const { return num_allocations; }
+    inline uint64_t GetBytesAllocated() const { return bytes_allocated; }
+    inline size_t GetNumBlocks() const { return blocks.size(); }
+    size_t GetCapacity() const;
+};
+
+// Rewinds the arena to its current position when going out of scope. For scratch memory in functions that may
+// be called while the arena also holds longer lived data.
+class ArenaScope
+{
+private:
+
+    Arena *arena;
+    Arena::Mark mark;
+
+    ArenaScope(const ArenaScope &);
+    ArenaScope &operator=(const ArenaScope &);
+
+public:
+
+    inline ArenaScope(Arena &arena) : arena(&arena), mark(arena.GetMark()) { }
+    inline ~ArenaScope() { arena->Rewind(mark); }
+};
+
+// Standard allocator over an Arena. A null arena means the global heap, so containers using it can still be
+// default constructed. Copies of containers get the heap (select_on_container_copy_construction), so that they
+// may outlive the arena; moves and swaps keep the arena.
+template<typename T>
+class ArenaAllocator
+{
+public:
+
+    typedef T value_type;
+    typedef T *pointer;
+    typedef const T *const_pointer;
+    typedef T &reference;
+    typedef const T &const_reference;
+    typedef size_t size_type;
+    typedef ptrdiff_t difference_type;
+
+    typedef std::false_type propagate_on_container_copy_assignment;
+    typedef std::true_type propagate_on_container_move_assignment;
+    typedef std::true_type propagate_on_container_swap;
+
+    template<typename U>
+    struct rebind
+    {
+        typedef ArenaAllocator<U> other;
+    };
+
+    Arena *arena;
+
+    inline ArenaAllocator() : arena(nullptr) { }
+    inline ArenaAllocator(Arena *arena) : arena(arena) { }
+
+    template<typename U>
+    inline ArenaAllocator(const ArenaAllocator<U> &other) : arena(other.arena) { }
+
+    inline T *allocate(size_t n)
+    {
+        if (n > std::numeric_limits<size_t>::max() / sizeof(T))
+            throw std::bad_alloc();
+
+        if (!arena)
+            return (T *)::operator new(n * sizeof(T));
+
+        return (T *)arena->Allocate(n * sizeof(T), alignof(T));
+    }
+
+    inline void deallocate(T *p, size_t n)
+    {
+        if (!arena)
+            ::operator delete(p);
+        else
+            arena->Deallocate(p, n * sizeof(T));
+    }
+
+    inline ArenaAllocator select_on_container_copy_construction() const { return ArenaAllocator(); }
+
+    // C++11 libraries that still go through these instead of allocator_traits
+    inline size_t max_size() const { return std::numeric_limits<size_t>::max() / sizeof(T); }
+
+    template<typename U, typename... Args>
+    inline void construct(U *p, Args&&... args) { ::new((void *)p) U(std::forward<Args>(args)...); }
+
+    template<typename U>
+    inline void destroy(U *p) { p->~U(); }
+};
+
+template<typename T, typename U>
+inline bool operator==(const ArenaAllocator<T> &a, const ArenaAllocator<U> &b) { return a.arena == b.arena; }
+
+template<typename T, typename U>
+inline bool operator!=(const ArenaAllocator<T> &a, const ArenaAllocator<U> &b) { return a.arena != b.arena; }
+
+template<typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+typedef std::basic_string<char, std::char_traits<char>, ArenaAllocator<char>> ArenaString;
+typedef std::basic_string<char16_t, std::char_traits<char16_t>, ArenaAllocator<char16_t>> ArenaU16String;
+
+#ifdef ARENA_HAS_PMR
+
+// std::pmr interface to an Arena, for code built as C++17
+class ArenaResource : public std::pmr::memory_resource
+{
+private:
+
+    Arena *arena;
+
+protected:
+
+    virtual void *do_allocate(size_t bytes, size_t alignment) override { return arena->Allocate(bytes, alignment); }
+    virtual void do_deallocate(void *p, size_t bytes, size_t) override { arena->Deallocate(p, bytes); }
+    virtual bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override { return this == &other; }
+
+public:
+
+    ArenaResource(Arena &arena) : arena(&arena) { }
+};
+
+#endif // ARENA_HAS_PMR
+
+#endif // __ARENA_H__
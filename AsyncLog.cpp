@@ -0,0 +1,300 @@
+#include "AsyncLog.h"
+#include "Mutex.h"
+#include "debug.h"
+
+#ifdef _MSC_VER
+#define ASYNC_LOG_THREAD_LOCAL  __declspec(thread)
+#else
+#define ASYNC_LOG_THREAD_LOCAL  __thread
+#endif
+
+// Ring of the last instance this thread wrote to. Instances are identified by id and not by address,
+// another one could be created where a destroyed one was.
+static ASYNC_LOG_THREAD_LOCAL uint64_t current_log_id = 0;
+static ASYNC_LOG_THREAD_LOCAL void *current_producer = nullptr;
+
+static std::atomic<uint64_t> next_log_id(1);
+
+class AsyncLogWriter : public Runnable
+{
+private:
+
+    AsyncLog *log;
+
+public:
+
+    AsyncLogWriter(AsyncLog *log) : log(log) { }
+    virtual ~AsyncLogWriter() { }
+
+    virtual uint32_t Run() override
+    {
+        log->WriterLoop();
+        return 0;
+    }
+
+    virtual void Stop() override
+    {
+        log->stop.store(true);
+        log->wakeup.Notify();
+    }
+};
+
+AsyncLog::AsyncLog(ASYNC_LOG_WRITE_FUNCTION write_func, void *write_param, size_t ring_size) : write_func(write_func), write_param(write_param), ring_size(ring_size), writer(nullptr)
+{
+    if (!this->write_func)
+        this->write_func = DefaultWrite;
+
+    id = next_log_id.fetch_add(1);
+    num_producers.store(0);
+    state.store(0);
+    writer_sleeping.store(false);
+    stop.store(false);
+    lines_written.store(0);
+}
+
+AsyncLog::~AsyncLog()
+{
+    if (writer)
+    {
+        // Kill calls Stop, the writer empties the rings before leaving
+        writer->Kill();
+        delete writer;
+    }
+
+    for (Producer *producer : producers)
+        delete producer;
+}
+
+void AsyncLog::DefaultWrite(const std::string &text, void *)
+{
+    DPRINTF("%s", text.c_str());
+}
+
+AsyncLog::Producer *AsyncLog::GetProducer()
+{
+    if (current_log_id == id)
+        return (Producer *)current_producer;
+
+    std::thread::id self = std::this_thread::get_id();
+    Producer *producer = nullptr;
+
+    {
+        MutexLocker lock(&producers_mutex);
+
+        // The thread may have written to another instance since its last write to this one
+        for (Producer *p : producers)
+        {
+            if (p->thread_id == self)
+            {
+                producer = p;
+                break;
+            }
+        }
+
+        if (!producer)
+        {
+            producer = new Producer(ring_size);
+            producers.push_back(producer);
+            num_producers.store(producers.size(), std::memory_order_release);
+        }
+    }
+
+    current_log_id = id;
+    current_producer = producer;
+    return producer;
+}
+
+void AsyncLog::StartWriter()
+{
+    int expected = 0;
+
+    // Whoever loses the race just goes on, its lines wait in the ring until the writer runs
+    if (!state.compare_exchange_strong(expected, 1))
+        return;
+
+    writer = new Thread(new AsyncLogWriter(this), true);
+    writer->Start();
+    state.store(2, std::memory_order_release);
+}
+
+void AsyncLog::WakeWriter()
+{
+    // Pairs with the fence in WriterLoop: either the writer sees the new line before sleeping, or we see it sleeping
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    if (writer_sleeping.load(std::memory_order_relaxed))
+        wakeup.Notify();
+}
+
+void AsyncLog::Write(std::string &&line)
+{
+    if (state.load(std::memory_order_acquire) != 2)
+        StartWriter();
+
+    Producer *producer = GetProducer();
+
+    while (!producer->ring.Push(std::move(line)))
+    {
+        wakeup.Notify();
+        std::this_thread::yield();
+    }
+
+    WakeWriter();
+}
+
+bool AsyncLog::Flush(uint32_t timeout_ms)
+{
+    std::vector<std::pair<Producer *, size_t>> targets;
+    auto start = std::chrono::steady_clock::now();
+
+    {
+        MutexLocker lock(&producers_mutex);
+
+        for (Producer *producer : producers)
+            targets.push_back(std::make_pair(producer, producer->ring.GetNumPushed()));
+    }
+
+    // Nothing was ever written if there are no producers: don't start a thread for that (Flush may be called from DllMain)
+    if (targets.empty())
+        return true;
+
+    if (state.load(std::memory_order_acquire) != 2)
+        StartWriter();
+
+    for (auto &it : targets)
+    {
+        while (it.first->num_written.load(std::memory_order_acquire) < it.second)
+        {
+            if (timeout_ms != ASYNC_LOG_WAIT_FOREVER &&
+                std::chrono::steady_clock::now() - start >= std::chrono::milliseconds(timeout_ms))
+            {
+                return false;
+            }
+
+            wakeup.Notify();
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+
+    return true;
+}
+
+void AsyncLog::FlushOrphaned()
+{
+    std::vector<Producer *> list;
+    std::string batch;
+    std::string line;
+
+    // A terminated thread may have died holding the mutex, nothing can be adding producers by now anyway
+    bool locked = producers_mutex.TryLock();
+    list = producers;
+
+    if (locked)
+        producers_mutex.Unlock();
+
+    for (Producer *producer : list)
+    {
+        while (producer->ring.Pop(line))
+        {
+            batch += line;
+            producer->in_batch++;
+
+            if (batch.length() >= ASYNC_LOG_BATCH_SIZE)
+                WriteBatch(list, batch);
+        }
+    }
+
+    WriteBatch(list, batch);
+}
+
+void AsyncLog::GetProducers(std::vector<Producer *> &list)
+{
+    if (list.size() == num_producers.load(std::memory_order_acquire))
+        return;
+
+    MutexLocker lock(&producers_mutex);
+    list = producers;
+}
+
+void AsyncLog::WriteBatch(const std::vector<Producer *> &list, std::string &batch)
+{
+    uint64_t num_lines = 0;
+
+    if (!batch.empty())
+        write_func(batch, write_param);
+
+    batch.clear();
+
+    for (Producer *producer : list)
+    {
+        if (producer->in_batch == 0)
+            continue;
+
+        num_lines += producer->in_batch;
+        producer->num_written.store(producer->num_written.load(std::memory_order_relaxed) + producer->in_batch, std::memory_order_release);
+        producer->in_batch = 0;
+    }
+
+    lines_written.fetch_add(num_lines, std::memory_order_relaxed);
+}
+
+void AsyncLog::WriterLoop()
+{
+    std::vector<Producer *> list;
+    std::string batch;
+    std::string line;
+
+    batch.reserve(ASYNC_LOG_BATCH_SIZE + 256);
+
+    while (true)
+    {
+        bool stopping = stop.load();
+        bool any = false;
+        size_t batch_lines = 0;
+
+        GetProducers(list);
+
+        for (Producer *producer : list)
+        {
+            while (producer->ring.Pop(line))
+            {
+                batch += line;
+                producer->in_batch++;
+                batch_lines++;
+                any = true;
+
+                if (batch.length() >= ASYNC_LOG_BATCH_SIZE)
+                {
+                    WriteBatch(list, batch);
+                    batch_lines = 0;
+                }
+            }
+        }
+
+        if (batch_lines > 0)
+            WriteBatch(list, batch);
+
+        // Stop was seen before the last pass, so the rings were emptied after it
+        if (stopping)
+            break;
+
+        if (any)
+            continue;
+
+        writer_sleeping.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        bool pending = stop.load() || list.size() != num_producers.load(std::memory_order_relaxed);
+
+        for (size_t i = 0; i < list.size() && !pending; i++)
+        {
+            if (!list[i]->ring.IsEmpty())
+                pending = true;
+        }
+
+        if (!pending)
+            wakeup.Wait();
+
+        writer_sleeping.store(false, std::memory_order_relaxed);
+    }
+}
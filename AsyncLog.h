@@ -0,0 +1,102 @@
+#ifndef __ASYNCLOG_H__
+#define __ASYNCLOG_H__
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <thread>
+
+#include "SpscRing.h"
+#include "Thread.h"
+
+// Default size of the ring of each thread, in lines
+#define ASYNC_LOG_RING_SIZE     1024
+// Lines are joined until this size before calling the write function
+#define ASYNC_LOG_BATCH_SIZE    (16*1024)
+// Flush without timeout
+#define ASYNC_LOG_WAIT_FOREVER  ((uint32_t)-1)
+
+// text is the concatenation of one or more lines, as they were given to Write
+typedef void (* ASYNC_LOG_WRITE_FUNCTION)(const std::string &text, void *param);
+
+class AsyncLogWriter;
+
+// Log lines written from many threads without making them wait for each other. Each thread gets its own SpscRing
+// the first time it writes, and a background thread takes the lines of all the rings and passes them to the write
+// function in batches. The lines of a thread keep their order, the ones of different threads may be interleaved
+// differently. A thread whose ring is full waits for the writer, lines are never dropped.
+// The writer thread is started on the first Write, so an object can be created at any time (static init, DllMain).
+// Don't Write while the object is being destroyed.
+class AsyncLog
+{
+private:
+
+    friend class AsyncLogWriter;
+
+    struct Producer
+    {
+        SpscRing<std::string> ring;
+        std::thread::id thread_id;
+        std::atomic<size_t> num_written;
+        size_t in_batch; // Writer only: lines popped and not yet written
+
+        Producer(size_t ring_size) : ring(ring_size), thread_id(std::this_thread::get_id()), in_batch(0)
+        {
+            num_written.store(0, std::memory_order_relaxed);
+        }
+    };
+
+    ASYNC_LOG_WRITE_FUNCTION write_func;
+    void *write_param;
+    size_t ring_size;
+    uint64_t id; // Tells apart the instances in the per thread cache
+
+    // The list only grows, under producers_mutex. The writer takes a copy when num_producers changes.
+    Mutex producers_mutex;
+    std::vector<Producer *> producers;
+    std::atomic<size_t> num_producers;
+
+    std::atomic<int> state; // 0: writer not started, 1: starting, 2: started
+    Thread *writer;
+
+    std::atomic<bool> writer_sleeping;
+    std::atomic<bool> stop;
+    Event wakeup;
+
+    std::atomic<uint64_t> lines_written;
+
+    AsyncLog(const AsyncLog &);
+    AsyncLog &operator=(const AsyncLog &);
+
+    Producer *GetProducer();
+    void StartWriter();
+    void WakeWriter();
+
+    void WriterLoop();
+    void GetProducers(std::vector<Producer *> &list);
+    void WriteBatch(const std::vector<Producer *> &list, std::string &batch);
+
+    static void DefaultWrite(const std::string &text, void *param);
+
+public:
+
+    // write_func nullptr: DPRINTF
+    AsyncLog(ASYNC_LOG_WRITE_FUNCTION write_func=nullptr, void *write_param=nullptr, size_t ring_size=ASYNC_LOG_RING_SIZE);
+    // Writes what is left and stops the writer thread
+    ~AsyncLog();
+
+    // line must include its line break, if it wants one
+    void Write(std::string &&line);
+    inline void Write(const std::string &line) { Write(std::string(line)); }
+
+    // Waits until everything written before the call, by any thread, has been passed to the write function.
+    // Returns false if that didn't happen in timeout_ms, for callers that can't be sure the writer thread still runs.
+    bool Flush(uint32_t timeout_ms=ASYNC_LOG_WAIT_FOREVER);
+    // Writes the lines left in the rings from the calling thread, for when the writer thread is gone: at process exit
+    // the system terminates it before DLL_PROCESS_DETACH. The writer must not be running.
+    void FlushOrphaned();
+
+    inline uint64_t GetNumLinesWritten() const { return lines_written.load(std::memory_order_relaxed); }
+};
+
+#endif // __ASYNCLOG_H__
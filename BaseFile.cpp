@@ -3,10 +3,48 @@
 #include <string.h>
 
 #include "BaseFile.h"
+#include "XmlReader.h"
+#include "XmlWriter.h"
+#include "Arena.h"
+#include "MemoryStream.h"
 #include "Utils.h"
 #include "common.h"
 #include "debug.h"
 
+#ifdef CPU_X86_64
+#include <immintrin.h>
+#define SWAP_SIMD
+
+#ifdef _MSC_VER
+#define TARGET_SSSE3
+#define TARGET_AVX2
+#else
+#define TARGET_SSSE3    __attribute__((target("ssse3")))
+#define TARGET_AVX2     __attribute__((target("avx2")))
+#endif
+
+#endif
+
+BaseFile::~BaseFile()
+{
+    if (arena)
+        delete arena;
+}
+
+Arena &BaseFile::GetArena()
+{
+    if (!arena)
+        arena = new Arena();
+
+    return *arena;
+}
+
+void BaseFile::RewindArena()
+{
+    if (arena)
+        arena->Rewind();
+}
+
 uint64_t BaseFile::val64(uint64_t val) const
 {
 #ifdef __BIG_ENDIAN__
@@ -49,6 +87,138 @@ void BaseFile::copy_float(void *x, float val) const
     *(uint32_t *)x = val32(*p);
 }
 
+#ifdef SWAP_SIMD
+
+static const uint8_t swap16_mask[16] = { 1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14 };
+static const uint8_t swap32_mask[16] = { 3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12 };
+static const uint8_t swap64_mask[16] = { 7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8 };
+
+// Both return the number of bytes processed, the caller does the tail
+TARGET_SSSE3 static size_t swap_ssse3(uint8_t *p, size_t size, const uint8_t *mask)
+{
+    const __m128i m = _mm_loadu_si128((const __m128i *)mask);
+    size_t i = 0;
+
+    for (; i + 64 <= size; i += 64)
+    {
+        __m128i a = _mm_loadu_si128((const __m128i *)(p+i));
+        __m128i b = _mm_loadu_si128((const __m128i *)(p+i+16));
+        __m128i c = _mm_loadu_si128((const __m128i *)(p+i+32));
+        __m128i d = _mm_loadu_si128((const __m128i *)(p+i+48));
+
+        _mm_storeu_si128((__m128i *)(p+i), _mm_shuffle_epi8(a, m));
+        _mm_storeu_si128((__m128i *)(p+i+16), _mm_shuffle_epi8(b, m));
+        _mm_storeu_si128((__m128i *)(p+i+32), _mm_shuffle_epi8(c, m));
+        _mm_storeu_si128((__m128i *)(p+i+48), _mm_shuffle_epi8(d, m));
+    }
+
+    for (; i + 16 <= size; i += 16)
+    {
+        __m128i a = _mm_loadu_si128((const __m128i *)(p+i));
+        _mm_storeu_si128((__m128i *)(p+i), _mm_shuffle_epi8(a, m));
+    }
+
+    return i;
+}
+
+TARGET_AVX2 static size_t swap_avx2(uint8_t *p, size_t size, const uint8_t *mask)
+{
+    // vpshufb works per 128 bits lane, so the same mask goes in both
+    const __m256i m = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)mask));
+    size_t i = 0;
+
+    for (; i + 128 <= size; i += 128)
+    {
+        __m256i a = _mm256_loadu_si256((const __m256i *)(p+i));
+        __m256i b = _mm256_loadu_si256((const __m256i *)(p+i+32));
+        __m256i c = _mm256_loadu_si256((const __m256i *)(p+i+64));
+        __m256i d = _mm256_loadu_si256((const __m256i *)(p+i+96));
+
+        _mm256_storeu_si256((__m256i *)(p+i), _mm256_shuffle_epi8(a, m));
+        _mm256_storeu_si256((__m256i *)(p+i+32), _mm256_shuffle_epi8(b, m));
+        _mm256_storeu_si256((__m256i *)(p+i+64), _mm256_shuffle_epi8(c, m));
+        _mm256_storeu_si256((__m256i *)(p+i+96), _mm256_shuffle_epi8(d, m));
+    }
+
+    for (; i + 32 <= size; i += 32)
+    {
+        __m256i a = _mm256_loadu_si256((const __m256i *)(p+i));
+        _mm256_storeu_si256((__m256i *)(p+i), _mm256_shuffle_epi8(a, m));
+    }
+
+    return i;
+}
+
+static size_t swap_simd(void *p, size_t size, const uint8_t *mask)
+{
+    static const bool has_avx2 = Utils::CpuHasAvx2();
+    static const bool has_ssse3 = Utils::CpuHasSsse3();
+
+    if (has_avx2)
+        return swap_avx2((uint8_t *)p, size, mask);
+
+    if (has_ssse3)
+        return swap_ssse3((uint8_t *)p, size, mask);
+
+    return 0;
+}
+
+#endif // SWAP_SIMD
+
+void BaseFile::SwapArray16(uint16_t *values, size_t count)
+{
+    size_t i = 0;
+
+#ifdef SWAP_SIMD
+    i = swap_simd(values, count*sizeof(uint16_t), swap16_mask) / sizeof(uint16_t);
+#endif
+
+    for (; i < count; i++)
+        values[i] = re16(values[i]);
+}
+
+void BaseFile::SwapArray32(uint32_t *values, size_t count)
+{
+    size_t i = 0;
+
+#ifdef SWAP_SIMD
+    i = swap_simd(values, count*sizeof(uint32_t), swap32_mask) / sizeof(uint32_t);
+#endif
+
+    for (; i < count; i++)
+        values[i] = re32(values[i]);
+}
+
+void BaseFile::SwapArray64(uint64_t *values, size_t count)
+{
+    size_t i = 0;
+
+#ifdef SWAP_SIMD
+    i = swap_simd(values, count*sizeof(uint64_t), swap64_mask) / sizeof(uint64_t);
+#endif
+
+    for (; i < count; i++)
+        values[i] = re64(values[i]);
+}
+
+void BaseFile::val_array16(uint16_t *values, size_t count) const
+{
+    if (needs_swap())
+        SwapArray16(values, count);
+}
+
+void BaseFile::val_array32(uint32_t *values, size_t count) const
+{
+    if (needs_swap())
+        SwapArray32(values, count);
+}
+
+void BaseFile::val_array64(uint64_t *values, size_t count) const
+{
+    if (needs_swap())
+        SwapArray64(values, count);
+}
+
 uint8_t *BaseFile::GetOffsetPtr(const void *base, uint32_t offset, bool native) const
 {
 	if (native)
@@ -126,8 +296,13 @@ std::string BaseFile::GetString16AsUtf8(const void *base, uint32_t offset, bool
     if (offset == 0)
         return std::string();
 
-    std::u16string temp = (char16_t *)GetOffsetPtr(base, offset, native);
-    return Utils::Ucs2ToUtf8(temp);
+    const char16_t *str = (const char16_t *)GetOffsetPtr(base, offset, native);
+    size_t len = 0;
+
+    while (str[len] != 0)
+        len++;
+
+    return Utils::Ucs2ToUtf8(str, len);
 }
 
 uint32_t BaseFile::GetStringOffset(uint32_t str_base, const std::vector<std::string> &list, const std::string &str)
@@ -178,6 +353,36 @@ bool BaseFile::LoadFromFile(const std::string &path, bool show_error)
 	return ret;
 }
 
+bool BaseFile::LoadFromStream(Stream *s, uint64_t size)
+{
+    if (!s || size > (uint64_t)(size_t)-1)
+        return false;
+
+    MemoryStream *mem = dynamic_cast<MemoryStream *>(s);
+    if (mem)
+    {
+        uint8_t *buf;
+
+        if (!mem->FastRead(&buf, (size_t)size))
+            return false;
+
+        return Load(buf, (size_t)size);
+    }
+
+    uint8_t *buf = new uint8_t[size];
+
+    if (!s->Read(buf, (size_t)size))
+    {
+        delete[] buf;
+        return false;
+    }
+
+    bool ret = Load(buf, (size_t)size);
+    delete[] buf;
+
+    return ret;
+}
+
 bool BaseFile::SaveToFile(const std::string &path, bool show_error, bool build_path)
 {
     size_t size;
@@ -195,6 +400,49 @@ bool BaseFile::SaveToFile(const std::string &path, bool show_error, bool build_p
 
 bool BaseFile::DecompileToFile(const std::string &path, bool show_error, bool build_path)
 {
+    if (SupportsDecompileStream())
+    {
+        if (build_path && !Utils::CreatePath(path))
+        {
+            if (show_error)
+            {
+                DPRINTF("Cannot create path for file \"%s\"\n", path.c_str());
+            }
+
+            return false;
+        }
+
+        XmlWriter writer;
+
+        if (!writer.Open(path))
+        {
+            if (show_error)
+            {
+                DPRINTF("Cannot create/write file \"%s\"\n", path.c_str());
+            }
+
+            return false;
+        }
+
+        bool ret = DecompileStream(&writer);
+
+        if (!writer.Close() || !ret)
+        {
+            if (show_error)
+            {
+                if (ret)
+                    DPRINTF("Cannot create/write file \"%s\"\n", path.c_str());
+                else
+                    DPRINTF("Decompilation of file \"%s\" failed.\n", path.c_str());
+            }
+
+            Utils::RemoveFile(path);
+            return false;
+        }
+
+        return true;
+    }
+
 	TiXmlDocument *doc = Decompile();
 	
 	if (!doc)
@@ -233,6 +481,37 @@ bool BaseFile::DecompileToFile(const std::string &path, bool show_error, bool bu
 
 bool BaseFile::CompileFromFile(const std::string &path, bool show_error, bool big_endian)
 {
+    if (SupportsCompileFast())
+    {
+        XmlDocument doc;
+
+        if (!doc.LoadFile(path))
+        {
+            if (show_error)
+            {
+                if (doc.ErrorId() == TiXmlBase::TIXML_ERROR_OPENING_FILE)
+                {
+                    DPRINTF("Cannot open file \"%s\"\n", path.c_str());
+                }
+                else
+                {
+                    DPRINTF("Error parsing file \"%s\": %s. Row=%d, col=%d.\n", path.c_str(), doc.ErrorDesc(), doc.ErrorRow(), doc.ErrorCol());
+                }
+            }
+
+            return false;
+        }
+
+        bool ret = CompileFast(&doc, big_endian);
+
+        if (!ret && show_error)
+        {
+            DPRINTF("Compilation of file \"%s\" failed.\n", path.c_str());
+        }
+
+        return ret;
+    }
+
 	TiXmlDocument doc;
 	
 	if (!doc.LoadFile(path))
@@ -23,8 +23,17 @@
 #define CHECK_STRUCT_SIZE(c, s)	static_assert(sizeof(c) == s, "Incorrect structure size.")
 #define CHECK_FIELD_OFFSET(c, f, o)	static_assert(offsetof(c, f) == o, "Incorrect field offset.")
 
+class Stream;
+class Arena;
+class XmlDocument;
+class XmlWriter;
+
 class BaseFile
 {
+private:
+
+    Arena *arena; // Created on first use
+
 protected:
 	
 	bool big_endian;
@@ -36,6 +45,21 @@ protected:
 
     void copy_float(void *x, float val) const;
 
+    inline bool needs_swap() const
+    {
+#ifdef __BIG_ENDIAN__
+        return !big_endian;
+#else
+        return big_endian;
+#endif
+    }
+
+    // In-place versions of the above for whole arrays. No-op when the file endianess is the native one.
+    void val_array16(uint16_t *values, size_t count) const;
+    void val_array32(uint32_t *values, size_t count) const;
+    void val_array64(uint64_t *values, size_t count) const;
+    inline void val_array_float(float *values, size_t count) const { val_array32((uint32_t *)values, count); }
+
     static inline uint64_t re64(uint64_t val)
     {
 #ifdef __BIG_ENDIAN__
@@ -124,20 +148,48 @@ protected:
 
     uint32_t GetStringOffset(uint32_t str_base, const std::vector<std::string> &list, const std::string &str);
     void *WriteStringList(void *buf, const std::vector<std::string> &list);
+
+    // Per object arena for parsed data and scratch memory (see Arena.h). Whatever is allocated in it must be
+    // destroyed before RewindArena, usually at the start of Reset. Copies of the object don't share it.
+    Arena &GetArena();
+    void RewindArena();
 	
 public:
 	// Don't make any function abstract, instead let's provide an empty default implementation
 
-	virtual ~BaseFile() { }
+    BaseFile() : arena(nullptr) { }
+    BaseFile(const BaseFile &other) : arena(nullptr), big_endian(other.big_endian) { }
+	virtual ~BaseFile();
+
+    inline BaseFile &operator=(const BaseFile &other)
+    {
+        big_endian = other.big_endian;
+        return *this;
+    }
+
+    // Unconditional in-place byte swap of arrays, SIMD accelerated (SSSE3/AVX2, chosen at runtime) on x86.
+    static void SwapArray16(uint16_t *values, size_t count);
+    static void SwapArray32(uint32_t *values, size_t count);
+    static void SwapArray64(uint64_t *values, size_t count);
 
     inline bool IsBigEndian() { return big_endian; }
     inline void SetEndianess(bool big_endian) { this->big_endian = big_endian; }
 	
     virtual bool Load(const uint8_t *buf, size_t size) { UNUSED(buf); UNUSED(size); return false; }
 	virtual bool LoadFromFile(const std::string &path, bool show_error=true);
+    // Loads size bytes from the current position of the stream. The default implementation reads them into memory
+    // (or uses them in place for memory streams) and calls Load. Containers may override it to parse only their metadata.
+    virtual bool LoadFromStream(Stream *s, uint64_t size);
    	
     virtual TiXmlDocument *Decompile() const { return nullptr; }
     virtual bool Compile(TiXmlDocument *doc, bool big_endian=false) { UNUSED(doc); UNUSED(big_endian); return false; }
+    // Formats whose compiler works on the in-situ reader (XmlReader.h) override both, CompileFromFile then uses it
+    virtual bool CompileFast(const XmlDocument *doc, bool big_endian=false) { UNUSED(doc); UNUSED(big_endian); return false; }
+    virtual bool SupportsCompileFast() const { return false; }
+    // Formats that can write their xml forward only (XmlWriter.h) override both, DecompileToFile then streams it
+    // to the file instead of building the document in memory
+    virtual bool DecompileStream(XmlWriter *writer) const { UNUSED(writer); return false; }
+    virtual bool SupportsDecompileStream() const { return false; }
 	
 	virtual bool DecompileToFile(const std::string &path, bool show_error=true, bool build_path=false);		
 	virtual bool CompileFromFile(const std::string &path, bool show_error=true, bool big_endian=false);	
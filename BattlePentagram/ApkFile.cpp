@@ -1,7 +1,9 @@
 #include <map>
 #include <algorithm>
+#include <atomic>
 
 #include "ApkFile.h"
+#include "Thread.h"
 #include "debug.h"
 
 ApkFile::ApkFile()
@@ -23,6 +25,7 @@ void ApkFile::Reset()
         apk = nullptr;
     }
 
+    apk_path.clear();
     names.clear();
     files.clear();
     fshds.clear();
@@ -35,9 +38,12 @@ bool ApkFile::LoadFromFile(const std::string &path, bool show_error)
     Reset();
 
     apk = new FileStream("rb");
+    apk->SetBuffered();
     if (!apk->LoadFromFile(path, show_error))
         return false;
 
+    apk_path = path;
+
 
     ENDILTLEHeader header;
     if (!apk->Read(&header, sizeof(header)))
@@ -211,6 +217,8 @@ bool ApkFile::LoadFromFile(const std::string &path, bool show_error)
         apk->Seek((off64_t)pos, SEEK_SET);
     }
 
+    ComputeSlots();
+
     /*DPRINTF("-----\n");
     for (const Fshd &f : fshds)
     {
@@ -406,11 +414,15 @@ bool ApkFile::SaveToFile(const std::string &path, bool show_error, bool build_pa
     if (!apk)
         return false;
 
+    if (Utils::ToLowerCase(Utils::NormalizePath(path)) == Utils::ToLowerCase(Utils::NormalizePath(apk_path)) && CanSaveInPlace())
+        return SaveInPlace(show_error);
+
     std::string temp_path = path + ".tmp" + Utils::RandomString(5);
     if (!Utils::WriteFileBool(temp_path, (const uint8_t *)"0", 1, show_error, build_path)) // Write dummy file
         return false;
 
     FileStream *out = new FileStream();
+    out->SetBuffered();
 
     if (!out->LoadFromFile(temp_path, show_error))
         return SaveFailCleanup(out, temp_path);
@@ -656,6 +668,9 @@ bool ApkFile::SaveToFile(const std::string &path, bool show_error, bool build_pa
     if (!out->Write(&pheader, sizeof(pheader)))
         return SaveFailCleanup(out, temp_path);
 
+    if (!out->Close())
+        return SaveFailCleanup(out, temp_path);
+
     delete out;
     delete apk;
     apk = nullptr;
@@ -670,6 +685,254 @@ bool ApkFile::SaveToFile(const std::string &path, bool show_error, bool build_pa
     return LoadFromFile(path, show_error); // Reload, as some offsets have changed
 }
 
+bool ApkFile::CanSaveInPlace() const
+{
+    if (!apk)
+        return false;
+
+    for (const FileEntry &file : files)
+    {
+        if (file.buf && file.attributes != ATTRIBUTE_DIRECTORY)
+        {
+            uint64_t size = (file.attributes == ATTRIBUTE_COMPRESSED) ? file.comp_size : file.size;
+            if (size > file.slot_size)
+                return false;
+        }
+    }
+
+    for (const Fshd &fshd : fshds)
+    {
+        for (const FileEntry &file : fshd.files)
+        {
+            if (file.buf)
+            {
+                uint64_t size = (file.attributes == ATTRIBUTE_COMPRESSED) ? file.comp_size : file.size;
+                if (size > file.slot_size)
+                    return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+bool ApkFile::WriteInPlace(const FileEntry &file, uint64_t entry_offset, bool toc_entry)
+{
+    uint64_t size = (file.attributes == ATTRIBUTE_COMPRESSED) ? file.comp_size : file.size;
+
+    if (!apk->Seek((off64_t)file.file_offset, SEEK_SET))
+        return false;
+
+    if (!apk->Write(file.buf, (size_t)size))
+        return false;
+
+    // Zero the rest of the old slot, like the padding of a freshly built apk
+    static const uint8_t zero[0x200] = { 0 };
+
+    for (uint64_t rem = file.slot_size - size; rem > 0; )
+    {
+        size_t w = (rem > sizeof(zero)) ? sizeof(zero) : (size_t)rem;
+        if (!apk->Write(zero, w))
+            return false;
+
+        rem -= w;
+    }
+
+    if (!apk->Seek((off64_t)entry_offset, SEEK_SET))
+        return false;
+
+    if (toc_entry)
+    {
+        TOCEntry entry;
+
+        if (!apk->Read(&entry, sizeof(entry)))
+            return false;
+
+        entry.size = file.size;
+        entry.comp_size = file.comp_size;
+
+        if (!apk->Seek((off64_t)entry_offset, SEEK_SET) || !apk->Write(&entry, sizeof(entry)))
+            return false;
+    }
+    else
+    {
+        FSHDEntry entry;
+
+        if (!apk->Read(&entry, sizeof(entry)))
+            return false;
+
+        entry.size = file.size;
+        entry.comp_size = file.comp_size;
+
+        if (!apk->Seek((off64_t)entry_offset, SEEK_SET) || !apk->Write(&entry, sizeof(entry)))
+            return false;
+    }
+
+    return true;
+}
+
+bool ApkFile::SaveInPlace(bool show_error)
+{
+    if (!CanSaveInPlace())
+    {
+        if (show_error)
+        {
+            DPRINTF("%s: Some replaced file doesn't fit in its old slot.\n", FUNCNAME);
+        }
+
+        return false;
+    }
+
+    if (!apk->Reopen("r+b"))
+    {
+        if (show_error)
+        {
+            DPRINTF("%s: Cannot reopen \"%s\" for writing.\n", FUNCNAME, apk_path.c_str());
+        }
+
+        apk->Reopen("rb");
+        return false;
+    }
+
+    bool ret = true;
+    const uint64_t toc_entries_offset = sizeof(ENDILTLEHeader) + sizeof(PACKHEDRHeader) + sizeof(PACKTOCHeader);
+
+    for (size_t i = 0; ret && i < files.size(); i++)
+    {
+        const FileEntry &file = files[i];
+
+        if (file.buf && file.attributes != ATTRIBUTE_DIRECTORY)
+            ret = WriteInPlace(file, toc_entries_offset + i*sizeof(TOCEntry), true);
+    }
+
+    for (size_t i = 0; ret && i < fshds.size(); i++)
+    {
+        const Fshd &fshd = fshds[i];
+        const uint64_t fshd_entries_offset = fshd.offset + sizeof(ENDILTLEHeader) + sizeof(PACKFSHDHeader);
+        bool modified = false;
+
+        for (size_t j = 0; ret && j < fshd.files.size(); j++)
+        {
+            const FileEntry &file = fshd.files[j];
+
+            if (file.buf)
+            {
+                ret = WriteInPlace(file, fshd_entries_offset + j*sizeof(FSHDEntry), false);
+                modified = true;
+            }
+        }
+
+        if (!ret || !modified)
+            continue;
+
+        // The fshd keeps its size, but its md5 in the fsls entry must be updated
+        uint8_t md5[0x10];
+        uint8_t *buf = new uint8_t[fshd.size];
+
+        ret = (apk->Seek((off64_t)fshd.offset, SEEK_SET) && apk->Read(buf, (size_t)fshd.size));
+        if (ret)
+        {
+            Utils::Md5(buf, (uint32_t)fshd.size, md5);
+
+            uint64_t md5_offset = gfsls_offset + sizeof(PACKFSLSHeader) + i*sizeof(FSLSEntry) + offsetof(FSLSEntry, md5);
+            ret = (apk->Seek((off64_t)md5_offset, SEEK_SET) && apk->Write(md5, sizeof(md5)));
+        }
+
+        delete[] buf;
+    }
+
+    if (!apk->Reopen("rb"))
+        ret = false;
+
+    if (!ret)
+    {
+        if (show_error)
+        {
+            DPRINTF("%s: Failed to patch \"%s\", the file may be corrupted.\n", FUNCNAME, apk_path.c_str());
+        }
+
+        return false;
+    }
+
+    // The data is now in the apk
+    for (FileEntry &file : files)
+    {
+        if (file.buf)
+        {
+            delete[] file.buf;
+            file.buf = nullptr;
+        }
+    }
+
+    for (Fshd &fshd : fshds)
+    {
+        for (FileEntry &file : fshd.files)
+        {
+            if (file.buf)
+            {
+                delete[] file.buf;
+                file.buf = nullptr;
+            }
+        }
+    }
+
+    return true;
+}
+
+void ApkFile::ComputeSlots()
+{
+    // A file can grow up to the start of whatever comes next in the apk (next file, next fshd or eof)
+    std::vector<uint64_t> starts;
+
+    for (const FileEntry &file : files)
+    {
+        if (file.attributes != ATTRIBUTE_DIRECTORY)
+            starts.push_back(file.file_offset);
+    }
+
+    for (const Fshd &fshd : fshds)
+    {
+        starts.push_back(fshd.offset);
+
+        for (const FileEntry &file : fshd.files)
+            starts.push_back(file.file_offset);
+    }
+
+    std::sort(starts.begin(), starts.end());
+    const uint64_t apk_size = apk->GetSize();
+
+    // limit: end of the region the file must stay in
+    auto compute = [&starts](FileEntry &file, uint64_t limit)
+    {
+        auto range = std::equal_range(starts.begin(), starts.end(), file.file_offset);
+
+        // Files sharing their offset with something else (empty files) can't be replaced in place
+        if (range.second - range.first > 1 || file.file_offset >= limit)
+        {
+            file.slot_size = 0;
+        }
+        else
+        {
+            uint64_t end = (range.second == starts.end()) ? limit : *range.second;
+            file.slot_size = ((end < limit) ? end : limit) - file.file_offset;
+        }
+    };
+
+    for (FileEntry &file : files)
+    {
+        if (file.attributes != ATTRIBUTE_DIRECTORY)
+            compute(file, apk_size);
+    }
+
+    // The files of a fshd can't grow into the alignment padding after it: the size and md5 of its
+    // fsls entry only cover fshd.size, and they are left as they are by SaveInPlace
+    for (Fshd &fshd : fshds)
+    {
+        for (FileEntry &file : fshd.files)
+            compute(file, fshd.offset + fshd.size);
+    }
+}
+
 bool ApkFile::ReadStrings(uint64_t offset, std::vector<std::string> &strings, bool show_error)
 {
     if (!apk->Seek((off64_t)offset, SEEK_SET))
@@ -804,6 +1067,8 @@ bool ApkFile::ReadFshd(const FSLSEntry &entry, Fshd &fshd, bool show_error)
     //DPRINTF("%s\n", names[entry.name_idx].c_str());
     fshd.name = names[entry.name_idx];
     fshd.pack_idx = entry.pack_idx;
+    fshd.offset = entry.offset;
+    fshd.size = entry.size;
 
     if (!apk->Seek((off64_t)entry.offset, SEEK_SET))
     {
@@ -892,9 +1157,9 @@ bool ApkFile::ReadFshd(const FSLSEntry &entry, Fshd &fshd, bool show_error)
     return true;
 }
 
-bool ApkFile::ExtractFile(const FileEntry &file, const std::string &dir_path, const std::string &fshd_name, const std::string &filter) const
+bool ApkFile::ExtractFile(FileStream *stream, const FileEntry &file, const std::string &dir_path, const std::string &fshd_name, const std::string &filter) const
 {
-    if (!apk)
+    if (!stream)
         return false;
 
     std::string out_path;
@@ -924,14 +1189,14 @@ bool ApkFile::ExtractFile(const FileEntry &file, const std::string &dir_path, co
         uint8_t *buf = file.buf;
         if (!buf)
         {
-            if (!apk->Seek((off64_t)file.file_offset, SEEK_SET))
+            if (!stream->Seek((off64_t)file.file_offset, SEEK_SET))
             {
                 DPRINTF("%s: Failed to seek (file %s).\n", FUNCNAME, file.path.c_str());
                 return false;
             }
 
             buf = new uint8_t[file.comp_size];
-            if (!apk->Read(buf, (size_t)file.comp_size))
+            if (!stream->Read(buf, (size_t)file.comp_size))
             {
                 DPRINTF("%s: Failed to read file %s.\n", FUNCNAME, file.path.c_str());
                 delete[] buf;
@@ -965,14 +1230,14 @@ bool ApkFile::ExtractFile(const FileEntry &file, const std::string &dir_path, co
         uint8_t *buf = file.buf;
         if (!buf)
         {
-            if (!apk->Seek((off64_t)file.file_offset, SEEK_SET))
+            if (!stream->Seek((off64_t)file.file_offset, SEEK_SET))
             {
                 DPRINTF("%s: Failed to seek (file %s).\n", FUNCNAME, file.path.c_str());
                 return false;
             }
 
             buf = new uint8_t[file.size];
-            if (!apk->Read(buf, (size_t)file.size))
+            if (!stream->Read(buf, (size_t)file.size))
             {
                 DPRINTF("%s: Failed to read file %s.\n", FUNCNAME, file.path.c_str());
                 delete[] buf;
@@ -1022,24 +1287,125 @@ bool ApkFile::DoReplaceFile(FileEntry &file, const uint8_t *buf, size_t size)
     return true;
 }
 
-bool ApkFile::Extract(const std::string &dir_path, const std::string &filter) const
+struct ApkExtractJob
+{
+    const FileEntry *file;
+    const std::string *fshd_name;
+};
+
+class ApkExtractor : public Runnable
+{
+private:
+
+    const ApkFile *apk;
+    const std::string &apk_path;
+    const std::vector<ApkExtractJob> &jobs;
+    const std::string &dir_path;
+    const std::string &filter;
+    std::atomic<size_t> *next;
+    std::atomic<bool> *error;
+
+public:
+
+    ApkExtractor(const ApkFile *apk, const std::string &apk_path, const std::vector<ApkExtractJob> &jobs, const std::string &dir_path,
+                 const std::string &filter, std::atomic<size_t> *next, std::atomic<bool> *error) :
+        apk(apk), apk_path(apk_path), jobs(jobs), dir_path(dir_path), filter(filter), next(next), error(error)
+    {
+    }
+
+    virtual uint32_t Run() override
+    {
+        // Own handle, the apk one can't be shared between threads
+        FileStream stream("rb");
+        stream.SetBuffered();
+
+        if (!stream.LoadFromFile(apk_path))
+        {
+            *error = true;
+            return (uint32_t)-1;
+        }
+
+        while (!*error)
+        {
+            size_t idx = next->fetch_add(1);
+            if (idx >= jobs.size())
+                break;
+
+            const ApkExtractJob &job = jobs[idx];
+
+            if (!apk->ExtractFile(&stream, *job.file, dir_path, *job.fshd_name, filter))
+            {
+                *error = true;
+                return (uint32_t)-1;
+            }
+        }
+
+        return 0;
+    }
+};
+
+bool ApkFile::Extract(const std::string &dir_path, const std::string &filter, int max_threads) const
 {
+    static const std::string no_fshd;
+    std::vector<ApkExtractJob> jobs;
+
+    // Directories first and serially, as they must exist in order
     for (const FileEntry &file : files)
     {
-        if (!ExtractFile(file, dir_path, "", filter))
-            return false;
+        if (file.attributes == ATTRIBUTE_DIRECTORY)
+        {
+            if (!ExtractFile(apk, file, dir_path, no_fshd, filter))
+                return false;
+        }
+        else
+        {
+            jobs.push_back({ &file, &no_fshd });
+        }
     }
 
     for (const Fshd &fshd : fshds)
     {
         for (const FileEntry &file : fshd.files)
         {
-            if (!ExtractFile(file, dir_path, fshd.name, filter))
+            jobs.push_back({ &file, &fshd.name });
+        }
+    }
+
+    if (jobs.size() == 0)
+        return true;
+
+    if (max_threads <= 0)
+        max_threads = Thread::LogicalCoresCount();
+
+    if ((size_t)max_threads > jobs.size())
+        max_threads = (int)jobs.size();
+
+    if (max_threads == 1)
+    {
+        for (const ApkExtractJob &job : jobs)
+        {
+            if (!ExtractFile(apk, *job.file, dir_path, *job.fshd_name, filter))
                 return false;
         }
+
+        return true;
     }
 
-    return true;
+    std::atomic<size_t> next(0);
+    std::atomic<bool> error(false);
+
+    {
+        ThreadPool pool(max_threads);
+
+        for (int i = 0; i < max_threads; i++)
+        {
+            pool.AddWork(new ApkExtractor(this, apk_path, jobs, dir_path, filter, &next, &error));
+        }
+
+        pool.Wait();
+    }
+
+    return !error;
 }
 
 uint8_t *ApkFile::Extract(const std::string &file_path, size_t *psize) const
@@ -227,11 +227,13 @@ struct FileEntry
     uint32_t file_idx_start; // For folders only
     uint32_t num_files; // For folders only
     uint8_t *buf; // For replacing
+    uint64_t slot_size; // Space available at file_offset for in-place replacing
 
     FileEntry()
     {
         buf = nullptr;
         pack_idx = 0;
+        slot_size = 0;
     }
 
     ~FileEntry()
@@ -250,6 +252,8 @@ struct Fshd
     std::vector<std::string> names;
     std::vector<FileEntry> files;
     uint32_t pack_idx;
+    uint64_t offset; // As in the fsls entry
+    uint64_t size;
 };
 
 #include "IdxFile.h"
@@ -257,10 +261,12 @@ struct Fshd
 class ApkFile : BaseFile
 {
     friend class IdxFile;
+    friend class ApkExtractor;
 
 private:
 
     FileStream *apk;
+    std::string apk_path;
     uint32_t pack_idx;
     uint8_t checksum[0x10]; // Until what the checksum hashes and which kind of checksum is, let's just copy it here
 
@@ -274,9 +280,13 @@ private:
     bool BuildPath(size_t idx, const std::string &path, std::vector<bool> &build);
     bool BuildPaths();
     bool ReadFshd(const FSLSEntry &entry, Fshd &fshd, bool show_error);
-    bool ExtractFile(const FileEntry &file, const std::string &dir_path, const std::string &fshd_name, const std::string &filter) const;
+    void ComputeSlots();
+    bool ExtractFile(FileStream *stream, const FileEntry &file, const std::string &dir_path, const std::string &fshd_name, const std::string &filter) const;
     bool DoReplaceFile(FileEntry &file, const uint8_t *buf, size_t size);
 
+    bool CanSaveInPlace() const;
+    bool WriteInPlace(const FileEntry &file, uint64_t entry_offset, bool toc_entry);
+
     bool SaveFailCleanup(FileStream *stream, const std::string &temp_file);
     static void BuildNamesTable(const std::vector<std::string> &names, std::unordered_map<std::string, uint64_t> &table);
     static bool WriteNamesTable(FileStream *out, const std::vector<std::string> &names, const std::unordered_map<std::string,uint64_t> &table);
@@ -294,12 +304,18 @@ public:
     virtual bool LoadFromFile(const std::string &path, bool show_error=true) override;
     virtual bool SaveToFile(const std::string &path, bool show_error=true, bool build_path=false) override;
 
-    bool Extract(const std::string &dir_path, const std::string &filter="") const;
+    // max_threads <= 0: use the number of logical cores. Every worker uses its own read handle
+    bool Extract(const std::string &dir_path, const std::string &filter="", int max_threads=0) const;
     uint8_t *Extract(const std::string &file_path, size_t *psize) const;
 
     bool Replace(const std::string &path, const uint8_t *buf, size_t size);
     bool Replace(const std::string &path, const std::string &src_path);
 
+    // Writes the replaced files over their old data in the loaded apk and only patches the affected
+    // toc/fshd entries and fsls md5s, instead of rewriting the whole package. Only possible if every
+    // replaced file fits in its old slot; SaveToFile to the loaded path uses it automatically when it is.
+    bool SaveInPlace(bool show_error=true);
+
     bool VisitFiles(bool (* visitor)(const std::string &path, void *custom_param1, void *custom_param2, void *custom_param3), const std::string &filter="", void *custom_param1=nullptr, void *custom_param2=nullptr, void *custom_param3=nullptr) const;
 
     void DebugDumpOffsets();
@@ -0,0 +1,16 @@
+#ifndef __CPUFEATURES_H__
+#define __CPUFEATURES_H__
+
+// The cpu feature queries of Utils (implemented in UtilsMisc.cpp), for code that shouldn't pull Utils.h and windows.h
+
+namespace Utils
+{
+    // Runtime cpu features detection, always false on non x86 builds
+    bool CpuHasSsse3();
+    bool CpuHasAvx2();
+    bool CpuHasAesNi();
+    bool CpuHasVaes();
+    bool CpuHasShaNi();
+}
+
+#endif /* __CPUFEATURES_H__ */
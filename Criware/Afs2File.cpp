@@ -1,6 +1,7 @@
 #include "Afs2File.h"
 #include "CpkFile.h"
 #include "HcaFile.h"
+#include "Stream.h"
 #include "debug.h"
 
 #define COPY_BUF_SIZE	(16*1024*1024)
@@ -9,6 +10,8 @@ Afs2File::Afs2File()
 {
 	big_endian = false;
 	r_handle = nullptr;
+	r_stream = nullptr;
+	r_stream_start = 0;
 	
 	version[0] = 1;
 	version[1] = 4;
@@ -31,6 +34,9 @@ void Afs2File::Reset()
 		r_handle = nullptr;
 	}
 	
+	r_stream = nullptr;
+	r_stream_start = 0;
+	
 	memset(version, 0, sizeof(version));
 	alignment = 0;
 	
@@ -267,6 +273,55 @@ void Afs2File::PadFile(FILE *file)
     }
 }
 
+bool Afs2File::ReadInternal(uint32_t offset, void *buf, size_t size) const
+{
+	if (r_handle)
+	{
+		fseek(r_handle, offset, SEEK_SET);
+		return DoCopyFile(r_handle, (uint8_t *)buf, size);
+	}
+	
+	assert(r_stream != nullptr);
+	
+	if (!r_stream->Seek((off64_t)(r_stream_start + offset), SEEK_SET))
+		return false;
+	
+	return r_stream->Read(buf, size);
+}
+
+bool Afs2File::CopyInternal(uint32_t offset, FILE *dst, size_t size) const
+{
+	if (r_handle)
+	{
+		fseek(r_handle, offset, SEEK_SET);
+		return DoCopyFile(r_handle, dst, size);
+	}
+	
+	assert(r_stream != nullptr);
+	
+	if (!r_stream->Seek((off64_t)(r_stream_start + offset), SEEK_SET))
+		return false;
+	
+	size_t copy_size = (size < COPY_BUF_SIZE) ? size : COPY_BUF_SIZE;
+	uint8_t *copy_buf = new uint8_t[copy_size];
+	
+	while (size > 0)
+	{
+		size_t n = (size < copy_size) ? size : copy_size;
+		
+		if (!r_stream->Read(copy_buf, n) || fwrite(copy_buf, 1, n, dst) != n)
+		{
+			delete[] copy_buf;
+			return false;
+		}
+		
+		size -= n;
+	}
+	
+	delete[] copy_buf;
+	return true;
+}
+
 bool Afs2File::Load(const uint8_t *buf, size_t size)
 {
 	AFS2Header *header;
@@ -409,6 +464,74 @@ bool Afs2File::LoadFromFile(const std::string &path, bool show_error)
 	return true;
 }
 
+bool Afs2File::LoadFromStream(Stream *s, uint64_t size)
+{
+	AFS2Header header;
+	unsigned int offsets_size, total_header_size;
+	std::vector<uint8_t> offsets_buf;
+	std::vector<uint32_t> offsets;
+	std::vector<uint32_t> sizes;
+	
+	Reset();
+	
+	uint64_t start = s->Tell();
+	
+	if (size < sizeof(AFS2Header) || !s->Read(&header, sizeof(header)) || header.signature != AFS2_SIGNATURE)
+		return false;
+	
+	memcpy(version, header.version, sizeof(version));
+	alignment = header.alignment;
+	
+	if (version[1] == 2)
+	{
+		offsets_size = (header.num_files+1) * sizeof(uint16_t);
+	}
+	else
+	{
+		offsets_size = (header.num_files+1) * sizeof(uint32_t);
+	}
+	
+	total_header_size = sizeof(AFS2Header) + (header.num_files*2) + offsets_size;
+	if (size < total_header_size)
+	{
+		Reset();
+		return false;
+	}
+	
+	offsets_buf.resize(offsets_size);
+	
+	if (!s->Seek(header.num_files*2, SEEK_CUR) || !s->Read(offsets_buf.data(), offsets_size))
+	{
+		Reset();
+		return false;
+	}
+	
+	offsets.resize(header.num_files);
+	sizes.resize(header.num_files);
+	
+	GetOffsetsAndSizes(offsets_buf.data(), offsets, sizes);
+	files.resize(header.num_files);
+	
+	for (size_t i = 0; i < files.size(); i++)
+	{
+		if ((uint64_t)offsets[i]+sizes[i] > size)
+		{
+			DPRINTF("%s: File out of bounds.\n", FUNCNAME);
+			Reset();
+			return false;
+		}
+		
+		files[i].offset = offsets[i];
+		files[i].size = sizes[i];
+	}
+	
+	r_stream = s;
+	r_stream_start = start;
+	
+	s->Seek((off64_t)(start + size), SEEK_SET);
+	return true;
+}
+
 uint8_t *Afs2File::Save(size_t *psize)
 {
 	uint8_t *buf;
@@ -468,12 +591,8 @@ uint8_t *Afs2File::Save(size_t *psize)
 		
 		if (entry.offset != (uint32_t)-1)
 		{
-			// Internal file in r_handle
-			
-			assert(r_handle != nullptr);			
-			fseek(r_handle, entry.offset, SEEK_SET);	
-			
-            if (!DoCopyFile(r_handle, buf+offset, entry.size))
+			// Internal file
+            if (!ReadInternal(entry.offset, buf+offset, entry.size))
 			{
                 DPRINTF("%s: DoCopyFile file mem failed.\n", FUNCNAME);
 				
@@ -611,12 +730,8 @@ bool Afs2File::SaveToFile(const std::string &path, bool show_error, bool build_p
 		
 		if (entry.offset != (uint32_t)-1)
 		{
-			// Internal file in r_handle
-			
-			assert(r_handle != nullptr);			
-			fseek(r_handle, entry.offset, SEEK_SET);	
-			
-            if (!DoCopyFile(r_handle, w_handle, entry.size))
+			// Internal file
+            if (!CopyInternal(entry.offset, w_handle, entry.size))
 			{
 				if (show_error)
 				{
@@ -733,10 +848,7 @@ std::string Afs2File::ChooseFileName(uint32_t idx, uint32_t file_size) const
 
     if (entry.offset != (uint32_t)-1)
     {
-        assert(r_handle);
-        fseek(r_handle, entry.offset, SEEK_SET);
-
-        fread(&signature, 1, sizeof(uint32_t), r_handle);
+        ReadInternal(entry.offset, &signature, sizeof(uint32_t));
     }
     else if (entry.buf)
     {
@@ -791,12 +903,8 @@ bool Afs2File::ExtractFile(uint32_t idx, const std::string &path, bool auto_path
 	
 	if (entry.offset != (uint32_t)-1)
 	{
-		// Internal file in r_handle
-		
-		assert(r_handle != nullptr);			
-		fseek(r_handle, entry.offset, SEEK_SET);	
-		
-        if (!DoCopyFile(r_handle, out, size))
+		// Internal file
+        if (!CopyInternal(entry.offset, out, size))
 		{			
 			fclose(out);
 			return false;
@@ -852,12 +960,8 @@ uint8_t *Afs2File::ExtractFile(uint32_t idx, uint64_t *psize) const
 	
 	if (entry.offset != (uint32_t)-1)
 	{
-		// Internal file in r_handle
-		
-		assert(r_handle != nullptr);			
-		fseek(r_handle, entry.offset, SEEK_SET);	
-		
-        if (!DoCopyFile(r_handle, buf, *psize))
+		// Internal file
+        if (!ReadInternal(entry.offset, buf, *psize))
 		{			
 			delete[] buf;
 			return nullptr;
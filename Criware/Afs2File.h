@@ -89,6 +89,10 @@ private:
 
 	FILE *r_handle;	
 	
+	// Set by LoadFromStream instead of r_handle. Not owned, must outlive this object.
+	Stream *r_stream;
+	uint64_t r_stream_start;
+	
 	uint8_t version[4];
 	uint32_t alignment;
 	
@@ -106,6 +110,9 @@ private:
 	
 	static bool GetEntrySize(const Afs2Entry &entry, uint32_t *psize);
 	void PadFile(FILE *file);
+	
+	bool ReadInternal(uint32_t offset, void *buf, size_t size) const;
+	bool CopyInternal(uint32_t offset, FILE *dst, size_t size) const;
 
     std::string ChooseFileName(uint32_t idx, uint32_t file_size) const;
 	
@@ -147,6 +154,10 @@ public:
 	virtual bool LoadFromFile(const std::string &path, bool show_error=true) override;
 	virtual bool SaveToFile(const std::string &path, bool show_error=true, bool build_path=false) override;
 	
+	// Only the header and offsets are read, the files are read from the stream when needed.
+	// The stream is not owned, it must stay alive as long as this object uses it.
+	virtual bool LoadFromStream(Stream *s, uint64_t size) override;
+	
     virtual uint8_t *CreateHeader(unsigned int *psize, bool extra_word=true) override;
 	
     virtual uint32_t GetNumFiles() const override { return (uint32_t)files.size(); }
@@ -1112,12 +1112,33 @@ bool CpkFile::ExtractCommon(const CpkEntry &entry, Stream *stream, uint32_t size
         // Internal file
         assert(fstream);
 
+        if (entry.compressed_size != 0)
+        {
+            // Only the read needs the file position, decompression may run in parallel with other extractions
+            uint8_t *compressed = new uint8_t[entry.compressed_size];
+
+            {
+                MutexLocker lock(&mutex);
+
+                if (!fstream->Seek(entry.offset, SEEK_SET) || !fstream->Read(compressed, entry.compressed_size))
+                {
+                    delete[] compressed;
+                    return false;
+                }
+            }
+
+            FixedMemoryStream input(compressed, entry.compressed_size);
+            bool ret = ExtractCrylaila(&input, stream, entry.compressed_size, size);
+
+            delete[] compressed;
+            return ret;
+        }
+
+        MutexLocker lock(&mutex);
+
         if (!fstream->Seek(entry.offset, SEEK_SET))
             return false;
 
-        if (entry.compressed_size != 0)
-            return ExtractCrylaila(fstream, stream, entry.compressed_size, size);
-
         if (!stream->Copy(fstream, size))
         {
             //DPRINTF("Failed here. Offset: %I64x size: %x\n", entry.offset, size);
@@ -1175,9 +1196,10 @@ std::string CpkFile::GetPath(uint32_t idx, uint32_t file_size) const
     if (entry.offset != (uint64_t)-1)
     {
         assert(fstream);
-        fstream->Seek(entry.offset, SEEK_SET);
+        MutexLocker lock(&mutex);
 
-        fstream->Read32(&signature);
+        if (!fstream->Seek(entry.offset, SEEK_SET) || !fstream->Read32(&signature))
+            return default_return;
     }
     else if (entry.buf)
     {
@@ -1288,6 +1310,8 @@ uint32_t CpkFile::FindEntryByPath(const std::string &path) const
 
 bool CpkFile::FileExists(const std::string &path) const
 {
+    MutexLocker lock(&mutex);
+
     if (!cache_built)
     {
         for (size_t i = 0; i < entries.size(); i++)
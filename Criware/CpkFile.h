@@ -5,6 +5,7 @@
 #include "AwbFile.h"
 #include "UtfFile.h"
 #include "FileStream.h"
+#include "Mutex.h"
 
 // "CPK "
 #define CPK_SIGNATURE	0x204B5043
@@ -181,6 +182,9 @@ private:
 
     std::vector<CpkEntry> entries;
 
+    // Guards the position of fstream and the fileexists cache, so that files can be extracted from several threads
+    mutable Mutex mutex;
+
     // For fileexists cache
     mutable bool cache_built = false;
     mutable std::unordered_set<std::string> cache;
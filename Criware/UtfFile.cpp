@@ -1,8 +1,39 @@
-#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
 
 #include "UtfFile.h"
+#include "Arena.h"
 #include "debug.h"
 
+// The string tables built while saving go in a local arena of this block size
+#define UTF_SCRATCH_BLOCK_SIZE  (16*1024)
+
+struct CStrHash
+{
+    size_t operator()(const char *str) const
+    {
+        // FNV-1a
+        size_t h = (size_t)2166136261U;
+
+        while (*str)
+        {
+            h ^= (uint8_t)*str++;
+            h *= (size_t)16777619U;
+        }
+
+        return h;
+    }
+};
+
+struct CStrEqual
+{
+    bool operator()(const char *a, const char *b) const { return strcmp(a, b) == 0; }
+};
+
+// Strings of a table by content, for deduplication. The pointed strings are owned by someone else.
+typedef std::unordered_set<const char *, CStrHash, CStrEqual, ArenaAllocator<const char *>> UtfStringsSet;
+typedef std::unordered_map<const char *, uint32_t, CStrHash, CStrEqual, ArenaAllocator<std::pair<const char * const, uint32_t>>> UtfStringsMap;
+
 UtfFile::UtfFile()
 {
 	big_endian = true;
@@ -52,8 +83,16 @@ bool UtfFile::Load(const uint8_t *buf, size_t size)
 	uint8_t *data = GetOffsetPtr(table_hdr, table_hdr->data_offset);
 
 	uint8_t *col_ptr = GetOffsetPtr(table_hdr, sizeof(UTFTableHeader), true);
+	uint16_t num_columns = val16(table_hdr->num_columns);
+	uint32_t num_rows = val32(table_hdr->num_rows);
+
+	// Values are moved into their final place, so that strings and blobs are allocated once
+	columns.reserve(num_columns);
 
-	for (uint16_t i = 0; i < val16(table_hdr->num_columns); i++)
+	if ((uint64_t)num_rows * val16(table_hdr->row_length) <= size)
+		rows.reserve(num_rows);
+
+	for (uint16_t i = 0; i < num_columns; i++)
 	{
 		UtfColumn col;
 
@@ -147,17 +186,18 @@ bool UtfFile::Load(const uint8_t *buf, size_t size)
 			}
 		}
 
-		columns.push_back(col);
+		columns.push_back(std::move(col));
 	}
 
-	for (uint32_t j = 0; j < val32(table_hdr->num_rows); j++)
+	for (uint32_t j = 0; j < num_rows; j++)
 	{
 		UtfRow current_row;
 		uint8_t *row_ptr = GetOffsetPtr(table_hdr, val16(table_hdr->rows_offset) + j*val16(table_hdr->row_length), true);
 
 		//DPRINTF("ptr: %x\n", Utils::DifPointer(row_ptr, table_hdr));
+		current_row.values.reserve(num_columns);
 
-		for (uint16_t i = 0; i < val16(table_hdr->num_columns); i++)
+		for (uint16_t i = 0; i < num_columns; i++)
 		{
 			UtfValue current_value;
 
@@ -165,19 +205,19 @@ bool UtfFile::Load(const uint8_t *buf, size_t size)
 
 			if (storage_flag == STORAGE_NONE) // 0x00
 			{
-				current_row.values.push_back(current_value);
+				current_row.values.push_back(std::move(current_value));
 				continue;
 			}
 
 			if (storage_flag == STORAGE_ZERO) // 0x10
 			{
-				current_row.values.push_back(current_value);
+				current_row.values.push_back(std::move(current_value));
 				continue;
 			}
 
 			if (storage_flag == STORAGE_CONSTANT) // 0x30
 			{
-				current_row.values.push_back(current_value);
+				current_row.values.push_back(std::move(current_value));
 				continue;
 			}
 
@@ -251,10 +291,10 @@ bool UtfFile::Load(const uint8_t *buf, size_t size)
 					return false;
 			}
 
-			current_row.values.push_back(current_value);
+			current_row.values.push_back(std::move(current_value));
 		}
 
-		rows.push_back(current_row);
+		rows.push_back(std::move(current_row));
 	}
 
     if (strings && strcmp(strings, "<NULL>") == 0)
@@ -356,14 +396,16 @@ uint16_t UtfFile::CalculateRowLength() const
 
 size_t UtfFile::CalculateStringsSize() const
 {
-    std::vector<std::string> strings_list;
+    // Local, so that const objects can be saved from several threads at once
+    Arena arena(UTF_SCRATCH_BLOCK_SIZE);
+    UtfStringsSet strings_set(columns.size() + 16, CStrHash(), CStrEqual(), &arena);
     size_t strings_size = table_name.length() + 1;
 
-    strings_list.push_back(table_name);
+    strings_set.insert(table_name.c_str());
 
     if (add_null)
     {
-        strings_list.push_back("<NULL>");
+        strings_set.insert("<NULL>");
         strings_size += 7;
     }
 
@@ -378,9 +420,8 @@ size_t UtfFile::CalculateStringsSize() const
 
         if (storage_flag == STORAGE_CONSTANT && ctype == TYPE_STRING)
         {
-            if (std::find(strings_list.begin(), strings_list.end(), col.constant_str) == strings_list.end())
+            if (strings_set.insert(col.constant_str.c_str()).second)
             {
-                strings_list.push_back(col.constant_str);
                 strings_size += col.constant_str.length() + 1;
             }
         }
@@ -392,9 +433,8 @@ size_t UtfFile::CalculateStringsSize() const
 		{
 			if (data.type == TYPE_STRING)
             {
-                if (std::find(strings_list.begin(), strings_list.end(), data.str) == strings_list.end())
+                if (strings_set.insert(data.str.c_str()).second)
                 {
-                    strings_list.push_back(data.str);
                     strings_size += data.str.length() + 1;
                 }
 			}
@@ -710,21 +750,6 @@ void UtfFile::DebugDump() const
     }
 }
 
-char *UtfFile::FindString(char *strings_list, const char *str, char *end)
-{
-    char *ptr = strings_list;
-
-    while (ptr < end)
-    {
-        if (strcmp(ptr, str) == 0)
-            return ptr;
-
-        ptr += strlen(ptr)+1;
-    }
-
-    return nullptr;
-}
-
 uint8_t *UtfFile::Save(size_t *psize)
 {
     size_t file_size;
@@ -808,12 +833,15 @@ uint8_t *UtfFile::Save(size_t *psize)
     table_hdr->strings_offset = val32(offset - sizeof(UTFHeader));
 	str_ptr = (char *)GetOffsetPtr(buf, offset, true);
 
-    char *str_top = str_ptr;
+    // Every string written so far (column names included), to the offset of its first occurrence
+    Arena arena(UTF_SCRATCH_BLOCK_SIZE);
+    UtfStringsMap written_strings(columns.size()*2 + 16, CStrHash(), CStrEqual(), &arena);
 
 	if (!add_null)
     {
         strcpy(str_ptr, table_name.c_str());
         table_hdr->table_name = 0;
+        written_strings.emplace(str_ptr, 0);
 
         str_offset = (uint32_t)table_name.length() + 1;
     }
@@ -822,6 +850,8 @@ uint8_t *UtfFile::Save(size_t *psize)
         strcpy(str_ptr, "<NULL>");
         strcpy(str_ptr+7, table_name.c_str());
         table_hdr->table_name = val32(7);
+        written_strings.emplace(str_ptr, 0);
+        written_strings.emplace(str_ptr+7, 7);
 
         str_offset = (uint32_t)table_name.length() + 8;
     }
@@ -836,16 +866,17 @@ uint8_t *UtfFile::Save(size_t *psize)
 
         if (storage_flag == STORAGE_CONSTANT && ctype == TYPE_STRING)
         {
-            str_ptr =  (char *)GetOffsetPtr(buf, offset+str_offset, true);
-            char *existing_string = FindString(str_top, col.constant_str.c_str(), str_ptr);
+            auto it = written_strings.find(col.constant_str.c_str());
 
-            if (existing_string)
+            if (it != written_strings.end())
             {
-                cstring_offset = Utils::DifPointer(existing_string, str_top);
+                cstring_offset = it->second;
             }
             else
             {
+                str_ptr =  (char *)GetOffsetPtr(buf, offset+str_offset, true);
                 strcpy(str_ptr, col.constant_str.c_str());
+                written_strings.emplace(str_ptr, str_offset);
                 cstring_offset = str_offset;
                 str_offset += (uint32_t)col.constant_str.length() + 1;
             }
@@ -857,6 +888,7 @@ uint8_t *UtfFile::Save(size_t *psize)
         // for column names, we don't check existing strings!!
         str_ptr =  (char *)GetOffsetPtr(buf, offset+str_offset, true);
         strcpy(str_ptr, col.name.c_str());
+        written_strings.emplace(str_ptr, str_offset);
         *(uint32_t *)col_ptr = val32(str_offset);
         str_offset += (uint32_t)col.name.length() + 1;
 
@@ -930,23 +962,24 @@ uint8_t *UtfFile::Save(size_t *psize)
 				break;
 
 				case TYPE_STRING:
+				{
+                    auto it = written_strings.find(data.str.c_str());
 
-                    str_ptr =  (char *)GetOffsetPtr(buf, offset+str_offset, true);
-                    char *existing_string = FindString(str_top, data.str.c_str(), str_ptr);
-
-                    if (existing_string)
+                    if (it != written_strings.end())
                     {
-                        *(uint32_t *)ptr = val32(Utils::DifPointer(existing_string, str_top));
+                        *(uint32_t *)ptr = val32(it->second);
                     }
                     else
                     {
+                        str_ptr =  (char *)GetOffsetPtr(buf, offset+str_offset, true);
                         *(uint32_t *)ptr = val32(str_offset);
                         strcpy(str_ptr, data.str.c_str());
+                        written_strings.emplace(str_ptr, str_offset);
                         str_offset += (uint32_t)data.str.length() + 1;
                     }
 
                     ptr += 4;
-
+				}
 				break;
 			}
 		}
@@ -122,6 +122,29 @@ struct UtfColumn
         Copy(other);
     }
 
+	// Takes the data of other. noexcept, so that std::vector moves instead of copying when it grows.
+	void Move(UtfColumn &other) noexcept
+	{
+		flags = other.flags;
+		name = std::move(other.name);
+		constant_u8 = other.constant_u8;
+		constant_u16 = other.constant_u16;
+		constant_u32 = other.constant_u32;
+		constant_u64 = other.constant_u64;
+		constant_float = other.constant_float;
+		constant_str = std::move(other.constant_str);
+		constant_data = other.constant_data;
+		constant_data_size = other.constant_data_size;
+
+		other.constant_data = nullptr;
+		other.constant_data_size = 0;
+	}
+
+	UtfColumn(UtfColumn &&other) noexcept
+	{
+		Move(other);
+	}
+
 	~UtfColumn()
 	{
 		if (constant_data)
@@ -136,6 +159,18 @@ struct UtfColumn
         Copy(other);
         return *this;
     }
+
+	inline UtfColumn &operator=(UtfColumn &&other) noexcept
+	{
+		if (this == &other)
+			return *this;
+
+		if (constant_data)
+			delete[] constant_data;
+
+		Move(other);
+		return *this;
+	}
 };
 
 struct UtfValue
@@ -193,6 +228,28 @@ struct UtfValue
         Copy(other);
     }
 
+	// Takes the data of other. noexcept, so that std::vector moves instead of copying when it grows.
+	void Move(UtfValue &other) noexcept
+	{
+		type = other.type;
+		_u8 = other._u8;
+		_u16 = other._u16;
+		_u32 = other._u32;
+		_u64 = other._u64;
+		_float = other._float;
+		str = std::move(other.str);
+		data = other.data;
+		data_size = other.data_size;
+
+		other.data = nullptr;
+		other.data_size = 0;
+	}
+
+	UtfValue(UtfValue &&other) noexcept
+	{
+		Move(other);
+	}
+
 	~UtfValue()
 	{
 		if (data)
@@ -207,6 +264,18 @@ struct UtfValue
         Copy(other);
         return *this;
     }
+
+	inline UtfValue &operator=(UtfValue &&other) noexcept
+	{
+		if (this == &other)
+			return *this;
+
+		if (data)
+			delete[] data;
+
+		Move(other);
+		return *this;
+	}
 };
 
 struct UtfRow
@@ -228,8 +297,6 @@ private:
     uint16_t CalculateRowLength() const;
     size_t CalculateStringsSize() const;    
 
-    char *FindString(char *strings_list, const char *str, char *end);
-
 protected:
 
 	std::vector<UtfColumn> columns;
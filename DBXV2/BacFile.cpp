@@ -18,7 +18,7 @@ TiXmlElement *BACMatrix3x3::Decompile(TiXmlNode *root, const std::string &commen
     return entry_root;
 }
 
-bool BACMatrix3x3::Compile(const TiXmlElement *root)
+bool BACMatrix3x3::Compile(const XmlElement *root)
 {
     for (int i = 0; i < 3; i++)
     {
@@ -63,7 +63,7 @@ TiXmlElement *BACAnimation::Decompile(TiXmlNode *root) const
     return entry_root;
 }
 
-bool BACAnimation::Compile(const TiXmlElement *root)
+bool BACAnimation::Compile(const XmlElement *root)
 {
     if (!Utils::GetParamUnsigned(root, "START_TIME", &start_time))
         return false;
@@ -158,7 +158,7 @@ TiXmlElement *BACHitbox::Decompile(TiXmlNode *root) const
     return entry_root;
 }
 
-bool BACHitbox::Compile(const TiXmlElement *root)
+bool BACHitbox::Compile(const XmlElement *root)
 {
     if (!Utils::GetParamUnsigned(root, "START_TIME", &start_time))
         return false;
@@ -196,7 +196,7 @@ bool BACHitbox::Compile(const TiXmlElement *root)
     if (!Utils::GetParamMultipleUnsigned(root, "U_14", unk_14, 2))
         return false;
 
-    const TiXmlElement *matrix_entry;
+    const XmlElement *matrix_entry;
     if (Utils::GetElemCount(root, "Matrix3x3", &matrix_entry) == 0)
         return false;
 
@@ -236,7 +236,7 @@ TiXmlElement *BACAccelerationMovement::Decompile(TiXmlNode *root) const
     return entry_root;
 }
 
-bool BACAccelerationMovement::Compile(const TiXmlElement *root)
+bool BACAccelerationMovement::Compile(const XmlElement *root)
 {
     if (!Utils::GetParamUnsigned(root, "START_TIME", &start_time))
         return false;
@@ -297,7 +297,7 @@ TiXmlElement *BACInvulnerability::Decompile(TiXmlNode *root) const
     return entry_root;
 }
 
-bool BACInvulnerability::Compile(const TiXmlElement *root)
+bool BACInvulnerability::Compile(const XmlElement *root)
 {
     if (!Utils::GetParamUnsigned(root, "START_TIME", &start_time))
         return false;
@@ -331,7 +331,7 @@ TiXmlElement *BACMotionAdjust::Decompile(TiXmlNode *root) const
     return entry_root;
 }
 
-bool BACMotionAdjust::Compile(const TiXmlElement *root)
+bool BACMotionAdjust::Compile(const XmlElement *root)
 {
     if (!Utils::GetParamUnsigned(root, "START_TIME", &start_time))
         return false;
@@ -370,7 +370,7 @@ TiXmlElement *BACOpponentKnockback::Decompile(TiXmlNode *root) const
     return entry_root;
 }
 
-bool BACOpponentKnockback::Compile(const TiXmlElement *root)
+bool BACOpponentKnockback::Compile(const XmlElement *root)
 {
     if (!Utils::GetParamUnsigned(root, "START_TIME", &start_time))
         return false;
@@ -415,7 +415,7 @@ TiXmlElement *BACChainAttackParameters::Decompile(TiXmlNode *root) const
     return entry_root;
 }
 
-bool BACChainAttackParameters::Compile(const TiXmlElement *root)
+bool BACChainAttackParameters::Compile(const XmlElement *root)
 {
     if (!Utils::GetParamUnsigned(root, "START_TIME", &start_time))
         return false;
@@ -465,7 +465,7 @@ TiXmlElement *BACBcmCallback::Decompile(TiXmlNode *root) const
     return entry_root;
 }
 
-bool BACBcmCallback::Compile(const TiXmlElement *root)
+bool BACBcmCallback::Compile(const XmlElement *root)
 {
     if (!Utils::GetParamUnsigned(root, "START_TIME", &start_time))
         return false;
@@ -522,7 +522,7 @@ TiXmlElement *BACEffect::Decompile(TiXmlNode *root) const
     return entry_root;
 }
 
-bool BACEffect::Compile(const TiXmlElement *root)
+bool BACEffect::Compile(const XmlElement *root)
 {
     if (!Utils::GetParamUnsigned(root, "START_TIME", &start_time))
         return false;
@@ -603,7 +603,7 @@ TiXmlElement *BACProjectile::Decompile(TiXmlNode *root) const
     return entry_root;
 }
 
-bool BACProjectile::Compile(const TiXmlElement *root)
+bool BACProjectile::Compile(const XmlElement *root)
 {
     if (!Utils::GetParamUnsigned(root, "START_TIME", &start_time))
         return false;
@@ -726,7 +726,7 @@ TiXmlElement *BACCamera::Decompile(TiXmlNode *root) const
     return entry_root;
 }
 
-bool BACCamera::Compile(const TiXmlElement *root)
+bool BACCamera::Compile(const XmlElement *root)
 {
     if (!Utils::GetParamUnsigned(root, "START_TIME", &start_time))
         return false;
@@ -817,7 +817,7 @@ TiXmlElement *BACSound::Decompile(TiXmlNode *root) const
     return entry_root;
 }
 
-bool BACSound::Compile(const TiXmlElement *root)
+bool BACSound::Compile(const XmlElement *root)
 {
     if (!Utils::GetParamUnsigned(root, "START_TIME", &start_time))
         return false;
@@ -861,7 +861,7 @@ TiXmlElement *BACType12::Decompile(TiXmlNode *root) const
     return entry_root;
 }
 
-bool BACType12::Compile(const TiXmlElement *root)
+bool BACType12::Compile(const XmlElement *root)
 {
     if (!Utils::GetParamUnsigned(root, "START_TIME", &start_time))
         return false;
@@ -901,7 +901,7 @@ TiXmlElement *BACPartInvisibility::Decompile(TiXmlNode *root) const
     return entry_root;
 }
 
-bool BACPartInvisibility::Compile(const TiXmlElement *root)
+bool BACPartInvisibility::Compile(const XmlElement *root)
 {
     if (!Utils::GetParamUnsigned(root, "START_TIME", &start_time))
         return false;
@@ -948,7 +948,7 @@ TiXmlElement *BACAnimationModification::Decompile(TiXmlNode *root) const
     return entry_root;
 }
 
-bool BACAnimationModification::Compile(const TiXmlElement *root)
+bool BACAnimationModification::Compile(const XmlElement *root)
 {
     if (!Utils::GetParamUnsigned(root, "START_TIME", &start_time))
         return false;
@@ -1049,7 +1049,7 @@ TiXmlElement *BACTransformControl::Decompile(TiXmlNode *root) const
     return entry_root;
 }
 
-bool BACTransformControl::Compile(const TiXmlElement *root)
+bool BACTransformControl::Compile(const XmlElement *root)
 {
     if (!Utils::GetParamUnsigned(root, "START_TIME", &start_time))
         return false;
@@ -1098,7 +1098,7 @@ TiXmlElement *BACScreenEffect::Decompile(TiXmlNode *root) const
     return entry_root;
 }
 
-bool BACScreenEffect::Compile(const TiXmlElement *root)
+bool BACScreenEffect::Compile(const XmlElement *root)
 {
     if (!Utils::GetParamUnsigned(root, "START_TIME", &start_time))
         return false;
@@ -1182,7 +1182,7 @@ TiXmlElement *BACThrowHandler::Decompile(TiXmlNode *root, bool _small) const
     return entry_root;
 }
 
-bool BACThrowHandler::Compile(const TiXmlElement *root, bool _small)
+bool BACThrowHandler::Compile(const XmlElement *root, bool _small)
 {
     if (!Utils::GetParamUnsigned(root, "START_TIME", &start_time))
         return false;
@@ -1239,7 +1239,7 @@ TiXmlElement *BACType18::Decompile(TiXmlNode *root) const
     return entry_root;
 }
 
-bool BACType18::Compile(const TiXmlElement *root)
+bool BACType18::Compile(const XmlElement *root)
 {
     if (!Utils::GetParamUnsigned(root, "START_TIME", &start_time))
         return false;
@@ -1295,7 +1295,7 @@ TiXmlElement *BACAuraEffect::Decompile(TiXmlNode *root) const
     return entry_root;
 }
 
-bool BACAuraEffect::Compile(const TiXmlElement *root)
+bool BACAuraEffect::Compile(const XmlElement *root)
 {
     if (!Utils::GetParamUnsigned(root, "START_TIME", &start_time))
         return false;
@@ -1357,7 +1357,7 @@ TiXmlElement *BACHomingMovement::Decompile(TiXmlNode *root) const
     return entry_root;
 }
 
-bool BACHomingMovement::Compile(const TiXmlElement *root)
+bool BACHomingMovement::Compile(const XmlElement *root)
 {
     if (!Utils::GetParamUnsigned(root, "START_TIME", &start_time))
         return false;
@@ -1423,7 +1423,7 @@ TiXmlElement *BACType21::Decompile(TiXmlNode *root) const
     return entry_root;
 }
 
-bool BACType21::Compile(const TiXmlElement *root)
+bool BACType21::Compile(const XmlElement *root)
 {
     if (!Utils::GetParamUnsigned(root, "START_TIME", &start_time))
         return false;
@@ -1484,7 +1484,7 @@ TiXmlElement *BACType22::Decompile(TiXmlNode *root) const
     return entry_root;
 }
 
-bool BACType22::Compile(const TiXmlElement *root)
+bool BACType22::Compile(const XmlElement *root)
 {
     if (!Utils::GetParamUnsigned(root, "START_TIME", &start_time))
         return false;
@@ -1555,7 +1555,7 @@ TiXmlElement *BACTransparencyEffect::Decompile(TiXmlNode *root) const
     return entry_root;
 }
 
-bool BACTransparencyEffect::Compile(const TiXmlElement *root)
+bool BACTransparencyEffect::Compile(const XmlElement *root)
 {
     if (!Utils::GetParamUnsigned(root, "START_TIME", &start_time))
         return false;
@@ -1622,7 +1622,7 @@ TiXmlElement *BACDualSkillData::Decompile(TiXmlNode *root) const
     return entry_root;
 }
 
-bool BACDualSkillData::Compile(const TiXmlElement *root)
+bool BACDualSkillData::Compile(const XmlElement *root)
 {
     if (!Utils::GetParamUnsigned(root, "START_TIME", &start_time)) return false;
     if (!Utils::GetParamUnsigned(root, "DURATION", &duration)) return false;
@@ -1663,7 +1663,7 @@ TiXmlElement *BACType25::Decompile(TiXmlNode *root) const
     return entry_root;
 }
 
-bool BACType25::Compile(const TiXmlElement *root)
+bool BACType25::Compile(const XmlElement *root)
 {
     if (!Utils::GetParamUnsigned(root, "START_TIME", &start_time)) return false;
     if (!Utils::GetParamUnsigned(root, "DURATION", &duration)) return false;
@@ -1691,7 +1691,7 @@ TiXmlElement *BACType26::Decompile(TiXmlNode *root) const
     return entry_root;
 }
 
-bool BACType26::Compile(const TiXmlElement *root)
+bool BACType26::Compile(const XmlElement *root)
 {
     if (!Utils::GetParamUnsigned(root, "START_TIME", &start_time)) return false;
     if (!Utils::GetParamUnsigned(root, "DURATION", &duration)) return false;
@@ -1722,7 +1722,7 @@ TiXmlElement *BACType27::Decompile(TiXmlNode *root) const
     return entry_root;
 }
 
-bool BACType27::Compile(const TiXmlElement *root)
+bool BACType27::Compile(const XmlElement *root)
 {
     if (!Utils::GetParamUnsigned(root, "START_TIME", &start_time)) return false;
     if (!Utils::GetParamUnsigned(root, "DURATION", &duration)) return false;
@@ -1755,7 +1755,7 @@ TiXmlElement *BACType28::Decompile(TiXmlNode *root) const
     return entry_root;
 }
 
-bool BACType28::Compile(const TiXmlElement *root)
+bool BACType28::Compile(const XmlElement *root)
 {
     if (!Utils::GetParamUnsigned(root, "START_TIME", &start_time)) return false;
     if (!Utils::GetParamUnsigned(root, "DURATION", &duration)) return false;
@@ -1787,7 +1787,7 @@ TiXmlElement *BACType29::Decompile(TiXmlNode *root) const
     return entry_root;
 }
 
-bool BACType29::Compile(const TiXmlElement *root)
+bool BACType29::Compile(const XmlElement *root)
 {
     if (!Utils::GetParamUnsigned(root, "START_TIME", &start_time)) return false;
     if (!Utils::GetParamUnsigned(root, "DURATION", &duration)) return false;
@@ -1815,7 +1815,7 @@ TiXmlElement *BACType30::Decompile(TiXmlNode *root) const
     return entry_root;
 }
 
-bool BACType30::Compile(const TiXmlElement *root)
+bool BACType30::Compile(const XmlElement *root)
 {
     if (!Utils::GetParamUnsigned(root, "START_TIME", &start_time)) return false;
     if (!Utils::GetParamUnsigned(root, "DURATION", &duration)) return false;
@@ -1848,7 +1848,7 @@ TiXmlElement *BACType31::Decompile(TiXmlNode *root) const
     return entry_root;
 }
 
-bool BACType31::Compile(const TiXmlElement *root)
+bool BACType31::Compile(const XmlElement *root)
 {
     if (!Utils::GetParamUnsigned(root, "START_TIME", &start_time)) return false;
     if (!Utils::GetParamUnsigned(root, "DURATION", &duration)) return false;
@@ -2314,7 +2314,7 @@ TiXmlElement *BacEntry::Decompile(TiXmlNode *root, bool small_17, int idx) const
     return entry_root;
 }
 
-bool BacEntry::Compile(const TiXmlElement *root, bool small_17)
+bool BacEntry::Compile(const XmlElement *root, bool small_17)
 {
     if (!Utils::ReadAttrUnsigned(root, "flags", &flags))
     {
@@ -2325,7 +2325,7 @@ bool BacEntry::Compile(const TiXmlElement *root, bool small_17)
     for (int i = 0; i <= MAX_BAC_TYPE; i++)
         has_type[i] = false;
 
-    for (const TiXmlElement *elem = root->FirstChildElement(); elem; elem = elem->NextSiblingElement())
+    for (const XmlElement *elem = root->FirstChildElement(); elem; elem = elem->NextSiblingElement())
     {
         if (elem->ValueStr() == "Animation")
         {
@@ -3849,12 +3849,24 @@ TiXmlDocument *BacFile::Decompile() const
     return doc;
 }
 
-bool BacFile::Compile(TiXmlDocument *doc, bool )
+bool BacFile::Compile(TiXmlDocument *doc, bool big_endian)
+{
+    XmlDocument fast_doc;
+
+    if (!fast_doc.LoadTinyXml(doc))
+    {
+        DPRINTF("%s: Failed to reparse the document (%s).\n", FUNCNAME, fast_doc.ErrorDesc());
+        return false;
+    }
+
+    return CompileFast(&fast_doc, big_endian);
+}
+
+bool BacFile::CompileFast(const XmlDocument *doc, bool )
 {
     Reset();
 
-    TiXmlHandle handle(doc);
-    const TiXmlElement *root = Utils::FindRoot(&handle, "BAC");
+    const XmlElement *root = Utils::FindRoot(doc, "BAC");
 
     if (!root)
     {
@@ -3884,7 +3896,7 @@ bool BacFile::Compile(TiXmlDocument *doc, bool )
     std::vector<bool> used;
     used.resize(n, false);
 
-    for (const TiXmlElement *elem = root->FirstChildElement(); elem; elem = elem->NextSiblingElement())
+    for (const XmlElement *elem = root->FirstChildElement(); elem; elem = elem->NextSiblingElement())
     {
         if (elem->ValueStr() == "BacEntry")
         {
@@ -2,6 +2,7 @@
 #define BACFILE_H
 
 #include "BaseFile.h"
+#include "XmlReader.h"
 
 /*Type 0 - Animation
 Type 1 - hit box
@@ -61,7 +62,7 @@ CHECK_STRUCT_SIZE(BACSubEntry, 0x10);
 struct BACMatrix3x3
 {
     TiXmlElement *Decompile(TiXmlNode *root, const std::string &comment) const;
-    bool Compile(const TiXmlElement *root);
+    bool Compile(const XmlElement *root);
 
     float floats[9];
 };
@@ -87,7 +88,7 @@ struct BACAnimation // Skill control and animation
     float transitory_animation_compression;
 
     TiXmlElement *Decompile(TiXmlNode *root) const;
-    bool Compile(const TiXmlElement *root);
+    bool Compile(const XmlElement *root);
 };
 CHECK_STRUCT_SIZE(BACAnimation, 0x24);
 
@@ -109,7 +110,7 @@ struct BACHitbox
     BACMatrix3x3 matrix;
 
     TiXmlElement *Decompile(TiXmlNode *root) const;
-    bool Compile(const TiXmlElement *root);
+    bool Compile(const XmlElement *root);
 };
 CHECK_STRUCT_SIZE(BACHitbox, 0x40);
 
@@ -129,7 +130,7 @@ struct BACAccelerationMovement
     float y_axis_drag; // 0x1C
     float z_axis_drag; // 0x20
     TiXmlElement *Decompile(TiXmlNode *root) const;
-    bool Compile(const TiXmlElement *root);
+    bool Compile(const XmlElement *root);
 };
 CHECK_STRUCT_SIZE(BACAccelerationMovement, 0x24);
 
@@ -143,7 +144,7 @@ struct BACInvulnerability
     uint32_t type;
 
     TiXmlElement *Decompile(TiXmlNode *root) const;
-    bool Compile(const TiXmlElement *root);
+    bool Compile(const XmlElement *root);
 };
 CHECK_STRUCT_SIZE(BACInvulnerability, 0xC);
 
@@ -157,7 +158,7 @@ struct BACMotionAdjust
     float time_scale;
 
     TiXmlElement *Decompile(TiXmlNode *root) const;
-    bool Compile(const TiXmlElement *root);
+    bool Compile(const XmlElement *root);
 };
 CHECK_STRUCT_SIZE(BACMotionAdjust, 0xC);
 
@@ -173,7 +174,7 @@ struct BACOpponentKnockback
     uint16_t unk_0E;
 
     TiXmlElement *Decompile(TiXmlNode *root) const;
-    bool Compile(const TiXmlElement *root);
+    bool Compile(const XmlElement *root);
 };
 CHECK_STRUCT_SIZE(BACOpponentKnockback, 0x10);
 
@@ -189,7 +190,7 @@ struct BACChainAttackParameters
     uint16_t unk_0E;
 
     TiXmlElement *Decompile(TiXmlNode *root) const;
-    bool Compile(const TiXmlElement *root);
+    bool Compile(const XmlElement *root);
 };
 CHECK_STRUCT_SIZE(BACChainAttackParameters, 0x10);
 
@@ -204,7 +205,7 @@ struct BACBcmCallback
     uint16_t unk_0A;
 
     TiXmlElement *Decompile(TiXmlNode *root) const;
-    bool Compile(const TiXmlElement *root);
+    bool Compile(const XmlElement *root);
 };
 CHECK_STRUCT_SIZE(BACBcmCallback, 0xC);
 
@@ -223,7 +224,7 @@ struct BACEffect
     uint32_t on_off_switch; // 0x2C
 
     TiXmlElement *Decompile(TiXmlNode *root) const;
-    bool Compile(const TiXmlElement *root);
+    bool Compile(const XmlElement *root);
 };
 CHECK_STRUCT_SIZE(BACEffect, 0x30);
 
@@ -249,7 +250,7 @@ struct BACProjectile
     uint32_t unk_34[3];
 
     TiXmlElement *Decompile(TiXmlNode *root) const;
-    bool Compile(const TiXmlElement *root);
+    bool Compile(const XmlElement *root);
 };
 CHECK_STRUCT_SIZE(BACProjectile, 0x40);
 
@@ -281,7 +282,7 @@ struct BACCamera
     uint16_t camera_flags; // 0x4A
 
     TiXmlElement *Decompile(TiXmlNode *root) const;
-    bool Compile(const TiXmlElement *root);
+    bool Compile(const XmlElement *root);
 };
 CHECK_STRUCT_SIZE(BACCamera, 0x4C);
 
@@ -298,7 +299,7 @@ struct BACSound
     uint16_t unk_0E;
 
     TiXmlElement *Decompile(TiXmlNode *root) const;
-    bool Compile(const TiXmlElement *root);
+    bool Compile(const XmlElement *root);
 };
 CHECK_STRUCT_SIZE(BACSound, 0x10);
 
@@ -312,7 +313,7 @@ struct BACType12
     uint16_t unk_0A;
 
     TiXmlElement *Decompile(TiXmlNode *root) const;
-    bool Compile(const TiXmlElement *root);
+    bool Compile(const XmlElement *root);
 };
 CHECK_STRUCT_SIZE(BACType12, 0xC);
 
@@ -327,7 +328,7 @@ struct BACPartInvisibility
     uint16_t on_off_switch;
 
     TiXmlElement *Decompile(TiXmlNode *root) const;
-    bool Compile(const TiXmlElement *root);
+    bool Compile(const XmlElement *root);
 };
 CHECK_STRUCT_SIZE(BACPartInvisibility, 0xC);
 
@@ -342,7 +343,7 @@ struct BACAnimationModification
     uint16_t unk_0A;
 
     TiXmlElement *Decompile(TiXmlNode *root) const;
-    bool Compile(const TiXmlElement *root);
+    bool Compile(const XmlElement *root);
 };
 CHECK_STRUCT_SIZE(BACAnimationModification, 0xC);
 
@@ -360,7 +361,7 @@ struct BACTransformControl
     uint32_t unk_18[2];
 
     TiXmlElement *Decompile(TiXmlNode *root) const;
-    bool Compile(const TiXmlElement *root);
+    bool Compile(const XmlElement *root);
 };
 CHECK_STRUCT_SIZE(BACTransformControl, 0x20);
 
@@ -377,7 +378,7 @@ struct BACScreenEffect
     uint32_t unk_10[4];
 
     TiXmlElement *Decompile(TiXmlNode *root) const;
-    bool Compile(const TiXmlElement *root);
+    bool Compile(const XmlElement *root);
 };
 CHECK_STRUCT_SIZE(BACScreenEffect, 0x20);
 
@@ -397,7 +398,7 @@ struct BACThrowHandler
     float victim_displacement[3]; // 0x14
 
     TiXmlElement *Decompile(TiXmlNode *root, bool _small) const;
-    bool Compile(const TiXmlElement *root, bool _small);
+    bool Compile(const XmlElement *root, bool _small);
 };
 CHECK_STRUCT_SIZE(BACThrowHandler, 0x20);
 
@@ -412,7 +413,7 @@ struct BACType18
     uint32_t unk_1C;
 
     TiXmlElement *Decompile(TiXmlNode *root) const;
-    bool Compile(const TiXmlElement *root);
+    bool Compile(const XmlElement *root);
 };
 CHECK_STRUCT_SIZE(BACType18, 0x20);
 
@@ -428,7 +429,7 @@ struct BACAuraEffect
     uint32_t unk_0C;
 
     TiXmlElement *Decompile(TiXmlNode *root) const;
-    bool Compile(const TiXmlElement *root);
+    bool Compile(const XmlElement *root);
 };
 CHECK_STRUCT_SIZE(BACAuraEffect, 0x10);
 
@@ -450,7 +451,7 @@ struct BACHomingMovement
     uint32_t unk_20[4];
 
     TiXmlElement *Decompile(TiXmlNode *root) const;
-    bool Compile(const TiXmlElement *root);
+    bool Compile(const XmlElement *root);
 };
 CHECK_STRUCT_SIZE(BACHomingMovement, 0x30);
 
@@ -471,7 +472,7 @@ struct BACType21
     float unk_1C;
 
     TiXmlElement *Decompile(TiXmlNode *root) const;
-    bool Compile(const TiXmlElement *root);
+    bool Compile(const XmlElement *root);
 };
 CHECK_STRUCT_SIZE(BACType21, 0x20);
 
@@ -487,7 +488,7 @@ struct BACType22
     char name[32];
 
     TiXmlElement *Decompile(TiXmlNode *root) const;
-    bool Compile(const TiXmlElement *root);
+    bool Compile(const XmlElement *root);
 };
 CHECK_STRUCT_SIZE(BACType22, 0x30);
 
@@ -507,7 +508,7 @@ struct BACTransparencyEffect
     float unk_20[8];
 
     TiXmlElement *Decompile(TiXmlNode *root) const;
-    bool Compile(const TiXmlElement *root);
+    bool Compile(const XmlElement *root);
 };
 CHECK_STRUCT_SIZE(BACTransparencyEffect, 0x40);
 
@@ -536,7 +537,7 @@ struct BACDualSkillData
     uint16_t unk_36;
 
     TiXmlElement *Decompile(TiXmlNode *root) const;
-    bool Compile(const TiXmlElement *root);
+    bool Compile(const XmlElement *root);
 };
 CHECK_STRUCT_SIZE(BACDualSkillData, 0x38);
 
@@ -551,7 +552,7 @@ struct BACType25
     uint32_t unk_0C;
 
     TiXmlElement *Decompile(TiXmlNode *root) const;
-    bool Compile(const TiXmlElement *root);
+    bool Compile(const XmlElement *root);
 };
 CHECK_STRUCT_SIZE(BACType25, 0x10);
 
@@ -567,7 +568,7 @@ struct BACType26
     uint32_t unk_14[15];
 
     TiXmlElement *Decompile(TiXmlNode *root) const;
-    bool Compile(const TiXmlElement *root);
+    bool Compile(const XmlElement *root);
 };
 CHECK_STRUCT_SIZE(BACType26, 0x50);
 
@@ -585,7 +586,7 @@ struct BACType27
     uint32_t unk_14;
 
     TiXmlElement *Decompile(TiXmlNode *root) const;
-    bool Compile(const TiXmlElement *root);
+    bool Compile(const XmlElement *root);
 };
 CHECK_STRUCT_SIZE(BACType27, 0x18);
 
@@ -603,7 +604,7 @@ struct BACType28
     uint32_t unk_18[3];
 
     TiXmlElement *Decompile(TiXmlNode *root) const;
-    bool Compile(const TiXmlElement *root);
+    bool Compile(const XmlElement *root);
 };
 CHECK_STRUCT_SIZE(BACType28, 0x24);
 
@@ -620,7 +621,7 @@ struct BACType29
     uint32_t unk_30[3];
 
     TiXmlElement *Decompile(TiXmlNode *root) const;
-    bool Compile(const TiXmlElement *root);
+    bool Compile(const XmlElement *root);
 };
 CHECK_STRUCT_SIZE(BACType29, 0x3C);
 
@@ -635,7 +636,7 @@ struct BACType30
     uint32_t unk_0C[9];
 
     TiXmlElement *Decompile(TiXmlNode *root) const;
-    bool Compile(const TiXmlElement *root);
+    bool Compile(const XmlElement *root);
 };
 CHECK_STRUCT_SIZE(BACType30, 0x30);
 
@@ -656,7 +657,7 @@ struct BACType31
     uint32_t unk_20[8];
 
     TiXmlElement *Decompile(TiXmlNode *root) const;
-    bool Compile(const TiXmlElement *root);
+    bool Compile(const XmlElement *root);
 };
 CHECK_STRUCT_SIZE(BACType31, 0x40);
 
@@ -715,7 +716,7 @@ struct BacEntry
     }
 
     TiXmlElement *Decompile(TiXmlNode *root, bool small_17, int idx) const;
-    bool Compile(const TiXmlElement *root, bool small_17);
+    bool Compile(const XmlElement *root, bool small_17);
 };
 
 class BacFile : public BaseFile
@@ -747,6 +748,8 @@ public:
 
     virtual TiXmlDocument *Decompile() const override;
     virtual bool Compile(TiXmlDocument *doc, bool big_endian=false) override;
+    virtual bool CompileFast(const XmlDocument *doc, bool big_endian=false) override;
+    virtual bool SupportsCompileFast() const override { return true; }
 
     size_t ChangeReferencesToSkill(uint16_t old_skill, uint16_t new_skill);
 
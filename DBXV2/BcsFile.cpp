@@ -2,6 +2,7 @@
 #include <unordered_set>
 
 #include "BcsFile.h"
+#include "Arena.h"
 #include "debug.h"
 
 #define COPY_VAL(a, b, f) a->f = b->f
@@ -21,7 +22,7 @@
 #define COPY_I(f) COPY_VAL(this, hdr, f)
 #define COPY_O(f) COPY_VAL(hdr, this, f)
 
-#define ADD_STR(s) { if (s.length() > 0) { strings.push_back(s); *str_size += s.length()+1; } }
+#define ADD_STR(s) { if (s.length() > 0) { strings.push_back(&s); *str_size += s.length()+1; } }
 
 bool BcsColorSelector::Load(const uint8_t *, const BCSColorSelector *file_unk1)
 {
@@ -107,7 +108,7 @@ bool BcsPhysics::Load(BcsFile *file, const uint8_t *, const BCSPhysics *file_unk
     return true;
 }
 
-size_t BcsPhysics::PreSave(size_t *str_size, std::vector<std::string> &strings) const
+size_t BcsPhysics::PreSave(size_t *str_size, BcsStringList &strings) const
 {
     for (size_t i = 0; i < 6; i++)
     {
@@ -296,7 +297,7 @@ bool BcsPart::Load(BcsFile *file, const uint8_t *top, const BCSPart *file_part)
     return true;
 }
 
-size_t BcsPart::PreSave(size_t *str_size, std::vector<std::string> &strings) const
+size_t BcsPart::PreSave(size_t *str_size, BcsStringList &strings) const
 {
     if (!valid)
         return 0;
@@ -561,7 +562,7 @@ bool BcsPartSet::Load(BcsFile *file, const uint8_t *top, const BCSPartSet *file_
     return true;
 }
 
-size_t BcsPartSet::PreSave(size_t *str_size, std::vector<std::string> &strings) const
+size_t BcsPartSet::PreSave(size_t *str_size, BcsStringList &strings) const
 {
     if (!valid)
         return 0;
@@ -774,7 +775,7 @@ bool BcsPartColors::Load(BcsFile *file, const uint8_t *, const BCSPartColors *fi
     return true;
 }
 
-size_t BcsPartColors::PreSave(size_t *str_size, std::vector<std::string> &strings) const
+size_t BcsPartColors::PreSave(size_t *str_size, BcsStringList &strings) const
 {
     if (!valid)
         return 0;
@@ -887,7 +888,7 @@ bool BcsBoneScale::Load(BcsFile *file, const uint8_t *, const BCSBoneScale *file
     return true;
 }
 
-size_t BcsBoneScale::PreSave(size_t *str_size, std::vector<std::string> &strings) const
+size_t BcsBoneScale::PreSave(size_t *str_size, BcsStringList &strings) const
 {
     ADD_STR(name);
     return sizeof(BCSBoneScale);
@@ -955,7 +956,7 @@ bool BcsBody::Load(BcsFile *file, const uint8_t *top, const BCSBody *file_unk2)
     return true;
 }
 
-size_t BcsBody::PreSave(size_t *str_size, std::vector<std::string> &strings) const
+size_t BcsBody::PreSave(size_t *str_size, BcsStringList &strings) const
 {
     if (!valid)
         return 0;
@@ -1069,7 +1070,7 @@ bool BcsBone::Load(BcsFile *file, const uint8_t *, const BCSBone *file_bone)
     return true;
 }
 
-size_t BcsBone::PreSave(size_t *str_size, std::vector<std::string> &strings) const
+size_t BcsBone::PreSave(size_t *str_size, BcsStringList &strings) const
 {
     ADD_STR(name);
     return sizeof(BCSBone);
@@ -1151,7 +1152,7 @@ bool BcsSkeletonData::Load(BcsFile *file, const uint8_t *top, const BCSSkeletonD
     return true;
 }
 
-size_t BcsSkeletonData::PreSave(size_t *str_size, std::vector<std::string> &strings) const
+size_t BcsSkeletonData::PreSave(size_t *str_size, BcsStringList &strings) const
 {
     if (!valid)
         return 0;
@@ -1363,7 +1364,8 @@ bool BcsFile::Load(const uint8_t *buf, size_t size)
 
 uint8_t *BcsFile::Save(size_t *psize)
 {
-    std::vector<std::string> strings;
+    ArenaScope scope(GetArena());
+    BcsStringList strings(&GetArena());
     std::queue<uint32_t> strings_offs;
 
     size_t str_size = 0;
@@ -1401,10 +1403,10 @@ uint8_t *BcsFile::Save(size_t *psize)
     size = header_size + sets_size + unk1s_size + unk2s_size + sk_size + sk2_size + str_size;
 
     current_offset = (uint32_t)(header_size + sets_size + unk1s_size + unk2s_size + sk_size + sk2_size);
-    for (const std::string &str : strings)
+    for (const std::string *str : strings)
     {
         strings_offs.push(current_offset);
-        current_offset += (uint32_t)str.length()+1;
+        current_offset += (uint32_t)str->length()+1;
     }
 
     uint8_t *buf = new uint8_t[size];
@@ -1518,7 +1520,11 @@ uint8_t *BcsFile::Save(size_t *psize)
 
     assert(strings_offs.empty());
 
-    WriteStringList(buf+current_offset, strings);
+    for (const std::string *str : strings)
+    {
+        strcpy((char *)buf+current_offset, str->c_str());
+        current_offset += (uint32_t)str->length()+1;
+    }
 
     if (sets.size() == 0)
         hdr->part_sets_table_offset = 0;
@@ -4,6 +4,7 @@
 #include <queue>
 #include "BaseFile.h"
 #include "FixedMemoryStream.h"
+#include "Arena.h"
 
 #ifdef _MSC_VER
 #pragma pack(push,1)
@@ -154,6 +155,9 @@ STATIC_ASSERT_STRUCT(BCSBone, 0x34);
 
 class BcsFile;
 
+// Strings collected by PreSave, in the order they are written. They point to the strings of the BcsFile objects.
+typedef ArenaVector<const std::string *> BcsStringList;
+
 struct BcsColorSelector
 {
     uint16_t part_colors;
@@ -190,7 +194,7 @@ struct BcsPhysics
     std::string unk_28[6];
 
     bool Load(BcsFile *file, const uint8_t *top, const BCSPhysics *file_unk2);
-    size_t PreSave(size_t *str_size, std::vector<std::string> &strings) const;
+    size_t PreSave(size_t *str_size, BcsStringList &strings) const;
     size_t Save(BcsFile *file, const uint8_t *top, BCSPhysics *file_unk2, std::queue<uint32_t> &strings) const;
 
     TiXmlElement *Decompile(TiXmlNode *root) const;
@@ -251,7 +255,7 @@ struct BcsPart
 
     BcsPart() : valid(false) { }
     bool Load(BcsFile *file, const uint8_t *top, const BCSPart *file_part);
-    size_t PreSave(size_t *str_size, std::vector<std::string> &strings) const;
+    size_t PreSave(size_t *str_size, BcsStringList &strings) const;
     size_t Save(BcsFile *file, const uint8_t *top, BCSPart *file_part, std::queue<uint32_t> &strings) const;
 
     TiXmlElement *Decompile(TiXmlNode *root, int idx, const BcsFile *owner=nullptr) const;
@@ -315,7 +319,7 @@ struct BcsPartSet
 
     BcsPartSet() : valid(false) { }
     bool Load(BcsFile *file, const uint8_t *top, const BCSPartSet *file_set);
-    size_t PreSave(size_t *str_size, std::vector<std::string> &strings) const;
+    size_t PreSave(size_t *str_size, BcsStringList &strings) const;
     size_t Save(BcsFile *file, const uint8_t *top, BCSPartSet *file_set, std::queue<uint32_t> &strings) const;
 
     TiXmlElement *Decompile(TiXmlNode *root, int idx, const BcsFile *owner=nullptr) const;
@@ -369,7 +373,7 @@ struct BcsPartColors
 
     BcsPartColors() : valid(false) { }
     bool Load(BcsFile *file, const uint8_t *top, const BCSPartColors *file_part_colors);
-    size_t PreSave(size_t *str_size, std::vector<std::string> &strings) const;
+    size_t PreSave(size_t *str_size, BcsStringList &strings) const;
     size_t Save(BcsFile *file, const uint8_t *top, BCSPartColors *file_part_colors, std::queue<uint32_t> &strings, FixedMemoryStream &s2_stream, uint32_t doffs) const;
 
     TiXmlElement *Decompile(TiXmlNode *root, int idx) const;
@@ -399,7 +403,7 @@ struct BcsBoneScale
     std::string name;
 
     bool Load(BcsFile *file, const uint8_t *top, const BCSBoneScale *file_bone_scale);
-    size_t PreSave(size_t *str_size, std::vector<std::string> &strings) const;
+    size_t PreSave(size_t *str_size, BcsStringList &strings) const;
     size_t Save(BcsFile *file, const uint8_t *top, FixedMemoryStream &stream, std::queue<uint32_t> &strings) const;
 
     TiXmlElement *Decompile(TiXmlNode *root) const;
@@ -424,7 +428,7 @@ struct BcsBody
 
     BcsBody() : valid(false) { }
     bool Load(BcsFile *file, const uint8_t *top, const BCSBody *file_unk2);
-    size_t PreSave(size_t *str_size, std::vector<std::string> &strings) const;
+    size_t PreSave(size_t *str_size, BcsStringList &strings) const;
     size_t Save(BcsFile *file, const uint8_t *top, BCSBody *file_unk2, std::queue<uint32_t> &strings, FixedMemoryStream &s2_stream, uint32_t doffs) const;
 
     TiXmlElement *Decompile(TiXmlNode *root, int idx) const;
@@ -461,7 +465,7 @@ struct BcsBone
     std::string name;
 
     bool Load(BcsFile *file, const uint8_t *top, const BCSBone *file_bone);
-    size_t PreSave(size_t *str_size, std::vector<std::string> &strings) const;
+    size_t PreSave(size_t *str_size, BcsStringList &strings) const;
     size_t Save(BcsFile *file, const uint8_t *top, BCSBone *file_bone, std::queue<uint32_t> &strings) const;
 
     TiXmlElement *Decompile(TiXmlNode *root) const;
@@ -491,7 +495,7 @@ struct BcsSkeletonData
 
     BcsSkeletonData() : valid(false) { }
     bool Load(BcsFile *file, const uint8_t *top, const BCSSkeletonData *file_skl);
-    size_t PreSave(size_t *str_size, std::vector<std::string> &strings) const;
+    size_t PreSave(size_t *str_size, BcsStringList &strings) const;
     size_t Save(BcsFile *file, const uint8_t *top, BCSSkeletonData *file_skl, std::queue<uint32_t> &strings) const;
 
     TiXmlElement *Decompile(TiXmlNode *root) const;
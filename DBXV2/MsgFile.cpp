@@ -1,4 +1,5 @@
 #include "MsgFile.h"
+#include "Arena.h"
 #include "debug.h"
 
 TiXmlElement *MsgEntry::Decompile(TiXmlNode *root) const
@@ -165,16 +166,49 @@ bool MsgFile::Load(const uint8_t *buf, size_t size)
     return true;
 }
 
-size_t MsgFile::CalculateFileSize(uint32_t *str_data_offset) const
+static MsgUcs2String ToUcs2(Arena &arena, const std::string &str)
+{
+    // Converted straight into the arena: utf-16 never has more units than the utf-8 has bytes
+    char16_t *out = arena.AllocateArray<char16_t>(str.length()+1);
+    MsgUcs2String ret;
+    size_t length, err_pos;
+
+    if (!Utils::Utf8ToUtf16(str.c_str(), str.length(), out, &length, &err_pos))
+    {
+        DPRINTF("%s: Invalid utf-8 sequence at byte %u, the string was cut there.\n", FUNCNAME, (uint32_t)err_pos);
+    }
+
+    out[length] = 0;
+
+    ret.str = out;
+    ret.length = (uint32_t)length;
+    return ret;
+}
+
+static uint32_t CountVars(const char16_t *str, size_t length)
+{
+    uint32_t count = 0;
+
+    for (size_t i = 0; i+3 <= length; i++)
+    {
+        if (str[i] == '%' && str[i+1] == 'l' && str[i+2] == 's')
+            count++;
+    }
+
+    return count;
+}
+
+// names16 and lines16 are only used when unicode_names or unicode_values are set. lines16 has all the lines of all the entries, in order.
+size_t MsgFile::CalculateFileSize(uint32_t *str_data_offset, const MsgUcs2String *names16, const MsgUcs2String *lines16) const
 {
     size_t size = sizeof(MSGHeader);
     size += entries.size() * (sizeof(MSGStr)+sizeof(uint32_t)+sizeof(MSGLines));
 
     size_t num_strings = 0, strings_size = 0;
 
-    for (const MsgEntry &entry : entries)
+    for (size_t i = 0; i < entries.size(); i++)
     {
-        std::u16string temp;
+        const MsgEntry &entry = entries[i];
 
         if (!unicode_names)
         {
@@ -182,8 +216,7 @@ size_t MsgFile::CalculateFileSize(uint32_t *str_data_offset) const
         }
         else
         {
-            temp = Utils::Utf8ToUcs2(entry.name);
-            strings_size += (temp.length() * 2) + 2;
+            strings_size += (names16[i].length * 2) + 2;
         }
 
         for (const std::string &line : entry.lines)
@@ -194,8 +227,7 @@ size_t MsgFile::CalculateFileSize(uint32_t *str_data_offset) const
             }
             else
             {
-                temp = Utils::Utf8ToUcs2(line);
-                strings_size += (temp.length() * 2) + 2;
+                strings_size += (lines16[num_strings].length * 2) + 2;
             }
 
             num_strings++;
@@ -218,8 +250,37 @@ uint8_t *MsgFile::Save(size_t *psize)
         return nullptr;
     }
 
+    // Convert every string once, both the size calculation and the writing need them
+    Arena &arena = GetArena();
+    ArenaScope scope(arena);
+    ArenaVector<MsgUcs2String> names16(&arena), lines16(&arena);
+
+    if (unicode_names)
+    {
+        names16.reserve(entries.size());
+
+        for (const MsgEntry &entry : entries)
+            names16.push_back(ToUcs2(arena, entry.name));
+    }
+
+    if (unicode_values)
+    {
+        size_t num_lines = 0;
+
+        for (const MsgEntry &entry : entries)
+            num_lines += entry.lines.size();
+
+        lines16.reserve(num_lines);
+
+        for (const MsgEntry &entry : entries)
+        {
+            for (const std::string &line : entry.lines)
+                lines16.push_back(ToUcs2(arena, line));
+        }
+    }
+
     uint32_t strings_data_offset;
-    size_t size = CalculateFileSize(&strings_data_offset);
+    size_t size = CalculateFileSize(&strings_data_offset, names16.data(), lines16.data());
 
     uint8_t *buf = new uint8_t[size];
     memset(buf, 0, size);
@@ -246,11 +307,10 @@ uint8_t *MsgFile::Save(size_t *psize)
         }
         else
         {
-            std::u16string u16str = Utils::Utf8ToUcs2(entry.name);
-            names[i].num_chars = (uint32_t)u16str.length();
+            names[i].num_chars = names16[i].length;
             names[i].num_bytes = (names[i].num_chars*2)+2;
 
-            memcpy(buf+next_string_offset, u16str.c_str(), names[i].num_bytes);
+            memcpy(buf+next_string_offset, names16[i].str, names[i].num_bytes);
         }
 
         next_string_offset += names[i].num_bytes;
@@ -295,27 +355,13 @@ uint8_t *MsgFile::Save(size_t *psize)
             }
             else
             {
-                std::u16string u16str = Utils::Utf8ToUcs2(line);
-                size_t pos = std::string::npos;
-
-                do
-                {
-                    // Fuck, ms vs2013 doesn't support u16 literals
-
-#ifdef _MSC_VER
-                    pos = u16str.find(reinterpret_cast<const char16_t *>(L"%ls"), pos+1);
-#else
-                    pos = u16str.find(u"%ls", pos+1);
-#endif
-                    if (pos != std::string::npos)
-                        num_vars++;
+                const MsgUcs2String &u16str = lines16[num_strings];
 
-                } while (pos != std::string::npos);
-
-                current_line->num_chars = (uint32_t)u16str.length();
+                num_vars = CountVars(u16str.str, u16str.length);
+                current_line->num_chars = u16str.length;
                 current_line->num_bytes = (current_line->num_chars*2)+2;
 
-                memcpy(buf+next_string_offset, u16str.c_str(), current_line->num_bytes);
+                memcpy(buf+next_string_offset, u16str.str, current_line->num_bytes);
             }
 
             current_line->num_vars = num_vars;
@@ -325,7 +371,6 @@ uint8_t *MsgFile::Save(size_t *psize)
             current_line++;
         }
     }
-
     hdr->signature = MSG_SIGNATURE;
     hdr->type = (unicode_names) ? 0x100 : 0;
     hdr->unicode_values = unicode_values;
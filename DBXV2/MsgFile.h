@@ -47,6 +47,13 @@ STATIC_ASSERT_STRUCT(MSGLines, 8);
 #pragma pack(pop)
 #endif
 
+// UCS-2 version of a string, in the file arena while saving
+struct MsgUcs2String
+{
+    const char16_t *str; // Null terminated
+    uint32_t length;
+};
+
 struct MsgEntry
 {
     std::string name;
@@ -74,7 +81,7 @@ private:
 protected:
 
     void Reset();
-    size_t CalculateFileSize(uint32_t *str_data_offset) const;
+    size_t CalculateFileSize(uint32_t *str_data_offset, const MsgUcs2String *names16, const MsgUcs2String *lines16) const;
 
 public:
 
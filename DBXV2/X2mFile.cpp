@@ -9084,6 +9084,9 @@ bool X2mFile::InstallBtlPortrait(bool update)
     return ret;
 }
 
+// Uncompressed bytes read from the x2m at once by InstallDir, the files are inflated in parallel
+#define X2M_INSTALL_BATCH_SIZE  (64*1024*1024)
+
 bool X2mFile::InstallDir(const std::string &in_path, const std::string &out_path)
 {
     size_t num_entries = GetNumEntries();
@@ -9097,6 +9100,34 @@ bool X2mFile::InstallDir(const std::string &in_path, const std::string &out_path
     if (proper_out_path.length() != 0 && proper_out_path.back() != '/')
         proper_out_path += '/';
 
+    std::vector<std::string> batch_paths;
+    std::vector<std::string> batch_out_files;
+    std::vector<std::vector<uint8_t>> batch_contents;
+    uint64_t batch_size = 0;
+
+    auto flush_batch = [&]()
+    {
+        if (batch_paths.size() == 0)
+            return true;
+
+        if (!ReadFiles(batch_paths, batch_contents))
+            return false;
+
+        for (size_t i = 0; i < batch_paths.size(); i++)
+        {
+            const std::vector<uint8_t> &content = batch_contents[i];
+
+            if (!xv2fs->WriteFile(batch_out_files[i], content.data(), content.size()))
+                return false;
+        }
+
+        batch_paths.clear();
+        batch_out_files.clear();
+        batch_contents.clear();
+        batch_size = 0;
+        return true;
+    };
+
     for (size_t i = 0; i < num_entries; i++)
     {
         zip_stat_t zstat;
@@ -9118,12 +9149,13 @@ bool X2mFile::InstallDir(const std::string &in_path, const std::string &out_path
         if (!Utils::BeginsWith(entry_path, proper_in_path, false))
             continue;
 
-        size_t size;
-        uint8_t *buf;
         std::string out_file = proper_out_path + entry_path.substr(proper_in_path.length());
 
         if (IsDummyMode())
         {
+            size_t size;
+            uint8_t *buf;
+
             if (Utils::BeginsWith(out_file, "data2/", false) || Utils::BeginsWith(out_file, "/data2/", false))
             {
                 // some mode out there is using data2 even if it doesn't really use it
@@ -9134,22 +9166,25 @@ bool X2mFile::InstallDir(const std::string &in_path, const std::string &out_path
             buf = RecoverFile(out_file, &size);
             if (!buf)
                 return false;
-        }
-        else
-        {
-            buf = ReadFile(zstat.name, &size);
-            if (!buf)
+
+            bool ret = xv2fs->WriteFile(out_file, buf, size);
+            delete[] buf;
+
+            if (!ret)
                 return false;
+
+            continue;
         }
 
-        bool ret = xv2fs->WriteFile(out_file, buf, size);
-        delete[] buf;
+        batch_paths.push_back(zstat.name);
+        batch_out_files.push_back(out_file);
+        batch_size += zstat.size;
 
-        if (!ret)
+        if (batch_size >= X2M_INSTALL_BATCH_SIZE && !flush_batch())
             return false;
     }
 
-    return true;
+    return flush_batch();
 }
 
 bool X2mFile::InstallCharaFiles()
@@ -1,8 +1,13 @@
 #include <algorithm>
 #include <unordered_set>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <memory>
 
 #include "Xenoverse2.h"
 #include "SwfFile.h"
+#include "Thread.h"
 #include "xv2stagedef_default.inc"
 #include "xv2_default_stage_slots.inc"
 #include "debug.h"
@@ -4880,6 +4885,189 @@ bool Xenoverse2::CommitShopText()
     return SaveMsgs(GAME_SHOP_TEXT_PATH, game_shop_texts, false);
 }
 
+struct Xv2InitNode
+{
+    uint64_t subsystem;
+    const char *name;
+    uint64_t deps; // Subsystems that must be loaded before this one, when they are requested too
+    bool (* init)(uint64_t subsystems, int only_this_lang);
+};
+
+static const Xv2InitNode xv2_init_nodes[] =
+{
+    { XV2_INIT_CHARA_LIST, "CharaList", 0, [](uint64_t, int) { return Xenoverse2::InitCharaList(); } },
+    // Decompiling a new stage def looks up the stage names, and loads them if they aren't
+    { XV2_INIT_SYSTEM_FILES, "SystemFiles", XV2_INIT_STAGE_NAMES, [](uint64_t subsystems, int)
+        { return Xenoverse2::InitSystemFiles((subsystems & XV2_INIT_OPT_ONLY_CMS) != 0, (subsystems & XV2_INIT_OPT_MULTIPLE_HCI) != 0); } },
+    { XV2_INIT_CHARA_NAMES, "CharaNames", 0, [](uint64_t, int lang) { return Xenoverse2::InitCharaNames(lang); } },
+    { XV2_INIT_CHARA_COSTUME_NAMES, "CharaCostumeNames", 0, [](uint64_t, int lang) { return Xenoverse2::InitCharaCostumeNames(lang); } },
+    { XV2_INIT_SKILL_NAMES, "SkillNames", 0, [](uint64_t, int lang) { return Xenoverse2::InitSkillNames(lang); } },
+    { XV2_INIT_SKILL_DESCS, "SkillDescs", 0, [](uint64_t, int lang) { return Xenoverse2::InitSkillDescs(lang); } },
+    { XV2_INIT_SKILL_HOWS, "SkillHows", 0, [](uint64_t, int lang) { return Xenoverse2::InitSkillHows(lang); } },
+    { XV2_INIT_BTLHUD_TEXT, "BtlHudText", 0, [](uint64_t, int lang) { return Xenoverse2::InitBtlHudText(lang); } },
+    { XV2_INIT_SEL_PORT, "SelPort", 0, [](uint64_t, int) { return Xenoverse2::InitSelPort(); } },
+    { XV2_INIT_PREBAKED, "PreBaked", 0, [](uint64_t, int) { return Xenoverse2::InitPreBaked(); } },
+    { XV2_INIT_LOBBY_TEXT, "LobbyText", 0, [](uint64_t, int lang) { return Xenoverse2::InitLobbyText(lang); } },
+    { XV2_INIT_CAC_COSTUME_NAMES, "CacCostumeNames", 0, [](uint64_t, int lang) { return Xenoverse2::InitCacCostumeNames(lang); } },
+    { XV2_INIT_CAC_COSTUME_DESCS, "CacCostumeDescs", 0, [](uint64_t, int lang) { return Xenoverse2::InitCacCostumeDescs(lang); } },
+    { XV2_INIT_TALISMAN_NAMES, "TalismanNames", 0, [](uint64_t, int lang) { return Xenoverse2::InitTalismanNames(lang); } },
+    { XV2_INIT_TALISMAN_DESCS, "TalismanDescs", 0, [](uint64_t, int lang) { return Xenoverse2::InitTalismanDescs(lang); } },
+    { XV2_INIT_TALISMAN_HOWS, "TalismanHows", 0, [](uint64_t, int lang) { return Xenoverse2::InitTalismanHows(lang); } },
+    { XV2_INIT_MATERIAL_NAMES, "MaterialNames", 0, [](uint64_t, int lang) { return Xenoverse2::InitMaterialNames(lang); } },
+    { XV2_INIT_BATTLE_NAMES, "BattleNames", 0, [](uint64_t, int lang) { return Xenoverse2::InitBattleNames(lang); } },
+    { XV2_INIT_EXTRA_NAMES, "ExtraNames", 0, [](uint64_t, int lang) { return Xenoverse2::InitExtraNames(lang); } },
+    { XV2_INIT_PET_NAMES, "PetNames", 0, [](uint64_t, int lang) { return Xenoverse2::InitPetNames(lang); } },
+    { XV2_INIT_IDB_COSTUMES, "IdbCostumes", 0, [](uint64_t, int) { return Xenoverse2::InitIdb(true, false, false, false, false, false, false, false); } },
+    { XV2_INIT_IDB_ACCESORIES, "IdbAccesories", 0, [](uint64_t, int) { return Xenoverse2::InitIdb(false, true, false, false, false, false, false, false); } },
+    { XV2_INIT_IDB_TALISMAN, "IdbTalisman", 0, [](uint64_t, int) { return Xenoverse2::InitIdb(false, false, true, false, false, false, false, false); } },
+    { XV2_INIT_IDB_SKILLS, "IdbSkills", 0, [](uint64_t, int) { return Xenoverse2::InitIdb(false, false, false, true, false, false, false, false); } },
+    { XV2_INIT_IDB_MATERIAL, "IdbMaterial", 0, [](uint64_t, int) { return Xenoverse2::InitIdb(false, false, false, false, true, false, false, false); } },
+    { XV2_INIT_IDB_BATTLE, "IdbBattle", 0, [](uint64_t, int) { return Xenoverse2::InitIdb(false, false, false, false, false, true, false, false); } },
+    { XV2_INIT_IDB_EXTRA, "IdbExtra", 0, [](uint64_t, int) { return Xenoverse2::InitIdb(false, false, false, false, false, false, true, false); } },
+    { XV2_INIT_IDB_PET, "IdbPet", 0, [](uint64_t, int) { return Xenoverse2::InitIdb(false, false, false, false, false, false, false, true); } },
+    { XV2_INIT_LOBBY, "Lobby", 0, [](uint64_t subsystems, int) { return Xenoverse2::InitLobby((subsystems & XV2_INIT_OPT_LOBBY_TNL) != 0); } },
+    { XV2_INIT_SOUND, "Sound", 0, [](uint64_t subsystems, int) { return Xenoverse2::InitSound((subsystems & XV2_INIT_OPT_SOUND_SEV_CMN) != 0); } },
+    { XV2_INIT_BGM, "Bgm", 0, [](uint64_t, int) { return Xenoverse2::InitBgm(); } },
+    { XV2_INIT_CAC, "Cac", 0, [](uint64_t, int) { return Xenoverse2::InitCac(); } },
+    { XV2_INIT_COSTUME_FILE, "CostumeFile", 0, [](uint64_t, int) { return Xenoverse2::InitCostumeFile(); } },
+    { XV2_INIT_STAGE_SLOTS, "StageSlots", 0, [](uint64_t, int) { return Xenoverse2::InitStageSlots(); } },
+    { XV2_INIT_STAGE_NAMES, "StageNames", 0, [](uint64_t, int lang) { return Xenoverse2::InitStageNames(lang); } },
+    { XV2_INIT_STAGE_EMB, "StageEmb", 0, [](uint64_t, int) { return Xenoverse2::InitStageEmb(); } },
+    { XV2_INIT_COMMON_DIALOGUE, "CommonDialogue", 0, [](uint64_t, int) { return Xenoverse2::InitCommonDialogue(); } },
+    { XV2_INIT_CNC, "Cnc", 0, [](uint64_t, int) { return Xenoverse2::InitDualSkill(true, false); } },
+    { XV2_INIT_CNS, "Cns", 0, [](uint64_t, int) { return Xenoverse2::InitDualSkill(false, true); } },
+    { XV2_INIT_VFX, "Vfx", 0, [](uint64_t, int) { return Xenoverse2::InitVfx(); } },
+    { XV2_INIT_SHOP_TEXT, "ShopText", 0, [](uint64_t, int lang) { return Xenoverse2::InitShopText(lang); } },
+};
+
+static const size_t xv2_num_init_nodes = sizeof(xv2_init_nodes) / sizeof(Xv2InitNode);
+
+// Shared by the tasks of an Init call, it may outlive the call by a few instructions of the last task
+struct Xv2InitRun
+{
+    uint64_t subsystems;
+    int only_this_lang;
+
+    std::vector<Xv2InitTiming> results; // Indexed like xv2_init_nodes
+    std::vector<std::atomic<int>> waiting; // Dependencies not loaded yet
+    std::atomic<size_t> remaining;
+    std::promise<void> done;
+
+    Xv2InitRun(size_t num_nodes) : results(num_nodes), waiting(num_nodes) { }
+};
+
+static void LaunchInitNode(const std::shared_ptr<Xv2InitRun> &run, size_t idx)
+{
+    ThreadPool::GetGlobal().Submit([run, idx]()
+    {
+        const Xv2InitNode &node = xv2_init_nodes[idx];
+        Xv2InitTiming &result = run->results[idx];
+        bool deps_ok = true;
+
+        for (size_t i = 0; i < xv2_num_init_nodes; i++)
+        {
+            if ((node.deps & run->subsystems & xv2_init_nodes[i].subsystem) && !run->results[i].success)
+                deps_ok = false;
+        }
+
+        if (deps_ok)
+        {
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            result.success = node.init(run->subsystems, run->only_this_lang);
+            result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        }
+
+        for (size_t i = 0; i < xv2_num_init_nodes; i++)
+        {
+            if ((run->subsystems & xv2_init_nodes[i].subsystem) && (xv2_init_nodes[i].deps & node.subsystem))
+            {
+                if (run->waiting[i].fetch_sub(1) == 1)
+                    LaunchInitNode(run, i);
+            }
+        }
+
+        if (run->remaining.fetch_sub(1) == 1)
+            run->done.set_value();
+    });
+}
+
+bool Xenoverse2::Init(uint64_t subsystems, int only_this_lang, std::vector<Xv2InitTiming> *timings)
+{
+    if (!xv2fs)
+        return false;
+
+    std::shared_ptr<Xv2InitRun> run = std::make_shared<Xv2InitRun>(xv2_num_init_nodes);
+    std::vector<size_t> roots;
+    size_t num_requested = 0;
+
+    run->subsystems = subsystems;
+    run->only_this_lang = only_this_lang;
+
+    for (size_t i = 0; i < xv2_num_init_nodes; i++)
+    {
+        const Xv2InitNode &node = xv2_init_nodes[i];
+        Xv2InitTiming &result = run->results[i];
+        int num_deps = 0;
+
+        result.subsystem = node.subsystem;
+        result.name = node.name;
+        result.seconds = 0.0;
+        result.success = false;
+
+        if (!(subsystems & node.subsystem))
+        {
+            run->waiting[i] = 0;
+            continue;
+        }
+
+        for (size_t j = 0; j < xv2_num_init_nodes; j++)
+        {
+            if (node.deps & subsystems & xv2_init_nodes[j].subsystem)
+                num_deps++;
+        }
+
+        run->waiting[i] = num_deps;
+        num_requested++;
+
+        if (num_deps == 0)
+            roots.push_back(i);
+    }
+
+    if (timings)
+        timings->clear();
+
+    if (num_requested == 0)
+        return true;
+
+    run->remaining = num_requested;
+    std::future<void> done = run->done.get_future();
+
+    // Only after all the counters are set, the first tasks may already launch their dependents
+    for (size_t idx : roots)
+        LaunchInitNode(run, idx);
+
+    ThreadPool::GetGlobal().Get(done);
+
+    bool ret = true;
+
+    for (const Xv2InitTiming &result : run->results)
+    {
+        if (!(subsystems & result.subsystem))
+            continue;
+
+        if (!result.success)
+        {
+            DPRINTF("%s: failed to load %s.\n", FUNCNAME, result.name);
+            ret = false;
+        }
+
+        if (timings)
+            timings->push_back(result);
+    }
+
+    return ret;
+}
+
 bool Xenoverse2::GetShopText(const std::string &entry_name, std::string &name, int lang)
 {
     if (game_shop_texts.size() != XV2_LANG_NUM && !InitShopText())
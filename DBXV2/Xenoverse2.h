@@ -78,6 +78,70 @@ enum
     XV2_DLC_EXTRA2 = 0x17,
 };
 
+// Subsystems for Xenoverse2::Init. Each one loads what the Init function of the same name loads with its default
+// parameters. The idb and dual skill ones are split per file, so they can load in parallel.
+enum : uint64_t
+{
+    XV2_INIT_CHARA_LIST = 1ULL << 0,
+    XV2_INIT_SYSTEM_FILES = 1ULL << 1,
+    XV2_INIT_CHARA_NAMES = 1ULL << 2,
+    XV2_INIT_CHARA_COSTUME_NAMES = 1ULL << 3,
+    XV2_INIT_SKILL_NAMES = 1ULL << 4,
+    XV2_INIT_SKILL_DESCS = 1ULL << 5,
+    XV2_INIT_SKILL_HOWS = 1ULL << 6,
+    XV2_INIT_BTLHUD_TEXT = 1ULL << 7,
+    XV2_INIT_SEL_PORT = 1ULL << 8,
+    XV2_INIT_PREBAKED = 1ULL << 9,
+    XV2_INIT_LOBBY_TEXT = 1ULL << 10,
+    XV2_INIT_CAC_COSTUME_NAMES = 1ULL << 11,
+    XV2_INIT_CAC_COSTUME_DESCS = 1ULL << 12,
+    XV2_INIT_TALISMAN_NAMES = 1ULL << 13,
+    XV2_INIT_TALISMAN_DESCS = 1ULL << 14,
+    XV2_INIT_TALISMAN_HOWS = 1ULL << 15,
+    XV2_INIT_MATERIAL_NAMES = 1ULL << 16,
+    XV2_INIT_BATTLE_NAMES = 1ULL << 17,
+    XV2_INIT_EXTRA_NAMES = 1ULL << 18,
+    XV2_INIT_PET_NAMES = 1ULL << 19,
+    XV2_INIT_IDB_COSTUMES = 1ULL << 20,
+    XV2_INIT_IDB_ACCESORIES = 1ULL << 21,
+    XV2_INIT_IDB_TALISMAN = 1ULL << 22,
+    XV2_INIT_IDB_SKILLS = 1ULL << 23,
+    XV2_INIT_IDB_MATERIAL = 1ULL << 24,
+    XV2_INIT_IDB_BATTLE = 1ULL << 25,
+    XV2_INIT_IDB_EXTRA = 1ULL << 26,
+    XV2_INIT_IDB_PET = 1ULL << 27,
+    XV2_INIT_LOBBY = 1ULL << 28,
+    XV2_INIT_SOUND = 1ULL << 29,
+    XV2_INIT_BGM = 1ULL << 30,
+    XV2_INIT_CAC = 1ULL << 31,
+    XV2_INIT_COSTUME_FILE = 1ULL << 32,
+    XV2_INIT_STAGE_SLOTS = 1ULL << 33,
+    XV2_INIT_STAGE_NAMES = 1ULL << 34,
+    XV2_INIT_STAGE_EMB = 1ULL << 35,
+    XV2_INIT_COMMON_DIALOGUE = 1ULL << 36,
+    XV2_INIT_CNC = 1ULL << 37,
+    XV2_INIT_CNS = 1ULL << 38,
+    XV2_INIT_VFX = 1ULL << 39,
+    XV2_INIT_SHOP_TEXT = 1ULL << 40,
+
+    // What InitIdb() loads
+    XV2_INIT_IDB = XV2_INIT_IDB_COSTUMES | XV2_INIT_IDB_ACCESORIES | XV2_INIT_IDB_TALISMAN | XV2_INIT_IDB_SKILLS,
+
+    // Options, the parameters of the Init functions that have them
+    XV2_INIT_OPT_ONLY_CMS = 1ULL << 56, // InitSystemFiles(only_cms=true)
+    XV2_INIT_OPT_MULTIPLE_HCI = 1ULL << 57, // InitSystemFiles(multiple_hci=true)
+    XV2_INIT_OPT_LOBBY_TNL = 1ULL << 58, // InitLobby(tnl=true)
+    XV2_INIT_OPT_SOUND_SEV_CMN = 1ULL << 59, // InitSound(load_sev_cmn=true)
+};
+
+struct Xv2InitTiming
+{
+    uint64_t subsystem; // One of XV2_INIT_*
+    const char *name;
+    double seconds; // 0 if it didn't run because of a failed dependency
+    bool success;
+};
+
 #include "X2mCostumeFile.h"
 
 extern const std::vector<std::string> xv2_lang_codes;
@@ -236,6 +300,12 @@ namespace Xenoverse2
     bool InitVfx();
     bool InitShopText(int only_this_lang=-1);
 
+    // Loads the subsystems set in subsystems (XV2_INIT_* flags) in parallel, in the shared thread pool. The result is
+    // the same as calling their Init functions one after another; subsystems that depend on others run after them.
+    // only_this_lang is passed to the msg ones. Returns false if any failed, the rest are loaded anyway.
+    // timings, if not null, receives the load time of every requested subsystem.
+    bool Init(uint64_t subsystems, int only_this_lang=-1, std::vector<Xv2InitTiming> *timings=nullptr);
+
     bool CommitCharaList(bool commit_slots, bool commit_iggy);
     bool CommitSystemFiles(bool pup, bool ikd, bool vlc);
     bool CommitSelPort();
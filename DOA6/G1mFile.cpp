@@ -160,103 +160,103 @@ bool G1MFChunk::Write(MemoryStream &out) const
     return true;
 }
 
-TiXmlElement *G1MFChunk::Decompile(TiXmlNode *root) const
+bool G1MFChunk::Decompile(XmlWriter *writer) const
 {   
-    TiXmlElement *entry_root = new TiXmlElement("G1MF");
-    entry_root->SetAttribute("version", version);
-    entry_root->SetAttribute("auto", "true");
-
-    Utils::WriteParamUnsigned(entry_root, "U_0C", data.unk_0C);
-    Utils::WriteParamUnsigned(entry_root, "num_bones", data.num_bones);
-    Utils::WriteParamUnsigned(entry_root, "U_14", data.unk_14);
-    Utils::WriteParamUnsigned(entry_root, "num_matrix", data.num_matrix);
-    Utils::WriteParamUnsigned(entry_root, "U_1C", data.unk_1C);
-    Utils::WriteParamUnsigned(entry_root, "num_materials", data.num_materials);
-    Utils::WriteParamUnsigned(entry_root, "num_material_attributes", data.num_material_attributes);
-    Utils::WriteParamUnsigned(entry_root, "num_attributes", data.num_attributes);
-    Utils::WriteParamUnsigned(entry_root, "U_2C", data.unk_2C);
-    Utils::WriteParamUnsigned(entry_root, "U_30", data.unk_30);
-    Utils::WriteParamUnsigned(entry_root, "num_vb", data.num_vb);
-    Utils::WriteParamUnsigned(entry_root, "num_layouts", data.num_layouts);
-    Utils::WriteParamUnsigned(entry_root, "num_layout_refs", data.num_layout_refs);
-    Utils::WriteParamUnsigned(entry_root, "num_bone_maps", data.num_bone_maps);
-    Utils::WriteParamUnsigned(entry_root, "num_individual_bone_maps", data.num_individual_bone_maps);
-    Utils::WriteParamUnsigned(entry_root, "num_non_shared_vb", data.num_non_shared_vb);
-    Utils::WriteParamUnsigned(entry_root, "num_submeshes", data.num_submeshes);
-    Utils::WriteParamUnsigned(entry_root, "num_submeshes2", data.num_submeshes2);
-    Utils::WriteParamUnsigned(entry_root, "U_54", data.unk_54);
-    Utils::WriteParamUnsigned(entry_root, "num_meshes", data.num_meshes);
-    Utils::WriteParamUnsigned(entry_root, "num_submeshes_in_meshes", data.num_submeshes_in_meshes);
-    Utils::WriteParamUnsigned(entry_root, "U_60", data.unk_60);
-    Utils::WriteParamUnsigned(entry_root, "U_64", data.unk_64);
-    Utils::WriteParamUnsigned(entry_root, "num_nuno2s", data.num_nuno2s);
-    Utils::WriteParamUnsigned(entry_root, "U_6C", data.unk_6C);
-    Utils::WriteParamUnsigned(entry_root, "num_nuno2s_unk11", data.num_nuno2s_unk11);
-    Utils::WriteParamUnsigned(entry_root, "num_nuno1s", data.num_nuno1s);
-    Utils::WriteParamUnsigned(entry_root, "num_nuno1s_unk4", data.num_nuno1s_unk4);
-    Utils::WriteParamUnsigned(entry_root, "num_nuno1s_control_points", data.num_nuno1s_control_points);
-    Utils::WriteParamUnsigned(entry_root, "num_nuno1s_unk1", data.num_nuno1s_unk1);
-    Utils::WriteParamUnsigned(entry_root, "num_nuno1s_unk2_and_unk3", data.num_nuno1s_unk2_and_unk3);
-    Utils::WriteParamUnsigned(entry_root, "bones_id_size", data.bones_id_size);
-    Utils::WriteParamUnsigned(entry_root, "U_8C", data.unk_8C);
+    writer->StartElement("G1MF");
+    writer->Attribute("version", version);
+    writer->Attribute("auto", "true");
+
+    Utils::WriteParamUnsigned(writer, "U_0C", data.unk_0C);
+    Utils::WriteParamUnsigned(writer, "num_bones", data.num_bones);
+    Utils::WriteParamUnsigned(writer, "U_14", data.unk_14);
+    Utils::WriteParamUnsigned(writer, "num_matrix", data.num_matrix);
+    Utils::WriteParamUnsigned(writer, "U_1C", data.unk_1C);
+    Utils::WriteParamUnsigned(writer, "num_materials", data.num_materials);
+    Utils::WriteParamUnsigned(writer, "num_material_attributes", data.num_material_attributes);
+    Utils::WriteParamUnsigned(writer, "num_attributes", data.num_attributes);
+    Utils::WriteParamUnsigned(writer, "U_2C", data.unk_2C);
+    Utils::WriteParamUnsigned(writer, "U_30", data.unk_30);
+    Utils::WriteParamUnsigned(writer, "num_vb", data.num_vb);
+    Utils::WriteParamUnsigned(writer, "num_layouts", data.num_layouts);
+    Utils::WriteParamUnsigned(writer, "num_layout_refs", data.num_layout_refs);
+    Utils::WriteParamUnsigned(writer, "num_bone_maps", data.num_bone_maps);
+    Utils::WriteParamUnsigned(writer, "num_individual_bone_maps", data.num_individual_bone_maps);
+    Utils::WriteParamUnsigned(writer, "num_non_shared_vb", data.num_non_shared_vb);
+    Utils::WriteParamUnsigned(writer, "num_submeshes", data.num_submeshes);
+    Utils::WriteParamUnsigned(writer, "num_submeshes2", data.num_submeshes2);
+    Utils::WriteParamUnsigned(writer, "U_54", data.unk_54);
+    Utils::WriteParamUnsigned(writer, "num_meshes", data.num_meshes);
+    Utils::WriteParamUnsigned(writer, "num_submeshes_in_meshes", data.num_submeshes_in_meshes);
+    Utils::WriteParamUnsigned(writer, "U_60", data.unk_60);
+    Utils::WriteParamUnsigned(writer, "U_64", data.unk_64);
+    Utils::WriteParamUnsigned(writer, "num_nuno2s", data.num_nuno2s);
+    Utils::WriteParamUnsigned(writer, "U_6C", data.unk_6C);
+    Utils::WriteParamUnsigned(writer, "num_nuno2s_unk11", data.num_nuno2s_unk11);
+    Utils::WriteParamUnsigned(writer, "num_nuno1s", data.num_nuno1s);
+    Utils::WriteParamUnsigned(writer, "num_nuno1s_unk4", data.num_nuno1s_unk4);
+    Utils::WriteParamUnsigned(writer, "num_nuno1s_control_points", data.num_nuno1s_control_points);
+    Utils::WriteParamUnsigned(writer, "num_nuno1s_unk1", data.num_nuno1s_unk1);
+    Utils::WriteParamUnsigned(writer, "num_nuno1s_unk2_and_unk3", data.num_nuno1s_unk2_and_unk3);
+    Utils::WriteParamUnsigned(writer, "bones_id_size", data.bones_id_size);
+    Utils::WriteParamUnsigned(writer, "U_8C", data.unk_8C);
 
     if (version > 21)
     {
-        Utils::WriteParamUnsigned(entry_root, "num_nunv1s", data.num_nunv1s);
-        Utils::WriteParamUnsigned(entry_root, "num_nunv1s_unk4", data.num_nunv1s_unk4);
-        Utils::WriteParamUnsigned(entry_root, "num_nunv1s_control_points", data.num_nunv1s_control_points);
-        Utils::WriteParamUnsigned(entry_root, "num_nunv1s_unk1", data.num_nunv1s_unk1);
-        Utils::WriteParamUnsigned(entry_root, "U_A0", data.unk_A0);
-        Utils::WriteParamUnsigned(entry_root, "U_A4", data.unk_A4);
-        Utils::WriteParamUnsigned(entry_root, "U_A8", data.unk_A8);
-        Utils::WriteParamUnsigned(entry_root, "U_AC", data.unk_AC);
-        Utils::WriteParamUnsigned(entry_root, "U_B0", data.unk_B0);
-        Utils::WriteParamUnsigned(entry_root, "U_B4", data.unk_B4);
-        Utils::WriteParamUnsigned(entry_root, "U_B8", data.unk_B8);
-        Utils::WriteParamUnsigned(entry_root, "U_BC", data.unk_BC);
-        Utils::WriteParamUnsigned(entry_root, "U_C0", data.unk_C0);
-        Utils::WriteParamUnsigned(entry_root, "U_C4", data.unk_C4);
-        Utils::WriteParamUnsigned(entry_root, "U_C8", data.unk_C8);
+        Utils::WriteParamUnsigned(writer, "num_nunv1s", data.num_nunv1s);
+        Utils::WriteParamUnsigned(writer, "num_nunv1s_unk4", data.num_nunv1s_unk4);
+        Utils::WriteParamUnsigned(writer, "num_nunv1s_control_points", data.num_nunv1s_control_points);
+        Utils::WriteParamUnsigned(writer, "num_nunv1s_unk1", data.num_nunv1s_unk1);
+        Utils::WriteParamUnsigned(writer, "U_A0", data.unk_A0);
+        Utils::WriteParamUnsigned(writer, "U_A4", data.unk_A4);
+        Utils::WriteParamUnsigned(writer, "U_A8", data.unk_A8);
+        Utils::WriteParamUnsigned(writer, "U_AC", data.unk_AC);
+        Utils::WriteParamUnsigned(writer, "U_B0", data.unk_B0);
+        Utils::WriteParamUnsigned(writer, "U_B4", data.unk_B4);
+        Utils::WriteParamUnsigned(writer, "U_B8", data.unk_B8);
+        Utils::WriteParamUnsigned(writer, "U_BC", data.unk_BC);
+        Utils::WriteParamUnsigned(writer, "U_C0", data.unk_C0);
+        Utils::WriteParamUnsigned(writer, "U_C4", data.unk_C4);
+        Utils::WriteParamUnsigned(writer, "U_C8", data.unk_C8);
 
         if (version >= 24)
         {
-            Utils::WriteParamUnsigned(entry_root, "U_CC", data.unk_CC);
-            Utils::WriteParamUnsigned(entry_root, "U_D0", data.unk_D0);
-            Utils::WriteParamUnsigned(entry_root, "U_D4", data.unk_D4);
-            Utils::WriteParamUnsigned(entry_root, "U_D8", data.unk_D8);
-            Utils::WriteParamUnsigned(entry_root, "U_DC", data.unk_DC);
-            Utils::WriteParamUnsigned(entry_root, "U_E0", data.unk_E0);
-            Utils::WriteParamUnsigned(entry_root, "U_E4", data.unk_E4);
-            Utils::WriteParamUnsigned(entry_root, "U_E8", data.unk_E8);
-            Utils::WriteParamUnsigned(entry_root, "U_EC", data.unk_EC);
-            Utils::WriteParamUnsigned(entry_root, "num_nuno3s", data.num_nuno3s);
-            Utils::WriteParamUnsigned(entry_root, "num_nuno3s_unk4", data.num_nuno3s_unk4);
-            Utils::WriteParamUnsigned(entry_root, "num_nuno3s_control_points", data.num_nuno3s_control_points);
-            Utils::WriteParamUnsigned(entry_root, "num_nuno3s_unk1", data.num_nuno3s_unk1);
-            Utils::WriteParamUnsigned(entry_root, "U_100", data.unk_100);
+            Utils::WriteParamUnsigned(writer, "U_CC", data.unk_CC);
+            Utils::WriteParamUnsigned(writer, "U_D0", data.unk_D0);
+            Utils::WriteParamUnsigned(writer, "U_D4", data.unk_D4);
+            Utils::WriteParamUnsigned(writer, "U_D8", data.unk_D8);
+            Utils::WriteParamUnsigned(writer, "U_DC", data.unk_DC);
+            Utils::WriteParamUnsigned(writer, "U_E0", data.unk_E0);
+            Utils::WriteParamUnsigned(writer, "U_E4", data.unk_E4);
+            Utils::WriteParamUnsigned(writer, "U_E8", data.unk_E8);
+            Utils::WriteParamUnsigned(writer, "U_EC", data.unk_EC);
+            Utils::WriteParamUnsigned(writer, "num_nuno3s", data.num_nuno3s);
+            Utils::WriteParamUnsigned(writer, "num_nuno3s_unk4", data.num_nuno3s_unk4);
+            Utils::WriteParamUnsigned(writer, "num_nuno3s_control_points", data.num_nuno3s_control_points);
+            Utils::WriteParamUnsigned(writer, "num_nuno3s_unk1", data.num_nuno3s_unk1);
+            Utils::WriteParamUnsigned(writer, "U_100", data.unk_100);
 
             if (version >= 25)
             {
-                Utils::WriteParamUnsigned(entry_root, "U_104", data.unk_104);
-                Utils::WriteParamUnsigned(entry_root, "U_108", data.unk_108);
+                Utils::WriteParamUnsigned(writer, "U_104", data.unk_104);
+                Utils::WriteParamUnsigned(writer, "U_108", data.unk_108);
 
                 if (version >= 26)
                 {
-                    Utils::WriteParamUnsigned(entry_root, "U_10C", data.unk_10C);
-                    Utils::WriteParamUnsigned(entry_root, "U_110", data.unk_110);
+                    Utils::WriteParamUnsigned(writer, "U_10C", data.unk_10C);
+                    Utils::WriteParamUnsigned(writer, "U_110", data.unk_110);
 
                     if (version >= 27)
                     {
-                        Utils::WriteParamUnsigned(entry_root, "num_nuno4s", data.num_nuno4s);
-                        Utils::WriteParamUnsigned(entry_root, "num_nuno4s_unk7", data.num_nuno4s_unk7);
-                        Utils::WriteParamUnsigned(entry_root, "num_nuno4s_unk8", data.num_nuno4s_unk8);
-                        Utils::WriteParamUnsigned(entry_root, "num_nuno4s_unk9", data.num_nuno4s_unk9);
-                        Utils::WriteParamUnsigned(entry_root, "num_nuno4s_unk10", data.num_nuno4s_unk10);
-                        Utils::WriteParamUnsigned(entry_root, "U_128", data.unk_128);
+                        Utils::WriteParamUnsigned(writer, "num_nuno4s", data.num_nuno4s);
+                        Utils::WriteParamUnsigned(writer, "num_nuno4s_unk7", data.num_nuno4s_unk7);
+                        Utils::WriteParamUnsigned(writer, "num_nuno4s_unk8", data.num_nuno4s_unk8);
+                        Utils::WriteParamUnsigned(writer, "num_nuno4s_unk9", data.num_nuno4s_unk9);
+                        Utils::WriteParamUnsigned(writer, "num_nuno4s_unk10", data.num_nuno4s_unk10);
+                        Utils::WriteParamUnsigned(writer, "U_128", data.unk_128);
 
                         if (version >= 29)
                         {
-                            Utils::WriteParamUnsigned(entry_root, "U_12C", data.unk_12C);
+                            Utils::WriteParamUnsigned(writer, "U_12C", data.unk_12C);
                         }
                     }
 
@@ -295,7 +295,7 @@ TiXmlElement *G1MFChunk::Decompile(TiXmlNode *root) const
 
                         size = (size - 0x130) / 4;                        
 
-                        Utils::WriteParamMultipleUnsigned(entry_root, "MU_130", std::vector<uint32_t>(data.unk_130, data.unk_130+size));
+                        Utils::WriteParamMultipleUnsigned(writer, "MU_130", std::vector<uint32_t>(data.unk_130, data.unk_130+size));
                     }
                 }
             }
@@ -304,11 +304,11 @@ TiXmlElement *G1MFChunk::Decompile(TiXmlNode *root) const
 
     if (extra.size() > 0)
     {
-        Utils::WriteParamBlob(entry_root, "extra_data", extra);
+        Utils::WriteParamBlob(writer, "extra_data", extra);
     }
 
-    root->LinkEndChild(entry_root);
-    return entry_root;
+    writer->EndElement();
+    return true;
 }
 
 bool G1MFChunk::Compile(const TiXmlElement *root, bool *g1mf_auto)
@@ -624,19 +624,19 @@ bool G1MSChunk::Write(MemoryStream &out) const
     return out.Seek((off64_t)end, SEEK_SET);
 }
 
-TiXmlElement *G1MSChunk::Decompile(TiXmlNode *root) const
+bool G1MSChunk::Decompile(XmlWriter *writer) const
 {
-    TiXmlElement *entry_root = new TiXmlElement("G1MS");
+    writer->StartElement("G1MS");
 
-    entry_root->SetAttribute("version", version);
-    entry_root->SetAttribute("id_size", (int)indices.size());
-    entry_root->SetAttribute("u_10", unk_10);
+    writer->Attribute("version", version);
+    writer->Attribute("id_size", (int)indices.size());
+    writer->Attribute("u_10", unk_10);
 
     if (bone_names.size() != bones.size())
     {
         DPRINTF("G1MSChunk::Decompile called before bones names set");
         throw std::runtime_error("G1MSChunk::Decompile called before bones names set.\n");
-        return nullptr;
+        return false;
     }
 
     std::vector<std::string> final_bones_str;
@@ -646,48 +646,48 @@ TiXmlElement *G1MSChunk::Decompile(TiXmlNode *root) const
         if ((size_t)b >= bone_names.size())
         {
             DPRINTF("%s: Bone %d in final_bones is over names array.\n", FUNCNAME, b);
-            return nullptr;
+            return false;
         }
 
         final_bones_str.push_back(bone_names[b]);
     }
 
-    Utils::WriteParamMultipleStrings(entry_root, "final_bones", final_bones_str);
+    Utils::WriteParamMultipleStrings(writer, "final_bones", final_bones_str);
 
     for (size_t i = 0; i < bones.size(); i++)
     {
-        TiXmlElement *bone_root = new TiXmlElement("Bone");
+        writer->StartElement("Bone");
 
-        bone_root->SetAttribute("name", bone_names[i]);
-        bone_root->SetAttribute("id", IndexToID((uint16_t)i));
-        bone_root->SetAttribute("idx", (int)i);
+        writer->Attribute("name", bone_names[i]);
+        writer->Attribute("id", IndexToID((uint16_t)i));
+        writer->Attribute("idx", (int)i);
 
         if (bones[i].parent != 0xFFFF)
         {
             if (bones[i].parent >= bone_names.size())
             {
-                bone_root->SetAttribute("parent", bones[i].parent);
+                writer->Attribute("parent", bones[i].parent);
             }
             else
             {
-                bone_root->SetAttribute("parent", bone_names[bones[i].parent]);
+                writer->Attribute("parent", bone_names[bones[i].parent]);
             }
         }
 
         if (bones[i].flags != 0xFFFF && bones[i].flags != 0)
         {
-             bone_root->SetAttribute("flags", Utils::UnsignedToString(bones[i].flags, true));
+             writer->Attribute("flags", Utils::UnsignedToString(bones[i].flags, true));
         }
 
-        Utils::WriteParamMultipleFloats(bone_root, "Translation", std::vector<float>(bones[i].position, bones[i].position+4));
-        Utils::WriteParamMultipleFloats(bone_root, "RotationQ", std::vector<float>(bones[i].rotation, bones[i].rotation+4));
-        Utils::WriteParamMultipleFloats(bone_root, "Scale", std::vector<float>(bones[i].scale, bones[i].scale+3));
+        Utils::WriteParamMultipleFloats(writer, "Translation", std::vector<float>(bones[i].position, bones[i].position+4));
+        Utils::WriteParamMultipleFloats(writer, "RotationQ", std::vector<float>(bones[i].rotation, bones[i].rotation+4));
+        Utils::WriteParamMultipleFloats(writer, "Scale", std::vector<float>(bones[i].scale, bones[i].scale+3));
 
-        entry_root->LinkEndChild(bone_root);
+        writer->EndElement();
     }
 
-    root->LinkEndChild(entry_root);
-    return entry_root;
+    writer->EndElement();
+    return true;
 }
 
 bool G1MSChunk::Compile(const TiXmlElement *root)
@@ -919,12 +919,12 @@ bool G1MMChunk::Write(MemoryStream &out) const
     return true;
 }
 
-void G1MMChunk::DecompileMatrix(TiXmlElement *root, const float *matrix)
+void G1MMChunk::DecompileMatrix(XmlWriter *writer, const float *matrix)
 {
     std::vector<float> row;
     row.resize(4);
 
-    TiXmlElement *matrix_root = new TiXmlElement("Matrix");
+    writer->StartElement("Matrix");
 
     for (int i = 0; i < 4; i++)
     {
@@ -935,10 +935,10 @@ void G1MMChunk::DecompileMatrix(TiXmlElement *root, const float *matrix)
         row[2] = matrix[(i*4)+2];
         row[3] = matrix[(i*4)+3];
 
-        Utils::WriteParamMultipleFloats(matrix_root, row_name.c_str(), row);
+        Utils::WriteParamMultipleFloats(writer, row_name.c_str(), row);
     }
 
-    root->LinkEndChild(matrix_root);
+    writer->EndElement();
 }
 
 bool G1MMChunk::CompileMatrix(const TiXmlElement *root, float *matrix)
@@ -967,17 +967,17 @@ bool G1MMChunk::CompileMatrix(const TiXmlElement *root, float *matrix)
     return true;
 }
 
-TiXmlElement *G1MMChunk::Decompile(TiXmlNode *root) const
+bool G1MMChunk::Decompile(XmlWriter *writer) const
 {
-    TiXmlElement *entry_root = new TiXmlElement("G1MM");
+    writer->StartElement("G1MM");
 
-    entry_root->SetAttribute("version", version);
+    writer->Attribute("version", version);
 
     for (const G1MMMatrix &m: matrices)
-        DecompileMatrix(entry_root, m.matrix);
+        DecompileMatrix(writer, m.matrix);
 
-    root->LinkEndChild(entry_root);
-    return entry_root;
+    writer->EndElement();
+    return true;
 }
 
 bool G1MMChunk::Compile(const TiXmlElement *root)
@@ -1040,17 +1040,17 @@ bool G1MGUnkSection1::Write(MemoryStream &out) const
     return true;
 }
 
-TiXmlElement *G1MGUnkSection1::Decompile(TiXmlNode *root) const
+bool G1MGUnkSection1::Decompile(XmlWriter *writer) const
 {
     if (!valid)
-        return nullptr;
+        return false;
 
-    TiXmlElement *entry_root = new TiXmlElement("Section1");
-    Utils::WriteComment(entry_root, "Section 1 is currently not parsed. Raw base64 ahead.");
-    Utils::WriteParamBlob(entry_root, "data", unk);
+    writer->StartElement("Section1");
+    Utils::WriteComment(writer, "Section 1 is currently not parsed. Raw base64 ahead.");
+    Utils::WriteParamBlob(writer, "data", unk);
 
-    root->LinkEndChild(entry_root);
-    return entry_root;
+    writer->EndElement();
+    return true;
 }
 
 bool G1MGUnkSection1::Compile(const TiXmlElement *root)
@@ -1102,30 +1102,30 @@ bool G1MGMaterial::Write(MemoryStream &out) const
     return true;
 }
 
-TiXmlElement *G1MGMaterial::Decompile(TiXmlNode *root, uint32_t idx) const
+bool G1MGMaterial::Decompile(XmlWriter *writer, uint32_t idx) const
 {
-    TiXmlElement *entry_root = new TiXmlElement("Material");
-    entry_root->SetAttribute("idx", idx);
+    writer->StartElement("Material");
+    writer->Attribute("idx", idx);
 
-    Utils::WriteParamUnsigned(entry_root, "Index", index);
-    Utils::WriteParamUnsigned(entry_root, "U_08", unk_08);
-    Utils::WriteParamUnsigned(entry_root, "U_0C", unk_0C);
+    Utils::WriteParamUnsigned(writer, "Index", index);
+    Utils::WriteParamUnsigned(writer, "U_08", unk_08);
+    Utils::WriteParamUnsigned(writer, "U_0C", unk_0C);
 
     for (const G1MGTexture &texture : textures)
     {
-        TiXmlElement *texture_root = new TiXmlElement("Texture");
-        texture_root->SetAttribute("id", texture.tex_id);
-        texture_root->SetAttribute("type", texture.tex_type);
-        texture_root->SetAttribute("type2", texture.tex_type2);
-        texture_root->SetAttribute("u_06", texture.unk_06);
-        texture_root->SetAttribute("u_08", texture.unk_08);
-        texture_root->SetAttribute("u_0a", texture.unk_0A);
+        writer->StartElement("Texture");
+        writer->Attribute("id", texture.tex_id);
+        writer->Attribute("type", texture.tex_type);
+        writer->Attribute("type2", texture.tex_type2);
+        writer->Attribute("u_06", texture.unk_06);
+        writer->Attribute("u_08", texture.unk_08);
+        writer->Attribute("u_0a", texture.unk_0A);
 
-        entry_root->LinkEndChild(texture_root);
+        writer->EndElement();
     }
 
-    root->LinkEndChild(entry_root);
-    return entry_root;
+    writer->EndElement();
+    return true;
 }
 
 bool G1MGMaterial::Compile(const TiXmlElement *root)
@@ -1245,17 +1245,17 @@ bool G1MGMaterialSection::Write(MemoryStream &out) const
     return out.Seek((off64_t)end, SEEK_SET);
 }
 
-TiXmlElement *G1MGMaterialSection::Decompile(TiXmlNode *root) const
+bool G1MGMaterialSection::Decompile(XmlWriter *writer) const
 {
     if (!valid)
-        return nullptr;
+        return false;
 
-    TiXmlElement *entry_root = new TiXmlElement("MaterialsSection");
+    writer->StartElement("MaterialsSection");
     for (uint32_t i = 0; i < (uint32_t)materials.size(); i++)
-        materials[i].Decompile(entry_root, i);
+        materials[i].Decompile(writer, i);
 
-    root->LinkEndChild(entry_root);
-    return entry_root;
+    writer->EndElement();
+    return true;
 }
 
 bool G1MGMaterialSection::Compile(const TiXmlElement *root)
@@ -1379,11 +1379,11 @@ bool G1MGAttribute::Write(MemoryStream &out) const
     return true;
 }
 
-TiXmlElement *G1MGAttribute::Decompile(TiXmlNode *root) const
+bool G1MGAttribute::Decompile(XmlWriter *writer) const
 {
-    TiXmlElement *entry_root = new TiXmlElement("Attribute");
-    entry_root->SetAttribute("name", name);
-    entry_root->SetAttribute("u_08", unk_08);
+    writer->StartElement("Attribute");
+    writer->Attribute("name", name);
+    writer->Attribute("u_08", unk_08);
 
     const float *float_data = (const float *)data.data();
     const int32_t *i32_data = (const int32_t *)data.data();
@@ -1393,7 +1393,7 @@ TiXmlElement *G1MGAttribute::Decompile(TiXmlNode *root) const
     {
         case 1:
 
-            entry_root->SetAttribute("data_type", "float");
+            writer->Attribute("data_type", "float");
 
             for (size_t i = 0; i < count; i++)
             {
@@ -1405,23 +1405,23 @@ TiXmlElement *G1MGAttribute::Decompile(TiXmlNode *root) const
         break;
 
         case 2:
-            entry_root->SetAttribute("data_type", "vector2D");
+            writer->Attribute("data_type", "vector2D");
             value = Utils::Vectors2DToString(float_data, count);
         break;
 
         case 3:
-            entry_root->SetAttribute("data_type", "vector3D");
+            writer->Attribute("data_type", "vector3D");
             value = Utils::Vectors3DToString(float_data, count);
         break;
 
         case 4:
-            entry_root->SetAttribute("data_type", "vector4D");
+            writer->Attribute("data_type", "vector4D");
             value = Utils::Vectors4DToString(float_data, count);
         break;
 
         case 5:
 
-            entry_root->SetAttribute("data_type", "int");
+            writer->Attribute("data_type", "int");
 
             for (size_t i = 0; i < count; i++)
             {
@@ -1433,8 +1433,8 @@ TiXmlElement *G1MGAttribute::Decompile(TiXmlNode *root) const
         break;
 
         default:
-            entry_root->SetAttribute("data_type", data_type);
-            entry_root->SetAttribute("data_count", count);
+            writer->Attribute("data_type", data_type);
+            writer->Attribute("data_count", count);
 
             for (size_t i = 0; i < data.size(); i++)
             {
@@ -1444,9 +1444,9 @@ TiXmlElement *G1MGAttribute::Decompile(TiXmlNode *root) const
             }
     }
 
-    entry_root->SetAttribute("value", value);
-    root->LinkEndChild(entry_root);
-    return entry_root;
+    writer->Attribute("value", value);
+    writer->EndElement();
+    return true;
 }
 
 bool G1MGAttribute::Compile(const TiXmlElement *root)
@@ -1604,18 +1604,18 @@ bool G1MGMaterialAttributes::Write(MemoryStream &out) const
     return true;
 }
 
-TiXmlElement *G1MGMaterialAttributes::Decompile(TiXmlNode *root, uint32_t idx) const
+bool G1MGMaterialAttributes::Decompile(XmlWriter *writer, uint32_t idx) const
 {
-    TiXmlElement *entry_root = new TiXmlElement("MaterialAttributes");
-    entry_root->SetAttribute("idx", idx);
+    writer->StartElement("MaterialAttributes");
+    writer->Attribute("idx", idx);
 
     for (const G1MGAttribute &attr: attributes)
     {
-        attr.Decompile(entry_root);
+        attr.Decompile(writer);
     }
 
-    root->LinkEndChild(entry_root);
-    return entry_root;
+    writer->EndElement();
+    return true;
 }
 
 bool G1MGMaterialAttributes::Compile(const TiXmlElement *root)
@@ -1693,20 +1693,20 @@ bool G1MGAttributesSection::Write(MemoryStream &out) const
     return out.Seek((off64_t)end, SEEK_SET);
 }
 
-TiXmlElement *G1MGAttributesSection::Decompile(TiXmlNode *root) const
+bool G1MGAttributesSection::Decompile(XmlWriter *writer) const
 {
     if (!valid)
-        return nullptr;
+        return false;
 
-    TiXmlElement *entry_root = new TiXmlElement("AttributesSection");
+    writer->StartElement("AttributesSection");
 
     for (uint32_t i = 0; i < (uint32_t)mat_attributes.size(); i++)
     {
-        mat_attributes[i].Decompile(entry_root, i);
+        mat_attributes[i].Decompile(writer, i);
     }
 
-    root->LinkEndChild(entry_root);
-    return entry_root;
+    writer->EndElement();
+    return true;
 }
 
 bool G1MGAttributesSection::Compile(const TiXmlElement *root)
@@ -1809,31 +1809,31 @@ bool G1MGVertexBuffer::Write(MemoryStream &out) const
     return true;
 }
 
-TiXmlElement *G1MGVertexBuffer::Decompile(TiXmlNode *root, const std::string &att_dir, uint32_t idx) const
+bool G1MGVertexBuffer::Decompile(XmlWriter *writer, const std::string &att_dir, uint32_t idx) const
 {
-    TiXmlElement *entry_root = new TiXmlElement("VB");
+    writer->StartElement("VB");
     std::string fn = "VB_" + Utils::ToString(idx) + ".bin";
 
-    entry_root->SetAttribute("idx", idx);
-    entry_root->SetAttribute("vertex_size", vertex_size);
-    entry_root->SetAttribute("u_00", flags);
-    entry_root->SetAttribute("u_0c", unk_0C);
+    writer->Attribute("idx", idx);
+    writer->Attribute("vertex_size", vertex_size);
+    writer->Attribute("u_00", flags);
+    writer->Attribute("u_0c", unk_0C);
 
     if (vertex.size() > 0)
     {
-        entry_root->SetAttribute("binary", fn);
+        writer->Attribute("binary", fn);
 
         std::string path = Utils::MakePathString(att_dir, fn);
         if (!Utils::WriteFileBool(path, vertex.data(), vertex.size(), true, true))
-            return nullptr;
+            return false;
     }
     else
     {
-        entry_root->SetAttribute("num_vertex", num_vertex);
+        writer->Attribute("num_vertex", num_vertex);
     }
 
-    root->LinkEndChild(entry_root);
-    return entry_root;
+    writer->EndElement();
+    return true;
 }
 
 bool G1MGVertexBuffer::Compile(const TiXmlElement *root, const std::string &att_dir)
@@ -2035,21 +2035,21 @@ bool G1MGVertexSection::Write(MemoryStream &out)
     return out.Seek((off64_t)end, SEEK_SET);
 }
 
-TiXmlElement *G1MGVertexSection::Decompile(TiXmlNode *root, const std::string &att_dir) const
+bool G1MGVertexSection::Decompile(XmlWriter *writer, const std::string &att_dir) const
 {
     if (!valid)
-        return nullptr;
+        return false;
 
-    TiXmlElement *entry_root = new TiXmlElement("VertexSection");
+    writer->StartElement("VertexSection");
 
     for (uint32_t i = 0; i < (uint32_t)vertex_bufs_pure.size(); i++)
     {
-        if (!vertex_bufs_pure[i].Decompile(entry_root, att_dir, i))
-            return nullptr;
+        if (!vertex_bufs_pure[i].Decompile(writer, att_dir, i))
+            return false;
     }
 
-    root->LinkEndChild(entry_root);
-    return entry_root;
+    writer->EndElement();
+    return true;
 }
 
 bool G1MGVertexSection::Compile(const TiXmlElement *root, const std::string &att_dir)
@@ -2135,9 +2135,9 @@ bool G1MGSemantic::Write(MemoryStream &out) const
     return true;
 }
 
-TiXmlElement *G1MGSemantic::Decompile(TiXmlNode *root) const
+bool G1MGSemantic::Decompile(XmlWriter *writer) const
 {
-    TiXmlElement *entry_root = new TiXmlElement("Semantic");
+    writer->StartElement("Semantic");
 
     uint8_t type = semantic&0xFF;
     uint8_t idx = semantic >> 8;
@@ -2203,7 +2203,7 @@ TiXmlElement *G1MGSemantic::Decompile(TiXmlNode *root) const
 
         default:
             DPRINTF("%s: Unrecognized semantic  %d\n", FUNCNAME, type);
-            return nullptr;
+            return false;
     }
 
     switch (data_type)
@@ -2252,17 +2252,17 @@ TiXmlElement *G1MGSemantic::Decompile(TiXmlNode *root) const
 
         default:
             DPRINTF("%s: Unrecognized data type %d\n", FUNCNAME, data_type);
-            return nullptr;
+            return false;
     }
 
-    entry_root->SetAttribute("index", idx);
-    entry_root->SetAttribute("type", type_str);
-    entry_root->SetAttribute("format", format_str);
-    entry_root->SetAttribute("buffer_index", buffer_index);
-    entry_root->SetAttribute("offset", offset);
+    writer->Attribute("index", idx);
+    writer->Attribute("type", type_str);
+    writer->Attribute("format", format_str);
+    writer->Attribute("buffer_index", buffer_index);
+    writer->Attribute("offset", offset);
 
-    root->LinkEndChild(entry_root);
-    return entry_root;
+    writer->EndElement();
+    return true;
 }
 
 bool G1MGSemantic::Compile(const TiXmlElement *root)
@@ -2422,7 +2422,7 @@ bool G1MGLayout::Read(FixedMemoryStream &in)
 
     refs.resize(n_refs);
 
-    if (refs.size() > 0 && !in.Read(refs.data(), refs.size()*sizeof(uint32_t)))
+    if (refs.size() > 0 && !in.ReadArray32(refs.data(), refs.size()))
         return false;
 
     if (!in.Read32(&n_sem))
@@ -2444,7 +2444,7 @@ bool G1MGLayout::Write(MemoryStream &out) const
     if (!out.Write32((uint32_t)refs.size()))
         return false;
 
-    if (refs.size() >0 && !out.Write(refs.data(), refs.size()*sizeof(uint32_t)))
+    if (refs.size() >0 && !out.WriteArray32(refs.data(), refs.size()))
         return false;
 
     if (!out.Write32((uint32_t)semantics.size()))
@@ -2459,20 +2459,20 @@ bool G1MGLayout::Write(MemoryStream &out) const
     return true;
 }
 
-TiXmlElement *G1MGLayout::Decompile(TiXmlNode *root, uint32_t idx) const
+bool G1MGLayout::Decompile(XmlWriter *writer, uint32_t idx) const
 {
-    TiXmlElement *entry_root = new TiXmlElement("Layout");
-    entry_root->SetAttribute("idx", idx);
+    writer->StartElement("Layout");
+    writer->Attribute("idx", idx);
 
-    Utils::WriteParamMultipleUnsigned(entry_root, "Refs", refs);
+    Utils::WriteParamMultipleUnsigned(writer, "Refs", refs);
     for (const G1MGSemantic &sem: semantics)
     {
-        if (!sem.Decompile(entry_root))
-            return nullptr;
+        if (!sem.Decompile(writer))
+            return false;
     }
 
-    root->LinkEndChild(entry_root);
-    return entry_root;
+    writer->EndElement();
+    return true;
 }
 
 bool G1MGLayout::Compile(const TiXmlElement *root)
@@ -2553,21 +2553,21 @@ bool G1MGLayoutSection::Write(MemoryStream &out) const
     return out.Seek((off64_t)end, SEEK_SET);
 }
 
-TiXmlElement *G1MGLayoutSection::Decompile(TiXmlNode *root) const
+bool G1MGLayoutSection::Decompile(XmlWriter *writer) const
 {
     if (!valid)
-        return nullptr;
+        return false;
 
-    TiXmlElement *entry_root = new TiXmlElement("LayoutSection");
+    writer->StartElement("LayoutSection");
 
     for (uint32_t i = 0; i < (uint32_t)entries.size(); i++)
     {
-        if (!entries[i].Decompile(entry_root, i))
-            return nullptr;
+        if (!entries[i].Decompile(writer, i))
+            return false;
     }
 
-    root->LinkEndChild(entry_root);
-    return entry_root;
+    writer->EndElement();
+    return true;
 }
 
 bool G1MGLayoutSection::Compile(const TiXmlElement *root)
@@ -2648,33 +2648,33 @@ bool G1MGBoneMapEntry::Write(MemoryStream &out) const
     return true;
 }
 
-TiXmlElement *G1MGBoneMapEntry::Decompile(TiXmlNode *root, const std::vector<std::string> &bone_names) const
+bool G1MGBoneMapEntry::Decompile(XmlWriter *writer, const std::vector<std::string> &bone_names) const
 {
-    TiXmlElement *entry_root = new TiXmlElement("BoneEntry");
+    writer->StartElement("BoneEntry");
 
     if (mapped >= bone_names.size()/* && flags != 0*/)
     {
         /*DPRINTF("%s: mapped bone (0x%x aka %d) is greater than names array (%Id) (u_04=%d).\n", FUNCNAME, mapped, mapped, bone_names.size(), unk_04);
-        return nullptr;*/
+        return false;*/
         // Happens in AYA_COS_010.g1m, possibly other
-        entry_root->SetAttribute("mapped", mapped);
+        writer->Attribute("mapped", mapped);
 
         if (flags != 0)
-            entry_root->SetAttribute("flags", Utils::UnsignedToString(flags, true));
+            writer->Attribute("flags", Utils::UnsignedToString(flags, true));
     }
     else
     {
-        entry_root->SetAttribute("bone", bone_names[mapped]);
+        writer->Attribute("bone", bone_names[mapped]);
 
         if (flags != 0)
-            entry_root->SetAttribute("flags", Utils::UnsignedToString(flags, true));
+            writer->Attribute("flags", Utils::UnsignedToString(flags, true));
     }
 
-    entry_root->SetAttribute("cloth", cloth);
-    entry_root->SetAttribute("matrix", matrix);
+    writer->Attribute("cloth", cloth);
+    writer->Attribute("matrix", matrix);
 
-    root->LinkEndChild(entry_root);
-    return entry_root;
+    writer->EndElement();
+    return true;
 }
 
 bool G1MGBoneMapEntry::Compile(const TiXmlElement *root, const std::vector<std::string> &bone_names)
@@ -2768,19 +2768,19 @@ bool G1MGBonesMap::Write(MemoryStream &out) const
     return true;
 }
 
-TiXmlElement *G1MGBonesMap::Decompile(TiXmlNode *root, const std::vector<std::string> &bone_names, uint32_t idx) const
+bool G1MGBonesMap::Decompile(XmlWriter *writer, const std::vector<std::string> &bone_names, uint32_t idx) const
 {
-    TiXmlElement *entry_root = new TiXmlElement("BonesMap");
-    entry_root->SetAttribute("idx", idx);
+    writer->StartElement("BonesMap");
+    writer->Attribute("idx", idx);
 
     for (const G1MGBoneMapEntry &entry : map)
     {
-        if (!entry.Decompile(entry_root, bone_names))
-            return nullptr;
+        if (!entry.Decompile(writer, bone_names))
+            return false;
     }
 
-    root->LinkEndChild(entry_root);
-    return entry_root;
+    writer->EndElement();
+    return true;
 }
 
 bool G1MGBonesMap::Compile(const TiXmlElement *root, const std::vector<std::string> &bone_names)
@@ -2858,21 +2858,21 @@ bool G1MGBonesMapSection::Write(MemoryStream &out) const
     return out.Seek((off64_t)end, SEEK_SET);
 }
 
-TiXmlElement *G1MGBonesMapSection::Decompile(TiXmlNode *root, const std::vector<std::string> &bone_names) const
+bool G1MGBonesMapSection::Decompile(XmlWriter *writer, const std::vector<std::string> &bone_names) const
 {
     if (!valid)
-        return nullptr;
+        return false;
 
-    TiXmlElement *entry_root = new TiXmlElement("BonesMapSection");
+    writer->StartElement("BonesMapSection");
 
     for (uint32_t i = 0; i < (uint32_t)bones_maps.size(); i++)
     {
-        if (!bones_maps[i].Decompile(entry_root, bone_names, i))
-            return nullptr;
+        if (!bones_maps[i].Decompile(writer, bone_names, i))
+            return false;
     }
 
-    root->LinkEndChild(entry_root);
-    return entry_root;
+    writer->EndElement();
+    return true;
 }
 
 bool G1MGBonesMapSection::Compile(const TiXmlElement *root, const std::vector<std::string> &bone_names)
@@ -2984,22 +2984,22 @@ bool G1MGIndexBuffer::Write(MemoryStream &out) const
     return true;
 }
 
-TiXmlElement *G1MGIndexBuffer::Decompile(TiXmlNode *root, const std::string &att_dir, uint32_t idx) const
+bool G1MGIndexBuffer::Decompile(XmlWriter *writer, const std::string &att_dir, uint32_t idx) const
 {
-    TiXmlElement *entry_root = new TiXmlElement("IB");
+    writer->StartElement("IB");
     std::string fn = "IB_" + Utils::ToString(idx) + ".bin";
 
-    entry_root->SetAttribute("idx", idx);
-    entry_root->SetAttribute("bits", type);
-    entry_root->SetAttribute("u_08", unk_08);
-    entry_root->SetAttribute("binary", fn);
+    writer->Attribute("idx", idx);
+    writer->Attribute("bits", type);
+    writer->Attribute("u_08", unk_08);
+    writer->Attribute("binary", fn);
 
     std::string path = Utils::MakePathString(att_dir, fn);
     if (!Utils::WriteFileBool(path, indices.data(), indices.size(), true, true))
-        return nullptr;
+        return false;
 
-    root->LinkEndChild(entry_root);
-    return entry_root;
+    writer->EndElement();
+    return true;
 }
 
 bool G1MGIndexBuffer::Compile(const TiXmlElement *root, const std::string &att_dir)
@@ -3092,21 +3092,21 @@ bool G1MGIndexBufferSection::Write(MemoryStream &out) const
     return out.Seek((off64_t)end, SEEK_SET);
 }
 
-TiXmlElement *G1MGIndexBufferSection::Decompile(TiXmlNode *root, const std::string &att_dir) const
+bool G1MGIndexBufferSection::Decompile(XmlWriter *writer, const std::string &att_dir) const
 {
     if (!valid)
-        return nullptr;
+        return false;
 
-    TiXmlElement *entry_root = new TiXmlElement("IndicesSection");
+    writer->StartElement("IndicesSection");
 
     for (uint32_t i = 0; i < (uint32_t)buffers.size(); i++)
     {
-        if (!buffers[i].Decompile(entry_root, att_dir, i))
-            return nullptr;
+        if (!buffers[i].Decompile(writer, att_dir, i))
+            return false;
     }
 
-    root->LinkEndChild(entry_root);
-    return entry_root;
+    writer->EndElement();
+    return true;
 }
 
 bool G1MGIndexBufferSection::Compile(const TiXmlElement *root, const std::string &att_dir)
@@ -3248,29 +3248,29 @@ bool G1MGSubmesh::Write(MemoryStream &out) const
     return true;
 }
 
-TiXmlElement *G1MGSubmesh::Decompile(TiXmlNode *root, uint32_t idx) const
-{
-    TiXmlElement *entry_root = new TiXmlElement("Submesh");
-    entry_root->SetAttribute("idx", idx);
-
-    Utils::WriteParamUnsigned(entry_root, "Flags", flags, true);
-    Utils::WriteParamSigned(entry_root, "VB", vertex_buf_ref);
-    Utils::WriteParamSigned(entry_root, "Bones_map", bones_map_index);
-    Utils::WriteComment(entry_root, "If you want a submesh to use the material of other, replace the Matpalid, U_10, Attribute and Material. Matpalid matches the number in the .mtl in DOA6.");
-    Utils::WriteParamUnsigned(entry_root, "Matpalid", matpalid);
-    Utils::WriteParamUnsigned(entry_root, "U_10", unk_10);
-    Utils::WriteParamSigned(entry_root, "Attribute", attribute);
-    Utils::WriteParamSigned(entry_root, "Material", material);
-    Utils::WriteParamSigned(entry_root, "IB", index_buf_ref);
-    Utils::WriteParamUnsigned(entry_root, "U_20", unk_20);
-    Utils::WriteParamUnsigned(entry_root, "IB_format", index_buf_fmt);
-    Utils::WriteParamUnsigned(entry_root, "VB_Start", vertex_buf_start);
-    Utils::WriteParamUnsigned(entry_root, "NumVertices", num_vertices);
-    Utils::WriteParamUnsigned(entry_root, "IB_Start", index_buf_start);
-    Utils::WriteParamUnsigned(entry_root, "NumIndices", num_indices);
-
-    root->LinkEndChild(entry_root);
-    return entry_root;
+bool G1MGSubmesh::Decompile(XmlWriter *writer, uint32_t idx) const
+{
+    writer->StartElement("Submesh");
+    writer->Attribute("idx", idx);
+
+    Utils::WriteParamUnsigned(writer, "Flags", flags, true);
+    Utils::WriteParamSigned(writer, "VB", vertex_buf_ref);
+    Utils::WriteParamSigned(writer, "Bones_map", bones_map_index);
+    Utils::WriteComment(writer, "If you want a submesh to use the material of other, replace the Matpalid, U_10, Attribute and Material. Matpalid matches the number in the .mtl in DOA6.");
+    Utils::WriteParamUnsigned(writer, "Matpalid", matpalid);
+    Utils::WriteParamUnsigned(writer, "U_10", unk_10);
+    Utils::WriteParamSigned(writer, "Attribute", attribute);
+    Utils::WriteParamSigned(writer, "Material", material);
+    Utils::WriteParamSigned(writer, "IB", index_buf_ref);
+    Utils::WriteParamUnsigned(writer, "U_20", unk_20);
+    Utils::WriteParamUnsigned(writer, "IB_format", index_buf_fmt);
+    Utils::WriteParamUnsigned(writer, "VB_Start", vertex_buf_start);
+    Utils::WriteParamUnsigned(writer, "NumVertices", num_vertices);
+    Utils::WriteParamUnsigned(writer, "IB_Start", index_buf_start);
+    Utils::WriteParamUnsigned(writer, "NumIndices", num_indices);
+
+    writer->EndElement();
+    return true;
 }
 
 bool G1MGSubmesh::Compile(const TiXmlElement *root)
@@ -3348,21 +3348,21 @@ bool G1MGSubmeshesSection::Write(MemoryStream &out) const
     return out.Seek((off64_t)end, SEEK_SET);
 }
 
-TiXmlElement *G1MGSubmeshesSection::Decompile(TiXmlNode *root) const
+bool G1MGSubmeshesSection::Decompile(XmlWriter *writer) const
 {
     if (!valid)
-        return nullptr;
+        return false;
 
-    TiXmlElement *entry_root = new TiXmlElement("SubmeshesSection");
+    writer->StartElement("SubmeshesSection");
 
     for (uint32_t i = 0; i < submeshes.size(); i++)
     {
-        if (!submeshes[i].Decompile(entry_root, i))
-            return nullptr;
+        if (!submeshes[i].Decompile(writer, i))
+            return false;
     }
 
-    root->LinkEndChild(entry_root);
-    return entry_root;
+    writer->EndElement();
+    return true;
 }
 
 bool G1MGSubmeshesSection::Compile(const TiXmlElement *root)
@@ -3435,7 +3435,7 @@ bool G1MGMesh::Read(FixedMemoryStream &in)
 
     submeshes.resize(count);
 
-    if (!in.Read(submeshes.data(), count*sizeof(uint32_t)))
+    if (!in.ReadArray32(submeshes.data(), count))
         return false;
 
     return true;
@@ -3461,7 +3461,7 @@ bool G1MGMesh::Write(MemoryStream &out) const
     if (!out.Write32((uint32_t)submeshes.size()))
         return false;
 
-    if (!out.Write(submeshes.data(), submeshes.size()*sizeof(uint32_t)))
+    if (!out.WriteArray32(submeshes.data(), submeshes.size()))
         return false;
 
     return true;
@@ -3604,7 +3604,7 @@ static bool load_names(const std::string &path, std::unordered_map<uint32_t, std
     return ret;
 }
 
-TiXmlElement *G1MGMesh::Decompile(TiXmlNode *root, uint32_t idx) const
+bool G1MGMesh::Decompile(XmlWriter *writer, uint32_t idx) const
 {
     static std::unordered_map<uint16_t, std::string> types_map =
     {
@@ -3621,8 +3621,8 @@ TiXmlElement *G1MGMesh::Decompile(TiXmlNode *root, uint32_t idx) const
         load_names("sid_alt_hash.txt", shader_map);
     }
 
-    TiXmlElement *entry_root = new TiXmlElement("Mesh");
-    entry_root->SetAttribute("idx", idx);
+    writer->StartElement("Mesh");
+    writer->Attribute("idx", idx);
 
     if (shader_map.size() > 0 && shader.length() >= 2 && shader.front() == '@')
     {
@@ -3633,30 +3633,30 @@ TiXmlElement *G1MGMesh::Decompile(TiXmlNode *root, uint32_t idx) const
             auto it = shader_map.find(hash);
             if (it != shader_map.end())
             {
-                Utils::WriteComment(entry_root, "Shader ID is " + it->second);
+                Utils::WriteComment(writer, "Shader ID is " + it->second);
             }
         }
     }
 
-    Utils::WriteParamString(entry_root, "Shader", shader);
+    Utils::WriteParamString(writer, "Shader", shader);
 
     auto it = types_map.find(type);
     if (it != types_map.end())
     {
-        Utils::WriteParamString(entry_root, "Type", it->second);
+        Utils::WriteParamString(writer, "Type", it->second);
     }
     else
     {
-        Utils::WriteParamUnsigned(entry_root, "Type", type);
+        Utils::WriteParamUnsigned(writer, "Type", type);
         //DPRINTF("*********Warning: unrecognized type %x.\n", type);
     }
 
-    Utils::WriteParamUnsigned(entry_root, "U_12", unk_12);
-    Utils::WriteParamSigned(entry_root, "External_Section_ID", external_section_id);
-    Utils::WriteParamMultipleUnsigned(entry_root, "Submeshes", submeshes);
+    Utils::WriteParamUnsigned(writer, "U_12", unk_12);
+    Utils::WriteParamSigned(writer, "External_Section_ID", external_section_id);
+    Utils::WriteParamMultipleUnsigned(writer, "Submeshes", submeshes);
 
-    root->LinkEndChild(entry_root);
-    return entry_root;
+    writer->EndElement();
+    return true;
 }
 
 bool G1MGMesh::Compile(const TiXmlElement *root)
@@ -3827,31 +3827,31 @@ bool G1MGLodGroup::Write(MemoryStream &out) const
     return true;
 }
 
-TiXmlElement *G1MGLodGroup::Decompile(TiXmlNode *root, const G1MGChunk &g1mg, size_t idx) const
+bool G1MGLodGroup::Decompile(XmlWriter *writer, const G1MGChunk &g1mg, size_t idx) const
 {
-    TiXmlElement *entry_root = new TiXmlElement("LodGroup");
-    entry_root->SetAttribute("idx", (uint32_t)idx);
-    entry_root->SetAttribute("auto", CanAutoCalcMeshCounts(g1mg) ? "true" : "false");
+    writer->StartElement("LodGroup");
+    writer->Attribute("idx", (uint32_t)idx);
+    writer->Attribute("auto", CanAutoCalcMeshCounts(g1mg) ? "true" : "false");
 
-    Utils::WriteParamUnsigned(entry_root, "U_00", unk_00);
-    Utils::WriteParamUnsigned(entry_root, "U_04", unk_04);
-    Utils::WriteParamUnsigned(entry_root, "U_08", unk_08);
-    //Utils::WriteComment(entry_root, "Notice: the sum of Count1+Count2 must equal the number of <Mesh> entries.");
-    Utils::WriteParamUnsigned(entry_root, "Count1", count1);
-    Utils::WriteParamUnsigned(entry_root, "Count2", count2);
-    Utils::WriteParamSigned(entry_root, "S_14", unk_14);
-    Utils::WriteParamUnsigned(entry_root, "U_18", unk_18);
-    Utils::WriteParamSigned(entry_root, "S_1C", unk_1C);
-    Utils::WriteParamUnsigned(entry_root, "U_20", unk_20);
+    Utils::WriteParamUnsigned(writer, "U_00", unk_00);
+    Utils::WriteParamUnsigned(writer, "U_04", unk_04);
+    Utils::WriteParamUnsigned(writer, "U_08", unk_08);
+    //Utils::WriteComment(writer, "Notice: the sum of Count1+Count2 must equal the number of <Mesh> entries.");
+    Utils::WriteParamUnsigned(writer, "Count1", count1);
+    Utils::WriteParamUnsigned(writer, "Count2", count2);
+    Utils::WriteParamSigned(writer, "S_14", unk_14);
+    Utils::WriteParamUnsigned(writer, "U_18", unk_18);
+    Utils::WriteParamSigned(writer, "S_1C", unk_1C);
+    Utils::WriteParamUnsigned(writer, "U_20", unk_20);
 
     for (uint32_t i = 0; i < (uint32_t)meshes.size(); i++)
     {
-        if (!meshes[i].Decompile(entry_root, i))
-            return nullptr;
+        if (!meshes[i].Decompile(writer, i))
+            return false;
     }
 
-    root->LinkEndChild(entry_root);
-    return entry_root;
+    writer->EndElement();
+    return true;
 }
 
 bool G1MGLodGroup::Compile(const TiXmlElement *root, bool *auto_meshes)
@@ -3981,22 +3981,22 @@ bool G1MGMeshesSection::Write(MemoryStream &out) const
     return out.Seek((off64_t)end, SEEK_SET);
 }
 
-TiXmlElement *G1MGMeshesSection::Decompile(TiXmlNode *root, const G1MGChunk &g1mg) const
+bool G1MGMeshesSection::Decompile(XmlWriter *writer, const G1MGChunk &g1mg) const
 {
     if (!valid)
-        return nullptr;
+        return false;
 
-    TiXmlElement *entry_root = new TiXmlElement("MeshesSection");
+    writer->StartElement("MeshesSection");
 
     for (uint32_t i = 0; i < (uint32_t)groups.size(); i++)
     {
-        Utils::WriteComment(entry_root, "If auto = true, Count1 & Count2 will be calculated automatically, and the meshes re-ordered if needed.");
-        if (!groups[i].Decompile(entry_root, g1mg, i))
-            return nullptr;
+        Utils::WriteComment(writer, "If auto = true, Count1 & Count2 will be calculated automatically, and the meshes re-ordered if needed.");
+        if (!groups[i].Decompile(writer, g1mg, i))
+            return false;
     }
 
-    root->LinkEndChild(entry_root);
-    return entry_root;
+    writer->EndElement();
+    return true;
 }
 
 bool G1MGMeshesSection::Compile(const TiXmlElement *root, std::vector<bool> &auto_meshes)
@@ -4245,7 +4245,7 @@ bool G1MGChunk::Write(MemoryStream &out)
     return out.Seek((off64_t)end, SEEK_SET);
 }
 
-TiXmlElement *G1MGChunk::Decompile(TiXmlNode *root, const std::string &att_dir, const std::vector<std::string> &bone_names) const
+bool G1MGChunk::Decompile(XmlWriter *writer, const std::string &att_dir, const std::vector<std::string> &bone_names) const
 {
     std::string platform_str;
     const char *ptr_plat = (const char *)&platform;
@@ -4255,72 +4255,72 @@ TiXmlElement *G1MGChunk::Decompile(TiXmlNode *root, const std::string &att_dir,
         platform_str.push_back(*ptr_plat++);
     }
 
-    TiXmlElement *entry_root = new TiXmlElement("G1MG");
-    entry_root->SetAttribute("version", version);
-    entry_root->SetAttribute("platform", platform_str);
+    writer->StartElement("G1MG");
+    writer->Attribute("version", version);
+    writer->Attribute("platform", platform_str);
 
     std::vector<float> min = { min_x, min_y, min_z };
     std::vector<float> max = { max_x, max_y, max_z };
 
-    Utils::WriteParamMultipleFloats(entry_root, "Min", min);
-    Utils::WriteParamMultipleFloats(entry_root, "Max", max);
+    Utils::WriteParamMultipleFloats(writer, "Min", min);
+    Utils::WriteParamMultipleFloats(writer, "Max", max);
 
     if (unk_section1.valid)
     {
-        if (!unk_section1.Decompile(entry_root))
-            return nullptr;
+        if (!unk_section1.Decompile(writer))
+            return false;
     }
 
     if (mat_section.valid)
     {
-        if (!mat_section.Decompile(entry_root))
-            return nullptr;
+        if (!mat_section.Decompile(writer))
+            return false;
     }
 
     if (att_section.valid)
     {
-        if (!att_section.Decompile(entry_root))
-            return nullptr;
+        if (!att_section.Decompile(writer))
+            return false;
     }
 
     if (vert_section.valid)
     {
-        if (!vert_section.Decompile(entry_root, att_dir))
-            return nullptr;
+        if (!vert_section.Decompile(writer, att_dir))
+            return false;
     }
 
     if (layout_section.valid)
     {
-        if (!layout_section.Decompile(entry_root))
-            return nullptr;
+        if (!layout_section.Decompile(writer))
+            return false;
     }
 
     if (bones_map_section.valid)
     {
-        if (!bones_map_section.Decompile(entry_root, bone_names))
-            return nullptr;
+        if (!bones_map_section.Decompile(writer, bone_names))
+            return false;
     }
 
     if (index_buf_section.valid)
     {
-        if (!index_buf_section.Decompile(entry_root, att_dir))
-            return nullptr;
+        if (!index_buf_section.Decompile(writer, att_dir))
+            return false;
     }
 
     if (submeshes_section.valid)
     {
-        if (!submeshes_section.Decompile(entry_root))
-            return nullptr;
+        if (!submeshes_section.Decompile(writer))
+            return false;
     }
 
     if (meshes_section.valid)
     {       
-        if (!meshes_section.Decompile(entry_root, *this))
-            return nullptr;
+        if (!meshes_section.Decompile(writer, *this))
+            return false;
     }
 
-    root->LinkEndChild(entry_root);
-    return entry_root;
+    writer->EndElement();
+    return true;
 }
 
 bool G1MGChunk::Compile(const TiXmlElement *root, const std::string &att_dir, const std::vector<std::string> &bone_names, std::vector<bool> &auto_meshes)
@@ -4622,42 +4622,42 @@ bool NUNO1::Write(MemoryStream &out) const
     return true;
 }
 
-static bool DecompileControlPointsInfluences(TiXmlElement *root, const std::vector<NUNOControlPoint> &control_points, const std::vector<NUNOInfluence> &influences)
+static bool DecompileControlPointsInfluences(XmlWriter *writer, const std::vector<NUNOControlPoint> &control_points, const std::vector<NUNOInfluence> &influences)
 {
-    Utils::WriteComment(root, "Number of Control_Point: " + Utils::ToString(control_points.size()));
+    Utils::WriteComment(writer, "Number of Control_Point: " + Utils::ToString(control_points.size()));
 
     for (size_t i = 0; i < control_points.size(); i++)
     {
-         TiXmlElement *control_point_root = new TiXmlElement("Control_Point");
+         writer->StartElement("Control_Point");
 
         std::string value = Utils::FloatToString(control_points[i].x) + ", " + Utils::FloatToString(control_points[i].y) +  ", " +
                             Utils::FloatToString(control_points[i].z) + ", " + Utils::FloatToString(control_points[i].w);
 
 
-        control_point_root->SetAttribute("value", value);
-        control_point_root->SetAttribute("p1", influences[i].P1);
-        control_point_root->SetAttribute("p2", influences[i].P2);
-        control_point_root->SetAttribute("p3", influences[i].P3);
-        control_point_root->SetAttribute("p4", influences[i].P4);
-        control_point_root->SetAttribute("p5", Utils::FloatToString(influences[i].P5));
-        control_point_root->SetAttribute("p6", Utils::FloatToString(influences[i].P6));
+        writer->Attribute("value", value);
+        writer->Attribute("p1", influences[i].P1);
+        writer->Attribute("p2", influences[i].P2);
+        writer->Attribute("p3", influences[i].P3);
+        writer->Attribute("p4", influences[i].P4);
+        writer->Attribute("p5", Utils::FloatToString(influences[i].P5));
+        writer->Attribute("p6", Utils::FloatToString(influences[i].P6));
 
-        root->LinkEndChild(control_point_root);
+        writer->EndElement();
     }
 
     return true;
 }
 
-static void DecompileNunoUnk1(TiXmlElement *root, const std::vector<NUNOUnk1> &unk1s)
+static void DecompileNunoUnk1(XmlWriter *writer, const std::vector<NUNOUnk1> &unk1s)
 {
-    Utils::WriteComment(root, "Number of NunoUnk1: " + Utils::ToString(unk1s.size()));
+    Utils::WriteComment(writer, "Number of NunoUnk1: " + Utils::ToString(unk1s.size()));
 
     for (const NUNOUnk1 &unk1 : unk1s)
     {
-        TiXmlElement *unk1_root = new TiXmlElement("NunoUnk1");
-        Utils::WriteParamMultipleFloats(unk1_root, "F_00", std::vector<float>(unk1.unk_00, unk1.unk_00+8));
-        Utils::WriteParamMultipleUnsigned(unk1_root, "U_20", std::vector<uint32_t>(unk1.unk_20, unk1.unk_20+4), true);
-        root->LinkEndChild(unk1_root);
+        writer->StartElement("NunoUnk1");
+        Utils::WriteParamMultipleFloats(writer, "F_00", std::vector<float>(unk1.unk_00, unk1.unk_00+8));
+        Utils::WriteParamMultipleUnsigned(writer, "U_20", std::vector<uint32_t>(unk1.unk_20, unk1.unk_20+4), true);
+        writer->EndElement();
     }
 }
 
@@ -4701,45 +4701,45 @@ static bool CompileNunoUnk1(const TiXmlElement *root, NUNOUnk1 &unk1)
     return true;
 }
 
-TiXmlElement *NUNO1::Decompile(TiXmlNode *root, const G1mFile &g1m, size_t idx) const
+bool NUNO1::Decompile(XmlWriter *writer, const G1mFile &g1m, size_t idx) const
 {
-    TiXmlElement *entry_root = new TiXmlElement("Nuno1");
-    entry_root->SetAttribute("idx", (uint32_t)idx);
+    writer->StartElement("Nuno1");
+    writer->Attribute("idx", (uint32_t)idx);
     std::string bone_name;
 
     if (!g1m.BoneIDToName(parent_bone, bone_name))
     {
         DPRINTF("%s: bone %d couldn't be resolved to a name.\n", FUNCNAME, parent_bone);
-        return nullptr;
+        return false;
     }
     else
     {
-        entry_root->SetAttribute("parent_bone", bone_name);
+        writer->Attribute("parent_bone", bone_name);
     }
 
-    Utils::WriteParamMultipleFloats(entry_root, "F_18", std::vector<float>(unk.unk_18, unk.unk_18+2));
-    Utils::WriteParamUnsigned(entry_root, "U_20", unk.unk_20);
-    Utils::WriteParamMultipleFloats(entry_root, "F_24", std::vector<float>(unk.unk_24, unk.unk_24+9));
-    Utils::WriteParamUnsigned(entry_root, "U_48", unk.unk_48, true);
-    Utils::WriteParamMultipleFloats(entry_root, "F_4C", std::vector<float>(unk.unk_4C, unk.unk_4C+6));
-    Utils::WriteParamMultipleUnsigned(entry_root, "U_64", std::vector<uint32_t>(unk.unk_64, unk.unk_64+4));
+    Utils::WriteParamMultipleFloats(writer, "F_18", std::vector<float>(unk.unk_18, unk.unk_18+2));
+    Utils::WriteParamUnsigned(writer, "U_20", unk.unk_20);
+    Utils::WriteParamMultipleFloats(writer, "F_24", std::vector<float>(unk.unk_24, unk.unk_24+9));
+    Utils::WriteParamUnsigned(writer, "U_48", unk.unk_48, true);
+    Utils::WriteParamMultipleFloats(writer, "F_4C", std::vector<float>(unk.unk_4C, unk.unk_4C+6));
+    Utils::WriteParamMultipleUnsigned(writer, "U_64", std::vector<uint32_t>(unk.unk_64, unk.unk_64+4));
 
-    if (!DecompileControlPointsInfluences(entry_root, control_points, influences))
-        return nullptr;
+    if (!DecompileControlPointsInfluences(writer, control_points, influences))
+        return false;
 
-    DecompileNunoUnk1(entry_root, unk1s);
+    DecompileNunoUnk1(writer, unk1s);
 
     if (unk2s.size() > 0)
-        Utils::WriteParamMultipleUnsigned(entry_root, "NunoUnk2", unk2s);
+        Utils::WriteParamMultipleUnsigned(writer, "NunoUnk2", unk2s);
 
     if (unk3s.size() > 0)
-        Utils::WriteParamMultipleUnsigned(entry_root, "NunoUnk3", unk3s);
+        Utils::WriteParamMultipleUnsigned(writer, "NunoUnk3", unk3s);
 
     if (unk4s.size() > 0)
-        Utils::WriteParamMultipleUnsigned(entry_root, "NunoUnk4", unk4s);
+        Utils::WriteParamMultipleUnsigned(writer, "NunoUnk4", unk4s);
 
-    root->LinkEndChild(entry_root);
-    return entry_root;
+    writer->EndElement();
+    return true;
 }
 
 bool NUNO1::Compile(const TiXmlElement *root, const G1mFile &g1m)
@@ -4869,47 +4869,47 @@ bool NUNO2::Write(MemoryStream &out) const
     return true;
 }
 
-TiXmlElement *NUNO2::Decompile(TiXmlNode *root, const G1mFile &g1m, size_t idx) const
+bool NUNO2::Decompile(XmlWriter *writer, const G1mFile &g1m, size_t idx) const
 {
-    TiXmlElement *entry_root = new TiXmlElement("Nuno2");
-    entry_root->SetAttribute("idx", (uint32_t)idx);
+    writer->StartElement("Nuno2");
+    writer->Attribute("idx", (uint32_t)idx);
 
     std::string bone_name;
 
     if (!g1m.BoneIDToName(parent_bone, bone_name))
     {
         /*DPRINTF("%s: bone %d couldn't be resolved to a name.\n", FUNCNAME, parent_bone);
-        return nullptr;*/
-        entry_root->SetAttribute("parent_bone", parent_bone);
+        return false;*/
+        writer->Attribute("parent_bone", parent_bone);
     }
     else
     {
-        entry_root->SetAttribute("parent_bone", bone_name);
+        writer->Attribute("parent_bone", bone_name);
     }
 
     if (dummy != 0)
-        Utils::WriteParamUnsigned(entry_root, "dummy", dummy, true);
+        Utils::WriteParamUnsigned(writer, "dummy", dummy, true);
 
-    Utils::WriteParamSigned(entry_root, "I_04", unk_04);
-    Utils::WriteParamMultipleFloats(entry_root, "F_10", std::vector<float>(unk.unk_10, unk.unk_10+9));
-    Utils::WriteParamUnsigned(entry_root, "U_34", unk.unk_34, true);
-    Utils::WriteParamMultipleFloats(entry_root, "F_38", std::vector<float>(unk.unk_38, unk.unk_38+9));
+    Utils::WriteParamSigned(writer, "I_04", unk_04);
+    Utils::WriteParamMultipleFloats(writer, "F_10", std::vector<float>(unk.unk_10, unk.unk_10+9));
+    Utils::WriteParamUnsigned(writer, "U_34", unk.unk_34, true);
+    Utils::WriteParamMultipleFloats(writer, "F_38", std::vector<float>(unk.unk_38, unk.unk_38+9));
 
     for (const NUNOUnk11 &unk11 : unk11s)
     {
-        TiXmlElement *unk11_root = new TiXmlElement("NunoUnk11");
+        writer->StartElement("NunoUnk11");
 
-        Utils::WriteParamMultipleUnsigned(unk11_root, "U_00", std::vector<uint32_t>(unk11.unk_00, unk11.unk_00+4));
-        Utils::WriteParamMultipleFloats(unk11_root, "F_10", std::vector<float>(unk11.unk_10, unk11.unk_10+4));
+        Utils::WriteParamMultipleUnsigned(writer, "U_00", std::vector<uint32_t>(unk11.unk_00, unk11.unk_00+4));
+        Utils::WriteParamMultipleFloats(writer, "F_10", std::vector<float>(unk11.unk_10, unk11.unk_10+4));
 
-        entry_root->LinkEndChild(unk11_root);
+        writer->EndElement();
     }
 
     if (unk2s.size() > 0)
-        Utils::WriteParamMultipleUnsigned(entry_root, "NunoUnk2", unk2s);
+        Utils::WriteParamMultipleUnsigned(writer, "NunoUnk2", unk2s);
 
-    root->LinkEndChild(entry_root);
-    return entry_root;
+    writer->EndElement();
+    return true;
 }
 
 bool NUNO2::Compile(const TiXmlElement *root, const G1mFile &g1m)
@@ -5186,95 +5186,95 @@ bool NUNO3::Write(MemoryStream &out) const
     return true;
 }
 
-TiXmlElement *NUNO3::Decompile(TiXmlNode *root, const G1mFile &g1m, size_t idx) const
+bool NUNO3::Decompile(XmlWriter *writer, const G1mFile &g1m, size_t idx) const
 {
-    TiXmlElement *entry_root = new TiXmlElement("Nuno3");
-    entry_root->SetAttribute("idx", (uint32_t)idx);
+    writer->StartElement("Nuno3");
+    writer->Attribute("idx", (uint32_t)idx);
 
     std::string bone_name;
 
     if (!g1m.BoneIDToName(parent_bone, bone_name))
     {
         /*DPRINTF("%s: bone %d couldn't be resolved to a name.\n", FUNCNAME, parent_bone);
-        return nullptr;*/
-        entry_root->SetAttribute("parent_bone", parent_bone);
+        return false;*/
+        writer->Attribute("parent_bone", parent_bone);
     }
     else
     {
-        entry_root->SetAttribute("parent_bone", bone_name);
+        writer->Attribute("parent_bone", bone_name);
     }
 
     if (dummy != 0)
-        Utils::WriteParamUnsigned(entry_root, "dummy", dummy, true);
+        Utils::WriteParamUnsigned(writer, "dummy", dummy, true);
 
-    Utils::WriteParamUnsigned(entry_root, "U_10", unk_10);
+    Utils::WriteParamUnsigned(writer, "U_10", unk_10);
 
     if (version >= 35)
     {
         // New parser
-        Utils::WriteParamMultipleUnsigned(entry_root, "U_1C", std::vector<uint32_t>(np_1C, np_1C+3), true);
-        Utils::WriteParamBlob(entry_root, "extra_data", extra);
+        Utils::WriteParamMultipleUnsigned(writer, "U_1C", std::vector<uint32_t>(np_1C, np_1C+3), true);
+        Utils::WriteParamBlob(writer, "extra_data", extra);
     }
     else
     {
-        Utils::WriteParamMultipleUnsigned(entry_root, "U_1C", std::vector<uint32_t>(unk_1C, unk_1C+4), true);
-        Utils::WriteParamUnsigned(entry_root, "Opcode", nun_opcode);
+        Utils::WriteParamMultipleUnsigned(writer, "U_1C", std::vector<uint32_t>(unk_1C, unk_1C+4), true);
+        Utils::WriteParamUnsigned(writer, "Opcode", nun_opcode);
 
         if (version >= 30)
         {
-            Utils::WriteParamUnsigned(entry_root, "U_30", unk_30);
-            Utils::WriteParamUnsigned(entry_root, "U_34", unk_34);
+            Utils::WriteParamUnsigned(writer, "U_30", unk_30);
+            Utils::WriteParamUnsigned(writer, "U_34", unk_34);
         }
 
-        Utils::WriteParamMultipleFloats(entry_root, "F_30", std::vector<float>(unk.unk_30, unk.unk_30+9));
-        Utils::WriteParamUnsigned(entry_root, "U_54", unk.unk_54, true);
-        Utils::WriteParamUnsigned(entry_root, "U_58", unk.unk_58, true);
-        Utils::WriteParamMultipleFloats(entry_root, "F_5C", std::vector<float>(unk.unk_5C, unk.unk_5C+11));
-        Utils::WriteParamMultipleUnsigned(entry_root, "U_88", std::vector<uint32_t>(unk.unk_88, unk.unk_88+4), true);
-        Utils::WriteParamMultipleFloats(entry_root, "F_98", std::vector<float>(unk.unk_98, unk.unk_98+7));
-        Utils::WriteParamUnsigned(entry_root, "U_B4", unk.unk_B4, true);
-        Utils::WriteParamFloat(entry_root, "F_B8", unk.unk_B8);
-        Utils::WriteParamMultipleUnsigned(entry_root, "U_BC", std::vector<uint32_t>(unk.unk_BC, unk.unk_BC+7), true);
+        Utils::WriteParamMultipleFloats(writer, "F_30", std::vector<float>(unk.unk_30, unk.unk_30+9));
+        Utils::WriteParamUnsigned(writer, "U_54", unk.unk_54, true);
+        Utils::WriteParamUnsigned(writer, "U_58", unk.unk_58, true);
+        Utils::WriteParamMultipleFloats(writer, "F_5C", std::vector<float>(unk.unk_5C, unk.unk_5C+11));
+        Utils::WriteParamMultipleUnsigned(writer, "U_88", std::vector<uint32_t>(unk.unk_88, unk.unk_88+4), true);
+        Utils::WriteParamMultipleFloats(writer, "F_98", std::vector<float>(unk.unk_98, unk.unk_98+7));
+        Utils::WriteParamUnsigned(writer, "U_B4", unk.unk_B4, true);
+        Utils::WriteParamFloat(writer, "F_B8", unk.unk_B8);
+        Utils::WriteParamMultipleUnsigned(writer, "U_BC", std::vector<uint32_t>(unk.unk_BC, unk.unk_BC+7), true);
 
         if (version >= 30)
         {
-            Utils::WriteParamMultipleUnsigned(entry_root, "U_E0", std::vector<uint32_t>(unk2.unk_E0, unk2.unk_E0+4));
-            Utils::WriteParamSigned(entry_root, "I_F0", unk2.unk_F0);
+            Utils::WriteParamMultipleUnsigned(writer, "U_E0", std::vector<uint32_t>(unk2.unk_E0, unk2.unk_E0+4));
+            Utils::WriteParamSigned(writer, "I_F0", unk2.unk_F0);
 
             if (version >= 32 && nun_opcode == 3)
             {
-                Utils::WriteParamMultipleFloats(entry_root, "F_F4", std::vector<float>(unk3.unk_F4, unk3.unk_F4+5));
+                Utils::WriteParamMultipleFloats(writer, "F_F4", std::vector<float>(unk3.unk_F4, unk3.unk_F4+5));
             }
         }
     }
 
-    if (!DecompileControlPointsInfluences(entry_root, control_points, influences))
-        return nullptr;
+    if (!DecompileControlPointsInfluences(writer, control_points, influences))
+        return false;
 
-    DecompileNunoUnk1(entry_root, unk1s);
+    DecompileNunoUnk1(writer, unk1s);
 
     if (unk4s.size() > 0)
-        Utils::WriteParamMultipleUnsigned(entry_root, "NunoUnk4", unk4s);
+        Utils::WriteParamMultipleUnsigned(writer, "NunoUnk4", unk4s);
 
     for (const NUNOUnk5 &unk5 : unk5s)
     {
-        TiXmlElement *unk1_root = new TiXmlElement("NunoUnk5");
-        unk1_root->SetAttribute("u_00", unk5.unk_00);
-        unk1_root->SetAttribute("u_04", unk5.unk_04);
-        entry_root->LinkEndChild(unk1_root);
+        writer->StartElement("NunoUnk5");
+        writer->Attribute("u_00", unk5.unk_00);
+        writer->Attribute("u_04", unk5.unk_04);
+        writer->EndElement();
     }
 
     for (const NUNOUnk6 &unk6 : unk6s)
     {
-        TiXmlElement *unk1_root = new TiXmlElement("NunoUnk6");
-        unk1_root->SetAttribute("u_00", unk6.unk_00);
-        unk1_root->SetAttribute("u_04", unk6.unk_04);
-        unk1_root->SetAttribute("f_08", Utils::FloatToString(unk6.unk_08));
-        entry_root->LinkEndChild(unk1_root);
+        writer->StartElement("NunoUnk6");
+        writer->Attribute("u_00", unk6.unk_00);
+        writer->Attribute("u_04", unk6.unk_04);
+        writer->Attribute("f_08", Utils::FloatToString(unk6.unk_08));
+        writer->EndElement();
     }
 
-    root->LinkEndChild(entry_root);
-    return entry_root;
+    writer->EndElement();
+    return true;
 }
 
 bool NUNO3::Compile(const TiXmlElement *root, const G1mFile &g1m, uint32_t version)
@@ -5531,74 +5531,74 @@ bool NUNO4::Write(MemoryStream &out) const
     return true;
 }
 
-TiXmlElement *NUNO4::Decompile(TiXmlNode *root, const G1mFile &g1m, size_t idx) const
+bool NUNO4::Decompile(XmlWriter *writer, const G1mFile &g1m, size_t idx) const
 {
-    TiXmlElement *entry_root = new TiXmlElement("Nuno4");
-    entry_root->SetAttribute("idx", (uint32_t)idx);
+    writer->StartElement("Nuno4");
+    writer->Attribute("idx", (uint32_t)idx);
 
     std::string bone_name;
 
     if (!g1m.BoneIDToName(parent_bone, bone_name))
     {
         DPRINTF("%s: bone %d couldn't be resolved to a name.\n", FUNCNAME, parent_bone);
-        return nullptr;
+        return false;
     }
     else
     {
-        entry_root->SetAttribute("parent_bone", bone_name);
+        writer->Attribute("parent_bone", bone_name);
     }
 
     if (version < 30)
     {
-        Utils::WriteParamFloat(entry_root, "F_14", u29.unk_14);
-        Utils::WriteParamUnsigned(entry_root, "U_18", u29.unk_18);
-        Utils::WriteParamMultipleFloats(entry_root, "F_1C", std::vector<float>(u29.unk_1C, u29.unk_1C+5));
-        Utils::WriteParamUnsigned(entry_root, "U_30", u29.unk_30);
-        Utils::WriteParamMultipleFloats(entry_root, "F_34", std::vector<float>(u29.unk_34, u29.unk_34+16));
+        Utils::WriteParamFloat(writer, "F_14", u29.unk_14);
+        Utils::WriteParamUnsigned(writer, "U_18", u29.unk_18);
+        Utils::WriteParamMultipleFloats(writer, "F_1C", std::vector<float>(u29.unk_1C, u29.unk_1C+5));
+        Utils::WriteParamUnsigned(writer, "U_30", u29.unk_30);
+        Utils::WriteParamMultipleFloats(writer, "F_34", std::vector<float>(u29.unk_34, u29.unk_34+16));
     }
     else
     {
-        Utils::WriteParamUnsigned(entry_root, "U_14", u30.unk_14);
-        Utils::WriteParamUnsigned(entry_root, "U_18", u30.unk_18);
-        Utils::WriteParamFloat(entry_root, "F_1C", u30.unk_1C);
-        Utils::WriteParamUnsigned(entry_root, "U_20", u30.unk_20);
-        Utils::WriteParamMultipleFloats(entry_root, "F_24", std::vector<float>(u30.unk_24, u30.unk_24+5));
-        Utils::WriteParamUnsigned(entry_root, "U_38", u30.unk_38);
-        Utils::WriteParamMultipleFloats(entry_root, "F_3C", std::vector<float>(u30.unk_3C, u30.unk_3C+14));
-        Utils::WriteParamUnsigned(entry_root, "U_74", u30.unk_74);
-        Utils::WriteParamMultipleFloats(entry_root, "F_78", std::vector<float>(u30.unk_78, u30.unk_78+5));
-        Utils::WriteParamSigned(entry_root, "U_8C", u30.unk_8C);
-        Utils::WriteParamMultipleFloats(entry_root, "F_90", std::vector<float>(u30.unk_90, u30.unk_90+11));
+        Utils::WriteParamUnsigned(writer, "U_14", u30.unk_14);
+        Utils::WriteParamUnsigned(writer, "U_18", u30.unk_18);
+        Utils::WriteParamFloat(writer, "F_1C", u30.unk_1C);
+        Utils::WriteParamUnsigned(writer, "U_20", u30.unk_20);
+        Utils::WriteParamMultipleFloats(writer, "F_24", std::vector<float>(u30.unk_24, u30.unk_24+5));
+        Utils::WriteParamUnsigned(writer, "U_38", u30.unk_38);
+        Utils::WriteParamMultipleFloats(writer, "F_3C", std::vector<float>(u30.unk_3C, u30.unk_3C+14));
+        Utils::WriteParamUnsigned(writer, "U_74", u30.unk_74);
+        Utils::WriteParamMultipleFloats(writer, "F_78", std::vector<float>(u30.unk_78, u30.unk_78+5));
+        Utils::WriteParamSigned(writer, "U_8C", u30.unk_8C);
+        Utils::WriteParamMultipleFloats(writer, "F_90", std::vector<float>(u30.unk_90, u30.unk_90+11));
     }
 
     for (const NUNOUnk7 &unk7 : unk7s)
     {
-        TiXmlElement *unk7_root = new TiXmlElement("NunoUnk7");
-        Utils::WriteParamMultipleFloats(unk7_root, "F_00", std::vector<float>(unk7.unk_00, unk7.unk_00+7));
-        entry_root->LinkEndChild(unk7_root);
+        writer->StartElement("NunoUnk7");
+        Utils::WriteParamMultipleFloats(writer, "F_00", std::vector<float>(unk7.unk_00, unk7.unk_00+7));
+        writer->EndElement();
     }
 
     for (const NUNOUnk8 &unk8: unk8s)
     {
-        TiXmlElement *unk8_root = new TiXmlElement("NunoUnk8");
-        unk8_root->SetAttribute("f_00", Utils::FloatToString(unk8.unk_00));
-        unk8_root->SetAttribute("f_04", Utils::FloatToString(unk8.unk_04));
-        entry_root->LinkEndChild(unk8_root);
+        writer->StartElement("NunoUnk8");
+        writer->Attribute("f_00", Utils::FloatToString(unk8.unk_00));
+        writer->Attribute("f_04", Utils::FloatToString(unk8.unk_04));
+        writer->EndElement();
     }
 
     if (unk9s.size() > 0)
-        Utils::WriteParamMultipleUnsigned(entry_root, "NunoUnk9", unk9s);
+        Utils::WriteParamMultipleUnsigned(writer, "NunoUnk9", unk9s);
 
     for (const NUNOUnk10 &unk10 : unk10s)
     {
-        TiXmlElement *unk10_root = new TiXmlElement("NunoUnk10");
-        unk10_root->SetAttribute("u_00", unk10.unk_00);
-        unk10_root->SetAttribute("u_04", unk10.unk_04);
-        entry_root->LinkEndChild(unk10_root);
+        writer->StartElement("NunoUnk10");
+        writer->Attribute("u_00", unk10.unk_00);
+        writer->Attribute("u_04", unk10.unk_04);
+        writer->EndElement();
     }
 
-    root->LinkEndChild(entry_root);
-    return entry_root;
+    writer->EndElement();
+    return true;
 }
 
 bool NUNO4::Compile(const TiXmlElement *root, const G1mFile &g1m, uint32_t version)
@@ -5970,52 +5970,52 @@ bool NUNOChunk::Write(MemoryStream &out) const
     return out.Seek((off64_t)end, SEEK_SET);
 }
 
-TiXmlElement *NUNOChunk::Decompile(TiXmlNode *root, const G1mFile &g1m) const
+bool NUNOChunk::Decompile(XmlWriter *writer, const G1mFile &g1m) const
 {
-    TiXmlElement *entry_root = new TiXmlElement("NUNO");
-    entry_root->SetAttribute("version", version);
+    writer->StartElement("NUNO");
+    writer->Attribute("version", version);
 
     for (size_t i = 0; i < nuno1s.size(); i++)
     {
-        if (!nuno1s[i].Decompile(entry_root, g1m, i))
-            return nullptr;
+        if (!nuno1s[i].Decompile(writer, g1m, i))
+            return false;
     }
 
     for (size_t i = 0; i < nuno2s.size(); i++)
     {
-        if (!nuno2s[i].Decompile(entry_root, g1m, i))
-            return nullptr;
+        if (!nuno2s[i].Decompile(writer, g1m, i))
+            return false;
     }
 
     for (size_t i = 0; i < nuno3s.size(); i++)
     {
-        if (!nuno3s[i].Decompile(entry_root, g1m, i))
-            return nullptr;
+        if (!nuno3s[i].Decompile(writer, g1m, i))
+            return false;
     }
 
     for (size_t i = 0; i < nuno4s.size(); i++)
     {
-        if (!nuno4s[i].Decompile(entry_root, g1m, i))
-            return nullptr;
+        if (!nuno4s[i].Decompile(writer, g1m, i))
+            return false;
     }
 
     if (nuno4s_blob.size() > 0)
     {
-        Utils::WriteParamBlob(entry_root, "Nuno4s", nuno4s_blob);
+        Utils::WriteParamBlob(writer, "Nuno4s", nuno4s_blob);
     }
 
     if (nuno5s_blob.size() > 0)
     {
-        Utils::WriteParamBlob(entry_root, "Nuno5s", nuno5s_blob);
+        Utils::WriteParamBlob(writer, "Nuno5s", nuno5s_blob);
     }
 
     if (nuno6s_blob.size() > 0)
     {
-        Utils::WriteParamBlob(entry_root, "Nuno6s", nuno6s_blob);
+        Utils::WriteParamBlob(writer, "Nuno6s", nuno6s_blob);
     }
 
-    root->LinkEndChild(entry_root);
-    return entry_root;
+    writer->EndElement();
+    return true;
 }
 
 bool NUNOChunk::Compile(const TiXmlElement *root, const G1mFile &g1m)
@@ -6260,37 +6260,37 @@ bool NUNV1::Write(MemoryStream &out) const
     return true;
 }
 
-TiXmlElement *NUNV1::Decompile(TiXmlNode *root, const G1mFile &g1m, size_t idx) const
+bool NUNV1::Decompile(XmlWriter *writer, const G1mFile &g1m, size_t idx) const
 {
-    TiXmlElement *entry_root = new TiXmlElement("Nunv1");
-    entry_root->SetAttribute("idx", (uint32_t)idx);
+    writer->StartElement("Nunv1");
+    writer->Attribute("idx", (uint32_t)idx);
 
     std::string bone_name;
 
     if (!g1m.BoneIDToName(parent_bone, bone_name))
     {
         DPRINTF("%s: bone %d couldn't be resolved to a name.\n", FUNCNAME, parent_bone);
-        return nullptr;
+        return false;
     }
     else
     {
-        entry_root->SetAttribute("parent_bone", bone_name);
+        writer->Attribute("parent_bone", bone_name);
     }
 
-    Utils::WriteParamUnsigned(entry_root, "U_10", unk.unk_10);
-    Utils::WriteParamMultipleFloats(entry_root, "F_14", std::vector<float>(unk.unk_14, unk.unk_14+19));
-    Utils::WriteParamMultipleUnsigned(entry_root, "U_60", std::vector<uint32_t>(unk.unk_60, unk.unk_60+5), true);
+    Utils::WriteParamUnsigned(writer, "U_10", unk.unk_10);
+    Utils::WriteParamMultipleFloats(writer, "F_14", std::vector<float>(unk.unk_14, unk.unk_14+19));
+    Utils::WriteParamMultipleUnsigned(writer, "U_60", std::vector<uint32_t>(unk.unk_60, unk.unk_60+5), true);
 
-    if (!DecompileControlPointsInfluences(entry_root, control_points, influences))
-        return nullptr;
+    if (!DecompileControlPointsInfluences(writer, control_points, influences))
+        return false;
 
-    DecompileNunoUnk1(entry_root, unk1s);
+    DecompileNunoUnk1(writer, unk1s);
 
     if (unk4s.size() > 0)
-        Utils::WriteParamMultipleUnsigned(entry_root, "NunoUnk4", unk4s);
+        Utils::WriteParamMultipleUnsigned(writer, "NunoUnk4", unk4s);
 
-    root->LinkEndChild(entry_root);
-    return entry_root;
+    writer->EndElement();
+    return true;
 }
 
 bool NUNV1::Compile(const TiXmlElement *root, const G1mFile &g1m)
@@ -6454,19 +6454,19 @@ bool NUNVChunk::Write(MemoryStream &out) const
     return out.Seek((off64_t)end, SEEK_SET);
 }
 
-TiXmlElement *NUNVChunk::Decompile(TiXmlNode *root, const G1mFile &g1m) const
+bool NUNVChunk::Decompile(XmlWriter *writer, const G1mFile &g1m) const
 {
-    TiXmlElement *entry_root = new TiXmlElement("NUNV");
-    entry_root->SetAttribute("version", version);
+    writer->StartElement("NUNV");
+    writer->Attribute("version", version);
 
     for (size_t i = 0; i < nunv1s.size(); i++)
     {
-        if (!nunv1s[i].Decompile(entry_root, g1m, i))
-            return nullptr;
+        if (!nunv1s[i].Decompile(writer, g1m, i))
+            return false;
     }
 
-    root->LinkEndChild(entry_root);
-    return entry_root;
+    writer->EndElement();
+    return true;
 }
 
 bool NUNVChunk::Compile(const TiXmlElement *root, const G1mFile &g1m)
@@ -6553,7 +6553,7 @@ bool UnkChunk::Write(MemoryStream &out) const
     return true;
 }
 
-TiXmlElement *UnkChunk::Decompile(TiXmlNode *root, const std::string &att_dir, uint32_t idx) const
+bool UnkChunk::Decompile(XmlWriter *writer, const std::string &att_dir, uint32_t idx) const
 {
     std::string chunk_name;
 
@@ -6590,18 +6590,18 @@ TiXmlElement *UnkChunk::Decompile(TiXmlNode *root, const std::string &att_dir, u
         throw std::runtime_error("Not recognized chunk type, shouldn't be here.\n");
     }
 
-    TiXmlElement *entry_root = new TiXmlElement(chunk_name);
-    entry_root->SetAttribute("version", Utils::GetShortVersion(version));
+    writer->StartElement(chunk_name);
+    writer->Attribute("version", Utils::GetShortVersion(version));
 
     std::string fn = Utils::ToString(idx) + "." + Utils::ToLowerCase(chunk_name);
-    entry_root->SetAttribute("binary", fn);
+    writer->Attribute("binary", fn);
 
     std::string path = Utils::MakePathString(att_dir, fn);
     if (!Utils::WriteFileBool(path, unk.data(), unk.size(), true, true))
-        return nullptr;
+        return false;
 
-    root->LinkEndChild(entry_root);
-    return entry_root;
+    writer->EndElement();
+    return true;
 }
 
 bool UnkChunk::Compile(const TiXmlElement *root, const std::string &att_dir, uint32_t type)
@@ -7179,30 +7179,42 @@ uint8_t *G1mFile::Save(size_t *psize)
 TiXmlDocument *G1mFile::Decompile() const
 {
     TiXmlDocument *doc = new TiXmlDocument();
-    TiXmlDeclaration* decl = new TiXmlDeclaration("1.0", "utf-8", "" );
-    doc->LinkEndChild(decl);
+    XmlWriter writer(doc);
 
-    TiXmlElement *root = new TiXmlElement("G1M");
-    root->SetAttribute("version", version);    
+    if (!DecompileStream(&writer))
+    {
+        delete doc;
+        return nullptr;
+    }
+
+    return doc;
+}
+
+bool G1mFile::DecompileStream(XmlWriter *writer) const
+{
+    writer->Declaration();
+
+    writer->StartElement("G1M");
+    writer->Attribute("version", version);
 
     for (const G1MFChunk &g1mf : g1mfs)
     {
-         Utils::WriteComment(root, "If auto = true, the known values will be automatically calculated by the program.");
+         Utils::WriteComment(writer, "If auto = true, the known values will be automatically calculated by the program.");
 
-        if (!g1mf.Decompile(root))
-            return nullptr;
+        if (!g1mf.Decompile(writer))
+            return false;
     }
 
     for (const G1MSChunk &g1ms : g1mss)
     {
-        if (!g1ms.Decompile(root))
-            return nullptr;
+        if (!g1ms.Decompile(writer))
+            return false;
     }
 
     for (const G1MMChunk &g1mm : g1mms)
     {
-        if (!g1mm.Decompile(root))
-            return nullptr;
+        if (!g1mm.Decompile(writer))
+            return false;
     }
 
     for (const G1MGChunk &g1mg : g1mgs)
@@ -7210,33 +7222,33 @@ TiXmlDocument *G1mFile::Decompile() const
         if (g1mss.size() == 0)
         {
             DPRINTF("Umm, this is a weird case of a .g1m with G1MG but without G1MS, cannot decompile!\n");
-            return nullptr;
+            return false;
         }
 
-        if (!g1mg.Decompile(root, att_dir, g1mss[0].bone_names))
-            return nullptr;
+        if (!g1mg.Decompile(writer, att_dir, g1mss[0].bone_names))
+            return false;
     }
 
     for (uint32_t i = 0; i < (uint32_t)colls.size(); i++)
     {
-        if (!colls[i].Decompile(root, att_dir, i))
-            return nullptr;
+        if (!colls[i].Decompile(writer, att_dir, i))
+            return false;
     }
 
     if (nunos.size() > 0)
     {
         for (uint32_t i = 0; i < (uint32_t)nunos.size(); i++)
         {
-            if (!nunos[i].Decompile(root, *this))
-                return nullptr;
+            if (!nunos[i].Decompile(writer, *this))
+                return false;
         }
     }
     else
     {
         for (uint32_t i = 0; i < (uint32_t)unparsed_nunos.size(); i++)
         {
-            if (!unparsed_nunos[i].Decompile(root, att_dir, i))
-                return nullptr;
+            if (!unparsed_nunos[i].Decompile(writer, att_dir, i))
+                return false;
         }
     }
 
@@ -7244,45 +7256,45 @@ TiXmlDocument *G1mFile::Decompile() const
     {
         for (uint32_t i = 0; i < (uint32_t)nunvs.size(); i++)
         {
-            if (!nunvs[i].Decompile(root, *this))
-                return nullptr;
+            if (!nunvs[i].Decompile(writer, *this))
+                return false;
         }
     }
     else
     {
         for (uint32_t i = 0; i < (uint32_t)unparsed_nunvs.size(); i++)
         {
-            if (!unparsed_nunvs[i].Decompile(root, att_dir, i))
-                return nullptr;
+            if (!unparsed_nunvs[i].Decompile(writer, att_dir, i))
+                return false;
         }
     }
 
     for (uint32_t i = 0; i < (uint32_t)nunss.size(); i++)
     {
-        if (!nunss[i].Decompile(root, att_dir, i))
-            return nullptr;
+        if (!nunss[i].Decompile(writer, att_dir, i))
+            return false;
     }
 
     for (uint32_t i = 0; i < (uint32_t)extrs.size(); i++)
     {
-        if (!extrs[i].Decompile(root, att_dir, i))
-            return nullptr;
+        if (!extrs[i].Decompile(writer, att_dir, i))
+            return false;
     }
 
     for (uint32_t i = 0; i < (uint32_t)hairs.size(); i++)
     {
-        if (!hairs[i].Decompile(root, att_dir, i))
-            return nullptr;
+        if (!hairs[i].Decompile(writer, att_dir, i))
+            return false;
     }
 
     for (uint32_t i = 0; i < (uint32_t)softs.size(); i++)
     {
-        if (!softs[i].Decompile(root, att_dir, i))
-            return nullptr;
+        if (!softs[i].Decompile(writer, att_dir, i))
+            return false;
     }
 
-    doc->LinkEndChild(root);
-    return doc;
+    writer->EndElement();
+    return true;
 }
 
 bool G1mFile::Compile(TiXmlDocument *doc, bool)
@@ -29,6 +29,7 @@ using namespace DirectX;
 
 #include "FixedMemoryStream.h"
 #include "TransformMatrix.h"
+#include "XmlWriter.h"
 
 #define G1M_SIGNATURE   0x47314D5F
 
@@ -401,7 +402,7 @@ struct G1MFChunk
     bool Read(FixedMemoryStream &in, uint32_t chunk_version, uint32_t chunk_size);
     bool Write(MemoryStream &out) const;
 
-    TiXmlElement *Decompile(TiXmlNode *root) const;
+    bool Decompile(XmlWriter *writer) const;
     bool Compile(const TiXmlElement *root, bool *g1mf_auto);
 };
 
@@ -423,7 +424,7 @@ struct G1MSChunk
     bool Read(FixedMemoryStream &in, uint32_t chunk_version, uint32_t chunk_size);
     bool Write(MemoryStream &out) const;
 
-    TiXmlElement *Decompile(TiXmlNode *root) const;
+    bool Decompile(XmlWriter *writer) const;
     bool Compile(const TiXmlElement *root);
 };
 
@@ -435,10 +436,10 @@ struct G1MMChunk
     bool Read(FixedMemoryStream &in, uint32_t chunk_version, uint32_t chunk_size);
     bool Write(MemoryStream &out) const;
 
-    static void DecompileMatrix(TiXmlElement *root, const float *matrix);
+    static void DecompileMatrix(XmlWriter *writer, const float *matrix);
     static bool CompileMatrix(const TiXmlElement *root, float *matrix);
 
-    TiXmlElement *Decompile(TiXmlNode *root) const;
+    bool Decompile(XmlWriter *writer) const;
     bool Compile(const TiXmlElement *root);
 };
 
@@ -456,7 +457,7 @@ struct G1MGUnkSection1
     bool Read(FixedMemoryStream &in, uint32_t section_size);
     bool Write(MemoryStream &out) const;
 
-    TiXmlElement *Decompile(TiXmlNode *root) const;
+    bool Decompile(XmlWriter *writer) const;
     bool Compile(const TiXmlElement *root);
 };
 
@@ -471,7 +472,7 @@ struct G1MGMaterial
     bool Read(FixedMemoryStream &in);
     bool Write(MemoryStream &out) const;
 
-    TiXmlElement *Decompile(TiXmlNode *root, uint32_t idx) const;
+    bool Decompile(XmlWriter *writer, uint32_t idx) const;
     bool Compile(const TiXmlElement *root);
 };
 
@@ -488,7 +489,7 @@ struct G1MGMaterialSection
     bool Read(FixedMemoryStream &in, uint32_t section_size);
     bool Write(MemoryStream &out) const;
 
-    TiXmlElement *Decompile(TiXmlNode *root) const;
+    bool Decompile(XmlWriter *writer) const;
     bool Compile(const TiXmlElement *root);
 };
 
@@ -504,7 +505,7 @@ struct G1MGAttribute
     bool Read(FixedMemoryStream &in);
     bool Write(MemoryStream &out) const;
 
-    TiXmlElement *Decompile(TiXmlNode *root) const;
+    bool Decompile(XmlWriter *writer) const;
     bool Compile(const TiXmlElement *root);
 };
 
@@ -515,7 +516,7 @@ struct G1MGMaterialAttributes
     bool Read(FixedMemoryStream &in);
     bool Write(MemoryStream &out) const;
 
-    TiXmlElement *Decompile(TiXmlNode *root, uint32_t idx) const;
+    bool Decompile(XmlWriter *writer, uint32_t idx) const;
     bool Compile(const TiXmlElement *root);
 };
 
@@ -532,7 +533,7 @@ struct G1MGAttributesSection
     bool Read(FixedMemoryStream &in, uint32_t section_size);
     bool Write(MemoryStream &out) const;
 
-    TiXmlElement *Decompile(TiXmlNode *root) const;
+    bool Decompile(XmlWriter *writer) const;
     bool Compile(const TiXmlElement *root);
 };
 
@@ -564,7 +565,7 @@ struct G1MGVertexBuffer
         return (uint32_t)(vertex.size() / vertex_size);
     }
 
-    TiXmlElement *Decompile(TiXmlNode *root, const std::string &att_dir, uint32_t idx) const;
+    bool Decompile(XmlWriter *writer, const std::string &att_dir, uint32_t idx) const;
     bool Compile(const TiXmlElement *root, const std::string &att_dir);
 };
 
@@ -586,7 +587,7 @@ struct G1MGVertexSection
     bool Read(FixedMemoryStream &in, uint32_t section_size);
     bool Write(MemoryStream &out);
 
-    TiXmlElement *Decompile(TiXmlNode *root, const std::string &att_dir) const;
+    bool Decompile(XmlWriter *writer, const std::string &att_dir) const;
     bool Compile(const TiXmlElement *root, const std::string &att_dir);
 };
 
@@ -600,7 +601,7 @@ struct G1MGSemantic
     bool Read(FixedMemoryStream &in);
     bool Write(MemoryStream &out) const;
 
-    TiXmlElement *Decompile(TiXmlNode *root) const;
+    bool Decompile(XmlWriter *writer) const;
     bool Compile(const TiXmlElement *root);
 };
 
@@ -612,7 +613,7 @@ struct G1MGLayout
     bool Read(FixedMemoryStream &in);
     bool Write(MemoryStream &out) const;
 
-    TiXmlElement *Decompile(TiXmlNode *root, uint32_t idx) const;
+    bool Decompile(XmlWriter *writer, uint32_t idx) const;
     bool Compile(const TiXmlElement *root);
 };
 
@@ -629,7 +630,7 @@ struct G1MGLayoutSection
     bool Read(FixedMemoryStream &in, uint32_t section_size);
     bool Write(MemoryStream &out) const;
 
-    TiXmlElement *Decompile(TiXmlNode *root) const;
+    bool Decompile(XmlWriter *writer) const;
     bool Compile(const TiXmlElement *root);
 };
 
@@ -673,7 +674,7 @@ struct G1MGBoneMapEntry
     bool Read(FixedMemoryStream &in);
     bool Write(MemoryStream &out) const;
 
-    TiXmlElement *Decompile(TiXmlNode *root, const std::vector<std::string> &bone_names) const;
+    bool Decompile(XmlWriter *writer, const std::vector<std::string> &bone_names) const;
     bool Compile(const TiXmlElement *root, const std::vector<std::string> &bone_names);
 };
 
@@ -694,7 +695,7 @@ struct G1MGBonesMap
     bool Read(FixedMemoryStream &in);
     bool Write(MemoryStream &out) const;
 
-    TiXmlElement *Decompile(TiXmlNode *root, const std::vector<std::string> &bone_names, uint32_t idx) const;
+    bool Decompile(XmlWriter *writer, const std::vector<std::string> &bone_names, uint32_t idx) const;
     bool Compile(const TiXmlElement *root, const std::vector<std::string> &bone_names);
 };
 
@@ -711,7 +712,7 @@ struct G1MGBonesMapSection
     bool Read(FixedMemoryStream &in, uint32_t section_size);
     bool Write(MemoryStream &out) const;
 
-    TiXmlElement *Decompile(TiXmlNode *root, const std::vector<std::string> &bone_names) const;
+    bool Decompile(XmlWriter *writer, const std::vector<std::string> &bone_names) const;
     bool Compile(const TiXmlElement *root, const std::vector<std::string> &bone_names);
 };
 
@@ -757,7 +758,7 @@ struct G1MGIndexBuffer
     bool Read(FixedMemoryStream &in);
     bool Write(MemoryStream &out) const;
 
-    TiXmlElement *Decompile(TiXmlNode *root, const std::string &att_dir, uint32_t idx) const;
+    bool Decompile(XmlWriter *writer, const std::string &att_dir, uint32_t idx) const;
     bool Compile(const TiXmlElement *root, const std::string &att_dir);
 };
 
@@ -774,7 +775,7 @@ struct G1MGIndexBufferSection
     bool Read(FixedMemoryStream &in, uint32_t section_size);    
     bool Write(MemoryStream &out) const;
 
-    TiXmlElement *Decompile(TiXmlNode *root, const std::string &att_dir) const;
+    bool Decompile(XmlWriter *writer, const std::string &att_dir) const;
     bool Compile(const TiXmlElement *root, const std::string &att_dir);
 };
 
@@ -801,7 +802,7 @@ struct G1MGSubmesh
     bool Read(FixedMemoryStream &in);
     bool Write(MemoryStream &out) const;
 
-    TiXmlElement *Decompile(TiXmlNode *root, uint32_t idx) const;
+    bool Decompile(XmlWriter *writer, uint32_t idx) const;
     bool Compile(const TiXmlElement *root);
 };
 
@@ -818,7 +819,7 @@ struct G1MGSubmeshesSection
     bool Read(FixedMemoryStream &in, uint32_t section_size);
     bool Write(MemoryStream &out) const;
 
-    TiXmlElement *Decompile(TiXmlNode *root) const;
+    bool Decompile(XmlWriter *writer) const;
     bool Compile(const TiXmlElement *root);
 };
 
@@ -834,7 +835,7 @@ struct G1MGMesh
     bool Read(FixedMemoryStream &in);
     bool Write(MemoryStream &out) const;
 
-    TiXmlElement *Decompile(TiXmlNode *root, uint32_t idx) const;
+    bool Decompile(XmlWriter *writer, uint32_t idx) const;
     bool Compile(const TiXmlElement *root);
 };
 
@@ -857,7 +858,7 @@ struct G1MGLodGroup
     bool Read(FixedMemoryStream &in);
     bool Write(MemoryStream &out) const;
 
-    TiXmlElement *Decompile(TiXmlNode *root, const G1MGChunk &g1mg, size_t idx) const;
+    bool Decompile(XmlWriter *writer, const G1MGChunk &g1mg, size_t idx) const;
     bool Compile(const TiXmlElement *root, bool *auto_meshes);
 };
 
@@ -875,7 +876,7 @@ struct G1MGMeshesSection
     bool Read(FixedMemoryStream &in, uint32_t section_size);
     bool Write(MemoryStream &out) const;
 
-    TiXmlElement *Decompile(TiXmlNode *root, const G1MGChunk &g1mg) const;
+    bool Decompile(XmlWriter *writer, const G1MGChunk &g1mg) const;
     bool Compile(const TiXmlElement *root, std::vector<bool> &auto_meshes);
 };
 
@@ -899,7 +900,7 @@ struct G1MGChunk
     bool Read(FixedMemoryStream &in, uint32_t chunk_version, uint32_t chunk_size);
     bool Write(MemoryStream &out);
 
-    TiXmlElement *Decompile(TiXmlNode *root, const std::string &att_dir, const std::vector<std::string> &bone_names) const;
+    bool Decompile(XmlWriter *writer, const std::string &att_dir, const std::vector<std::string> &bone_names) const;
     bool Compile(const TiXmlElement *root, const std::string &att_dir, const std::vector<std::string> &bone_names,  std::vector<bool> &auto_meshes);
 };
 
@@ -930,7 +931,7 @@ struct NUNO1
     bool Read(FixedMemoryStream &in);
     bool Write(MemoryStream &out) const;
 
-    TiXmlElement *Decompile(TiXmlNode *root, const G1mFile &g1m, size_t idx) const;
+    bool Decompile(XmlWriter *writer, const G1mFile &g1m, size_t idx) const;
     bool Compile(const TiXmlElement *root, const G1mFile &g1m);
 };
 
@@ -956,7 +957,7 @@ struct NUNO2
     bool Read(FixedMemoryStream &in);
     bool Write(MemoryStream &out) const;
 
-    TiXmlElement *Decompile(TiXmlNode *root, const G1mFile &g1m, size_t idx) const;
+    bool Decompile(XmlWriter *writer, const G1mFile &g1m, size_t idx) const;
     bool Compile(const TiXmlElement *root, const G1mFile &g1m);
 };
 
@@ -1024,7 +1025,7 @@ struct NUNO3
     bool Read(FixedMemoryStream &in, uint32_t version);
     bool Write(MemoryStream &out) const;
 
-    TiXmlElement *Decompile(TiXmlNode *root, const G1mFile &g1m, size_t idx) const;
+    bool Decompile(XmlWriter *writer, const G1mFile &g1m, size_t idx) const;
     bool Compile(const TiXmlElement *root, const G1mFile &g1m, uint32_t version);
 };
 
@@ -1049,7 +1050,7 @@ struct NUNO4
     bool Read(FixedMemoryStream &in, uint32_t version);
     bool Write(MemoryStream &out) const;
 
-    TiXmlElement *Decompile(TiXmlNode *root, const G1mFile &g1m, size_t idx) const;
+    bool Decompile(XmlWriter *writer, const G1mFile &g1m, size_t idx) const;
     bool Compile(const TiXmlElement *root, const G1mFile &g1m, uint32_t version);
 };
 
@@ -1068,7 +1069,7 @@ struct NUNOChunk
     bool Read(FixedMemoryStream &in, uint32_t chunk_version, uint32_t chunk_size);
     bool Write(MemoryStream &out) const;
 
-    TiXmlElement *Decompile(TiXmlNode *root, const G1mFile &g1m) const;
+    bool Decompile(XmlWriter *writer, const G1mFile &g1m) const;
     bool Compile(const TiXmlElement *root, const G1mFile &g1m);
 };
 
@@ -1094,7 +1095,7 @@ struct NUNV1
     bool Read(FixedMemoryStream &in);
     bool Write(MemoryStream &out) const;
 
-    TiXmlElement *Decompile(TiXmlNode *root, const G1mFile &g1m, size_t idx) const;
+    bool Decompile(XmlWriter *writer, const G1mFile &g1m, size_t idx) const;
     bool Compile(const TiXmlElement *root, const G1mFile &g1m);
 };
 
@@ -1106,7 +1107,7 @@ struct NUNVChunk
     bool Read(FixedMemoryStream &in, uint32_t chunk_version, uint32_t chunk_size);
     bool Write(MemoryStream &out) const;
 
-    TiXmlElement *Decompile(TiXmlNode *root, const G1mFile &g1m) const;
+    bool Decompile(XmlWriter *writer, const G1mFile &g1m) const;
     bool Compile(const TiXmlElement *root, const G1mFile &g1m);
 };
 
@@ -1120,7 +1121,7 @@ struct UnkChunk
     bool Read(FixedMemoryStream &in, uint32_t chunk_type, uint32_t chunk_version, uint32_t chunk_size);
     bool Write(MemoryStream &out) const;
 
-    TiXmlElement *Decompile(TiXmlNode *root, const std::string &att_dir, uint32_t idx) const;
+    bool Decompile(XmlWriter *writer, const std::string &att_dir, uint32_t idx) const;
     bool Compile(const TiXmlElement *root, const std::string &att_dir, uint32_t type);
 };
 
@@ -1203,6 +1204,9 @@ public:
     virtual TiXmlDocument *Decompile() const override;
     virtual bool Compile(TiXmlDocument *doc, bool big_endian=false) override;
 
+    virtual bool DecompileStream(XmlWriter *writer) const override;
+    virtual bool SupportsDecompileStream() const override { return true; }
+
     virtual bool DecompileToFile(const std::string &path, bool show_error=true, bool build_path=false) override;
     virtual bool CompileFromFile(const std::string &path, bool show_error=true, bool big_endian=false) override;
 
@@ -128,77 +128,77 @@ size_t KidsODBColumn::GetStringArray(std::vector<std::string> &ret) const
     return ret.size();
 }
 
-TiXmlElement *KidsODBColumn::Decompile(TiXmlNode *root, const std::string &parent_name, uint32_t parent_type, const std::string &att_dir) const
+bool KidsODBColumn::Decompile(XmlWriter *writer, const std::string &parent_name, uint32_t parent_type, const std::string &att_dir) const
 {
-    TiXmlElement *entry_root = new TiXmlElement("Column");
     std::string my_name = hash_or_name(name);
 
-    entry_root->SetAttribute("name", my_name);
+    writer->StartElement("Column");
+    writer->Attribute("name", my_name);
 
     switch (type)
     {
         case KIDS_ODB_INT8:
-            entry_root->SetAttribute("type", "int8");
+            writer->Attribute("type", "int8");
         break;
 
         case KIDS_ODB_UINT8:
-            entry_root->SetAttribute("type", "uint8");
+            writer->Attribute("type", "uint8");
         break;
 
         case KIDS_ODB_INT16:
-            entry_root->SetAttribute("type", "int16");
+            writer->Attribute("type", "int16");
         break;
 
         case KIDS_ODB_UINT16:
-            entry_root->SetAttribute("type", "uint16");
+            writer->Attribute("type", "uint16");
         break;
 
         case KIDS_ODB_INT32:
-            entry_root->SetAttribute("type", "int32");
+            writer->Attribute("type", "int32");
         break;
 
         case KIDS_ODB_UINT32:
-            entry_root->SetAttribute("type", "uint32");
+            writer->Attribute("type", "uint32");
         break;
 
         case KIDS_ODB_FLOAT:
-            entry_root->SetAttribute("type", "float");
+            writer->Attribute("type", "float");
         break;
 
         case KIDS_ODB_VECTOR2:
-            entry_root->SetAttribute("type", "vector2");
+            writer->Attribute("type", "vector2");
         break;
 
         case KIDS_ODB_VECTOR3:
-            entry_root->SetAttribute("type", "vector3");
+            writer->Attribute("type", "vector3");
         break;
 
         case KIDS_ODB_VECTOR4:
-            entry_root->SetAttribute("type", "vector4");
+            writer->Attribute("type", "vector4");
         break;
 
         default:
             // should not be here
-            entry_root->SetAttribute("type", "???");
+            writer->Attribute("type", "???");
     }
 
     for (const KidsODBValue8 &val: values8)
     {
         if (IsString())
         {
-            TiXmlElement *rows_root = new TiXmlElement("Rows");
-            rows_root->SetAttribute("value", (const char *)values8.data());
-            entry_root->LinkEndChild(rows_root);
+            writer->StartElement("Rows");
+            writer->Attribute("value", (const char *)values8.data());
+            writer->EndElement();
             break;
         }
         else if (IsStringArray(parent_type))
         {
             std::vector<std::string> array;
 
-            TiXmlElement *rows_root = new TiXmlElement("Rows");
+            writer->StartElement("Rows");
             GetStringArray(array);
-            rows_root->SetAttribute("multi_str", Utils::ToSingleString(array, ", ", false));
-            entry_root->LinkEndChild(rows_root);
+            writer->Attribute("multi_str", Utils::ToSingleString(array, ", ", false));
+            writer->EndElement();
             break;
         }
         else if (IsBlob())
@@ -207,76 +207,76 @@ TiXmlElement *KidsODBColumn::Decompile(TiXmlNode *root, const std::string &paren
             std::string path = Utils::MakePathString(att_dir, fn);
 
             if (!Utils::WriteFileBool(path, (const uint8_t *)values8.data(), values8.size(), true, true))
-                return nullptr;
+                return false;
 
-            TiXmlElement *rows_root = new TiXmlElement("Rows");
-            rows_root->SetAttribute("binary", fn);
-            entry_root->LinkEndChild(rows_root);
+            writer->StartElement("Rows");
+            writer->Attribute("binary", fn);
+            writer->EndElement();
             break;
         }
 
-        TiXmlElement *row_root = new TiXmlElement("Row");
+        writer->StartElement("Row");
         std::string value;
 
         switch (type)
         {
             case KIDS_ODB_INT8:
-                row_root->SetAttribute("value", (int)val.i8);
+                writer->Attribute("value", (int)val.i8);
             break;
 
             case KIDS_ODB_UINT8:
-                row_root->SetAttribute("value", Utils::UnsignedToHexString(val.u8, true));
+                writer->Attribute("value", Utils::UnsignedToHexString(val.u8, true));
             break;           
         }
 
-        entry_root->LinkEndChild(row_root);
+        writer->EndElement();
     }
 
     for (const KidsODBValue16 &val: values16)
     {
-        TiXmlElement *row_root = new TiXmlElement("Row");
+        writer->StartElement("Row");
         std::string value;
 
         switch (type)
         {
             case KIDS_ODB_INT16:
-                row_root->SetAttribute("value", (int)val.i16);
+                writer->Attribute("value", (int)val.i16);
             break;
 
             case KIDS_ODB_UINT16:
-                row_root->SetAttribute("value", Utils::UnsignedToHexString(val.u16, true));
+                writer->Attribute("value", Utils::UnsignedToHexString(val.u16, true));
             break;
         }
 
-        entry_root->LinkEndChild(row_root);
+        writer->EndElement();
     }
 
     for (const KidsODBValue32 &val: values32)
     {
-        TiXmlElement *row_root = new TiXmlElement("Row");
+        writer->StartElement("Row");
         std::string value;
 
         switch (type)
         {
             case KIDS_ODB_INT32:
-                row_root->SetAttribute("value", (int)val.i32);
+                writer->Attribute("value", (int)val.i32);
             break;
 
             case KIDS_ODB_UINT32:
-                row_root->SetAttribute("value", hash_or_name(val.u32));
+                writer->Attribute("value", hash_or_name(val.u32));
             break;
 
             case KIDS_ODB_FLOAT:
-                row_root->SetAttribute("value", Utils::FloatToString(val.f));
+                writer->Attribute("value", Utils::FloatToString(val.f));
             break;
         }
 
-        entry_root->LinkEndChild(row_root);
+        writer->EndElement();
     }
 
     for (const KidsODBValue64 &val: values64)
     {
-        TiXmlElement *row_root = new TiXmlElement("Row");
+        writer->StartElement("Row");
         std::string value;
 
         switch (type)
@@ -290,16 +290,16 @@ TiXmlElement *KidsODBColumn::Decompile(TiXmlNode *root, const std::string &paren
                         value += ", ";
                 }
 
-                row_root->SetAttribute("value", value);
+                writer->Attribute("value", value);
             break;
         }
 
-        entry_root->LinkEndChild(row_root);
+        writer->EndElement();
     }
 
     for (const KidsODBValue96 &val: values96)
     {
-        TiXmlElement *row_root = new TiXmlElement("Row");
+        writer->StartElement("Row");
         std::string value;
 
         switch (type)
@@ -313,16 +313,16 @@ TiXmlElement *KidsODBColumn::Decompile(TiXmlNode *root, const std::string &paren
                         value += ", ";
                 }
 
-                row_root->SetAttribute("value", value);
+                writer->Attribute("value", value);
             break;
         }
 
-        entry_root->LinkEndChild(row_root);
+        writer->EndElement();
     }
 
     for (const KidsODBValue128 &val: values128)
     {
-        TiXmlElement *row_root = new TiXmlElement("Row");
+        writer->StartElement("Row");
         std::string value;
 
         switch (type)
@@ -336,15 +336,15 @@ TiXmlElement *KidsODBColumn::Decompile(TiXmlNode *root, const std::string &paren
                         value += ", ";
                 }
 
-                row_root->SetAttribute("value", value);
+                writer->Attribute("value", value);
             break;
         }
 
-        entry_root->LinkEndChild(row_root);
+        writer->EndElement();
     }
 
-    root->LinkEndChild(entry_root);
-    return entry_root;
+    writer->EndElement();
+    return true;
 }
 
 bool KidsODBColumn::Compile(const TiXmlElement *root, const std::string &att_dir)
@@ -569,32 +569,32 @@ bool KidsODBColumn::Compile(const TiXmlElement *root, const std::string &att_dir
     return true;
 }
 
-TiXmlElement *KidsODBObject::Decompile(TiXmlNode *root, const std::string &att_dir) const
+bool KidsODBObject::Decompile(XmlWriter *writer, const std::string &att_dir) const
 {
     std::string my_name = hash_or_name(name);
 
-    TiXmlElement *entry_root = new TiXmlElement("Object");
-    entry_root->SetAttribute("version", version);
-    entry_root->SetAttribute("name", my_name);    
+    writer->StartElement("Object");
+    writer->Attribute("version", version);
+    writer->Attribute("name", my_name);
 
     if (is_r)
     {
-        entry_root->SetAttribute("parent_object_file", hash_or_name(parent_object_file));
-        entry_root->SetAttribute("parent_object", hash_or_name(parent_object));
+        writer->Attribute("parent_object_file", hash_or_name(parent_object_file));
+        writer->Attribute("parent_object", hash_or_name(parent_object));
     }
     else
     {
-        entry_root->SetAttribute("type", hash_or_name(type));
+        writer->Attribute("type", hash_or_name(type));
     }
 
     for (const KidsODBColumn &col : columns)
     {
-        if (!col.Decompile(entry_root, my_name, type, att_dir))
-            return nullptr;
+        if (!col.Decompile(writer, my_name, type, att_dir))
+            return false;
     }
 
-    root->LinkEndChild(entry_root);
-    return entry_root;
+    writer->EndElement();
+    return true;
 }
 
 bool KidsODBObject::Compile(const TiXmlElement *root, const std::string &att_dir)
@@ -670,6 +670,7 @@ KidsObjDBFile::~KidsObjDBFile()
 void KidsObjDBFile::Reset()
 {
     objects.clear();
+    RewindArena();
     name_file = 0;
     version = 0;
     platform = 0xA;
@@ -677,7 +678,10 @@ void KidsObjDBFile::Reset()
 
 bool KidsObjDBFile::Load(const uint8_t *buf, size_t size)
 {
+    Reset();
+
     FixedMemoryStream mem(const_cast<uint8_t *>(buf), size);
+    Arena *arena = &GetArena();
 
     KODHeader *hdr;
 
@@ -711,6 +715,7 @@ bool KidsObjDBFile::Load(const uint8_t *buf, size_t size)
             obj.name = entry->name;
             obj.type = entry->type;
             obj.version = Utils::GetShortVersion(entry->version);
+            obj.columns = ArenaVector<KidsODBColumn>(arena);
             obj.columns.resize(entry->num_columns);
             obj.is_r = false;
         }
@@ -728,6 +733,7 @@ bool KidsObjDBFile::Load(const uint8_t *buf, size_t size)
 
             obj.name = rentry->name;
             obj.version = Utils::GetShortVersion(rentry->version);
+            obj.columns = ArenaVector<KidsODBColumn>(arena);
             obj.columns.resize(rentry->num_columns);
             obj.parent_object_file = rentry->parent_object_file;
             obj.parent_object = rentry->parent_object;
@@ -766,28 +772,28 @@ bool KidsObjDBFile::Load(const uint8_t *buf, size_t size)
             switch (col.type)
             {
                 case KIDS_ODB_INT8: case KIDS_ODB_UINT8:
-                    col.values8.resize(num);
+                    col.values8 = ArenaVector<KidsODBValue8>(num, KidsODBValue8(), arena);
                 break;
 
                 case KIDS_ODB_INT16: case KIDS_ODB_UINT16:
-                    col.values16.resize(num);
+                    col.values16 = ArenaVector<KidsODBValue16>(num, KidsODBValue16(), arena);
                 break;
 
                 case KIDS_ODB_INT32: case KIDS_ODB_UINT32:
                 case KIDS_ODB_FLOAT:
-                    col.values32.resize(num);
+                    col.values32 = ArenaVector<KidsODBValue32>(num, KidsODBValue32(), arena);
                 break;
 
                 case KIDS_ODB_VECTOR2:
-                    col.values64.resize(num);
+                    col.values64 = ArenaVector<KidsODBValue64>(num, KidsODBValue64(), arena);
                 break;
 
                 case KIDS_ODB_VECTOR3:
-                    col.values96.resize(num);
+                    col.values96 = ArenaVector<KidsODBValue96>(num, KidsODBValue96(), arena);
                 break;
 
                 case KIDS_ODB_VECTOR4:
-                    col.values128.resize(num);
+                    col.values128 = ArenaVector<KidsODBValue128>(num, KidsODBValue128(), arena);
                 break;
 
                 default:
@@ -1041,22 +1047,34 @@ uint8_t *KidsObjDBFile::Save(size_t *psize)
 TiXmlDocument *KidsObjDBFile::Decompile() const
 {
     TiXmlDocument *doc = new TiXmlDocument();
-    TiXmlDeclaration* decl = new TiXmlDeclaration("1.0", "utf-8", "" );
-    doc->LinkEndChild(decl);
+    XmlWriter writer(doc);
 
-    TiXmlElement *root = new TiXmlElement("KidsObjDB");
-    root->SetAttribute("version", version);
-    root->SetAttribute("platform", platform);
-    root->SetAttribute("name_file", hash_or_name(name_file));
+    if (!DecompileStream(&writer))
+    {
+        delete doc;
+        return nullptr;
+    }
+
+    return doc;
+}
+
+bool KidsObjDBFile::DecompileStream(XmlWriter *writer) const
+{
+    writer->Declaration();
+
+    writer->StartElement("KidsObjDB");
+    writer->Attribute("version", version);
+    writer->Attribute("platform", platform);
+    writer->Attribute("name_file", hash_or_name(name_file));
 
     for (const KidsODBObject &obj : objects)
     {
-        if (!obj.Decompile(root, att_dir))
-            return nullptr;
+        if (!obj.Decompile(writer, att_dir))
+            return false;
     }
 
-    doc->LinkEndChild(root);
-    return doc;
+    writer->EndElement();
+    return true;
 }
 
 bool KidsObjDBFile::Compile(TiXmlDocument *doc, bool)
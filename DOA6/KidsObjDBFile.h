@@ -3,6 +3,8 @@
 
 #include <unordered_map>
 #include "FixedMemoryStream.h"
+#include "Arena.h"
+#include "XmlWriter.h"
 
 #define KOD_SIGNATURE   0x4B4F445F
 #define KODI_SIGNATURE  0x4B4F4449
@@ -142,19 +144,20 @@ struct KidsODBColumn
     uint32_t name;
     int32_t type;
 
-    std::vector<KidsODBValue8> values8;
-    std::vector<KidsODBValue16> values16;
-    std::vector<KidsODBValue32> values32;
-    std::vector<KidsODBValue64> values64;
-    std::vector<KidsODBValue96> values96;
-    std::vector<KidsODBValue128> values128;
+    // When loaded from a file, these live in the arena of the KidsObjDBFile (compiled ones use the heap)
+    ArenaVector<KidsODBValue8> values8;
+    ArenaVector<KidsODBValue16> values16;
+    ArenaVector<KidsODBValue32> values32;
+    ArenaVector<KidsODBValue64> values64;
+    ArenaVector<KidsODBValue96> values96;
+    ArenaVector<KidsODBValue128> values128;
 
     bool IsString() const;
     bool IsBlob() const;
     bool IsStringArray(uint32_t parent_type) const;
     size_t GetStringArray(std::vector<std::string> &ret) const;
 
-    TiXmlElement *Decompile(TiXmlNode *root, const std::string &parent_name, uint32_t parent_type, const std::string &att_dir) const;
+    bool Decompile(XmlWriter *writer, const std::string &parent_name, uint32_t parent_type, const std::string &att_dir) const;
     bool Compile(const TiXmlElement *root, const std::string &att_dir);
 };
 
@@ -168,9 +171,40 @@ struct KidsODBObject
 
     bool is_r;
 
-    std::vector<KidsODBColumn> columns;
+    ArenaVector<KidsODBColumn> columns;
 
-    TiXmlElement *Decompile(TiXmlNode *root, const std::string &att_dir) const;
+    KidsODBObject() = default;
+    KidsODBObject(const KidsODBObject &other) = default;
+    KidsODBObject &operator=(const KidsODBObject &other) = default;
+
+    // Takes the columns of other and leaves it with an empty heap vector, so that a moved-from object
+    // doesn't keep pointing to the arena of the file it was loaded from.
+    void Move(KidsODBObject &other) noexcept
+    {
+        name = other.name;
+        type = other.type;
+        version = other.version;
+        parent_object_file = other.parent_object_file;
+        parent_object = other.parent_object;
+        is_r = other.is_r;
+        columns = std::move(other.columns);
+        other.columns = ArenaVector<KidsODBColumn>();
+    }
+
+    KidsODBObject(KidsODBObject &&other) noexcept
+    {
+        Move(other);
+    }
+
+    inline KidsODBObject &operator=(KidsODBObject &&other) noexcept
+    {
+        if (this != &other)
+            Move(other);
+
+        return *this;
+    }
+
+    bool Decompile(XmlWriter *writer, const std::string &att_dir) const;
     bool Compile(const TiXmlElement *root, const std::string &att_dir);
 };
 
@@ -199,6 +233,9 @@ public:
     virtual TiXmlDocument *Decompile() const override;
     virtual bool Compile(TiXmlDocument *doc, bool big_endian=false) override;
 
+    virtual bool DecompileStream(XmlWriter *writer) const override;
+    virtual bool SupportsDecompileStream() const override { return true; }
+
     virtual bool DecompileToFile(const std::string &path, bool show_error=true, bool build_path=false) override;
     virtual bool CompileFromFile(const std::string &path, bool show_error=true, bool big_endian=false) override;
 
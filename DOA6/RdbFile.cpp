@@ -1094,7 +1094,6 @@ bool RdbFile::ExtractFile(size_t idx, Stream *out, bool omit_external_error, boo
         return true;
 
     size_t out_size = file_entry.file_size;
-    uint8_t *out_buf = new uint8_t[out_size];
     size_t extracted_size = 0;
     bool ret = false;
 
@@ -1102,6 +1101,8 @@ bool RdbFile::ExtractFile(size_t idx, Stream *out, bool omit_external_error, boo
     {
         // Not compressed
         // Fixme: read in chunks
+        uint8_t *out_buf = new uint8_t[out_size];
+
         if (out_size > 0 && !stream->Read(out_buf, out_size))
         {
             delete[] out_buf;
@@ -1113,19 +1114,18 @@ bool RdbFile::ExtractFile(size_t idx, Stream *out, bool omit_external_error, boo
         }
 
         ret = out->Write(out_buf, out_size);
+        delete[] out_buf;
     }
     else
     {
-        // Compressed
+        // Compressed, each chunk is inflated straight from the input stream into the output one
         while (extracted_size < out_size)
         {
             uint32_t in_size;
-            uint8_t *in_buf;
+            uint64_t this_size = out_size - extracted_size; // Limit for this chunk
 
             if (!stream->Read32(&in_size))
             {
-                delete[] out_buf;
-
                 if (entry.external)
                     delete stream;
 
@@ -1134,45 +1134,18 @@ bool RdbFile::ExtractFile(size_t idx, Stream *out, bool omit_external_error, boo
 
             //DPRINTF("in_size = %Id out_size = %Id  offset = %Ix\n", in_size, out_size, stream->Tell());
 
-            in_buf = new uint8_t[in_size];
-            if (!stream->Read(in_buf, in_size))
-            {
-                delete[] out_buf;
-                delete[] in_buf;
-
-                if (entry.external)
-                    delete stream;
-
-                return false;
-            }
-
-            uint32_t this_size = (uint32_t)out_size;
-            ret = Utils::UncompressZlib(out_buf, &this_size, in_buf, in_size);
-            delete[] in_buf;
+            ret = Utils::UncompressZlib(stream, out, in_size, &this_size);
+            if (!ret)
+                break;
 
             //UPRINTF("%d uncompressed to %d\n", in_size, this_size);
-
-            if (ret)
-            {
-                if (!out->Write(out_buf, this_size))
-                {
-                    ret = false;
-                    break;
-                }
-
-                extracted_size += this_size;
-            }
-            else
-            {
-                break;
-            }
+            extracted_size += (size_t)this_size;
         }
     }
 
     if (entry.external)
         delete stream;
 
-    delete[] out_buf;
     return ret;
 }
 
@@ -361,6 +361,7 @@ bool SrstFile::LoadFromFile(const std::string &path, bool show_error)
     Reset();
 
     cont = new FileStream("rb");
+    cont->SetBuffered();
     if (!cont->LoadFromFile(path, show_error))
     {
         Reset();
@@ -508,6 +509,7 @@ bool SrstFile::SetExternal(size_t idx, const std::string &path)
 bool SrstFile::SaveToFile(const std::string &path, bool show_error, bool build_path)
 {
     FileStream out("r+b");
+    out.SetBuffered();
 
     FILE *f = (build_path) ? Utils::fopen_create_path(path, "wb") : fopen(path.c_str(), "wb");
     if (!f)
@@ -518,7 +520,10 @@ bool SrstFile::SaveToFile(const std::string &path, bool show_error, bool build_p
     if (!out.LoadFromFile(path, show_error))
         return false;
 
-    return SaveInternal(&out);
+    if (!SaveInternal(&out))
+        return false;
+
+    return out.Close();
 }
 
 bool SrstFile::LoadFromRaw(const std::string &path, bool show_error)
@@ -526,6 +531,7 @@ bool SrstFile::LoadFromRaw(const std::string &path, bool show_error)
     Reset();
 
     cont = new FileStream("rb");
+    cont->SetBuffered();
     if (!cont->LoadFromFile(path, show_error))
     {
         Reset();
@@ -316,41 +316,40 @@ uint32_t Utils::DoubleToColor(double r, double g, double b, double a)
     return color;
 }
 
-void VertexData::Decompile(TiXmlNode *root) const
+void VertexData::Decompile(XmlWriter *writer) const
 {
-	TiXmlElement *entry_root;
 	bool is64 = (size == sizeof(Vertex64));
 
 	if (is64)
 	{
-		entry_root = new TiXmlElement("Vertex64");
+		writer->StartElement("Vertex64");
 	}
 	else
 	{
-		entry_root = new TiXmlElement("Vertex52");
+		writer->StartElement("Vertex52");
 	}
 	
 	const VertexCommon *vc = &VertexUnion.vertex64.common;
 	
-	Utils::WriteParamMultipleFloats(entry_root, "POS", { vc->pos.x, vc->pos.y, vc->pos.z });
-	Utils::WriteParamMultipleFloats(entry_root, "NORM", { vc->norm.x, vc->norm.y, vc->norm.z });
-	Utils::WriteParamMultipleFloats(entry_root, "TEX", { vc->tex.u, vc->tex.v });
+	Utils::WriteParamMultipleFloats(writer, "POS", { vc->pos.x, vc->pos.y, vc->pos.z });
+	Utils::WriteParamMultipleFloats(writer, "NORM", { vc->norm.x, vc->norm.y, vc->norm.z });
+	Utils::WriteParamMultipleFloats(writer, "TEX", { vc->tex.u, vc->tex.v });
 	
 	if (is64)
 	{
-		Utils::WriteParamMultipleFloats(entry_root, "TEX2", std::vector<float>(VertexUnion.vertex64.tex2, VertexUnion.vertex64.tex2+3));
-        Utils::WriteParamUnsigned(entry_root, "COLOR", VertexUnion.vertex64.color, true);
-      	Utils::WriteParamMultipleUnsigned(entry_root, "BLEND", std::vector<uint8_t>(VertexUnion.vertex64.blend, VertexUnion.vertex64.blend+4), true);
-       	Utils::WriteParamMultipleFloats(entry_root, "BLEND_WEIGHT", std::vector<float>(VertexUnion.vertex64.blend_weight, VertexUnion.vertex64.blend_weight+3));
+		Utils::WriteParamMultipleFloats(writer, "TEX2", std::vector<float>(VertexUnion.vertex64.tex2, VertexUnion.vertex64.tex2+3));
+        Utils::WriteParamUnsigned(writer, "COLOR", VertexUnion.vertex64.color, true);
+      	Utils::WriteParamMultipleUnsigned(writer, "BLEND", std::vector<uint8_t>(VertexUnion.vertex64.blend, VertexUnion.vertex64.blend+4), true);
+       	Utils::WriteParamMultipleFloats(writer, "BLEND_WEIGHT", std::vector<float>(VertexUnion.vertex64.blend_weight, VertexUnion.vertex64.blend_weight+3));
 	}
     else
     {
-        Utils::WriteParamUnsigned(entry_root, "COLOR", VertexUnion.vertex52.color, true);
-		Utils::WriteParamMultipleUnsigned(entry_root, "BLEND", std::vector<uint8_t>(VertexUnion.vertex52.blend, VertexUnion.vertex52.blend+4), true);
-		Utils::WriteParamMultipleFloats(entry_root, "BLEND_WEIGHT", std::vector<float>(VertexUnion.vertex52.blend_weight, VertexUnion.vertex52.blend_weight+3));		
+        Utils::WriteParamUnsigned(writer, "COLOR", VertexUnion.vertex52.color, true);
+		Utils::WriteParamMultipleUnsigned(writer, "BLEND", std::vector<uint8_t>(VertexUnion.vertex52.blend, VertexUnion.vertex52.blend+4), true);
+		Utils::WriteParamMultipleFloats(writer, "BLEND_WEIGHT", std::vector<float>(VertexUnion.vertex52.blend_weight, VertexUnion.vertex52.blend_weight+3));		
     }
 	
-    root->LinkEndChild(entry_root);
+    writer->EndElement();
 }
 
 bool VertexData::Compile(const TiXmlElement *root, unsigned int vertex_size)
@@ -466,17 +465,17 @@ bool VertexData::Compile(const TiXmlElement *root, unsigned int vertex_size)
     return true;
 }
 
-void Texture::Decompile(TiXmlNode *root) const
+void Texture::Decompile(XmlWriter *writer) const
 {
-    TiXmlElement *entry_root = new TiXmlElement("Texture");
+    writer->StartElement("Texture");
 
-    Utils::WriteParamUnsigned(entry_root, "EMB_INDEX", emb_index);
-    Utils::WriteParamFloat(entry_root, "F1", f1);
-    Utils::WriteParamFloat(entry_root, "F2", f2);
-    Utils::WriteParamUnsigned(entry_root, "U_00", unk_00, true);
-    Utils::WriteParamMultipleUnsigned(entry_root, "U_02", std::vector<uint8_t>(unk_02, unk_02+2), true);
+    Utils::WriteParamUnsigned(writer, "EMB_INDEX", emb_index);
+    Utils::WriteParamFloat(writer, "F1", f1);
+    Utils::WriteParamFloat(writer, "F2", f2);
+    Utils::WriteParamUnsigned(writer, "U_00", unk_00, true);
+    Utils::WriteParamMultipleUnsigned(writer, "U_02", std::vector<uint8_t>(unk_02, unk_02+2), true);
 
-    root->LinkEndChild(entry_root);
+    writer->EndElement();
 }
 
 bool Texture::Compile(const TiXmlElement *root)
@@ -945,40 +944,40 @@ bool SubPart::InjectObj(const std::string &obj, bool do_uv, bool do_normal, int
     return InjectVertex(vertex, true, (uv_count != 0), (n_count != 0));
 }
 
-void SubPart::Decompile(TiXmlNode *root, uint16_t id) const
+void SubPart::Decompile(XmlWriter *writer, uint16_t id) const
 {
-    TiXmlElement *entry_root = new TiXmlElement("SubPart");
-    entry_root->SetAttribute("id", Utils::UnsignedToString(id, true));
+    writer->StartElement("SubPart");
+    writer->Attribute("id", Utils::UnsignedToString(id, true));
 
     if (meta_name != "")
     {
-        Utils::WriteComment(entry_root, meta_name.c_str());
+        Utils::WriteComment(writer, meta_name.c_str());
     }
 
-    Utils::WriteParamUnsigned(entry_root, "STRIPS", strips);
-    Utils::WriteParamMultipleFloats(entry_root, "VECTORS", std::vector<float>(vectors, vectors+12));
+    Utils::WriteParamUnsigned(writer, "STRIPS", strips);
+    Utils::WriteParamMultipleFloats(writer, "VECTORS", std::vector<float>(vectors, vectors+12));
 
-    Utils::WriteParamUnsigned(entry_root, "FLAGS", flags, true);
-    Utils::WriteParamUnsigned(entry_root, "U_02", unk_02, true);
-    Utils::WriteParamUnsigned(entry_root, "U_06", unk_06, true);
-    Utils::WriteParamUnsigned(entry_root, "U_08", unk_08, true);
+    Utils::WriteParamUnsigned(writer, "FLAGS", flags, true);
+    Utils::WriteParamUnsigned(writer, "U_02", unk_02, true);
+    Utils::WriteParamUnsigned(writer, "U_06", unk_06, true);
+    Utils::WriteParamUnsigned(writer, "U_08", unk_08, true);
 
     for (size_t i = 0; i < textures_lists.size(); i++)
     {
-        textures_lists[i].Decompile(entry_root, i);
+        textures_lists[i].Decompile(writer, i);
     }
 
     for (size_t i = 0; i < submeshes.size(); i++)
     {
-        submeshes[i].Decompile(entry_root, i, GetNumberOfPolygons(i));
+        submeshes[i].Decompile(writer, i, GetNumberOfPolygons(i));
     }
 
     for (const VertexData &v : vertex)
     {
-        v.Decompile(entry_root);
+        v.Decompile(writer);
     }
 
-    root->LinkEndChild(entry_root);
+    writer->EndElement();
 }
 
 bool SubPart::Compile(const TiXmlElement *root, SkeletonFile *skl)
@@ -2225,17 +2224,17 @@ size_t TexturesList::ReplaceEmbIndex(uint8_t old_index, uint8_t new_index)
     return count;
 }
 
-void TexturesList::Decompile(TiXmlNode *root, uint16_t id) const
+void TexturesList::Decompile(XmlWriter *writer, uint16_t id) const
 {
-    TiXmlElement *entry_root = new TiXmlElement("TexturesList");
-    entry_root->SetAttribute("id", Utils::UnsignedToString(id, true));
+    writer->StartElement("TexturesList");
+    writer->Attribute("id", Utils::UnsignedToString(id, true));
 
     for (const Texture &t : textures)
     {
-        t.Decompile(entry_root);
+        t.Decompile(writer);
     }
 
-    root->LinkEndChild(entry_root);
+    writer->EndElement();
 }
 
 bool TexturesList::Compile(const TiXmlElement *root)
@@ -2290,22 +2289,22 @@ size_t SubMesh::GetLinkedBones(std::vector<Bone *> &list, bool clear_vector, boo
     return count;
 }
 
-void SubMesh::Decompile(TiXmlNode *root, uint32_t id, size_t polygon_count) const
+void SubMesh::Decompile(XmlWriter *writer, uint32_t id, size_t polygon_count) const
 {
-    TiXmlElement *entry_root = new TiXmlElement("SubMesh");
-    entry_root->SetAttribute("id", Utils::UnsignedToString(id, true));
+    writer->StartElement("SubMesh");
+    writer->Attribute("id", Utils::UnsignedToString(id, true));
 
     if (meta_name != "")
     {
-        Utils::WriteComment(entry_root, meta_name.c_str());
+        Utils::WriteComment(writer, meta_name.c_str());
     }
 
-    Utils::WriteParamString(entry_root, "EMMMaterial", emm_material);
-    Utils::WriteParamUnsigned(entry_root, "TEXTURES_LISTS_INDEX", tl_index, true);
-    Utils::WriteParamMultipleFloats(entry_root, "VECTOR", std::vector<float>(vector, vector+4));
+    Utils::WriteParamString(writer, "EMMMaterial", emm_material);
+    Utils::WriteParamUnsigned(writer, "TEXTURES_LISTS_INDEX", tl_index, true);
+    Utils::WriteParamMultipleFloats(writer, "VECTOR", std::vector<float>(vector, vector+4));
 
-    Utils::WriteComment(entry_root, Utils::ToString(faces.size()) + " faces. " + Utils::ToString(polygon_count) + " polygons.");
-    Utils::WriteParamMultipleUnsigned(entry_root, "FACES", faces, true);
+    Utils::WriteComment(writer, Utils::ToString(faces.size()) + " faces. " + Utils::ToString(polygon_count) + " polygons.");
+    Utils::WriteParamMultipleUnsigned(writer, "FACES", faces, true);
 	
 	std::string bones_names;
 
@@ -2317,9 +2316,9 @@ void SubMesh::Decompile(TiXmlNode *root, uint32_t id, size_t polygon_count) cons
 		bones_names += b->GetName();
     }
 	
-	Utils::WriteParamString(entry_root, "LINKED_BONES", bones_names);
+	Utils::WriteParamString(writer, "LINKED_BONES", bones_names);
 
-    root->LinkEndChild(entry_root);
+    writer->EndElement();
 }
 
 bool SubMesh::Compile(const TiXmlElement *root, SkeletonFile *skl)
@@ -2806,28 +2805,28 @@ size_t EmgFile::ExportObj(std::string *vertex_out, std::string *uvmap_out, std::
     return count;
 }
 
-void EmgFile::Decompile(TiXmlNode *root, uint16_t id) const
+void EmgFile::Decompile(XmlWriter *writer, uint16_t id) const
 {
-    TiXmlElement *entry_root = new TiXmlElement("EMG");
-    entry_root->SetAttribute("id", Utils::UnsignedToString(id, true));
+    writer->StartElement("EMG");
+    writer->Attribute("id", Utils::UnsignedToString(id, true));
 
-    Utils::WriteComment(entry_root, meta_name);
+    Utils::WriteComment(writer, meta_name);
 
     if (!IsEmpty())
     {
-        Utils::WriteParamUnsigned(entry_root, "U_04", unk_04, true);
+        Utils::WriteParamUnsigned(writer, "U_04", unk_04, true);
 
         for (size_t i = 0; i < subparts.size(); i++)
         {
-            subparts[i].Decompile(entry_root, i);
+            subparts[i].Decompile(writer, i);
         }
     }
     else
     {
-        Utils::WriteComment(entry_root, "Empty part. This is normal.");
+        Utils::WriteComment(writer, "Empty part. This is normal.");
     }
 
-    root->LinkEndChild(entry_root);
+    writer->EndElement();
 }
 
 bool EmgFile::Compile(const TiXmlElement *root, SkeletonFile *skl)
@@ -159,7 +159,7 @@ struct VertexData
 
     unsigned int size;
 	
-    void Decompile(TiXmlNode *root) const;
+    void Decompile(XmlWriter *writer) const;
     bool Compile(const TiXmlElement *root, unsigned int vertex_size);
 
     inline bool operator==(const VertexData &rhs) const
@@ -322,7 +322,7 @@ public:
     size_t ExportObj(std::string *vertex_out, std::string *uvmap_out, std::string *normal_out, std::string *topology_out, size_t v_start_idx=0, bool write_group=true) const;
     bool InjectObj(const std::string &obj, bool do_uv, bool do_normal, int v_start_idx=0, int vt_start_idx=0, int vn_start_idx=0, bool show_error=true);
 
-    void Decompile(TiXmlNode *root, uint16_t id) const;
+    void Decompile(XmlWriter *writer, uint16_t id) const;
     bool Compile(const TiXmlElement *root, SkeletonFile *skl);
 
 #ifdef FBX_SUPPORT
@@ -365,7 +365,7 @@ public:
     size_t GetEmbIndexes(std::vector<uint8_t> &list, bool clear_vector, bool unique=true, bool sort=false) const;
     size_t ReplaceEmbIndex(uint8_t old_index, uint8_t new_index);
 
-    void Decompile(TiXmlNode *root, uint16_t id) const;
+    void Decompile(XmlWriter *writer, uint16_t id) const;
     bool Compile(const TiXmlElement *root);
 
     inline bool operator==(const TexturesList &rhs) const
@@ -431,7 +431,7 @@ public:
         return Utils::BeginsWith(emm_material, "edge", false);
     }
 
-    void Decompile(TiXmlNode *root, uint32_t id, size_t polygon_count) const;
+    void Decompile(XmlWriter *writer, uint32_t id, size_t polygon_count) const;
     bool Compile(const TiXmlElement *root, SkeletonFile *skl);
 
     bool operator==(const SubMesh &rhs) const;
@@ -464,7 +464,7 @@ public:
     inline uint8_t GetEmbIndex() { return emb_index; }
     inline void SetEmbIndex(uint8_t index) { this->emb_index = index; }
 
-    void Decompile(TiXmlNode *root) const;
+    void Decompile(XmlWriter *writer) const;
     bool Compile(const TiXmlElement *root);
 
     inline bool operator==(const Texture &rhs) const
@@ -550,7 +550,7 @@ public:
 
     size_t ExportObj(std::string *vertex_out, std::string *uvmap_out, std::string *normal_out, std::string *topology_out, size_t v_start_idx=0, bool write_group=true) const;
 
-    void Decompile(TiXmlNode *root, uint16_t id) const;
+    void Decompile(XmlWriter *writer, uint16_t id) const;
     bool Compile(const TiXmlElement *root, SkeletonFile *skl);
 
 #ifdef FBX_SUPPORT
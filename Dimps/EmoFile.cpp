@@ -198,18 +198,18 @@ size_t PartsGroup::ExportObj(std::string *vertex_out, std::string *uvmap_out, st
     return count;
 }
 
-void PartsGroup::Decompile(TiXmlNode *root) const
+void PartsGroup::Decompile(XmlWriter *writer) const
 {
-    TiXmlElement *entry_root = new TiXmlElement("PartsGroup");
+    writer->StartElement("PartsGroup");
 
-    entry_root->SetAttribute("name", name);
+    writer->Attribute("name", name);
 
     for (size_t i = 0; i < parts.size(); i++)
     {
-        parts[i].Decompile(entry_root, i);
+        parts[i].Decompile(writer, i);
     }
 
-    root->LinkEndChild(entry_root);
+    writer->EndElement();
 }
 
 bool PartsGroup::Compile(const TiXmlElement *root, SkeletonFile *skl)
@@ -1374,25 +1374,30 @@ uint8_t *EmoFile::Save(size_t *psize)
 TiXmlDocument *EmoFile::Decompile() const
 {	
 	TiXmlDocument *doc = new TiXmlDocument();
+	XmlWriter writer(doc);
 	
-	TiXmlDeclaration* decl = new TiXmlDeclaration("1.0", "utf-8", "" );	
-	doc->LinkEndChild(decl);
-	
-	TiXmlElement *root = new TiXmlElement("EMO");
+	DecompileStream(&writer);
+	return doc;
+}
+
+bool EmoFile::DecompileStream(XmlWriter *writer) const
+{
+	writer->Declaration();
+	writer->StartElement("EMO");
 	
-	Utils::WriteParamUnsigned(root, "MATERIAL_COUNT", material_count);
-    Utils::WriteParamMultipleUnsigned(root, "U_08", std::vector<uint16_t>(unk_08, unk_08+2), true);
-    Utils::WriteParamMultipleUnsigned(root, "U_18", std::vector<uint32_t>(unk_18, unk_18+2), true);
+	Utils::WriteParamUnsigned(writer, "MATERIAL_COUNT", material_count);
+    Utils::WriteParamMultipleUnsigned(writer, "U_08", std::vector<uint16_t>(unk_08, unk_08+2), true);
+    Utils::WriteParamMultipleUnsigned(writer, "U_18", std::vector<uint32_t>(unk_18, unk_18+2), true);
 	
 	for (const PartsGroup &pg : groups)
 	{
-		pg.Decompile(root);
+		pg.Decompile(writer);
 	}
 	
-	doc->LinkEndChild(root);
-	SkeletonFile::Decompile(doc);	
+	writer->EndElement();
+	SkeletonFile::Decompile(writer);
 	
-	return doc;
+	return true;
 }
 
 bool EmoFile::Compile(TiXmlDocument *doc, bool big_endian)
@@ -108,7 +108,7 @@ public:
 
     size_t ExportObj(std::string *vertex_out, std::string *uvmap_out, std::string *normal_out, std::string *topology_out, size_t v_start_idx=0, bool write_group=false) const;
 
-    void Decompile(TiXmlNode *root) const;
+    void Decompile(XmlWriter *writer) const;
     bool Compile(const TiXmlElement *root, SkeletonFile *skl);
 
 #ifdef FBX_SUPPORT
@@ -307,6 +307,9 @@ public:
 	virtual TiXmlDocument *Decompile() const override;
 	virtual bool Compile(TiXmlDocument *doc, bool big_endian=false) override;
 
+    virtual bool DecompileStream(XmlWriter *writer) const override;
+    virtual bool SupportsDecompileStream() const override { return true; }
+
     virtual bool DecompileToFile(const std::string &path, bool show_error=true, bool build_path=false) override;
     virtual bool CompileFromFile(const std::string &path, bool show_error=true, bool big_endian=false) override;
 
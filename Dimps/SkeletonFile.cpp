@@ -117,7 +117,7 @@ const static std::vector<std::string> matrix_suffix =
     "_O"
 };
 
-void Bone::DecompileTransformationMatrix(TiXmlElement *root, const char *name, const float *matrix)
+void Bone::DecompileTransformationMatrix(XmlWriter *writer, const char *name, const float *matrix)
 {
     std::vector<float> row;
 
@@ -139,22 +139,22 @@ void Bone::DecompileTransformationMatrix(TiXmlElement *root, const char *name, c
 
     std::string comment = "Translation: " + Utils::FloatToString((float)translation[0]) + ", " +
                           Utils::FloatToString((float)translation[1]) + ", " + Utils::FloatToString((float)translation[2]);
-    Utils::WriteComment(root, comment);
+    Utils::WriteComment(writer, comment);
 
     comment = "Rotation: " + Utils::FloatToString((float)rotation[0]) + ", " + Utils::FloatToString((float)rotation[1]) + ", " +
                 Utils::FloatToString((float)rotation[2]) + ", " + Utils::FloatToString((float)rotation[3]);
-    Utils::WriteComment(root, comment);
+    Utils::WriteComment(writer, comment);
 
     comment = "Scaling: " + Utils::FloatToString((float)scaling[0]) + ", " +
             Utils::FloatToString((float)scaling[1]) + ", " + Utils::FloatToString((float)scaling[2]);
-    Utils::WriteComment(root, comment);
+    Utils::WriteComment(writer, comment);
 
     comment = "Shearing: " + Utils::FloatToString((float)shearing[0]) + ", " +
             Utils::FloatToString((float)shearing[1]) + ", " + Utils::FloatToString((float)shearing[2]);
-    Utils::WriteComment(root, comment);
+    Utils::WriteComment(writer, comment);
 
     comment = "Sign: " + Utils::FloatToString((float)sign);
-    Utils::WriteComment(root, comment);
+    Utils::WriteComment(writer, comment);
 
 
 #endif
@@ -168,7 +168,7 @@ void Bone::DecompileTransformationMatrix(TiXmlElement *root, const char *name, c
         row[2] = matrix[i+8];
         row[3] = matrix[i+12];
 
-        Utils::WriteParamMultipleFloats(root, row_name.c_str(), row);
+        Utils::WriteParamMultipleFloats(writer, row_name.c_str(), row);
     }
 }
 
@@ -206,71 +206,71 @@ int Bone::CompileTransformationMatrix(const TiXmlElement *root, const char *name
     return true;
 }
 
-void Bone::Decompile(TiXmlNode *root) const
+void Bone::Decompile(XmlWriter *writer) const
 {
-    TiXmlElement *entry_root = new TiXmlElement("Bone");
-    entry_root->SetAttribute("name", name);
+    writer->StartElement("Bone");
+    writer->Attribute("name", name);
 
     if (parent)
     {
-        Utils::WriteParamString(entry_root, "PARENT", parent->name);
+        Utils::WriteParamString(writer, "PARENT", parent->name);
     }
     else
     {
-        Utils::WriteParamString(entry_root, "PARENT", "NULL");
+        Utils::WriteParamString(writer, "PARENT", "NULL");
     }
 
     if (child1)
     {
-        Utils::WriteParamString(entry_root, "CHILD1", child1->name);
+        Utils::WriteParamString(writer, "CHILD1", child1->name);
     }
     else
     {
-        Utils::WriteParamString(entry_root, "CHILD1", "NULL");
+        Utils::WriteParamString(writer, "CHILD1", "NULL");
     }
 
     if (child2)
     {
-        Utils::WriteParamString(entry_root, "CHILD2", child2->name);
+        Utils::WriteParamString(writer, "CHILD2", child2->name);
     }
     else
     {
-        Utils::WriteParamString(entry_root, "CHILD2", "NULL");
+        Utils::WriteParamString(writer, "CHILD2", "NULL");
     }
 
     if (child3)
     {
-        Utils::WriteParamString(entry_root, "CHILD3", child3->name);
+        Utils::WriteParamString(writer, "CHILD3", child3->name);
     }
     else
     {
-        Utils::WriteParamString(entry_root, "CHILD3", "NULL");
+        Utils::WriteParamString(writer, "CHILD3", "NULL");
     }
 
     if (child4)
     {
-        Utils::WriteParamString(entry_root, "CHILD4", child4->name);
+        Utils::WriteParamString(writer, "CHILD4", child4->name);
     }
     else
     {
-        Utils::WriteParamString(entry_root, "CHILD4", "NULL");
+        Utils::WriteParamString(writer, "CHILD4", "NULL");
     }
 
-    DecompileTransformationMatrix(entry_root, "M1", matrix1);
+    DecompileTransformationMatrix(writer, "M1", matrix1);
 
     if (has_matrix2)
     {
-       DecompileTransformationMatrix(entry_root, "M2", matrix2);
+       DecompileTransformationMatrix(writer, "M2", matrix2);
     }
 
-    Utils::WriteParamMultipleUnsigned(entry_root, "SN_U_0A", std::vector<uint16_t>(sn_u0A, sn_u0A+3), true);
+    Utils::WriteParamMultipleUnsigned(writer, "SN_U_0A", std::vector<uint16_t>(sn_u0A, sn_u0A+3), true);
 
     if (has_unk)
     {
-        Utils::WriteParamMultipleUnsigned(entry_root, "USD_U_00", std::vector<uint16_t>(usd_u00, usd_u00+4), true);
+        Utils::WriteParamMultipleUnsigned(writer, "USD_U_00", std::vector<uint16_t>(usd_u00, usd_u00+4), true);
     }
 
-    root->LinkEndChild(entry_root);
+    writer->EndElement();
 }
 
 bool Bone::Compile(const TiXmlElement *root, SkeletonFile *skl)
@@ -1294,36 +1294,42 @@ uint8_t *SkeletonFile::Save(size_t *psize)
     return buf;
 }
 
-void SkeletonFile::Decompile(TiXmlNode *root) const
+void SkeletonFile::Decompile(XmlWriter *writer) const
 {
-    TiXmlElement *entry_root = new TiXmlElement("Skeleton");
+    writer->StartElement("Skeleton");
 
-    Utils::WriteParamUnsigned(entry_root, "U_02", unk_02, true);
-    Utils::WriteParamUnsigned(entry_root, "U_06", unk_06, true);
-    Utils::WriteParamMultipleUnsigned(entry_root, "U_10", std::vector<uint32_t>(unk_10, unk_10+2), true);
-    Utils::WriteParamMultipleUnsigned(entry_root, "U_34", std::vector<uint16_t>(unk_34, unk_34+2), true);
-    Utils::WriteParamMultipleFloats(entry_root, "U_38", std::vector<float>(unk_38, unk_38+2));
+    Utils::WriteParamUnsigned(writer, "U_02", unk_02, true);
+    Utils::WriteParamUnsigned(writer, "U_06", unk_06, true);
+    Utils::WriteParamMultipleUnsigned(writer, "U_10", std::vector<uint32_t>(unk_10, unk_10+2), true);
+    Utils::WriteParamMultipleUnsigned(writer, "U_34", std::vector<uint16_t>(unk_34, unk_34+2), true);
+    Utils::WriteParamMultipleFloats(writer, "U_38", std::vector<float>(unk_38, unk_38+2));
 
     for (const Bone &b : bones)
     {
-        b.Decompile(entry_root);
+        b.Decompile(writer);
     }
 
     if (ik_data)
     {
-        Utils::WriteParamBlob(entry_root, "IK_DATA", ik_data, ik_size);
+        Utils::WriteParamBlob(writer, "IK_DATA", ik_data, ik_size);
     }
 
-    root->LinkEndChild(entry_root);
+    writer->EndElement();
+}
+
+void SkeletonFile::Decompile(TiXmlNode *root) const
+{
+    XmlWriter writer(root);
+    Decompile(&writer);
 }
 
 TiXmlDocument *SkeletonFile::Decompile() const
 {
     TiXmlDocument *doc = new TiXmlDocument();
-    TiXmlDeclaration* decl = new TiXmlDeclaration("1.0", "utf-8", "" );
-    doc->LinkEndChild(decl);
+    XmlWriter writer(doc);
 
-    Decompile(doc);
+    writer.Declaration();
+    Decompile(&writer);
 
     return doc;
 }
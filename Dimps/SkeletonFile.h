@@ -8,6 +8,7 @@
 #include <stdexcept>
 
 #include "BaseFile.h"
+#include "XmlWriter.h"
 
 #ifdef FBX_SUPPORT
 #include <fbxsdk.h>
@@ -129,7 +130,7 @@ private:
     // This looses its meaning when the skeleton is modified
     uint32_t meta_original_offset;
 
-    static void DecompileTransformationMatrix(TiXmlElement *root, const char *name, const float *matrix);
+    static void DecompileTransformationMatrix(XmlWriter *writer, const char *name, const float *matrix);
     static int CompileTransformationMatrix(const TiXmlElement *root, const char *name, float *matrix, bool must_exist);
     static bool PartialCompare(const Bone *b1, const Bone *b2);
 
@@ -192,7 +193,7 @@ public:
         name = str;
     }
 
-    void Decompile(TiXmlNode *root) const;
+    void Decompile(XmlWriter *writer) const;
     bool Compile(const TiXmlElement *root, SkeletonFile *skl);
 
 #ifdef FBX_SUPPORT
@@ -255,7 +256,7 @@ public:
 
     SkeletonFile();
     SkeletonFile(uint8_t *buf, unsigned int size);
-    SkeletonFile(const SkeletonFile &other)
+    SkeletonFile(const SkeletonFile &other) : BaseFile(other)
     {
         Copy(other);
     }
@@ -303,6 +304,7 @@ public:
     virtual bool Load(const uint8_t *buf, size_t size) override;
     virtual uint8_t *Save(size_t *psize) override;
 
+    void Decompile(XmlWriter *writer) const;
     void Decompile(TiXmlNode *root) const;
     virtual TiXmlDocument *Decompile() const override;
 
@@ -0,0 +1,38 @@
+#ifndef EPATCHCACHE_H
+#define EPATCHCACHE_H
+
+#include "BaseFile.h"
+#include "EPatchCacheData.h"
+
+// Addresses where the patches were found in the previous launches, so that EPatch::Find can skip the search.
+// The file side (LoadFromFile, SaveToFile...) of EPatchCacheData, which has the format and the lookups.
+class EPatchCache : public BaseFile
+{
+private:
+
+    EPatchCacheData data;
+
+public:
+
+    EPatchCache() { }
+    virtual ~EPatchCache() override { }
+
+    virtual bool Load(const uint8_t *buf, size_t size) override { return data.Load(buf, size); }
+    virtual uint8_t *Save(size_t *psize) override { return data.Save(psize); }
+
+    static void GetModuleId(const uint8_t *top, size_t image_size, uint8_t *id) { EPatchCacheData::GetModuleId(top, image_size, id); }
+    static void GetPatchId(const std::string &name, const std::vector<uint16_t> &pattern, size_t search_start, size_t search_down, size_t search_up, uint8_t *id)
+    {
+        EPatchCacheData::GetPatchId(name, pattern, search_start, search_down, search_up, id);
+    }
+
+    void CheckModule(const std::string &module, const uint8_t *top, size_t image_size) { data.CheckModule(module, top, image_size); }
+
+    bool GetAddress(const std::string &module, const uint8_t *patch_id, uint32_t match, size_t *address) const { return data.GetAddress(module, patch_id, match, address); }
+    void SetAddress(const std::string &module, const uint8_t *patch_id, uint32_t match, size_t address) { data.SetAddress(module, patch_id, match, address); }
+
+    size_t GetNumEntries() const { return data.GetNumEntries(); }
+    inline bool IsModified() const { return data.IsModified(); }
+};
+
+#endif // EPATCHCACHE_H
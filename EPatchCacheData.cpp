@@ -0,0 +1,292 @@
+#include <string.h>
+
+#include "EPatchCacheData.h"
+#include "UtilsCrypto.h"
+#include "debug.h"
+
+// PE headers, only the offsets of the fields used by GetModuleId
+#define PE_LFANEW_OFFSET            0x3C
+#define PE_SIGNATURE                0x00004550 // "PE\0\0"
+#define PE_FILE_HEADER_SIZE         20
+#define PE_NUM_SECTIONS_OFFSET      2
+#define PE_OPT_HEADER_SIZE_OFFSET   16
+#define PE_ENTRY_POINT_OFFSET       16 // From here on, relative to the optional header (same in PE32 and PE32+)
+#define PE_SIZE_OF_IMAGE_OFFSET     56
+#define PE_CHECKSUM_OFFSET          64
+#define PE_SECTION_HEADER_SIZE      40
+
+// The cache is only written and read on the same machine, so everything is in native (little endian) order
+static bool read_u32(const uint8_t *buf, size_t size, size_t *pos, uint32_t *value)
+{
+    if (size - *pos < sizeof(uint32_t))
+        return false;
+
+    memcpy(value, buf + *pos, sizeof(uint32_t));
+    *pos += sizeof(uint32_t);
+    return true;
+}
+
+static bool read_bytes(const uint8_t *buf, size_t size, size_t *pos, void *out, size_t len)
+{
+    if (size - *pos < len)
+        return false;
+
+    memcpy(out, buf + *pos, len);
+    *pos += len;
+    return true;
+}
+
+static void write_u32(std::vector<uint8_t> &out, uint32_t value)
+{
+    const uint8_t *p = (const uint8_t *)&value;
+    out.insert(out.end(), p, p + sizeof(uint32_t));
+}
+
+static void write_bytes(std::vector<uint8_t> &out, const void *data, size_t len)
+{
+    const uint8_t *p = (const uint8_t *)data;
+    out.insert(out.end(), p, p + len);
+}
+
+void EPatchCacheData::Reset()
+{
+    modules.clear();
+    modified = false;
+}
+
+std::string EPatchCacheData::MakeKey(const uint8_t *patch_id, uint32_t match)
+{
+    std::string key((const char *)patch_id, EPCH_ID_SIZE);
+
+    key.append((const char *)&match, sizeof(uint32_t));
+    return key;
+}
+
+bool EPatchCacheData::Load(const uint8_t *buf, size_t size)
+{
+    uint32_t signature, version, num_modules;
+    size_t pos = 0;
+
+    Reset();
+
+    if (!read_u32(buf, size, &pos, &signature) || !read_u32(buf, size, &pos, &version) || !read_u32(buf, size, &pos, &num_modules))
+        return false;
+
+    if (signature != EPCH_SIGNATURE)
+    {
+        DPRINTF("%s: Invalid signature.\n", FUNCNAME);
+        return false;
+    }
+
+    // Old versions are just discarded, the cache will be rebuilt
+    if (version != EPCH_VERSION)
+        return false;
+
+    for (uint32_t i = 0; i < num_modules; i++)
+    {
+        uint32_t name_len, num_entries;
+        std::string name;
+
+        if (!read_u32(buf, size, &pos, &name_len) || name_len > size - pos)
+            goto corrupted;
+
+        name.assign((const char *)buf + pos, name_len);
+        pos += name_len;
+
+        Module &module = modules[name];
+        module.checked = false;
+
+        if (!read_bytes(buf, size, &pos, module.id, EPCH_ID_SIZE) || !read_u32(buf, size, &pos, &num_entries))
+            goto corrupted;
+
+        if ((uint64_t)num_entries * (EPCH_ID_SIZE + 8) > size - pos)
+            goto corrupted;
+
+        module.addresses.reserve(num_entries);
+
+        for (uint32_t j = 0; j < num_entries; j++)
+        {
+            uint8_t patch_id[EPCH_ID_SIZE];
+            uint32_t match, address;
+
+            if (!read_bytes(buf, size, &pos, patch_id, EPCH_ID_SIZE) || !read_u32(buf, size, &pos, &match) || !read_u32(buf, size, &pos, &address))
+                goto corrupted;
+
+            module.addresses[MakeKey(patch_id, match)] = address;
+        }
+    }
+
+    return true;
+
+corrupted:
+
+    DPRINTF("%s: File is corrupted.\n", FUNCNAME);
+    Reset();
+    return false;
+}
+
+uint8_t *EPatchCacheData::Save(size_t *psize) const
+{
+    std::vector<uint8_t> out;
+
+    write_u32(out, EPCH_SIGNATURE);
+    write_u32(out, EPCH_VERSION);
+    write_u32(out, (uint32_t)modules.size());
+
+    for (auto &it : modules)
+    {
+        const Module &module = it.second;
+
+        write_u32(out, (uint32_t)it.first.length());
+        write_bytes(out, it.first.data(), it.first.length());
+        write_bytes(out, module.id, EPCH_ID_SIZE);
+        write_u32(out, (uint32_t)module.addresses.size());
+
+        for (auto &it2 : module.addresses)
+        {
+            // The key is the patch id followed by the match index
+            write_bytes(out, it2.first.data(), EPCH_ID_SIZE + sizeof(uint32_t));
+            write_u32(out, it2.second);
+        }
+    }
+
+    uint8_t *buf = new uint8_t[out.size()];
+    memcpy(buf, out.data(), out.size());
+
+    *psize = out.size();
+    return buf;
+}
+
+void EPatchCacheData::GetModuleId(const uint8_t *top, size_t image_size, uint8_t *id)
+{
+    Utils::Sha1Hasher hasher;
+    uint64_t size64 = image_size;
+    uint32_t lfanew, signature;
+    uint16_t num_sections, opt_header_size;
+
+    hasher.Update(&size64, sizeof(uint64_t));
+
+    if (image_size < PE_LFANEW_OFFSET + sizeof(uint32_t) || top[0] != 'M' || top[1] != 'Z')
+    {
+        hasher.Final(id);
+        return;
+    }
+
+    memcpy(&lfanew, top + PE_LFANEW_OFFSET, sizeof(uint32_t));
+
+    if ((uint64_t)lfanew + sizeof(uint32_t) + PE_FILE_HEADER_SIZE > image_size)
+    {
+        hasher.Final(id);
+        return;
+    }
+
+    const uint8_t *file_header = top + lfanew + sizeof(uint32_t);
+
+    memcpy(&signature, top + lfanew, sizeof(uint32_t));
+    memcpy(&num_sections, file_header + PE_NUM_SECTIONS_OFFSET, sizeof(uint16_t));
+    memcpy(&opt_header_size, file_header + PE_OPT_HEADER_SIZE_OFFSET, sizeof(uint16_t));
+
+    const uint8_t *opt_header = file_header + PE_FILE_HEADER_SIZE;
+    const uint8_t *sections = opt_header + opt_header_size;
+    uint64_t headers_end = (uint64_t)(sections - top) + (uint64_t)num_sections * PE_SECTION_HEADER_SIZE;
+
+    if (signature != PE_SIGNATURE || opt_header_size < PE_CHECKSUM_OFFSET + sizeof(uint32_t) || headers_end > image_size)
+    {
+        hasher.Final(id);
+        return;
+    }
+
+    hasher.Update(file_header, PE_FILE_HEADER_SIZE);
+    hasher.Update(opt_header + PE_ENTRY_POINT_OFFSET, sizeof(uint32_t));
+    hasher.Update(opt_header + PE_SIZE_OF_IMAGE_OFFSET, sizeof(uint32_t));
+    hasher.Update(opt_header + PE_CHECKSUM_OFFSET, sizeof(uint32_t));
+    hasher.Update(sections, (size_t)num_sections * PE_SECTION_HEADER_SIZE);
+    hasher.Final(id);
+}
+
+void EPatchCacheData::GetPatchId(const std::string &name, const std::vector<uint16_t> &pattern, size_t search_start, size_t search_down, size_t search_up, uint8_t *id)
+{
+    Utils::Sha1Hasher hasher;
+    uint64_t search[3] = { search_start, search_down, search_up };
+    uint32_t name_len = (uint32_t)name.length();
+
+    // The length first, so that name and pattern can't be confused
+    hasher.Update(&name_len, sizeof(uint32_t));
+    hasher.Update(name.data(), name.length());
+    hasher.Update(search, sizeof(search));
+    hasher.Update(pattern.data(), pattern.size()*sizeof(uint16_t));
+    hasher.Final(id);
+}
+
+void EPatchCacheData::CheckModule(const std::string &module, const uint8_t *top, size_t image_size)
+{
+    auto it = modules.find(module);
+
+    if (it != modules.end() && it->second.checked)
+        return;
+
+    uint8_t id[EPCH_ID_SIZE];
+    GetModuleId(top, image_size, id);
+
+    if (it == modules.end())
+    {
+        Module &new_module = modules[module];
+
+        memcpy(new_module.id, id, EPCH_ID_SIZE);
+        new_module.checked = true;
+        modified = true;
+        return;
+    }
+
+    if (memcmp(it->second.id, id, EPCH_ID_SIZE) != 0)
+    {
+        // Game updated (or another executable with the same name)
+        memcpy(it->second.id, id, EPCH_ID_SIZE);
+        it->second.addresses.clear();
+        modified = true;
+    }
+
+    it->second.checked = true;
+}
+
+bool EPatchCacheData::GetAddress(const std::string &module, const uint8_t *patch_id, uint32_t match, size_t *address) const
+{
+    auto it = modules.find(module);
+
+    if (it == modules.end() || !it->second.checked)
+        return false;
+
+    auto it2 = it->second.addresses.find(MakeKey(patch_id, match));
+    if (it2 == it->second.addresses.end())
+        return false;
+
+    *address = it2->second;
+    return true;
+}
+
+void EPatchCacheData::SetAddress(const std::string &module, const uint8_t *patch_id, uint32_t match, size_t address)
+{
+    auto it = modules.find(module);
+
+    if (it == modules.end() || !it->second.checked || address > 0xFFFFFFFF)
+        return;
+
+    const std::string key = MakeKey(patch_id, match);
+    auto it2 = it->second.addresses.find(key);
+
+    if (it2 != it->second.addresses.end() && it2->second == (uint32_t)address)
+        return;
+
+    it->second.addresses[key] = (uint32_t)address;
+    modified = true;
+}
+
+size_t EPatchCacheData::GetNumEntries() const
+{
+    size_t count = 0;
+
+    for (auto &it : modules)
+        count += it.second.addresses.size();
+
+    return count;
+}
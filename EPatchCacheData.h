@@ -0,0 +1,64 @@
+#ifndef EPATCHCACHEDATA_H
+#define EPATCHCACHEDATA_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <unordered_map>
+
+#define EPCH_SIGNATURE  0x48435045 // "EPCH"
+#define EPCH_VERSION    2
+
+#define EPCH_ID_SIZE    20
+
+// The content of EPatchCache: the file format, the ids and the lookups. Kept apart from BaseFile (and so from Utils.h
+// and windows.h) so that it builds anywhere.
+// Entries are grouped per module and dropped when the identity of the module (see GetModuleId) changes. The addresses
+// are relative to the module and are only hints: they must be verified against the pattern.
+class EPatchCacheData
+{
+private:
+
+    struct Module
+    {
+        uint8_t id[EPCH_ID_SIZE];
+        bool checked; // Identity compared with the module in memory in this session
+        std::unordered_map<std::string, uint32_t> addresses; // patch id + match index -> address
+    };
+
+    std::map<std::string, Module> modules;
+    bool modified;
+
+    static std::string MakeKey(const uint8_t *patch_id, uint32_t match);
+
+public:
+
+    EPatchCacheData() : modified(false) { }
+
+    void Reset();
+
+    bool Load(const uint8_t *buf, size_t size);
+    uint8_t *Save(size_t *psize) const;
+
+    // SHA1 of the fields of the PE headers that identify the build of the module: the file header (timestamp,
+    // number of sections...), the entry point, SizeOfImage, CheckSum and the section table. The image base is left out,
+    // the loader rewrites it when the module is relocated (ASLR). If top is not a PE image, only image_size is used.
+    static void GetModuleId(const uint8_t *top, size_t image_size, uint8_t *id);
+    // SHA1 of the name of the patch, its search pattern and the parameters of the search
+    static void GetPatchId(const std::string &name, const std::vector<uint16_t> &pattern, size_t search_start, size_t search_down, size_t search_up, uint8_t *id);
+
+    // Must be called before using the entries of a module. The hash is only done the first time in the session,
+    // if the module is not the one of the cache its entries are dropped.
+    void CheckModule(const std::string &module, const uint8_t *top, size_t image_size);
+
+    bool GetAddress(const std::string &module, const uint8_t *patch_id, uint32_t match, size_t *address) const;
+    void SetAddress(const std::string &module, const uint8_t *patch_id, uint32_t match, size_t address);
+
+    size_t GetNumEntries() const;
+    // Since the load, to know if it has to be saved
+    inline bool IsModified() const { return modified; }
+};
+
+#endif // EPATCHCACHEDATA_H
@@ -1,4 +1,5 @@
 #include <windows.h>
+#include <algorithm>
 
 #include "EpatchFile.h"
 #include "PatchUtils.h"
@@ -165,8 +166,24 @@ bool EInstruction::Compile(const TiXmlElement *root)
     return true;
 }
 
-std::vector<EPatch> EPatch::log_patches;
+AddressMap<EPatch> EPatch::log_patches;
 Mutex EPatch::log_mutex;
+Mutex EPatch::dbghelp_mutex;
+// Doesn't start its thread until the first line, so it can be created here. Never destroyed: at exit the hooks
+// may still be running and the writer thread already killed. FlushLog writes what is left.
+AsyncLog *EPatch::log_writer = new AsyncLog();
+
+void EPatch::FlushLog(bool process_exit)
+{
+    if (process_exit)
+    {
+        log_writer->FlushOrphaned();
+    }
+    else if (!log_writer->Flush(EPATCH_LOG_FLUSH_TIMEOUT))
+    {
+        DPRINTF("%s: The log writer didn't finish in time, some lines may be lost.\n", FUNCNAME);
+    }
+}
 
 // Keep lower case
 static const std::vector<std::string> epatch_types =
@@ -213,29 +230,82 @@ static const std::vector<std::string> calling_conventions =
     "fastcall"
 };
 
-bool EPatch::IsPattern(size_t address, const std::vector<uint16_t> &pattern) 
+void EPatch::BuildSearchPattern()
 {
-    size_t length = pattern.size();
-    uint8_t *module_top = (uint8_t *)GetModuleHandleA(CSTR(module));
+    if (!rebuild)
+        return;
 
-    for (size_t i = 0; i < length; i++)
+    size_t total_size = 0;
+    for (const EInstruction &ins : instructions)
     {
-        if (pattern[i] >= 0x100)
-            continue;
+        total_size += ins.search_pattern.size();
+    }
 
-        if (module_top[address+i] != pattern[i])
-            return false;
+    search_pattern.resize(total_size);
+    uint16_t *data = search_pattern.data();
+
+    //DPRINTF("total_size = %I64x\n", total_size);
+
+    for (const EInstruction &ins : instructions)
+    {
+        memcpy(data, ins.search_pattern.data(), ins.search_pattern.size()*sizeof(uint16_t));
+        data += ins.search_pattern.size();
     }
+
+    scanner.Compile(search_pattern);
+    EPatchCache::GetPatchId(name, search_pattern, search_start, search_down, search_up, cache_id);
+    rebuild = false;
+}
+
+// Positions where the pattern may start, as [begin, end). Same candidates as always: search_start, search_start+1,
+// search_start-1... down to address_lowest (excluded) and up to address_highest (excluded)
+bool EPatch::GetSearchWindow(size_t image_size, size_t *begin, size_t *end) const
+{
+    if (image_size < search_pattern.size())
+        return false;
+
+    size_t address_lowest, address_highest;
+
+    address_lowest = (search_start < search_down) ? 0 : search_start-search_down;
+    address_highest = search_start+search_up;
 	
-	if (num_matches > 1)
-	{	
-		if (block_addresses.find(address) != block_addresses.end())
-			return false;
-		
-		block_addresses.insert(address);
-	}
-	
-    return true;
+	if (address_lowest < 0x1000)
+		address_lowest = 0x1000; // Possible fix for possible crash
+
+    // The scanner reads the span in blocks, keep it inside the image
+    if (address_highest > image_size - search_pattern.size() + 1)
+        address_highest = image_size - search_pattern.size() + 1;
+
+    *begin = address_lowest+1;
+    *end = address_highest;
+    return (*begin < *end);
+}
+
+void EPatch::SetPrescanHits(std::vector<size_t> &hits)
+{
+    prescan_hits.swap(hits);
+    prescanned = true;
+}
+
+// The address of the last launch, if it still matches. With the same module and patch, the search would
+// find it there again, unless the patches applied before this one changed.
+size_t EPatch::FindCached(const uint8_t *module_top, size_t begin, size_t end, uint32_t match, const std::unordered_set<size_t> *exclude) const
+{
+    size_t address;
+
+    if (!cache->GetAddress(module, cache_id, match, &address))
+        return PATTERN_NOT_FOUND;
+
+    if (address < begin || address >= end)
+        return PATTERN_NOT_FOUND;
+
+    if (exclude && exclude->find(address) != exclude->end())
+        return PATTERN_NOT_FOUND;
+
+    if (!scanner.Match(module_top + address))
+        return PATTERN_NOT_FOUND;
+
+    return address;
 }
 
 uint8_t *EPatch::Find()
@@ -248,90 +318,88 @@ uint8_t *EPatch::Find()
 		return (uint8_t *)GetPtr(search_start, CSTR(module));
 	}
 
-    if (rebuild)
-    {
-        /*if (instructions.size() == 0)
-            return nullptr;*/
-
-        size_t total_size = 0;
-        for (const EInstruction &ins : instructions)
-        {
-            total_size += ins.search_pattern.size();
-        }
+    BuildSearchPattern();
 
-        search_pattern.resize(total_size);
-        uint16_t *data = search_pattern.data();
+    uint8_t *module_top = (uint8_t *)GetModuleHandleA(CSTR(module));
+    if (!module_top)
+        return nullptr;
 
-        //DPRINTF("total_size = %I64x\n", total_size);
+    size_t image_size = GetImageSize(CSTR(module));
+    size_t begin, end;
+    if (!GetSearchWindow(image_size, &begin, &end))
+        return nullptr;
 
-        for (const EInstruction &ins : instructions)
-        {
-            memcpy(data, ins.search_pattern.data(), ins.search_pattern.size()*sizeof(uint16_t));
-            data += ins.search_pattern.size();
-        }
+    const std::unordered_set<size_t> *exclude = (num_matches > 1) ? &block_addresses : nullptr;
+    const uint32_t match = (uint32_t)block_addresses.size();
+    size_t address = PATTERN_NOT_FOUND;
 
-        rebuild = false;
+    if (cache)
+    {
+        cache->CheckModule(module, module_top, image_size);
+        address = FindCached(module_top, begin, end, match, exclude);
     }
 
-    size_t address_lowest, address_highest;
-    size_t address_down, address_up;
-
-    address_lowest = (search_start < search_down) ? 0 : search_start-search_down;
-    address_highest = search_start+search_up;
-	
-	if (address_lowest < 0x1000)
-		address_lowest = 0x1000; // Possible fix for possible crash
+    if (address == PATTERN_NOT_FOUND)
+    {
+        if (prescanned)
+        {
+            // The patches applied after the prescan may have changed some bytes, so the hit must still be there.
+            // If none is left, search again.
+            std::unordered_set<size_t> skip;
 
-    address_down=search_start;
-    address_up=search_start+1;
+            if (exclude)
+                skip = *exclude;
 
-    bool search_down_end = (address_down==address_lowest);
-    bool search_up_end = (address_up==address_highest);
+            while ((address = PatternScanner::FindNearest(prescan_hits, begin, end, search_start, &skip)) != PATTERN_NOT_FOUND)
+            {
+                if (scanner.Match(module_top + address))
+                    break;
 
-    while (!search_down_end || !search_up_end)
-    {
-        if (!search_down_end)
-        {
-            if (IsPattern(address_down, search_pattern))
-            {				
-				return (uint8_t *)GetPtr(address_down, CSTR(module));
+                skip.insert(address);
             }
 
-            address_down--;
-            if (address_down == address_lowest)
-                search_down_end = true;
+            if (address == PATTERN_NOT_FOUND)
+                address = scanner.FindNearest(module_top, begin, end, search_start, exclude);
         }
-
-        if (!search_up_end)
+        else
         {
-            if (IsPattern(address_up, search_pattern))
-            {
-                return (uint8_t *)GetPtr(address_up, (CSTR(module)));
-            }
+            searched = true;
+            address = scanner.FindNearest(module_top, begin, end, search_start, exclude);
 
-            address_up++;
-            if (address_up == address_highest)
-                search_up_end = true;
+            if (file)
+                file->OnSearch(module, address != PATTERN_NOT_FOUND);
         }
+
+        if (address == PATTERN_NOT_FOUND)
+            return nullptr;
+
+        if (cache)
+            cache->SetAddress(module, cache_id, match, address);
     }
 
-    return nullptr;
-}
+    if (num_matches > 1)
+        block_addresses.insert(address);
 
-void EPatch::AddLogPatch()
-{
-    log_patches.push_back(*this);
+    return module_top + address;
 }
 
-EPatch *EPatch::FindLogPatch(void *addr)
+// The copy used by the hook. Never freed once the hook is installed, it may be running with it at any time.
+EPatch *EPatch::AddLogPatch()
 {
-    for (EPatch &patch : log_patches)
+    EPatch *patch = new EPatch(*this);
+
+    if (!log_patches.Insert(log_func, patch))
     {
-        if (patch.log_func == addr)
-            return &patch;
+        delete patch;
+        return nullptr;
     }
 
-    return nullptr;
+    return patch;
+}
+
+EPatch *EPatch::FindLogPatch(void *addr)
+{
+    return log_patches.Find(addr);
 }
 
 void EPatch::LogParam(size_t param, int index, std::string &buf)
@@ -1283,6 +1351,9 @@ bool EPatch::Compile(const TiXmlElement *root)
 	}
 
     rebuild = true;
+    searched = false;
+    prescanned = false;
+    prescan_hits.clear();
     return true;
 }
 
@@ -1570,28 +1641,42 @@ bool EPatch::Apply()
 
 			MutexLocker lock(&log_mutex);
 
+			// Registered before installing the hook, it may be called right away from other threads
+			EPatch *log_patch = AddLogPatch();
+			if (!log_patch)
+			{
+				DPRINTF("%s: patch \"%s\": there is already a log patch with the same number of params and calling convention.\n", FUNCNAME, name.c_str());
+				return false;
+			}
+
+			bool hooked;
+
 			if (hook_type == HOOK_TYPE_NORMAL)
 			{
-				if (!Hook(ptr, &log_original_func, log_func))
-					return false;
+				hooked = Hook(ptr, &log_patch->log_original_func, log_func);
 			}
 			else if (hook_type == HOOK_TYPE_RESOLVE_TARGET)
 			{
-				 if (!HookResolveTarget(ptr, &log_original_func, log_func))
-					return false;
+				hooked = HookResolveTarget(ptr, &log_patch->log_original_func, log_func);
 			}
 			else if (hook_type == HOOK_TYPE_DIRECT_TARGET)
 			{
-				if (!HookResolveTarget(ptr, &log_original_func, log_func, false))
-					return false;
+				hooked = HookResolveTarget(ptr, &log_patch->log_original_func, log_func, false);
 			}
 			else // HOOK_TYPE_CALLL
 			{
-				if (!HookCall(ptr, &log_original_func, log_func))
-					return false;
+				hooked = HookCall(ptr, &log_patch->log_original_func, log_func);
+			}
+
+			if (!hooked)
+			{
+				// No hook calls log_func, so nothing can be using the copy
+				log_patches.Erase(log_func);
+				delete log_patch;
+				return false;
 			}
 
-			AddLogPatch();
+			log_original_func = log_patch->log_original_func;
 		}
 		else if (type == EPATCH_TYPE_NOTIFY)
 		{
@@ -1661,6 +1746,7 @@ bool EPatchFile::Compile(TiXmlDocument *doc, bool big_endian)
     }
 
     patches.resize(patch_count);
+    prescan_states.clear();
 
     size_t idx = 0;
     for (const TiXmlElement *elem = root->FirstChildElement(); elem; elem = elem->NextSiblingElement())
@@ -1669,6 +1755,8 @@ bool EPatchFile::Compile(TiXmlDocument *doc, bool big_endian)
         {
             EPatch &patch = patches[idx++];
             patch.SetPatcher(patcher_module);
+            patch.SetCache(cache);
+            patch.file = this;
 
             if (!patch.Compile(elem))
             {
@@ -1681,6 +1769,139 @@ bool EPatchFile::Compile(TiXmlDocument *doc, bool big_endian)
     return true;
 }
 
+void EPatchFile::Copy(const EPatchFile &other)
+{
+    patcher_module = other.patcher_module;
+    cache = other.cache;
+    name = other.name;
+    enabled = other.enabled;
+    comment = other.comment;
+    patches = other.patches;
+    prescan_states = other.prescan_states;
+
+    // The copied patches still point to other
+    for (EPatch &patch : patches)
+        patch.file = this;
+}
+
+void EPatchFile::Prescan(const std::string &module)
+{
+    uint8_t *top = (uint8_t *)GetModuleHandleA(CSTR(module));
+    if (!top)
+        return;
+
+    size_t image_size = GetImageSize(CSTR(module));
+    MultiPatternScanner scanner;
+    std::vector<EPatch *> pending;
+    std::vector<std::pair<size_t, size_t>> spans;
+
+    for (EPatch &patch : patches)
+    {
+        std::string setting;
+        size_t begin, end;
+
+        if (patch.module != module || patch.searched || patch.prescanned)
+            continue;
+
+        if (patch.GetEnabled(setting) == 0 || patch.type >= EPATCH_TYPE_MAX || patch.instructions.size() == 0)
+            continue;
+
+        patch.BuildSearchPattern();
+
+        if (!patch.GetSearchWindow(image_size, &begin, &end))
+            continue;
+
+        if (cache)
+        {
+            uint32_t match;
+
+            cache->CheckModule(patch.module, top, image_size);
+
+            for (match = 0; match < patch.num_matches; match++)
+            {
+                if (patch.FindCached(top, begin, end, match, nullptr) == PATTERN_NOT_FOUND)
+                    break;
+            }
+
+            // Apply will take them from the cache, no need to scan for it
+            if (match == patch.num_matches)
+                continue;
+        }
+
+        pending.push_back(&patch);
+        // The bytes the matches can cover
+        spans.push_back(std::make_pair(begin, end + patch.search_pattern.size() - 1));
+    }
+
+    if (pending.size() < EPATCH_PRESCAN_MIN_PENDING)
+        return;
+
+    for (EPatch *patch : pending)
+        scanner.Add(&patch->scanner);
+
+    std::vector<std::vector<size_t>> hits;
+
+    // The windows of the patches overlap a lot, merge them so that each byte is read once
+    std::sort(spans.begin(), spans.end());
+
+    size_t begin = spans[0].first;
+    size_t end = spans[0].second;
+
+    for (size_t i = 1; i <= spans.size(); i++)
+    {
+        if (i < spans.size() && spans[i].first <= end)
+        {
+            if (spans[i].second > end)
+                end = spans[i].second;
+
+            continue;
+        }
+
+        scanner.Scan(top, begin, end, hits);
+
+        if (i < spans.size())
+        {
+            begin = spans[i].first;
+            end = spans[i].second;
+        }
+    }
+
+    hits.resize(pending.size());
+
+    for (size_t i = 0; i < pending.size(); i++)
+        pending[i]->SetPrescanHits(hits[i]);
+}
+
+void EPatchFile::OnSearch(const std::string &module, bool found)
+{
+    PrescanState &state = prescan_states[module];
+
+    if (state.done)
+        return;
+
+    state.searched++;
+
+    if (!found)
+        state.misses++;
+
+    // Most patterns are missing (patches made for another version of the module): every miss reads the whole
+    // search window, while the single pass costs about the same whatever is found.
+    if (state.misses >= EPATCH_PRESCAN_MIN_MISSES && state.misses*4 >= state.searched*3)
+    {
+        // The number of pending patches only goes down, no point in trying again if there are too few now
+        state.done = true;
+        Prescan(module);
+    }
+}
+
+void EPatchFile::SetCache(EPatchCache *cache)
+{
+    this->cache = cache;
+
+    for (EPatch &patch : patches)
+        patch.SetCache(cache);
+}
+
 int EPatchFile::GetEnabled(std::string &setting) const
 {
     if (enabled == "true" || enabled == "1")
@@ -2,12 +2,28 @@
 #define EPATCHFILE_H
 
 #include <windef.h>
+#include <map>
 #include <stdexcept>
 #include <unordered_set>
 
 #include "BaseFile.h"
+#include "PatternScanner.h"
+#include "EPatchCache.h"
+#include "AddressMap.h"
+#include "AsyncLog.h"
 #include "Mutex.h"
 
+// Patches of a module switch from one search per patch to a single pass over all the remaining ones (EPatchFile::Prescan)
+// once this many searches missed, with at least 3/4 of the searches so far missing, and if this many patches are left.
+// Below that, the pass costs more than the searches it saves.
+#define EPATCH_PRESCAN_MIN_MISSES   16
+#define EPATCH_PRESCAN_MIN_PENDING  96
+
+// Most time EPatch::FlushLog waits for the log writer thread
+#define EPATCH_LOG_FLUSH_TIMEOUT    2000
+
+class EPatchFile;
+
 struct EInstruction
 {
     std::string comment;
@@ -76,14 +92,23 @@ class EPatch
 private:
 
     // Global data
-    static std::vector<EPatch> log_patches;
-    static Mutex log_mutex;
+    static AddressMap<EPatch> log_patches; // log_func -> patch, looked up by the hooks without locking
+    static Mutex log_mutex; // Only for the installation of the hooks
+    static Mutex dbghelp_mutex; // The DbgHelp functions behind PrintStackTrace are not thread safe
+    static AsyncLog *log_writer;
 
     // Non serialized data
     std::string patcher_module;
 
     bool rebuild = true;
     std::vector<uint16_t> search_pattern; // instructions combined in a single item
+    PatternScanner scanner; // search_pattern compiled
+    bool searched = false;
+    bool prescanned = false;
+    std::vector<size_t> prescan_hits; // All the matches in the search window, from EPatchFile::Prescan
+    EPatchFile *file = nullptr; // Not owned, told about the searches
+    EPatchCache *cache = nullptr;
+    uint8_t cache_id[EPCH_ID_SIZE]; // Identity of the patch in the cache
 	std::unordered_set<size_t> block_addresses; // For num_matches > 1
 
     // Common
@@ -133,11 +158,14 @@ private:
     size_t size;
 
     //
-    bool IsPattern(size_t address, const std::vector<uint16_t> &pattern);
+    void BuildSearchPattern();
+    bool GetSearchWindow(size_t image_size, size_t *begin, size_t *end) const;
+    void SetPrescanHits(std::vector<size_t> &hits);
+    size_t FindCached(const uint8_t *module_top, size_t begin, size_t end, uint32_t match, const std::unordered_set<size_t> *exclude) const;
     uint8_t *Find();
 
     //
-    void AddLogPatch();
+    EPatch *AddLogPatch();
     static EPatch *FindLogPatch(void *addr);
 
     void LogParam(size_t param, int index, std::string &buf);
@@ -357,6 +385,8 @@ private:
 
 static int ParseHookType(const std::string &type);
 
+    friend class EPatchFile;
+
 public:
 
     EPatch() : type(EPATCH_TYPE_MAX), num_matches(1) { }
@@ -365,6 +395,11 @@ public:
     bool Compile(const TiXmlElement *root);
     bool Apply();
 
+    // The log hooks write through a background thread. The patcher must call this from DLL_PROCESS_DETACH and from its
+    // crash handler, or the last lines are lost. process_exit is for the detach at process exit (lpReserved != nullptr),
+    // when the system has already terminated the writer thread: the lines are then written from the calling thread.
+    static void FlushLog(bool process_exit);
+
     const std::string &GetName() const
     {
         return name;
@@ -372,11 +407,13 @@ public:
 
     int GetEnabled(std::string &setting) const;
     void SetPatcher(const std::string &patcher) { patcher_module = patcher; }
+    void SetCache(EPatchCache *cache) { this->cache = cache; }
 };
 
 class EPatchFile : public BaseFile
 {
     std::string patcher_module;
+    EPatchCache *cache = nullptr;
 
     std::string name;
     std::string enabled;
@@ -384,14 +421,53 @@ class EPatchFile : public BaseFile
 
     std::vector<EPatch> patches;
 
+    struct PrescanState
+    {
+        uint32_t searched = 0;
+        uint32_t misses = 0;
+        bool done = false;
+    };
+
+    std::map<std::string, PrescanState> prescan_states; // Per module
+
+    // Searches the patterns of the patches of module not searched yet in one pass (over the union of their search windows),
+    // instead of one search per patch. Their Apply then picks the nearest match from the stored hits that still match.
+    // A match created by the writes of patches applied after the prescan is only found if none of the hits is left.
+    void Prescan(const std::string &module);
+    // From EPatch::Find, after each search of a pattern in memory
+    void OnSearch(const std::string &module, bool found);
+
+    friend class EPatch;
+
+    void Copy(const EPatchFile &other);
+
 public:
 
     EPatchFile() { }
     EPatchFile(const std::string &patcher) : patcher_module(patcher) { }
+    EPatchFile(const EPatchFile &other) : BaseFile(other)
+    {
+        Copy(other);
+    }
+
     virtual ~EPatchFile() { }
 
+    inline EPatchFile &operator=(const EPatchFile &other)
+    {
+        if (this == &other)
+            return *this;
+
+        BaseFile::operator=(other);
+        Copy(other);
+        return *this;
+    }
+
     virtual bool Compile(TiXmlDocument *doc, bool big_endian) override;
 
+    // Addresses found in previous launches are tried first, and the new ones stored. The cache is not owned,
+    // the caller loads it before applying the patches and saves it after, if IsModified.
+    void SetCache(EPatchCache *cache);
+
     inline EPatch &operator[](size_t n) { return patches[n]; }
     inline const EPatch &operator[](size_t n) const { return patches[n]; }
 
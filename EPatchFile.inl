@@ -110,9 +110,9 @@ uintptr_t CALLING_CONVENTION FUNCTION_NAME(EPatch::Log)(
     TYPE_NAME func;
 	std::string buf;
 
+    // No lock: the patch is found in a lock-free table, and the record goes to the ring of this thread.
+    // Only the stack walk, which goes through DbgHelp, is serialized.
     {
-        MutexLocker lock(&log_mutex);
-
         patch = FindLogPatch((void *)FUNCTION_NAME(EPatch::Log));
         if (!patch)
         {
@@ -127,6 +127,8 @@ uintptr_t CALLING_CONVENTION FUNCTION_NAME(EPatch::Log)(
             if (patch->log_ra)
             {
                 Utils::Sprintf(buf, true, "Return address is %p. Relative: 0x%x\n", BRA(0), REL_ADDR32_2(BRA(0), patch));
+
+                MutexLocker lock(&dbghelp_mutex);
 				PrintStackTrace(8, buf);
             }
 			
@@ -219,8 +221,6 @@ uintptr_t CALLING_CONVENTION FUNCTION_NAME(EPatch::Log)(
 );
 
     {
-        MutexLocker lock(&log_mutex);
-
         if (!patch->log_before)
         {
             Utils::Sprintf(buf, true, "\n%s was called and has returned.\n", patch->function.c_str());
@@ -272,7 +272,10 @@ uintptr_t CALLING_CONVENTION FUNCTION_NAME(EPatch::Log)(
         }
 		
 		patch->LogParam(ret, -1, buf);
-        DPRINTF("%s\n", buf.c_str());
+
+        // Written in batches by a background thread
+        buf += '\n';
+        log_writer->Write(std::move(buf));
     }
 	
     return ret;
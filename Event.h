@@ -1,40 +1,62 @@
 #ifndef __EVENT_H__
 #define __EVENT_H__
 
-#include <windows.h>
-#include "Utils.h"
+#include <mutex>
+#include <condition_variable>
 
+// Same semantics as a Win32 event: an auto-reset event releases a single waiter per Notify and resets itself,
+// a manual-reset one releases every waiter and stays signaled until Reset.
 class Event
 {
 private:
 
-    HANDLE handle;
+    std::mutex mutex;
+    std::condition_variable cond;
+    bool signaled;
+    bool manual_reset;
+
+    Event(const Event &);
+    Event &operator=(const Event &);
 
 public:
 
-    Event(bool manual_reset=false)
+    Event(bool manual_reset=false) : signaled(false), manual_reset(manual_reset)
     {
-        handle = CreateEvent(nullptr, manual_reset, FALSE, nullptr);
     }
 
     ~Event()
     {
-        CloseHandle(handle);
     }
 
     inline void Notify()
     {
-        SetEvent(handle);
+        // Notified with the lock held, a woken waiter may destroy the event as soon as Wait returns
+        std::lock_guard<std::mutex> lock(mutex);
+        signaled = true;
+
+        if (manual_reset)
+            cond.notify_all();
+        else
+            cond.notify_one();
     }
 
     inline bool Wait()
     {
-        return (WaitForSingleObject(handle, INFINITE) == WAIT_OBJECT_0);
+        std::unique_lock<std::mutex> lock(mutex);
+
+        while (!signaled)
+            cond.wait(lock);
+
+        if (!manual_reset)
+            signaled = false;
+
+        return true;
     }
 
     inline void Reset()
     {
-        ResetEvent(handle);
+        std::lock_guard<std::mutex> lock(mutex);
+        signaled = false;
     }
 };
 
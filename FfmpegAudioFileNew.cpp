@@ -407,24 +407,17 @@ bool FfmpegAudioFile::ToFiles(const std::vector<AudioFile *> &files, uint16_t sp
     if (files.size() == 0)
         return true;
 
-    if (max_threads <= 0)
-    {
-        int cores_count = Thread::LogicalCoresCount();
-        max_threads = (files.size() > (size_t)cores_count) ? cores_count : (int)files.size();
-    }
-
-    ThreadPool pool(max_threads);
     bool error = false;
 
     const uint8_t *buf = decoded->GetMemory(false);
 
-    for (uint16_t i = 0; i < (uint16_t)files.size(); i++)
+    // One file per task, at most max_threads at once (0: as many as the shared pool allows)
+    ThreadPool::GetGlobal().ParallelFor(0, (uint16_t)files.size(), 1, [&](size_t i)
     {
-        pool.AddWork(new MultipleAudioEncoder(files[i], i*split_channels >= num_channels ? nullptr : buf, i, format,
-                                         split_channels, sample_rate, GetNumSamples(), num_channels, &error));
-    }
-
-    pool.Wait();
+        MultipleAudioEncoder encoder(files[i], i*split_channels >= num_channels ? nullptr : buf, (int)i, format,
+                                     split_channels, sample_rate, GetNumSamples(), num_channels, &error);
+        encoder.Run();
+    }, max_threads);
 
     // TODO: enable this when loop implemented
     UNUSED(preserve_loop);
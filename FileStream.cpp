@@ -3,16 +3,22 @@
 #include "FileStream.h"
 #include "debug.h"
 
+#define FS_BUFFER_ALIGN 4096
 
 FileStream::FileStream(const std::string &mode) : mode(mode)
 {
     handle = nullptr;
+    buf_mem = buffer = nullptr;
+    buffer_size = 0;
     Reset();
 }
 
 FileStream::~FileStream()
 {
     Reset();
+
+    if (buf_mem)
+        delete[] buf_mem;
 }
 
 bool FileStream::SetRegion(uint64_t start, uint64_t size)
@@ -20,6 +26,9 @@ bool FileStream::SetRegion(uint64_t start, uint64_t size)
     if (start + size > file_capacity)
         return false;
 
+    if (buffer && !Flush())
+        return false;
+
     file_start = start;
     stream_size = stream_capacity = size;
 
@@ -32,11 +41,253 @@ void FileStream::Reset()
 
     if (handle)
     {
+        Flush();
         fclose(handle);
         handle = nullptr;
     }
 
     stream_size = stream_pos = stream_capacity = file_start = file_capacity = 0;
+    buf_start = 0;
+    buf_len = 0;
+    buf_dirty = false;
+    handle_pos = -1;
+    handle_writing = false;
+}
+
+bool FileStream::SetBuffered(size_t size)
+{
+    if (!SyncHandle())
+        return false;
+
+    if (buf_mem)
+    {
+        delete[] buf_mem;
+        buf_mem = buffer = nullptr;
+    }
+
+    buffer_size = 0;
+    buf_len = 0;
+
+    if (size == 0)
+        return true;
+
+    size = (size + FS_BUFFER_ALIGN - 1) & ~(size_t)(FS_BUFFER_ALIGN - 1);
+    buf_mem = new uint8_t[size + FS_BUFFER_ALIGN];
+    buffer = (uint8_t *)(((uintptr_t)buf_mem + FS_BUFFER_ALIGN - 1) & ~(uintptr_t)(FS_BUFFER_ALIGN - 1));
+    buffer_size = size;
+    handle_pos = -1; // Unbuffered operations don't track the handle position
+
+    return true;
+}
+
+bool FileStream::PositionHandle(uint64_t abs_pos, bool write)
+{
+    // Switching between reading and writing requires a seek on the same FILE, even if the position matches
+    if (handle_pos == (int64_t)abs_pos && handle_writing == write)
+        return true;
+
+    if (fseeko64(handle, abs_pos, SEEK_SET) != 0)
+    {
+        handle_pos = -1;
+        return false;
+    }
+
+    handle_pos = (int64_t)abs_pos;
+    handle_writing = write;
+    return true;
+}
+
+bool FileStream::RawRead(uint64_t abs_pos, void *buf, size_t size)
+{
+    if (!PositionHandle(abs_pos, false))
+        return false;
+
+    size_t rd = fread(buf, 1, size, handle);
+    handle_pos += rd;
+
+    return (rd == size);
+}
+
+bool FileStream::RawWrite(uint64_t abs_pos, const void *buf, size_t size)
+{
+    if (!PositionHandle(abs_pos, true))
+        return false;
+
+    size_t wr = fwrite(buf, 1, size, handle);
+    handle_pos += wr;
+
+    return (wr == size);
+}
+
+bool FileStream::FillBuffer()
+{
+    buf_len = 0;
+    buf_start = file_start + stream_pos;
+
+    uint64_t remaining = stream_size - stream_pos;
+    size_t to_read = (remaining < buffer_size) ? (size_t)remaining : buffer_size;
+
+    if (to_read == 0)
+        return false;
+
+    if (!PositionHandle(buf_start, false))
+        return false;
+
+    size_t rd = fread(buffer, 1, to_read, handle);
+    handle_pos += rd;
+    buf_len = rd;
+
+    return (rd != 0);
+}
+
+bool FileStream::Flush()
+{
+    if (!buffer || !buf_dirty)
+        return true;
+
+    buf_dirty = false;
+
+    if (!RawWrite(buf_start, buffer, buf_len))
+    {
+        DPRINTF("%s: write failed.\n", FUNCNAME);
+        buf_len = 0;
+        return false;
+    }
+
+    // The buffer now mirrors the file, keep it as read cache
+    return true;
+}
+
+bool FileStream::SyncHandle()
+{
+    if (!buffer || !handle)
+        return true;
+
+    if (!Flush())
+        return false;
+
+    // The handle is about to be used directly, so its position can't be trusted afterwards
+    bool ret = (fseeko64(handle, file_start+stream_pos, SEEK_SET) == 0);
+    handle_pos = -1;
+    return ret;
+}
+
+bool FileStream::BufferedRead(void *buf, size_t size)
+{
+    if (size == 0)
+        return true;
+
+    if (stream_pos + size > stream_size)
+        return false;
+
+    if (buf_dirty && !Flush())
+        return false;
+
+    uint8_t *out = (uint8_t *)buf;
+    uint64_t abs_pos = file_start + stream_pos;
+    uint64_t save_pos = stream_pos;
+
+    if (buf_len != 0 && abs_pos >= buf_start && abs_pos < buf_start+buf_len)
+    {
+        size_t avail = (size_t)(buf_start + buf_len - abs_pos);
+        size_t n = (size < avail) ? size : avail;
+
+        memcpy(out, buffer + (abs_pos - buf_start), n);
+        out += n;
+        size -= n;
+        stream_pos += n;
+    }
+
+    if (size == 0)
+        return true;
+
+    if (size >= buffer_size)
+    {
+        // Big reads go straight to the destination
+        if (!RawRead(file_start + stream_pos, out, size))
+        {
+            stream_pos = save_pos;
+            return false;
+        }
+
+        stream_pos += size;
+        return true;
+    }
+
+    if (!FillBuffer() || buf_len < size)
+    {
+        stream_pos = save_pos;
+        return false;
+    }
+
+    memcpy(out, buffer, size);
+    stream_pos += size;
+    return true;
+}
+
+bool FileStream::BufferedWrite(const void *buf, size_t size)
+{
+    if (size == 0)
+        return true;
+
+    uint64_t abs_pos = file_start + stream_pos;
+
+    if (!buf_dirty)
+    {
+        // Drop the read cache, it could overlap the data being written
+        buf_len = 0;
+    }
+    else if (abs_pos != buf_start+buf_len || buf_len+size > buffer_size)
+    {
+        if (!Flush())
+            return false;
+
+        buf_len = 0;
+    }
+
+    if (size >= buffer_size)
+    {
+        if (!RawWrite(abs_pos, buf, size))
+            return false;
+    }
+    else
+    {
+        if (buf_len == 0)
+            buf_start = abs_pos;
+
+        memcpy(buffer+buf_len, buf, size);
+        buf_len += size;
+        buf_dirty = true;
+    }
+
+    if (stream_pos+size > stream_size)
+    {
+        stream_size = stream_pos+size;
+        if (stream_capacity < stream_size)
+            stream_capacity = stream_size;
+    }
+
+    stream_pos += size;
+    return true;
+}
+
+const uint8_t *FileStream::Peek(size_t size)
+{
+    if (!handle || !buffer || size > buffer_size || stream_pos+size > stream_size)
+        return nullptr;
+
+    if (buf_dirty && !Flush())
+        return nullptr;
+
+    uint64_t abs_pos = file_start + stream_pos;
+
+    if (buf_len == 0 || abs_pos < buf_start || abs_pos+size > buf_start+buf_len)
+    {
+        if (!FillBuffer() || buf_len < size)
+            return nullptr;
+    }
+
+    return buffer + (abs_pos - buf_start);
 }
 
 bool FileStream::Resize(uint64_t size)
@@ -56,6 +307,9 @@ bool FileStream::Read(void *buf, size_t size)
     if (!handle)
         return false;
 
+    if (buffer)
+        return BufferedRead(buf, size);
+
     off64_t pos = ftello64(handle);
     size_t rd = fread(buf, 1, size, handle);
 
@@ -74,6 +328,9 @@ bool FileStream::Write(const void *buf, size_t size)
     if (!handle)
         return false;
 
+    if (buffer)
+        return BufferedWrite(buf, size);
+
     off64_t pos = ftello64(handle);
     size_t rd = fwrite(buf, 1, size, handle);
 
@@ -94,11 +351,32 @@ bool FileStream::Write(const void *buf, size_t size)
     return true;
 }
 
+bool FileStream::Close()
+{
+    if (!handle)
+        return true;
+
+    bool ret = Flush();
+
+    if (fclose(handle) != 0)
+    {
+        DPRINTF("%s: fclose failed.\n", FUNCNAME);
+        ret = false;
+    }
+
+    handle = nullptr;
+    Reset();
+    return ret;
+}
+
 bool FileStream::Reopen(const std::string &mode)
 {
     if (!handle)
         return false;
 
+    if (!Flush())
+        return false;
+
     fclose(handle);
     handle = nullptr;
     this->mode = mode;
@@ -132,6 +410,13 @@ bool FileStream::Seek(int64_t offset, int whence)
     if (!handle && !new_pos)
         return false;
 
+    if (buffer)
+    {
+        // The handle is positioned lazily on the next read/write
+        stream_pos = new_pos;
+        return true;
+    }
+
     if (fseeko64(handle, new_pos+file_start, SEEK_SET) != 0)
         return false;
 
@@ -183,6 +468,10 @@ bool FileStream::LoadFromFile(const std::string &path, bool show_error)
 
     stream_pos = file_start = 0;
     saved_path = path;
+    buf_len = 0;
+    buf_dirty = false;
+    handle_pos = 0;
+    handle_writing = false;
     return true;
 }
 
@@ -205,6 +494,12 @@ bool FileStream::SaveToFile(const std::string &path, bool show_error, bool build
     uint64_t save_pos = stream_pos;
     Seek(0, SEEK_SET);
 
+    if (!SyncHandle())
+    {
+        fclose(w);
+        return false;
+    }
+
     bool ret = Utils::DoCopyFile(handle, w, stream_size);
     fclose(w);
 
@@ -217,5 +512,6 @@ HANDLE FileStream::GetWindowsHandle()
     if (!handle)
         return nullptr;
 
+    SyncHandle();
     return (HANDLE)_get_osfhandle(_fileno(handle));
 }
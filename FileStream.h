@@ -3,6 +3,8 @@
 
 #include "Stream.h"
 
+#define FS_DEFAULT_BUFFER_SIZE  (256*1024)
+
 class FileStream : public Stream
 {
     FILE *handle;
@@ -17,6 +19,25 @@ class FileStream : public Stream
 
     std::string saved_path;
 
+    // Buffered mode (see SetBuffered). buf_start and handle_pos are absolute file offsets.
+    uint8_t *buf_mem;
+    uint8_t *buffer;
+    size_t buffer_size;
+    uint64_t buf_start;
+    size_t buf_len;
+    bool buf_dirty;
+    int64_t handle_pos;
+    bool handle_writing;
+
+    bool PositionHandle(uint64_t abs_pos, bool write);
+    bool RawRead(uint64_t abs_pos, void *buf, size_t size);
+    bool RawWrite(uint64_t abs_pos, const void *buf, size_t size);
+    bool FillBuffer();
+    bool SyncHandle();
+
+    bool BufferedRead(void *buf, size_t size);
+    bool BufferedWrite(const void *buf, size_t size);
+
 protected:
 
     void Reset();
@@ -28,6 +49,22 @@ public:
 
     bool SetRegion(uint64_t start, uint64_t size);
 
+    // Enables (size != 0) or disables (size == 0) the internal buffer. In buffered mode the stream position
+    // is tracked without syscalls, reads are served from a read-ahead buffer and small contiguous writes are
+    // coalesced and written behind. Can be called at any time, pending writes are flushed.
+    bool SetBuffered(size_t size=FS_DEFAULT_BUFFER_SIZE);
+    inline bool IsBuffered() const { return (buffer != nullptr); }
+
+    // Returns a pointer to the next size bytes without advancing the position, or nullptr if they cannot be
+    // provided (not in buffered mode, size bigger than the buffer or past the end of the stream).
+    // The pointer is only valid until the next operation on the stream.
+    const uint8_t *Peek(size_t size);
+
+    bool Flush();
+    // Flushes and closes the file. Writers must call it and check the result: the destructor can't report
+    // a failure of the last flush.
+    bool Close();
+
     virtual uint64_t GetSize() const override { return stream_size; }
     virtual bool Resize(uint64_t size) override;
 
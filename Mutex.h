@@ -1,38 +1,191 @@
 #ifndef ____MUTEX_H___
 #define ____MUTEX_H___
 
+#include <stdint.h>
+#include <atomic>
+
+#ifdef _WIN32
+
 #include <windows.h>
 #include <winbase.h>
 
+#elif defined(__linux__)
+
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#else
+
+#include <pthread.h>
+#include <mutex>
+
+#endif
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define MUTEX_CPU_RELAX()   _mm_pause()
+#else
+#define MUTEX_CPU_RELAX()
+#endif
+
+// Spins before parking the thread in the kernel. Critical sections in this code are short, so a waiter usually
+// gets the lock before the spin runs out.
+#define MUTEX_SPIN_COUNT    128
+
+// User space lock. Uncontended Lock/Unlock are a single atomic operation, no syscall.
+// Recursive, like the Win32 mutex object this class used to wrap (a thread may Lock again a mutex it already owns).
 class Mutex
 {
 private:
 
-	void *handle;
-	
+    std::atomic<uintptr_t> owner;
+    unsigned int recursion;
+
+#ifdef _WIN32
+
+    SRWLOCK lock;
+
+    inline void RawLock()
+    {
+        for (int i = 0; i < MUTEX_SPIN_COUNT; i++)
+        {
+            if (TryAcquireSRWLockExclusive(&lock))
+                return;
+
+            MUTEX_CPU_RELAX();
+        }
+
+        AcquireSRWLockExclusive(&lock);
+    }
+
+    inline bool RawTryLock() { return (TryAcquireSRWLockExclusive(&lock) != 0); }
+    inline void RawUnlock() { ReleaseSRWLockExclusive(&lock); }
+
+    static inline uintptr_t CurrentThreadId() { return (uintptr_t)GetCurrentThreadId(); }
+
+#elif defined(__linux__)
+
+    // 0: unlocked, 1: locked, 2: locked and there may be threads sleeping on it
+    std::atomic<int> state;
+
+    static_assert(sizeof(std::atomic<int>) == sizeof(int), "std::atomic<int> can't be used as futex word.");
+
+    inline void FutexWait(int val) { syscall(SYS_futex, (int *)&state, FUTEX_WAIT_PRIVATE, val, nullptr, nullptr, 0); }
+    inline void FutexWake() { syscall(SYS_futex, (int *)&state, FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0); }
+
+    inline void RawLock()
+    {
+        int c = 0;
+
+        if (state.compare_exchange_strong(c, 1, std::memory_order_acquire, std::memory_order_relaxed))
+            return;
+
+        for (int i = 0; i < MUTEX_SPIN_COUNT && c != 2; i++)
+        {
+            MUTEX_CPU_RELAX();
+            c = state.load(std::memory_order_relaxed);
+
+            if (c == 0 && state.compare_exchange_weak(c, 1, std::memory_order_acquire, std::memory_order_relaxed))
+                return;
+        }
+
+        // Mark it as contended, whoever unlocks will wake one sleeper
+        c = state.exchange(2, std::memory_order_acquire);
+
+        while (c != 0)
+        {
+            FutexWait(2);
+            c = state.exchange(2, std::memory_order_acquire);
+        }
+    }
+
+    inline bool RawTryLock()
+    {
+        int c = 0;
+        return state.compare_exchange_strong(c, 1, std::memory_order_acquire, std::memory_order_relaxed);
+    }
+
+    inline void RawUnlock()
+    {
+        if (state.exchange(0, std::memory_order_release) == 2)
+            FutexWake();
+    }
+
+    static inline uintptr_t CurrentThreadId() { return (uintptr_t)pthread_self(); }
+
+#else
+
+    std::mutex lock;
+
+    inline void RawLock() { lock.lock(); }
+    inline bool RawTryLock() { return lock.try_lock(); }
+    inline void RawUnlock() { lock.unlock(); }
+
+    static inline uintptr_t CurrentThreadId() { return (uintptr_t)pthread_self(); }
+
+#endif
+
 	Mutex(const Mutex &);
-	Mutex& operator=(const Mutex &);	
+	Mutex& operator=(const Mutex &);
 
 public:
 
-	inline Mutex()
+	inline Mutex() : owner(0), recursion(0)
 	{
-        handle = (void *)CreateMutexA(nullptr, false, nullptr);
+#ifdef _WIN32
+        InitializeSRWLock(&lock);
+#elif defined(__linux__)
+        state.store(0, std::memory_order_relaxed);
+#endif
 	}
-	
+
 	inline ~Mutex()
 	{
-		CloseHandle((HANDLE)handle);
 	}
-	
+
 	inline void Lock()
     {
-        WaitForSingleObject((HANDLE)handle, INFINITE);
+        uintptr_t self = CurrentThreadId();
+
+        // Only this thread could have stored its own id, so a relaxed load is enough
+        if (owner.load(std::memory_order_relaxed) == self)
+        {
+            recursion++;
+            return;
+        }
+
+        RawLock();
+        owner.store(self, std::memory_order_relaxed);
+        recursion = 1;
 	}
-	
+
+    inline bool TryLock()
+    {
+        uintptr_t self = CurrentThreadId();
+
+        if (owner.load(std::memory_order_relaxed) == self)
+        {
+            recursion++;
+            return true;
+        }
+
+        if (!RawTryLock())
+            return false;
+
+        owner.store(self, std::memory_order_relaxed);
+        recursion = 1;
+        return true;
+    }
+
 	inline void Unlock()
 	{
-		ReleaseMutex((HANDLE)handle);
+        if (--recursion != 0)
+            return;
+
+        owner.store(0, std::memory_order_relaxed);
+        RawUnlock();
 	}
 };
 
@@ -41,9 +194,9 @@ class MutexLocker
 private:
 
 	Mutex *mutex;
-	
-	MutexLocker();	
-	MutexLocker(const MutexLocker &);	
+
+	MutexLocker();
+	MutexLocker(const MutexLocker &);
 	MutexLocker& operator=(const MutexLocker &);
 
 public:
@@ -52,7 +205,7 @@ public:
 	{
 		mutex->Lock();
 	}
-	
+
 	inline ~MutexLocker()
 	{
 		mutex->Unlock();
@@ -4,17 +4,28 @@
 DatFile::DatFile()
 {
     this->big_endian = false;
+    lazy = false;
+    mapped = nullptr;
+    mapped_size = 0;
 }
 
 DatFile::~DatFile()
 {
-
+    Reset();
 }
 
 void DatFile::Reset()
 {
     files.clear();
     unk_data.clear();
+
+    if (mapped)
+    {
+        Utils::UnmapFile(mapped, mapped_size);
+        mapped = nullptr;
+        mapped_size = 0;
+        mapped_path.clear();
+    }
 }
 
 bool DatFile::Load(const uint8_t *buf, size_t size)
@@ -43,9 +54,25 @@ bool DatFile::Load(const uint8_t *buf, size_t size)
     {
         DatFileEntry &file = files[i];
 
-        files[i].name = file_names + (file_name_step * i);
-        files[i].content.resize(file_sizes[i]);
-        memcpy(files[i].content.data(), buf + file_offsets[i], files[i].content.size());
+        if ((uint64_t)file_offsets[i] + file_sizes[i] > size)
+        {
+            DPRINTF("%s: File %Id out of bounds.\n", FUNCNAME, i);
+            Reset();
+            return false;
+        }
+
+        file.name = file_names + (file_name_step * i);
+
+        if (lazy)
+        {
+            file.src = buf + file_offsets[i];
+            file.src_size = file_sizes[i];
+        }
+        else
+        {
+            file.content.resize(file_sizes[i]);
+            memcpy(file.content.data(), buf + file_offsets[i], file.content.size());
+        }
 
         //DPRINTF("%s\n", files[i].name.c_str());
     }
@@ -98,20 +125,22 @@ size_t DatFile::CalcFileStructure(size_t *file_offsets_offset, size_t *extension
 
     for (const DatFileEntry &file : files)
     {
-        size += Utils::Align2(file.content.size(), 0x10);
+        size += Utils::Align2(file.GetSize(), 0x10);
     }
 
     return size;
 }
 
-uint8_t *DatFile::Save(size_t *psize)
+uint8_t *DatFile::BuildHeader(size_t *psize, size_t *ptotal_size) const
 {
     size_t files_offsets_offset, extensions_offset, names_offset, sizes_offset, unk_data_offset, content_offset;
     uint32_t names_step;
 
-    *psize = CalcFileStructure(&files_offsets_offset, &extensions_offset, &names_step, &names_offset, &sizes_offset, &unk_data_offset, &content_offset);
-    uint8_t *buf = new uint8_t[*psize];
-    memset(buf, 0, *psize);
+    *ptotal_size = CalcFileStructure(&files_offsets_offset, &extensions_offset, &names_step, &names_offset, &sizes_offset, &unk_data_offset, &content_offset);
+    *psize = content_offset;
+
+    uint8_t *buf = new uint8_t[content_offset];
+    memset(buf, 0, content_offset);
 
     NADatHeader *hdr = (NADatHeader *)buf;
     hdr->signature = NA_DAT_SIGNATURE;
@@ -127,7 +156,7 @@ uint8_t *DatFile::Save(size_t *psize)
     char *names = (char *)(buf + names_offset);
     uint32_t *sizes = (uint32_t *)(buf + sizes_offset);
     uint8_t *file_unk_data = buf + unk_data_offset;
-    uint8_t *data = buf + content_offset;
+    size_t data_offset = content_offset;
 
     *(uint32_t *)names = names_step;
     names += sizeof(uint32_t);
@@ -143,21 +172,128 @@ uint8_t *DatFile::Save(size_t *psize)
             return nullptr;
         }
 
-        files_offset[i] = Utils::DifPointer(data, buf);
-        sizes[i] = (uint32_t)file.content.size();
+        files_offset[i] = (uint32_t)data_offset;
+        sizes[i] = (uint32_t)file.GetSize();
 
         std::string extension = file.name.substr(file.name.length()-3, 3);
         strcpy(extensions + 4*i, extension.c_str());
         strcpy(names + names_step*i, file.name.c_str());
 
-        memcpy(data, file.content.data(), file.content.size());
-        data += Utils::Align2(file.content.size(), 0x10);
+        data_offset += Utils::Align2(file.GetSize(), 0x10);
     }
 
     memcpy(file_unk_data, unk_data.data(), unk_data.size());
     return buf;
 }
 
+uint8_t *DatFile::Save(size_t *psize)
+{
+    size_t header_size;
+
+    uint8_t *header = BuildHeader(&header_size, psize);
+    if (!header)
+        return nullptr;
+
+    uint8_t *buf = new uint8_t[*psize];
+    memset(buf+header_size, 0, *psize-header_size);
+    memcpy(buf, header, header_size);
+    delete[] header;
+
+    uint8_t *data = buf + header_size;
+
+    for (const DatFileEntry &file : files)
+    {
+        memcpy(data, file.GetData(), file.GetSize());
+        data += Utils::Align2(file.GetSize(), 0x10);
+    }
+
+    return buf;
+}
+
+void DatFile::Materialize()
+{
+    if (!mapped)
+        return;
+
+    for (DatFileEntry &file : files)
+    {
+        file.Materialize();
+    }
+
+    Utils::UnmapFile(mapped, mapped_size);
+    mapped = nullptr;
+    mapped_size = 0;
+    mapped_path.clear();
+}
+
+bool DatFile::LoadFromFile(const std::string &path, bool show_error)
+{
+    if (!lazy)
+        return BaseFile::LoadFromFile(path, show_error);
+
+    size_t size;
+    uint8_t *buf = Utils::MapFile(path, &size, show_error);
+    if (!buf)
+        return false;
+
+    // Load resets the previous mapping (if any), so the new one can only be recorded after it
+    if (!Load(buf, size))
+    {
+        Utils::UnmapFile(buf, size);
+        return false;
+    }
+
+    mapped = buf;
+    mapped_size = size;
+    mapped_path = path;
+    return true;
+}
+
+bool DatFile::SaveToFile(const std::string &path, bool show_error, bool build_path)
+{
+    // Cannot stream from a mapping into the same file
+    if (mapped && Utils::ToLowerCase(Utils::NormalizePath(path)) == Utils::ToLowerCase(Utils::NormalizePath(mapped_path)))
+        Materialize();
+
+    size_t header_size, total_size;
+    uint8_t *header = BuildHeader(&header_size, &total_size);
+    if (!header)
+        return false;
+
+    FILE *f = (build_path) ? Utils::fopen_create_path(path, "wb") : fopen(path.c_str(), "wb");
+    if (!f)
+    {
+        if (show_error)
+            DPRINTF("Cannot open/create file \"%s\"\n", path.c_str());
+
+        delete[] header;
+        return false;
+    }
+
+    static const uint8_t padding[0x10] = { 0 };
+    bool ret = (fwrite(header, 1, header_size, f) == header_size);
+    delete[] header;
+
+    for (size_t i = 0; ret && i < files.size(); i++)
+    {
+        const DatFileEntry &file = files[i];
+        size_t size = file.GetSize();
+        size_t pad_size = Utils::Align2(size, 0x10) - size;
+
+        if (fwrite(file.GetData(), 1, size, f) != size)
+            ret = false;
+        else if (pad_size > 0 && fwrite(padding, 1, pad_size, f) != pad_size)
+            ret = false;
+    }
+
+    fclose(f);
+
+    if (!ret && show_error)
+        DPRINTF("Write failure on file \"%s\"\n", path.c_str());
+
+    return ret;
+}
+
 DatFileEntry *DatFile::FindFile(const std::string &name)
 {
     for (DatFileEntry &file : files)
@@ -28,10 +28,56 @@ CHECK_STRUCT_SIZE(NADatHeader, 0x20);
 #pragma pack(pop)
 #endif
 
-struct DatFileEntry
+class DatFileEntry
 {
+private:
+
+    friend class DatFile;
+
     std::vector<uint8_t> content;
+
+    // In lazy mode, content is left empty and the data is a view into the dat source buffer.
+    const uint8_t *src = nullptr;
+    size_t src_size = 0;
+
+    inline void Materialize()
+    {
+        if (src)
+        {
+            content.assign(src, src+src_size);
+            src = nullptr;
+            src_size = 0;
+        }
+    }
+
+public:
+
     std::string name;
+
+    inline bool IsLazy() const { return (src != nullptr); }
+    inline const uint8_t *GetData() const { return (src) ? src : content.data(); }
+    inline size_t GetSize() const { return (src) ? src_size : content.size(); }
+
+    // For modification. A lazy entry gets its own copy of the data first, so changes are seen by Save.
+    inline std::vector<uint8_t> &GetContent()
+    {
+        Materialize();
+        return content;
+    }
+
+    inline void SetContent(const uint8_t *buf, size_t size)
+    {
+        content.assign(buf, buf+size);
+        src = nullptr;
+        src_size = 0;
+    }
+
+    inline void SetContent(std::vector<uint8_t> &&buf)
+    {
+        content = std::move(buf);
+        src = nullptr;
+        src_size = 0;
+    }
 };
 
 class DatFile : public BaseFile
@@ -41,8 +87,20 @@ private:
     std::vector<DatFileEntry> files;
     std::vector<uint8_t> unk_data;
 
+    bool lazy;
+    uint8_t *mapped;
+    size_t mapped_size;
+    std::string mapped_path;
+
     size_t CalcFileStructure(size_t *file_offsets_offset, size_t *extensions_offset, uint32_t *names_step, size_t *names_offset, size_t *sizes_offset, size_t *unk_data_offset, size_t *content_offset) const;
 
+    uint8_t *BuildHeader(size_t *psize, size_t *ptotal_size) const;
+    void Materialize();
+
+    // Would unmap the same view twice
+    DatFile(const DatFile &);
+    DatFile &operator=(const DatFile &);
+
 protected:
 
     void Reset();
@@ -51,9 +109,17 @@ public:
     DatFile();
     virtual ~DatFile();
 
+    // Lazy mode: Load doesn't copy the entries, they point into the buffer passed to Load (which must
+    // outlive this object or the next Load), and LoadFromFile maps the file instead of reading it.
+    inline void SetLazy(bool lazy) { this->lazy = lazy; }
+    inline bool IsLazy() const { return lazy; }
+
     virtual bool Load(const uint8_t *buf, size_t size) override;
     virtual uint8_t *Save(size_t *psize) override;
 
+    virtual bool LoadFromFile(const std::string &path, bool show_error=true) override;
+    virtual bool SaveToFile(const std::string &path, bool show_error=true, bool build_path=false) override;
+
     inline size_t GetNumFiles() const { return files.size(); }
 
     DatFileEntry *FindFile(const std::string &name);
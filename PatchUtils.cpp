@@ -61,6 +61,17 @@ ptrdiff_t PatchUtils::RelAddress(void *ptr, const char *mod)
 	return (uint8_t *)ptr - mod_top;
 }
 
+size_t PatchUtils::GetImageSize(const char *mod)
+{
+    uint8_t *mod_top = (uint8_t *)GetModuleHandleA(mod);
+	if (!mod_top)
+		return 0;
+
+    IMAGE_DOS_HEADER *dos_hdr = (IMAGE_DOS_HEADER *)mod_top;
+    IMAGE_NT_HEADERS *nt_hdr = (IMAGE_NT_HEADERS *)(mod_top + dos_hdr->e_lfanew);
+    return nt_hdr->OptionalHeader.SizeOfImage;
+}
+
 uint8_t PatchUtils::Read8(size_t rel_address, const char *mod)
 {
     uint8_t *mod_top = (uint8_t *)GetModuleHandleA(mod);
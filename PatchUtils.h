@@ -14,6 +14,8 @@ namespace PatchUtils
 	
 	void *GetPtr(size_t rel_address, const char *mod=nullptr);
 	ptrdiff_t RelAddress(void *ptr, const char *mod=nullptr);
+	// SizeOfImage of the module, 0 if it isn't loaded
+	size_t GetImageSize(const char *mod=nullptr);
 	
 	static inline uint8_t Read8(void *address, size_t ofs=0) { return *(((uint8_t *)address)+ofs); }
 	uint8_t Read8(size_t rel_address, const char *mod=nullptr);
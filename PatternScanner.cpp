@@ -0,0 +1,586 @@
+#include <string.h>
+#include <algorithm>
+
+#include "PatternScanner.h"
+#include "CpuFeatures.h"
+
+#if defined(_M_X64) || defined(__x86_64__)
+#include <immintrin.h>
+#define SCANNER_SIMD
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#define TARGET_AVX2
+#else
+#define TARGET_AVX2     __attribute__((target("avx2")))
+#endif
+
+#endif
+
+// How common each byte value is in x86/x64 code (higher is more common, 0 for the rare ones).
+// Rough order taken from the game executables, it only needs to tell apart the opcodes, prefixes and
+// modrm/displacement bytes that are everywhere from the rest.
+static const uint8_t byte_commonness[256] =
+{
+    95, 83, 60, 59, 61, 58, 57, 56, 72, 0, 0, 1, 55, 22, 0, 88,
+    73, 11, 0, 0, 27, 21, 0, 0, 66, 0, 0, 0, 26, 0, 0, 0,
+    71, 0, 0, 0, 89, 0, 0, 0, 70, 0, 0, 0, 25, 0, 0, 0,
+    69, 0, 0, 65, 24, 0, 0, 0, 68, 19, 0, 20, 23, 0, 0, 0,
+    67, 79, 28, 30, 87, 80, 29, 31, 93, 78, 0, 2, 86, 77, 0, 0,
+    53, 0, 0, 9, 52, 8, 7, 10, 51, 0, 0, 6, 54, 5, 4, 3,
+    50, 0, 0, 18, 0, 0, 34, 0, 49, 0, 0, 0, 0, 0, 0, 0,
+    48, 0, 0, 0, 75, 74, 0, 0, 47, 0, 0, 0, 15, 0, 0, 0,
+    46, 16, 0, 85, 62, 84, 0, 0, 45, 91, 33, 92, 0, 82, 0, 0,
+    63, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 32, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    81, 43, 42, 64, 0, 0, 17, 44, 14, 0, 0, 0, 90, 0, 0, 0,
+    13, 0, 41, 0, 0, 0, 0, 0, 40, 0, 0, 0, 0, 0, 0, 0,
+    39, 0, 0, 0, 0, 0, 0, 0, 76, 38, 0, 37, 0, 0, 0, 0,
+    36, 0, 0, 0, 0, 0, 12, 0, 35, 0, 0, 0, 0, 0, 0, 94,
+};
+
+bool PatternScanner::Compile(const uint16_t *pattern, size_t length)
+{
+    values.resize(length);
+    masks.resize(length);
+    anchor1 = anchor2 = 0;
+    num_fixed = 0;
+
+    if (length == 0)
+        return false;
+
+    for (size_t i = 0; i < length; i++)
+    {
+        if (pattern[i] >= 0x100)
+        {
+            values[i] = 0;
+            masks[i] = 0;
+        }
+        else
+        {
+            values[i] = (uint8_t)pattern[i];
+            masks[i] = 0xFF;
+            num_fixed++;
+        }
+    }
+
+    if (num_fixed == 0)
+        return true;
+
+    // The rarest fixed byte, and then the rarest other one, the farthest from the first one in case of tie
+    bool found = false;
+
+    for (size_t i = 0; i < length; i++)
+    {
+        if (masks[i] && (!found || byte_commonness[values[i]] < byte_commonness[values[anchor1]]))
+        {
+            anchor1 = i;
+            found = true;
+        }
+    }
+
+    anchor2 = anchor1;
+    found = false;
+
+    for (size_t i = 0; i < length; i++)
+    {
+        if (!masks[i] || i == anchor1)
+            continue;
+
+        if (!found || byte_commonness[values[i]] < byte_commonness[values[anchor2]])
+        {
+            anchor2 = i;
+            found = true;
+        }
+        else if (byte_commonness[values[i]] == byte_commonness[values[anchor2]])
+        {
+            size_t dist = (i > anchor1) ? i-anchor1 : anchor1-i;
+            size_t best_dist = (anchor2 > anchor1) ? anchor2-anchor1 : anchor1-anchor2;
+
+            if (dist > best_dist)
+                anchor2 = i;
+        }
+    }
+
+    return true;
+}
+
+bool PatternScanner::Match(const uint8_t *ptr) const
+{
+    const size_t length = values.size();
+    size_t i = 0;
+
+#ifdef SCANNER_SIMD
+    for (; i + 16 <= length; i += 16)
+    {
+        __m128i data = _mm_loadu_si128((const __m128i *)(ptr+i));
+        __m128i diff = _mm_xor_si128(data, _mm_loadu_si128((const __m128i *)(values.data()+i)));
+
+        diff = _mm_and_si128(diff, _mm_loadu_si128((const __m128i *)(masks.data()+i)));
+
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(diff, _mm_setzero_si128())) != 0xFFFF)
+            return false;
+    }
+#endif
+
+    for (; i < length; i++)
+    {
+        if ((ptr[i] ^ values[i]) & masks[i])
+            return false;
+    }
+
+    return true;
+}
+
+#ifdef SCANNER_SIMD
+
+static inline unsigned int ctz32(uint32_t v)
+{
+#ifdef _MSC_VER
+    unsigned long idx;
+    _BitScanForward(&idx, v);
+    return (unsigned int)idx;
+#else
+    return (unsigned int)__builtin_ctz(v);
+#endif
+}
+
+// Both return the position where they stopped, the caller does the rest
+TARGET_AVX2 static size_t scan_avx2(const PatternScanner *ps, const uint8_t *buf, size_t pos, size_t end, size_t a1, size_t a2, std::vector<size_t> &matches)
+{
+    const __m256i v1 = _mm256_set1_epi8((char)ps->GetValue(a1));
+    const __m256i v2 = _mm256_set1_epi8((char)ps->GetValue(a2));
+
+    for (; pos + 32 <= end; pos += 32)
+    {
+        __m256i c1 = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(buf+pos+a1)), v1);
+        __m256i c2 = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(buf+pos+a2)), v2);
+        uint32_t mask = (uint32_t)_mm256_movemask_epi8(_mm256_and_si256(c1, c2));
+
+        while (mask)
+        {
+            size_t p = pos + ctz32(mask);
+
+            if (ps->Match(buf+p))
+                matches.push_back(p);
+
+            mask &= mask-1;
+        }
+    }
+
+    return pos;
+}
+
+static size_t scan_sse2(const PatternScanner *ps, const uint8_t *buf, size_t pos, size_t end, size_t a1, size_t a2, std::vector<size_t> &matches)
+{
+    const __m128i v1 = _mm_set1_epi8((char)ps->GetValue(a1));
+    const __m128i v2 = _mm_set1_epi8((char)ps->GetValue(a2));
+
+    for (; pos + 16 <= end; pos += 16)
+    {
+        __m128i c1 = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(buf+pos+a1)), v1);
+        __m128i c2 = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(buf+pos+a2)), v2);
+        uint32_t mask = (uint32_t)_mm_movemask_epi8(_mm_and_si128(c1, c2));
+
+        while (mask)
+        {
+            size_t p = pos + ctz32(mask);
+
+            if (ps->Match(buf+p))
+                matches.push_back(p);
+
+            mask &= mask-1;
+        }
+    }
+
+    return pos;
+}
+
+#endif // SCANNER_SIMD
+
+void PatternScanner::ScanRange(const uint8_t *buf, size_t begin, size_t end, std::vector<size_t> &matches) const
+{
+    if (begin >= end || values.empty())
+        return;
+
+    if (num_fixed == 0)
+    {
+        for (size_t pos = begin; pos < end; pos++)
+            matches.push_back(pos);
+
+        return;
+    }
+
+    size_t pos = begin;
+
+#ifdef SCANNER_SIMD
+    static const bool has_avx2 = Utils::CpuHasAvx2();
+
+    // The loads read up to 31 bytes after the candidate position plus the anchor, which stays
+    // before end+length-1 as long as the whole block starts before end
+    if (has_avx2)
+        pos = scan_avx2(this, buf, pos, end, anchor1, anchor2, matches);
+
+    pos = scan_sse2(this, buf, pos, end, anchor1, anchor2, matches);
+#endif
+
+    const uint8_t v1 = values[anchor1];
+    const uint8_t v2 = values[anchor2];
+
+    for (; pos < end; pos++)
+    {
+        if (buf[pos+anchor1] == v1 && buf[pos+anchor2] == v2 && Match(buf+pos))
+            matches.push_back(pos);
+    }
+}
+
+void PatternScanner::FindAll(const uint8_t *buf, size_t begin, size_t end, std::vector<size_t> &matches) const
+{
+    matches.clear();
+    ScanRange(buf, begin, end, matches);
+}
+
+size_t PatternScanner::FindFirst(const uint8_t *buf, size_t begin, size_t end) const
+{
+    std::vector<size_t> matches;
+
+    for (size_t pos = begin; pos < end; pos += PATTERN_SCAN_CHUNK)
+    {
+        size_t chunk_end = (end - pos > PATTERN_SCAN_CHUNK) ? pos + PATTERN_SCAN_CHUNK : end;
+
+        ScanRange(buf, pos, chunk_end, matches);
+
+        if (!matches.empty())
+            return matches.front();
+    }
+
+    return PATTERN_NOT_FOUND;
+}
+
+size_t PatternScanner::FindNearest(const uint8_t *buf, size_t begin, size_t end, size_t origin, const std::unordered_set<size_t> *exclude) const
+{
+    if (begin >= end || values.empty())
+        return PATTERN_NOT_FOUND;
+
+    // Down side [begin, down_cur) walked towards begin, up side [up_cur, end) walked towards end.
+    // When origin is inside the span both sides start at origin+1, so the chunks of the same ring cover the same
+    // distances in both directions, and a match in a ring is always nearer than any match in the next rings.
+    size_t down_cur = (origin < begin) ? begin : ((origin >= end) ? end : origin+1);
+    size_t up_cur = (origin >= end) ? end : ((origin < begin) ? begin : origin+1);
+    std::vector<size_t> matches;
+
+    while (down_cur > begin || up_cur < end)
+    {
+        size_t down = PATTERN_NOT_FOUND;
+        size_t up = PATTERN_NOT_FOUND;
+
+        if (down_cur > begin)
+        {
+            size_t chunk_begin = (down_cur - begin > PATTERN_SCAN_CHUNK) ? down_cur - PATTERN_SCAN_CHUNK : begin;
+
+            matches.clear();
+            ScanRange(buf, chunk_begin, down_cur, matches);
+
+            for (size_t i = matches.size(); i > 0; i--)
+            {
+                if (!exclude || exclude->find(matches[i-1]) == exclude->end())
+                {
+                    down = matches[i-1];
+                    break;
+                }
+            }
+
+            down_cur = chunk_begin;
+        }
+
+        if (up_cur < end)
+        {
+            size_t chunk_end = (end - up_cur > PATTERN_SCAN_CHUNK) ? up_cur + PATTERN_SCAN_CHUNK : end;
+
+            matches.clear();
+            ScanRange(buf, up_cur, chunk_end, matches);
+
+            for (size_t match : matches)
+            {
+                if (!exclude || exclude->find(match) == exclude->end())
+                {
+                    up = match;
+                    break;
+                }
+            }
+
+            up_cur = chunk_end;
+        }
+
+        if (down != PATTERN_NOT_FOUND && up != PATTERN_NOT_FOUND)
+        {
+            // Same distance: the down side goes first
+            return (origin - down <= up - origin - 1) ? down : up;
+        }
+
+        if (down != PATTERN_NOT_FOUND)
+            return down;
+
+        if (up != PATTERN_NOT_FOUND)
+            return up;
+    }
+
+    return PATTERN_NOT_FOUND;
+}
+
+size_t PatternScanner::FindNearest(const std::vector<size_t> &hits, size_t begin, size_t end, size_t origin, const std::unordered_set<size_t> *exclude)
+{
+    if (begin >= end)
+        return PATTERN_NOT_FOUND;
+
+    size_t down = PATTERN_NOT_FOUND;
+    size_t up = PATTERN_NOT_FOUND;
+
+    // Down side: hits in [begin, min(origin+1, end)), the highest first
+    size_t down_end = (origin >= end) ? end : origin+1;
+    std::vector<size_t>::const_iterator it = std::lower_bound(hits.begin(), hits.end(), down_end);
+
+    while (it != hits.begin())
+    {
+        --it;
+
+        if (*it < begin)
+            break;
+
+        if (!exclude || exclude->find(*it) == exclude->end())
+        {
+            down = *it;
+            break;
+        }
+    }
+
+    // Up side: hits in [max(origin+1, begin), end), the lowest first
+    size_t up_begin = (origin < begin) ? begin : origin+1;
+
+    for (it = std::lower_bound(hits.begin(), hits.end(), up_begin); it != hits.end() && *it < end; ++it)
+    {
+        if (!exclude || exclude->find(*it) == exclude->end())
+        {
+            up = *it;
+            break;
+        }
+    }
+
+    if (down != PATTERN_NOT_FOUND && up != PATTERN_NOT_FOUND)
+        return (origin - down <= up - origin - 1) ? down : up;
+
+    return (down != PATTERN_NOT_FOUND) ? down : up;
+}
+
+#ifdef SCANNER_SIMD
+
+TARGET_AVX2 static inline __m256i byte_in_set_avx2(__m256i x, const uint8_t *set)
+{
+    const __m256i low_nibble = _mm256_set1_epi8(0x0F);
+    const __m256i bit_pos = _mm256_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128,
+                                             1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128);
+
+    __m256i lo = _mm256_and_si256(x, low_nibble);
+    __m256i hi = _mm256_and_si256(_mm256_srli_epi16(x, 4), low_nibble);
+    __m256i rows0 = _mm256_shuffle_epi8(_mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)set)), lo);
+    __m256i rows1 = _mm256_shuffle_epi8(_mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)(set+16))), lo);
+    __m256i row = _mm256_blendv_epi8(rows0, rows1, _mm256_cmpgt_epi8(hi, _mm256_set1_epi8(7)));
+    __m256i bit = _mm256_shuffle_epi8(bit_pos, hi);
+
+    return _mm256_cmpeq_epi8(_mm256_and_si256(row, bit), bit);
+}
+
+// Bit i set if buf[i] can be the first byte of a pair and buf[i+1] the second one. Reads buf[0-32].
+TARGET_AVX2 static uint32_t pair_candidates_avx2(const uint8_t *buf, const uint8_t (*sets)[32])
+{
+    __m256i first = byte_in_set_avx2(_mm256_loadu_si256((const __m256i *)buf), sets[0]);
+    __m256i second = byte_in_set_avx2(_mm256_loadu_si256((const __m256i *)(buf+1)), sets[1]);
+
+    return (uint32_t)_mm256_movemask_epi8(_mm256_and_si256(first, second));
+}
+
+#endif
+
+size_t MultiPatternScanner::Add(const PatternScanner *pattern)
+{
+    patterns.push_back(pattern);
+    built = false;
+
+    return patterns.size()-1;
+}
+
+void MultiPatternScanner::Clear()
+{
+    patterns.clear();
+    built = false;
+}
+
+void MultiPatternScanner::Build()
+{
+    pair_entries.clear();
+    single_entries.clear();
+    no_fixed.clear();
+    pair_filter.assign(65536 / 64, 0);
+    memset(single_filter, 0, sizeof(single_filter));
+
+    for (size_t i = 0; i < patterns.size(); i++)
+    {
+        const PatternScanner *ps = patterns[i];
+        const size_t length = ps->GetLength();
+
+        if (length == 0)
+            continue;
+
+        if (ps->GetNumFixed() == 0)
+        {
+            no_fixed.push_back((uint32_t)i);
+            continue;
+        }
+
+        Entry entry;
+        int best = -1;
+
+        entry.pattern = (uint32_t)i;
+        entry.anchor = 0;
+
+        for (size_t j = 0; j+1 < length; j++)
+        {
+            if (ps->IsWildcard(j) || ps->IsWildcard(j+1))
+                continue;
+
+            // The more common byte of the pair first: keeping the common bytes out of both bytes sets is what makes the prefilter work
+            int c1 = byte_commonness[ps->GetValue(j)];
+            int c2 = byte_commonness[ps->GetValue(j+1)];
+            int score = (std::max(c1, c2) << 8) + c1 + c2;
+
+            if (best < 0 || score < best)
+            {
+                best = score;
+                entry.anchor = j;
+            }
+        }
+
+        if (best >= 0)
+        {
+            entry.key = ps->GetValue(entry.anchor) | (ps->GetValue(entry.anchor+1) << 8);
+            pair_entries.push_back(entry);
+            pair_filter[entry.key >> 6] |= (1ULL << (entry.key & 63));
+        }
+        else
+        {
+            entry.anchor = ps->GetAnchor();
+            entry.key = ps->GetValue(entry.anchor);
+            single_entries.push_back(entry);
+            single_filter[entry.key >> 6] |= (1ULL << (entry.key & 63));
+        }
+    }
+
+    // Bytes with high nibble h and low nibble l are in the set if bit (h & 7) of pair_sets[x][l + ((h & 8) ? 16 : 0)] is set
+    memset(pair_sets, 0, sizeof(pair_sets));
+
+    for (const Entry &entry : pair_entries)
+    {
+        for (int i = 0; i < 2; i++)
+        {
+            uint8_t b = (uint8_t)(entry.key >> (i*8));
+            pair_sets[i][(b & 0xF) + ((b & 0x80) ? 16 : 0)] |= (uint8_t)(1 << ((b >> 4) & 7));
+        }
+    }
+
+    // Stable, so that the patterns sharing a key are verified in the order they were added
+    std::stable_sort(pair_entries.begin(), pair_entries.end());
+    std::stable_sort(single_entries.begin(), single_entries.end());
+    built = true;
+}
+
+void MultiPatternScanner::CheckEntries(const std::vector<Entry> &entries, uint32_t key, const uint8_t *buf, size_t q, size_t begin, size_t end, std::vector<std::vector<size_t>> &hits) const
+{
+    Entry search;
+    search.key = key;
+
+    for (std::vector<Entry>::const_iterator it = std::lower_bound(entries.begin(), entries.end(), search); it != entries.end() && it->key == key; ++it)
+    {
+        if (q - begin < it->anchor)
+            continue;
+
+        size_t p = q - it->anchor;
+        const PatternScanner *ps = patterns[it->pattern];
+
+        if (end - p < ps->GetLength())
+            continue;
+
+        if (ps->Match(buf+p))
+            hits[it->pattern].push_back(p);
+    }
+}
+
+void MultiPatternScanner::Scan(const uint8_t *buf, size_t begin, size_t end, std::vector<std::vector<size_t>> &hits)
+{
+    if (!built)
+        Build();
+
+    hits.resize(patterns.size());
+
+    if (begin >= end)
+        return;
+
+    for (uint32_t idx : no_fixed)
+    {
+        size_t length = patterns[idx]->GetLength();
+
+        for (size_t p = begin; end - p >= length; p++)
+            hits[idx].push_back(p);
+    }
+
+    const uint64_t *filter = pair_filter.data();
+
+    // Nearly every real pattern has two adjacent fixed bytes, the second loop is only there for the odd ones
+    if (!pair_entries.empty())
+    {
+        const size_t last = end-1;
+        size_t q = begin;
+
+#ifdef SCANNER_SIMD
+        static const bool has_avx2 = Utils::CpuHasAvx2();
+
+        if (has_avx2)
+        {
+            for (; q + 32 < end; q += 32)
+            {
+                uint32_t mask = pair_candidates_avx2(buf+q, pair_sets);
+
+                while (mask)
+                {
+                    size_t c = q + ctz32(mask);
+                    uint32_t key = buf[c] | (buf[c+1] << 8);
+
+                    if (filter[key >> 6] & (1ULL << (key & 63)))
+                        CheckEntries(pair_entries, key, buf, c, begin, end, hits);
+
+                    mask &= mask-1;
+                }
+            }
+        }
+#endif
+
+        for (; q < last; q++)
+        {
+            uint32_t key = buf[q] | (buf[q+1] << 8);
+
+            if (filter[key >> 6] & (1ULL << (key & 63)))
+                CheckEntries(pair_entries, key, buf, q, begin, end, hits);
+        }
+    }
+
+    if (!single_entries.empty())
+    {
+        for (size_t q = begin; q < end; q++)
+        {
+            uint32_t key = buf[q];
+
+            if (single_filter[key >> 6] & (1ULL << (key & 63)))
+                CheckEntries(single_entries, key, buf, q, begin, end, hits);
+        }
+    }
+}
@@ -0,0 +1,107 @@
+#ifndef __PATTERNSCANNER_H__
+#define __PATTERNSCANNER_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include <unordered_set>
+
+#define PATTERN_NOT_FOUND       ((size_t)-1)
+// Size of the rings of FindNearest, in each direction
+#define PATTERN_SCAN_CHUNK      (64*1024)
+
+// Byte pattern with wildcards, as used by the patch files (values >= 0x100 match any byte).
+// Candidates are located by comparing two of the fixed bytes (the rarest ones in x86 code) 16 or 32 positions at a time,
+// and only those are verified against the whole pattern. Works on any memory span, offsets are relative to the buffer given.
+// For all the Find functions, the bytes from begin up to end+GetLength()-1 must be readable.
+class PatternScanner
+{
+private:
+
+    std::vector<uint8_t> values;
+    std::vector<uint8_t> masks; // 0xFF fixed byte, 0 wildcard
+
+    size_t anchor1, anchor2; // Positions of the two fixed bytes used for the candidates (can be the same)
+    size_t num_fixed;
+
+    void ScanRange(const uint8_t *buf, size_t begin, size_t end, std::vector<size_t> &matches) const;
+
+public:
+
+    PatternScanner() : anchor1(0), anchor2(0), num_fixed(0) { }
+    PatternScanner(const uint16_t *pattern, size_t length) { Compile(pattern, length); }
+    PatternScanner(const std::vector<uint16_t> &pattern) { Compile(pattern); }
+
+    // False if the pattern is empty
+    bool Compile(const uint16_t *pattern, size_t length);
+    inline bool Compile(const std::vector<uint16_t> &pattern) { return Compile(pattern.data(), pattern.size()); }
+
+    inline size_t GetLength() const { return values.size(); }
+    inline size_t GetNumFixed() const { return num_fixed; }
+    inline size_t GetAnchor() const { return anchor1; }
+    inline uint8_t GetValue(size_t i) const { return values[i]; }
+    inline bool IsWildcard(size_t i) const { return masks[i] == 0; }
+
+    // ptr must have GetLength() readable bytes
+    bool Match(const uint8_t *ptr) const;
+
+    // All the matches starting in [begin, end), in increasing order
+    void FindAll(const uint8_t *buf, size_t begin, size_t end, std::vector<size_t> &matches) const;
+    // First match starting in [begin, end), or PATTERN_NOT_FOUND
+    size_t FindFirst(const uint8_t *buf, size_t begin, size_t end) const;
+
+    // Match in [begin, end) nearest to origin, in the order origin, origin+1, origin-1, origin+2, origin-2...
+    // (the order in which EPatch always searched). Matches in exclude are skipped.
+    // The span is scanned outwards in rings of PATTERN_SCAN_CHUNK, so it stops reading soon after the match.
+    size_t FindNearest(const uint8_t *buf, size_t begin, size_t end, size_t origin, const std::unordered_set<size_t> *exclude=nullptr) const;
+
+    // Same choice, made from the sorted positions of a previous scan (MultiPatternScanner::Scan) instead of reading memory
+    static size_t FindNearest(const std::vector<size_t> &hits, size_t begin, size_t end, size_t origin, const std::unordered_set<size_t> *exclude=nullptr);
+};
+
+// Many patterns searched in a single pass. Each pattern is bucketed by its rarest pair of adjacent fixed bytes (or by its
+// rarest fixed byte, if no two are adjacent). A bitmap of the 65536 pairs tells at each position if some pattern has to be
+// verified there, so the cost of the pass hardly depends on the number of patterns. With avx2, positions whose bytes are not
+// in the sets of first and second bytes of the pairs are discarded 32 at a time first, which pays off with few patterns.
+class MultiPatternScanner
+{
+private:
+
+    struct Entry
+    {
+        uint32_t key; // Pair (first byte | second byte << 8) or single byte
+        uint32_t pattern;
+        size_t anchor; // Position of the key in the pattern
+
+        inline bool operator<(const Entry &rhs) const { return key < rhs.key; }
+    };
+
+    std::vector<const PatternScanner *> patterns;
+    std::vector<Entry> pair_entries; // Sorted by key
+    std::vector<Entry> single_entries; // Sorted by key
+    std::vector<uint32_t> no_fixed; // Patterns made only of wildcards
+    std::vector<uint64_t> pair_filter; // 65536 bits
+    uint64_t single_filter[4];
+    // Sets of the first [0] and second [1] bytes of the pairs, as nibble tables for the simd prefilter
+    uint8_t pair_sets[2][32];
+    bool built;
+
+    void Build();
+    void CheckEntries(const std::vector<Entry> &entries, uint32_t key, const uint8_t *buf, size_t q, size_t begin, size_t end, std::vector<std::vector<size_t>> &hits) const;
+
+public:
+
+    MultiPatternScanner() : built(false) { }
+
+    // The scanner is referenced, not copied, and must not change while this is used. Returns the index of the pattern.
+    size_t Add(const PatternScanner *pattern);
+    inline size_t GetNumPatterns() const { return patterns.size(); }
+    void Clear();
+
+    // Matches of all the patterns lying entirely in buf[begin, end), in a single pass. hits is resized to the number of
+    // patterns and the positions of each one are appended to hits[index], in increasing order. Scanning disjoint spans
+    // in increasing order keeps them sorted.
+    void Scan(const uint8_t *buf, size_t begin, size_t end, std::vector<std::vector<size_t>> &hits);
+};
+
+#endif // __PATTERNSCANNER_H__
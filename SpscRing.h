@@ -0,0 +1,102 @@
+#ifndef __SPSCRING_H__
+#define __SPSCRING_H__
+
+#include <stddef.h>
+#include <atomic>
+#include <vector>
+#include <utility>
+
+// Keeps the indexes written by each side in different cache lines
+#define SPSC_RING_PADDING   64
+
+// Bounded queue for exactly one producer thread and one consumer thread. Lock-free: a push or pop is a single
+// release store. Each side keeps a copy of the index of the other one, and only reads the shared one when the
+// queue looks full (producer) or empty (consumer).
+// Indexes grow without wrapping around the capacity (which is a power of 2), so tail - head is the number of items.
+template<typename T>
+class SpscRing
+{
+private:
+
+    std::vector<T> slots;
+    size_t mask;
+
+    char pad0[SPSC_RING_PADDING];
+
+    // Producer side
+    std::atomic<size_t> tail;
+    size_t cached_head;
+
+    char pad1[SPSC_RING_PADDING];
+
+    // Consumer side
+    std::atomic<size_t> head;
+    size_t cached_tail;
+
+    char pad2[SPSC_RING_PADDING];
+
+    SpscRing(const SpscRing &);
+    SpscRing &operator=(const SpscRing &);
+
+public:
+
+    // capacity is rounded up to a power of 2
+    SpscRing(size_t capacity) : cached_head(0), cached_tail(0)
+    {
+        size_t size = 2;
+
+        while (size < capacity)
+            size <<= 1;
+
+        slots.resize(size);
+        mask = size-1;
+        tail.store(0, std::memory_order_relaxed);
+        head.store(0, std::memory_order_relaxed);
+    }
+
+    inline size_t GetCapacity() const { return slots.size(); }
+
+    // Producer only. Returns false if the queue is full, value is left untouched then.
+    inline bool Push(T &&value)
+    {
+        size_t t = tail.load(std::memory_order_relaxed);
+
+        if (t - cached_head == slots.size())
+        {
+            cached_head = head.load(std::memory_order_acquire);
+
+            if (t - cached_head == slots.size())
+                return false;
+        }
+
+        slots[t & mask] = std::move(value);
+        tail.store(t+1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer only. Returns false if the queue is empty.
+    inline bool Pop(T &value)
+    {
+        size_t h = head.load(std::memory_order_relaxed);
+
+        if (h == cached_tail)
+        {
+            cached_tail = tail.load(std::memory_order_acquire);
+
+            if (h == cached_tail)
+                return false;
+        }
+
+        value = std::move(slots[h & mask]);
+        head.store(h+1, std::memory_order_release);
+        return true;
+    }
+
+    // Number of items pushed/popped since the creation. From any thread; just a snapshot if the owner is working.
+    inline size_t GetNumPushed() const { return tail.load(std::memory_order_acquire); }
+    inline size_t GetNumPopped() const { return head.load(std::memory_order_acquire); }
+
+    inline bool IsEmpty() const { return GetNumPopped() == GetNumPushed(); }
+};
+
+#endif // __SPSCRING_H__
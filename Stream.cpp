@@ -1,11 +1,14 @@
-#include "Stream.h"
+#include <atomic>
+#include <chrono>
+#include <deque>
 
-#ifndef NO_CRYPTO
-#include "crypto/sha1.h"
-#endif
+#include "Stream.h"
+#include "Thread.h"
 
 #define BUFFER_SIZE	(16*1024*1024)
 
+#define SWAP_CHUNK_SIZE (64*1024)
+
 #define MIN(x, y) ((x < y) ? x : y)
 
 bool Stream::CopyBuffered(Stream *out, void *buf, size_t size, size_t buf_size)
@@ -27,6 +30,92 @@ bool Stream::CopyBuffered(Stream *out, void *buf, size_t size, size_t buf_size)
     return true;
 }
 
+bool Stream::ReadArray16(uint16_t *values, size_t count)
+{
+    if (!Read(values, count*sizeof(uint16_t)))
+        return false;
+
+    val_array16(values, count);
+    return true;
+}
+
+bool Stream::ReadArray32(uint32_t *values, size_t count)
+{
+    if (!Read(values, count*sizeof(uint32_t)))
+        return false;
+
+    val_array32(values, count);
+    return true;
+}
+
+bool Stream::ReadArray64(uint64_t *values, size_t count)
+{
+    if (!Read(values, count*sizeof(uint64_t)))
+        return false;
+
+    val_array64(values, count);
+    return true;
+}
+
+bool Stream::WriteSwapped(const void *values, size_t count, size_t elem_size)
+{
+    // On the heap and no bigger than the data, small arrays don't pay for a full chunk
+    size_t chunk_count = MIN(count, SWAP_CHUNK_SIZE / elem_size);
+    uint64_t *chunk = new uint64_t[(chunk_count*elem_size + sizeof(uint64_t) - 1) / sizeof(uint64_t)];
+    const uint8_t *src = (const uint8_t *)values;
+
+    while (count > 0)
+    {
+        size_t n = MIN(count, chunk_count);
+        size_t n_bytes = n*elem_size;
+
+        memcpy(chunk, src, n_bytes);
+
+        if (elem_size == sizeof(uint16_t))
+            SwapArray16((uint16_t *)chunk, n);
+        else if (elem_size == sizeof(uint32_t))
+            SwapArray32((uint32_t *)chunk, n);
+        else
+            SwapArray64(chunk, n);
+
+        if (!Write(chunk, n_bytes))
+        {
+            delete[] chunk;
+            return false;
+        }
+
+        src += n_bytes;
+        count -= n;
+    }
+
+    delete[] chunk;
+    return true;
+}
+
+bool Stream::WriteArray16(const uint16_t *values, size_t count)
+{
+    if (!needs_swap())
+        return Write(values, count*sizeof(uint16_t));
+
+    return WriteSwapped(values, count, sizeof(uint16_t));
+}
+
+bool Stream::WriteArray32(const uint32_t *values, size_t count)
+{
+    if (!needs_swap())
+        return Write(values, count*sizeof(uint32_t));
+
+    return WriteSwapped(values, count, sizeof(uint32_t));
+}
+
+bool Stream::WriteArray64(const uint64_t *values, size_t count)
+{
+    if (!needs_swap())
+        return Write(values, count*sizeof(uint64_t));
+
+    return WriteSwapped(values, count, sizeof(uint64_t));
+}
+
 bool Stream::ReadCString(std::string &str)
 {
     int8_t ch;
@@ -115,105 +204,283 @@ bool Stream::CopyEx(Stream *, size_t, Hash, uint8_t *, Cipher, const uint8_t *,
     return false;
 }
 
+bool Stream::CopyPipelined(Stream *, uint64_t, Hash, uint8_t *, Cipher, const uint8_t *, int, Cipher, const uint8_t *, int, size_t, unsigned int, CopyStats *)
+{
+    DPRINTF("%s: Crypto is not enabled.\n", FUNCNAME);
+    return false;
+}
+
 #else
 
-bool Stream::CopyEx(Stream *other, size_t size, Hash hash_mode, uint8_t *hash, Cipher decrypt_mode, const uint8_t *decrypt_key, int decrypt_key_size, Cipher encrypt_mode, const uint8_t *encrypt_key, int encrypt_key_size)
+#define AES_BLOCK_SIZE  16
+
+struct CopyChunk
 {
-    static const size_t block_size = 16;
-    uint8_t *copy_buf;
-    size_t remaining;
-    SHA1_CTX ctx;
-    bool decrypt, encrypt, do_hash;
+    uint8_t *buf;
+    size_t size; // Payload size (what is hashed)
+    size_t read_size;
+    size_t write_size;
+};
+
+// Single consumer queue. The Event is auto-reset, so the consumer just rechecks the queue after every wake up
+class CopyChunkQueue
+{
+private:
 
-    assert((BUFFER_SIZE % block_size) == 0);
+    Mutex mutex;
+    Event not_empty;
+    std::deque<CopyChunk *> queue;
+    bool closed;
 
-    do_hash = (hash_mode == Hash::SHA1);
-    decrypt = (decrypt_mode == Cipher::AES_PLAIN);
-    encrypt = (encrypt_mode == Cipher::AES_PLAIN);
+public:
 
-    if (size < BUFFER_SIZE)
-    {
-        size_t buf_size = size;
+    CopyChunkQueue() : closed(false) { }
 
-        if (decrypt || encrypt)
+    void Push(CopyChunk *chunk)
+    {
         {
-            if ((buf_size % block_size) != 0)
-            {
-                buf_size += (block_size - (buf_size % block_size));
-            }
+            MutexLocker lock(&mutex);
+            queue.push_back(chunk);
         }
 
-        copy_buf = new uint8_t[buf_size];
+        not_empty.Notify();
     }
-    else
-    {
-        copy_buf = new uint8_t[BUFFER_SIZE];
-    }   
 
-    if (do_hash)
-        __SHA1_Init(&ctx);
+    void Close()
+    {
+        {
+            MutexLocker lock(&mutex);
+            closed = true;
+        }
 
-    remaining = size;
+        not_empty.Notify();
+    }
 
-    while (remaining > 0)
+    // Returns nullptr once the queue is closed and empty
+    CopyChunk *Pop()
     {
-        size_t r = (remaining > BUFFER_SIZE) ? BUFFER_SIZE: remaining;
-        size_t read_size = r;
-        size_t write_size = r;
-        bool eof = false;
-
-        if (decrypt)
+        while (true)
         {
-            if ((read_size % block_size) != 0)
             {
-                read_size += (block_size - (r % block_size));
-                eof = true;
+                MutexLocker lock(&mutex);
+
+                if (queue.size() > 0)
+                {
+                    CopyChunk *chunk = queue.front();
+                    queue.pop_front();
+                    return chunk;
+                }
+
+                if (closed)
+                    return nullptr;
             }
-        }
 
-        if (!other->Read(copy_buf, read_size))
-        {
-            delete[] copy_buf;
-            return false;
+            not_empty.Wait();
         }
+    }
+};
+
+struct CopyPipeline
+{
+    Stream *out;
+    bool do_hash, decrypt, encrypt;
+    const uint8_t *decrypt_key, *encrypt_key;
+    int decrypt_key_size, encrypt_key_size;
+    Utils::Sha1Hasher hasher;
 
+    CopyChunkQueue free_chunks, read_chunks, ready_chunks;
+    std::atomic<bool> error;
+
+    void Transform(CopyChunk *chunk)
+    {
         if (do_hash)
-            __SHA1_Update(&ctx, copy_buf, (uint32_t)r);
+            hasher.Update(chunk->buf, chunk->size);
 
         if (decrypt)
-        {
-            Utils::AesEcbDecrypt(copy_buf, read_size, decrypt_key, decrypt_key_size);
-        }
+            Utils::AesEcbDecrypt(chunk->buf, chunk->read_size, decrypt_key, decrypt_key_size);
+
+        chunk->write_size = chunk->size;
 
         if (encrypt)
         {
-            if ((write_size % block_size) != 0)
+            if ((chunk->write_size % AES_BLOCK_SIZE) != 0)
             {
-                size_t new_write_size = write_size + (block_size - (r % block_size));
+                size_t new_write_size = Utils::Align2(chunk->write_size, AES_BLOCK_SIZE);
 
-                memset(copy_buf+write_size, 0, new_write_size-write_size);
-                write_size = new_write_size;
+                memset(chunk->buf+chunk->write_size, 0, new_write_size-chunk->write_size);
+                chunk->write_size = new_write_size;
             }
 
-            Utils::AesEcbEncrypt(copy_buf, write_size, encrypt_key, encrypt_key_size);
+            Utils::AesEcbEncrypt(chunk->buf, chunk->write_size, encrypt_key, encrypt_key_size);
         }
+    }
+};
 
-        if (!Write(copy_buf, write_size))
+class CopyTransformStage : public Runnable
+{
+    CopyPipeline *pipeline;
+
+public:
+
+    CopyTransformStage(CopyPipeline *pipeline) : pipeline(pipeline) { }
+
+    virtual uint32_t Run() override
+    {
+        CopyChunk *chunk;
+
+        while ((chunk = pipeline->read_chunks.Pop()))
         {
-            delete[] copy_buf;
-            return false;
+            if (!pipeline->error)
+                pipeline->Transform(chunk);
+
+            pipeline->ready_chunks.Push(chunk);
+        }
+
+        pipeline->ready_chunks.Close();
+        return 0;
+    }
+};
+
+class CopyWriteStage : public Runnable
+{
+    CopyPipeline *pipeline;
+
+public:
+
+    CopyWriteStage(CopyPipeline *pipeline) : pipeline(pipeline) { }
+
+    virtual uint32_t Run() override
+    {
+        CopyChunk *chunk;
+
+        while ((chunk = pipeline->ready_chunks.Pop()))
+        {
+            if (!pipeline->error && !pipeline->out->Write(chunk->buf, chunk->write_size))
+                pipeline->error = true;
+
+            // Always give the buffer back, so that the reader never blocks forever
+            pipeline->free_chunks.Push(chunk);
         }
 
-        if (eof)
+        return 0;
+    }
+};
+
+bool Stream::CopyEx(Stream *other, size_t size, Hash hash_mode, uint8_t *hash, Cipher decrypt_mode, const uint8_t *decrypt_key, int decrypt_key_size, Cipher encrypt_mode, const uint8_t *encrypt_key, int encrypt_key_size)
+{
+    return CopyPipelined(other, size, hash_mode, hash, decrypt_mode, decrypt_key, decrypt_key_size, encrypt_mode, encrypt_key, encrypt_key_size);
+}
+
+bool Stream::CopyPipelined(Stream *other, uint64_t size, Hash hash_mode, uint8_t *hash, Cipher decrypt_mode, const uint8_t *decrypt_key, int decrypt_key_size,
+                           Cipher encrypt_mode, const uint8_t *encrypt_key, int encrypt_key_size, size_t chunk_size, unsigned int num_buffers, CopyStats *stats)
+{
+    CopyPipeline pipeline;
+    auto start_time = std::chrono::steady_clock::now();
+
+    pipeline.out = this;
+    pipeline.do_hash = (hash_mode == Hash::SHA1);
+    pipeline.decrypt = (decrypt_mode == Cipher::AES_PLAIN);
+    pipeline.encrypt = (encrypt_mode == Cipher::AES_PLAIN);
+    pipeline.decrypt_key = decrypt_key;
+    pipeline.decrypt_key_size = decrypt_key_size;
+    pipeline.encrypt_key = encrypt_key;
+    pipeline.encrypt_key_size = encrypt_key_size;
+    pipeline.error = false;
+
+    // Chunks must hold whole AES blocks, also the last one once padded
+    chunk_size = Utils::Align2((chunk_size == 0) ? STREAM_COPY_CHUNK_SIZE : chunk_size, AES_BLOCK_SIZE);
+    if (size < chunk_size)
+        chunk_size = Utils::Align2((size_t)size, AES_BLOCK_SIZE);
+
+    bool threaded = (size > chunk_size && num_buffers >= 2);
+    if (!threaded)
+        num_buffers = 1;
+
+    std::vector<CopyChunk> chunks(num_buffers);
+    for (CopyChunk &chunk : chunks)
+    {
+        chunk.buf = new uint8_t[chunk_size];
+        pipeline.free_chunks.Push(&chunk);
+    }
+
+    if (pipeline.do_hash)
+        pipeline.hasher.Reset();
+
+    CopyTransformStage transform_stage(&pipeline);
+    CopyWriteStage write_stage(&pipeline);
+    Thread *transform_thread = nullptr, *write_thread = nullptr;
+
+    if (threaded)
+    {
+        transform_thread = new Thread(&transform_stage, false);
+        write_thread = new Thread(&write_stage, false);
+        transform_thread->Start();
+        write_thread->Start();
+    }
+
+    uint64_t remaining = size;
+    uint64_t total_read = 0;
+
+    while (remaining > 0 && !pipeline.error)
+    {
+        CopyChunk *chunk = pipeline.free_chunks.Pop();
+        size_t r = (remaining > chunk_size) ? chunk_size : (size_t)remaining;
+
+        chunk->size = chunk->read_size = r;
+
+        // Encrypted data is always read in whole blocks
+        if (pipeline.decrypt)
+            chunk->read_size = Utils::Align2(r, AES_BLOCK_SIZE);
+
+        if (!other->Read(chunk->buf, chunk->read_size))
+        {
+            pipeline.error = true;
+            pipeline.free_chunks.Push(chunk);
             break;
+        }
 
+        total_read += chunk->read_size;
         remaining -= r;
+
+        if (threaded)
+        {
+            pipeline.read_chunks.Push(chunk);
+        }
+        else
+        {
+            pipeline.Transform(chunk);
+
+            if (!Write(chunk->buf, chunk->write_size))
+                pipeline.error = true;
+
+            pipeline.free_chunks.Push(chunk);
+        }
+    }
+
+    if (threaded)
+    {
+        pipeline.read_chunks.Close();
+        transform_thread->Wait();
+        write_thread->Wait();
+        delete transform_thread;
+        delete write_thread;
     }
 
-    if (do_hash)
-        __SHA1_Final(&ctx, hash);
+    for (CopyChunk &chunk : chunks)
+        delete[] chunk.buf;
+
+    if (pipeline.error)
+        return false;
+
+    if (pipeline.do_hash)
+        pipeline.hasher.Final(hash);
+
+    if (stats)
+    {
+        stats->bytes = total_read;
+        stats->seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+    }
 
-    delete[] copy_buf;
     return true;
 }
 
@@ -5,8 +5,12 @@
 #include "BaseFile.h"
 #include "debug.h"
 
+#define STREAM_COPY_CHUNK_SIZE  (4*1024*1024)
+
 class Stream : public BaseFile
 {
+    bool WriteSwapped(const void *values, size_t count, size_t elem_size);
+
 protected:
     std::stack<uint64_t> saved_pos_stack;
 
@@ -24,6 +28,14 @@ public:
         AES_PLAIN,
     };
 
+    struct CopyStats
+    {
+        uint64_t bytes; // Bytes read from the source stream
+        double seconds;
+
+        inline double BytesPerSecond() const { return (seconds > 0.0) ? (double)bytes / seconds : 0.0; }
+    };
+
     virtual uint64_t GetSize() const = 0;
     virtual bool Resize(uint64_t size) = 0;
     virtual bool Grow(int64_t size) { return Resize((uint64_t)((int64_t)GetSize()+size)); }
@@ -58,8 +70,11 @@ public:
 
     inline bool ReadFloat(float *ptr)
     {
-        // TODO: endianess
-        return Read(ptr, sizeof(float));
+        bool ret = Read(ptr, sizeof(float));
+        if (ret)
+            *ptr = val_float(*ptr);
+
+        return ret;
     }
 
     inline bool Read64(uint64_t *ptr)
@@ -75,6 +90,16 @@ public:
 
 	inline bool ReadGuid(uint8_t *ptr) { return Read(ptr, 16); }
 
+    // Bulk versions of ReadXX, the whole array is read at once and then converted in place
+    bool ReadArray16(uint16_t *values, size_t count);
+    bool ReadArray32(uint32_t *values, size_t count);
+    bool ReadArray64(uint64_t *values, size_t count);
+    inline bool ReadArrayFloat(float *values, size_t count) { return ReadArray32((uint32_t *)values, count); }
+
+    inline bool ReadArray16(int16_t *values, size_t count) { return ReadArray16((uint16_t *)values, count); }
+    inline bool ReadArray32(int32_t *values, size_t count) { return ReadArray32((uint32_t *)values, count); }
+    inline bool ReadArray64(int64_t *values, size_t count) { return ReadArray64((uint64_t *)values, count); }
+
     bool ReadCString(std::string &str);
 
     template <typename T>
@@ -99,8 +124,9 @@ public:
 
     inline bool WriteFloat(float value)
     {
-        // TODO: endianess
-        return Write(&value, sizeof(float));
+        uint32_t temp;
+        copy_float(&temp, value);
+        return Write(&temp, sizeof(float));
     }
 
     inline bool Write64(uint64_t value)
@@ -116,6 +142,16 @@ public:
 
 	inline bool WriteGuid(const uint8_t *ptr)	{ return Write(ptr, 16); }
 
+    // Bulk versions of WriteXX. The input is not modified, when a conversion is needed it is done in chunks.
+    bool WriteArray16(const uint16_t *values, size_t count);
+    bool WriteArray32(const uint32_t *values, size_t count);
+    bool WriteArray64(const uint64_t *values, size_t count);
+    inline bool WriteArrayFloat(const float *values, size_t count) { return WriteArray32((const uint32_t *)values, count); }
+
+    inline bool WriteArray16(const int16_t *values, size_t count) { return WriteArray16((const uint16_t *)values, count); }
+    inline bool WriteArray32(const int32_t *values, size_t count) { return WriteArray32((const uint32_t *)values, count); }
+    inline bool WriteArray64(const int64_t *values, size_t count) { return WriteArray64((const uint64_t *)values, count); }
+
     template <typename T>
     inline bool WriteData(const T& data)
     {
@@ -131,6 +167,10 @@ public:
 
     virtual bool Copy(Stream *other, size_t size);
     virtual bool CopyEx(Stream *other, size_t size, Hash hash_mode=Hash::NONE, uint8_t *hash=nullptr, Cipher decrypt_mode=Cipher::NONE, const uint8_t *decrypt_key=nullptr, int decrypt_key_size=0, Cipher encrypt_mode=Cipher::NONE, const uint8_t *encrypt_key=nullptr, int encrypt_key_size=0);
+    // CopyEx in a pipeline: the calling thread reads, a second thread hashes and decrypts/encrypts, and a third one writes,
+    // with num_buffers chunks of chunk_size bytes in flight. Copies that fit in one chunk are done in the calling thread.
+    bool CopyPipelined(Stream *other, uint64_t size, Hash hash_mode=Hash::NONE, uint8_t *hash=nullptr, Cipher decrypt_mode=Cipher::NONE, const uint8_t *decrypt_key=nullptr, int decrypt_key_size=0,
+                       Cipher encrypt_mode=Cipher::NONE, const uint8_t *encrypt_key=nullptr, int encrypt_key_size=0, size_t chunk_size=STREAM_COPY_CHUNK_SIZE, unsigned int num_buffers=3, CopyStats *stats=nullptr);
     virtual bool CopyBuffered(Stream *out, void *buf, size_t size, size_t buf_size);
 
     virtual bool Align(unsigned int alignment);
@@ -1,5 +1,13 @@
+#include <atomic>
+
+#ifdef __linux__
+#include <sched.h>
+#include <set>
+#endif
+
 #include "Thread.h"
-#include "debug.h"
+
+#ifdef _WIN32
 
 static DWORD CountSetBits(ULONG_PTR bitMask)
 {
@@ -17,31 +25,25 @@ static DWORD CountSetBits(ULONG_PTR bitMask)
     return bitSetCount;
 }
 
-int Thread::LogicalCoresCount()
+// Returns 0 on error
+static int CountCores(bool logical)
 {
-    static int count = 0;
-    static Mutex mutex;
-
-    MutexLocker lock(&mutex);
-
-    if (count != 0)
-        return count;
-
     PSYSTEM_LOGICAL_PROCESSOR_INFORMATION pinfo = nullptr, ptr;
     DWORD length = 0;
     DWORD offset = 0;
+    int count = 0;
 
     if (GetLogicalProcessorInformation(pinfo, &length))
-        return 1;
+        return 0;
 
     if (GetLastError() != ERROR_INSUFFICIENT_BUFFER)
-        return 1;
+        return 0;
 
     pinfo = (PSYSTEM_LOGICAL_PROCESSOR_INFORMATION)malloc(length);
     if (!GetLogicalProcessorInformation(pinfo, &length))
     {
         free(pinfo);
-        return 1;
+        return 0;
     }
 
     ptr = pinfo;
@@ -49,7 +51,7 @@ int Thread::LogicalCoresCount()
     {
         if (ptr->Relationship == RelationProcessorCore)
         {
-            count += CountSetBits(ptr->ProcessorMask);
+            count += (logical) ? CountSetBits(ptr->ProcessorMask) : 1;
         }
 
         offset += sizeof(SYSTEM_LOGICAL_PROCESSOR_INFORMATION);
@@ -57,71 +59,135 @@ int Thread::LogicalCoresCount()
     }
 
     free(pinfo);
-    return (count >= 1) ? count : 1;
+    return count;
 }
 
-int Thread::PhisycalCoresCount()
+#elif defined(__linux__)
+
+// Returns 0 on error
+static int CountCores(bool logical)
 {
-    static int count = 0;
-    static Mutex mutex;
+    cpu_set_t set;
 
-    MutexLocker lock(&mutex);
+    // Cpus this process may run on, which can be less than the online ones (taskset, containers)
+    if (sched_getaffinity(0, sizeof(set), &set) != 0)
+        return (int)sysconf(_SC_NPROCESSORS_ONLN);
 
-    if (count != 0)
-        return count;
+    if (logical)
+        return CPU_COUNT(&set);
 
-    PSYSTEM_LOGICAL_PROCESSOR_INFORMATION pinfo = nullptr, ptr;
-    DWORD length = 0;
-    DWORD offset = 0;
+    // Physical cores are the distinct (package, core) pairs of those cpus
+    std::set<std::pair<int, int>> cores;
 
-    if (GetLogicalProcessorInformation(pinfo, &length))
-        return 1;
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+    {
+        if (!CPU_ISSET(cpu, &set))
+            continue;
 
-    if (GetLastError() != ERROR_INSUFFICIENT_BUFFER)
-        return 1;
+        char path[128];
+        int package = 0, core = 0;
 
-    pinfo = (PSYSTEM_LOGICAL_PROCESSOR_INFORMATION)malloc(length);
-    if (!GetLogicalProcessorInformation(pinfo, &length))
-    {
-        free(pinfo);
-        return 1;
-    }
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/physical_package_id", cpu);
+        FILE *f = fopen(path, "r");
+        if (!f)
+            return 0;
 
-    ptr = pinfo;
-    while (offset + sizeof(SYSTEM_LOGICAL_PROCESSOR_INFORMATION) <= length)
-    {
-        if (ptr->Relationship == RelationProcessorCore)
+        bool ok = (fscanf(f, "%d", &package) == 1);
+        fclose(f);
+
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/core_id", cpu);
+        f = fopen(path, "r");
+        if (!f || !ok)
         {
-            count++;
+            if (f)
+                fclose(f);
+
+            return 0;
         }
 
-        offset += sizeof(SYSTEM_LOGICAL_PROCESSOR_INFORMATION);
-        ptr++;
+        ok = (fscanf(f, "%d", &core) == 1);
+        fclose(f);
+
+        if (!ok)
+            return 0;
+
+        cores.insert(std::make_pair(package, core));
     }
 
-    free(pinfo);
-    return (count >= 1) ? count : 1;
+    return (int)cores.size();
 }
 
+#else
+
+static int CountCores(bool)
+{
+    return (int)std::thread::hardware_concurrency();
+}
+
+#endif
+
+int Thread::LogicalCoresCount()
+{
+    static std::atomic<int> count(0);
+
+    int ret = count.load(std::memory_order_relaxed);
+    if (ret != 0)
+        return ret;
+
+    ret = CountCores(true);
+    if (ret < 1)
+        ret = (int)std::thread::hardware_concurrency();
+    if (ret < 1)
+        ret = 1;
+
+    count.store(ret, std::memory_order_relaxed);
+    return ret;
+}
+
+int Thread::PhisycalCoresCount()
+{
+    static std::atomic<int> count(0);
+
+    int ret = count.load(std::memory_order_relaxed);
+    if (ret != 0)
+        return ret;
+
+    // When the topology can't be read, assume no SMT
+    ret = CountCores(false);
+    if (ret < 1)
+        ret = LogicalCoresCount();
+
+    count.store(ret, std::memory_order_relaxed);
+    return ret;
+}
+
+// Rounds of yield of an idle worker before sleeping. Tasks often come in bursts (the chunks of a ParallelFor, the
+// works of a loop of AddWork), it is cheaper to catch them awake.
+#define POOL_SPIN_COUNT 64
+
+#ifdef _MSC_VER
+#define POOL_THREAD_LOCAL   __declspec(thread)
+#else
+#define POOL_THREAD_LOCAL   __thread
+#endif
+
+// Pool and index of the worker running in this thread, if any
+static POOL_THREAD_LOCAL ThreadPool *current_pool = nullptr;
+static POOL_THREAD_LOCAL int current_worker = -1;
+
 class PoolThread : public Runnable
 {
 private:
 
     ThreadPool *pool;
+    int index;
     Thread *thread;
-    Runnable *work;
-    Event event;
-
-    bool auto_delete;
-    bool leave;
 
 public:
 
-    PoolThread(ThreadPool *pool, bool auto_delete, unsigned int stack_size) : pool(pool), auto_delete(auto_delete)
+    PoolThread(ThreadPool *pool, int index, unsigned int stack_size) : pool(pool), index(index)
     {
         thread = new Thread(this, false, stack_size);
-        work = nullptr;
-        leave = false;
         thread->Start();
     }
 
@@ -132,56 +198,68 @@ public:
 
     virtual uint32_t Run() override
     {
-        while (!leave)
-        {
-            event.Wait();
-
-            if (!leave && work)
-                work->Run();
-
-            if (work)
-            {
-                Runnable *temp = work;
-                work = nullptr;
-                pool->WorkDone(temp);
-
-                if (auto_delete)
-                    delete temp;
-            }
-        }
-
+        pool->WorkerLoop(index);
         return 0;
     }
+};
 
-    bool IsFree()
-    {
-        return !work;
-    }
+struct ParallelForState
+{
+    size_t begin;
+    size_t end;
+    size_t grain;
+    size_t num_chunks;
+    const std::function<void(size_t)> *body;
+
+    std::atomic<size_t> next_chunk;
+    std::atomic<size_t> chunks_done;
+};
 
-    void AddWork(Runnable *work)
-    {
-        this->work = work;
-        event.Notify();
-    }
+// Runs chunks of the loop until there are none left to take. Returns true if this call completed the loop.
+// Helper tasks may run after the loop has returned, they find no chunk and never touch body.
+static bool RunChunks(ParallelForState *state)
+{
+    bool completed = false;
+    size_t chunk;
 
-    void Kill()
+    while ((chunk = state->next_chunk.fetch_add(1)) < state->num_chunks)
     {
-        leave = true;
-        event.Notify();
-        thread->Kill();
+        size_t first = state->begin + chunk*state->grain;
+        size_t last = (state->end - first > state->grain) ? first + state->grain : state->end;
+
+        for (size_t i = first; i < last; i++)
+            (*state->body)(i);
+
+        if (state->chunks_done.fetch_add(1) + 1 == state->num_chunks)
+            completed = true;
     }
-};
 
-ThreadPool::ThreadPool(int num_threads, bool auto_delete, unsigned int stack_size)
+    return completed;
+}
+
+ThreadPool::ThreadPool(int num_threads, bool auto_delete, unsigned int stack_size) : auto_delete(auto_delete)
 {
     if (num_threads <= 0)
         num_threads = Thread::LogicalCoresCount();
 
+    next_queue = 0;
+    num_queued = 0;
+    num_works = 0;
+    num_sleeping = 0;
+    leave = false;
+
+    queues.resize(num_threads);
+
+    for (WorkerQueue *&queue : queues)
+    {
+        queue = new WorkerQueue();
+    }
+
     threads.resize(num_threads);
 
-    for (PoolThread *&thread : threads)
+    for (int i = 0; i < num_threads; i++)
     {
-        thread = new PoolThread(this, auto_delete, stack_size);
+        threads[i] = new PoolThread(this, i, stack_size);
     }
 }
 
@@ -189,72 +267,265 @@ ThreadPool::~ThreadPool()
 {
     Wait();
 
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex);
+        leave = true;
+    }
+
+    sleep_cond.notify_all();
+
     for (PoolThread *&thread : threads)
     {
-        thread->Kill();
+        // Joins it
         delete thread;
     }
+
+    for (WorkerQueue *&queue : queues)
+    {
+        delete queue;
+    }
+}
+
+int ThreadPool::CurrentWorker() const
+{
+    return (current_pool == this) ? current_worker : -1;
 }
 
-void ThreadPool::ProcessQueue()
+void ThreadPool::Push(Task &&task)
 {
-    for (size_t i = 0; i < works.size(); i++)
+    int worker = CurrentWorker();
+    WorkerQueue *queue = queues[(worker >= 0) ? (size_t)worker : next_queue.fetch_add(1) % queues.size()];
+
     {
-        if (running[i])
-            continue;
+        MutexLocker lock(&queue->mutex);
+        queue->tasks.push_back(std::move(task));
+    }
 
-        Runnable *&work = works[i];
+    num_queued.fetch_add(1);
 
-        for (PoolThread *&thread : threads)
+    if (num_sleeping.load() > 0)
+    {
+        // Sleepers check num_queued with sleep_mutex held, taking it here ensures the notify isn't lost
         {
-            if (thread->IsFree())
-            {
-                running[i] = true;
-                thread->AddWork(work);
-                break;
-            }
+            std::lock_guard<std::mutex> lock(sleep_mutex);
         }
+
+        sleep_cond.notify_one();
     }
+}
+
+bool ThreadPool::Pop(int worker, Task &task)
+{
+    if (num_queued.load() <= 0)
+        return false;
 
-    if (works.size() == 0)
-        completion.Notify();
+    size_t n = queues.size();
+    size_t start;
+
+    if (worker >= 0)
+    {
+        // Own tasks, newest first: they are the ones most likely still in cache
+        WorkerQueue *queue = queues[worker];
+        MutexLocker lock(&queue->mutex);
+
+        if (!queue->tasks.empty())
+        {
+            task = std::move(queue->tasks.back());
+            queue->tasks.pop_back();
+            num_queued.fetch_sub(1);
+            return true;
+        }
+
+        start = (size_t)worker + 1;
+    }
+    else
+    {
+        start = next_queue.load(std::memory_order_relaxed);
+    }
+
+    // Steal the oldest task of someone else
+    for (size_t i = 0; i < n; i++)
+    {
+        WorkerQueue *queue = queues[(start + i) % n];
+        MutexLocker lock(&queue->mutex);
+
+        if (!queue->tasks.empty())
+        {
+            task = std::move(queue->tasks.front());
+            queue->tasks.pop_front();
+            num_queued.fetch_sub(1);
+            return true;
+        }
+    }
+
+    return false;
 }
 
-void ThreadPool::AddWork(Runnable *work)
+void ThreadPool::Sleep(const std::function<bool()> &done)
 {
-    MutexLocker lock(&mutex);
-    works.push_back(work);
-    running.push_back(false);
-    ProcessQueue();
+    std::unique_lock<std::mutex> lock(sleep_mutex);
+
+    num_sleeping.fetch_add(1);
+
+    while (!done() && num_queued.load() <= 0)
+        sleep_cond.wait(lock);
+
+    num_sleeping.fetch_sub(1);
 }
 
-void ThreadPool::Wait()
+void ThreadPool::NotifyWaiters()
 {
+    // Pairs with the increment of num_sleeping in Sleep: either the sleeper sees the work done, or we see it sleeping
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    if (num_sleeping.load() > 0)
     {
-        MutexLocker lock(&mutex);
+        {
+            std::lock_guard<std::mutex> lock(sleep_mutex);
+        }
 
-        if (works.size() == 0)
-            return;
+        sleep_cond.notify_all();
     }
+}
 
-    completion.Wait();
+void ThreadPool::WaitUntil(const std::function<bool()> &done)
+{
+    while (!done())
+    {
+        if (!RunPendingTask())
+            Sleep(done);
+    }
 }
 
-void ThreadPool::WorkDone(Runnable *work)
+void ThreadPool::WorkerLoop(int worker)
 {
-    MutexLocker lock(&mutex);
+    current_pool = this;
+    current_worker = worker;
 
-    for (size_t i = 0; i < works.size(); i++)
-    {
-        Runnable *&this_work = works[i];
+    std::function<bool()> leaving = [this]() { return leave.load(); };
+    Task task;
 
-        if (running[i] && this_work == work)
+    while (true)
+    {
+        if (Pop(worker, task))
         {
-            running.erase(running.begin()+i);
-            works.erase(works.begin()+i);
+            task();
+            task = nullptr;
+            continue;
+        }
+
+        if (leave.load())
             break;
+
+        bool found = false;
+
+        for (int i = 0; i < POOL_SPIN_COUNT && !found; i++)
+        {
+            std::this_thread::yield();
+            found = (num_queued.load(std::memory_order_relaxed) > 0);
         }
+
+        if (!found)
+            Sleep(leaving);
     }
 
-    ProcessQueue();
+    current_pool = nullptr;
+    current_worker = -1;
+}
+
+bool ThreadPool::RunPendingTask()
+{
+    Task task;
+
+    if (!Pop(CurrentWorker(), task))
+        return false;
+
+    task();
+    return true;
+}
+
+void ThreadPool::AddWork(Runnable *work)
+{
+    num_works.fetch_add(1);
+
+    Push([this, work]()
+    {
+        work->Run();
+
+        if (auto_delete)
+            delete work;
+
+        if (num_works.fetch_sub(1) == 1)
+            NotifyWaiters();
+    });
+}
+
+void ThreadPool::Wait()
+{
+    WaitUntil([this]() { return num_works.load() == 0; });
+}
+
+void ThreadPool::ParallelForInternal(size_t begin, size_t end, size_t grain, const std::function<void(size_t)> &body, int max_threads)
+{
+    if (begin >= end)
+        return;
+
+    if (grain == 0)
+        grain = 1;
+
+    size_t num_chunks = (end - begin - 1) / grain + 1;
+    size_t num_helpers = threads.size();
+
+    if (max_threads > 0 && num_helpers > (size_t)max_threads - 1)
+        num_helpers = (size_t)max_threads - 1;
+
+    if (num_helpers > num_chunks - 1)
+        num_helpers = num_chunks - 1;
+
+    if (num_helpers == 0)
+    {
+        for (size_t i = begin; i < end; i++)
+            body(i);
+
+        return;
+    }
+
+    std::shared_ptr<ParallelForState> state = std::make_shared<ParallelForState>();
+    state->begin = begin;
+    state->end = end;
+    state->grain = grain;
+    state->num_chunks = num_chunks;
+    state->body = &body;
+    state->next_chunk = 0;
+    state->chunks_done = 0;
+
+    for (size_t i = 0; i < num_helpers; i++)
+    {
+        Push([this, state]()
+        {
+            if (RunChunks(state.get()))
+                NotifyWaiters();
+        });
+    }
+
+    if (RunChunks(state.get()))
+        return;
+
+    // The remaining chunks are being run by other threads
+    ParallelForState *s = state.get();
+    WaitUntil([s]() { return s->chunks_done.load() == s->num_chunks; });
+}
+
+ThreadPool &ThreadPool::GetGlobal()
+{
+    static std::once_flag once;
+    static ThreadPool *pool;
+
+    std::call_once(once, []()
+    {
+        int num_threads = Thread::LogicalCoresCount() - 1;
+        pool = new ThreadPool((num_threads < 1) ? 1 : num_threads);
+    });
+
+    return *pool;
 }
@@ -1,9 +1,25 @@
 #ifndef __THREAD_H__
 #define __THREAD_H__
 
+#include <stdint.h>
+#include <vector>
+#include <deque>
+#include <atomic>
+#include <memory>
+#include <functional>
+#include <future>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
 #include "Mutex.h"
 #include "Event.h"
 
+#ifdef __MINGW32__
+#include <pthread.h> // pthread_gethandle
+#endif
+
 class Runnable
 {
 public:
@@ -34,11 +50,14 @@ public:
     }
 };
 
+// Backed by std::thread. The thread is created suspended and begins running the Runnable on Start.
+// stack_size is ignored, std::thread has no way to set it.
 class Thread
 {
 private:
 
-    HANDLE handle;
+    std::thread thread;
+    std::mutex join_mutex;
     Runnable *runnable;
     bool auto_delete;
     bool started;
@@ -47,27 +66,44 @@ private:
 
     mutable Mutex mutex;
 
-    static DWORD WINAPI ThreadProc(LPVOID pthis)
-    {
-        return (((Thread *)pthis)->Run());
-    }
+    Thread(const Thread &);
+    Thread &operator=(const Thread &);
 
-    uint32_t Run()
+    void Run()
     {
-         uint32_t ret = runnable->Run();
+         runnable->Run();
 
          MutexLocker lock(&mutex);
          running = false;
          finished = true;
-         return ret;
+    }
+
+#ifdef _WIN32
+    HANDLE GetWindowsHandle()
+    {
+#ifdef __MINGW32__
+        // libstdc++ on MinGW runs over winpthreads, native_handle is a pthread_t there
+        return pthread_gethandle(thread.native_handle());
+#else
+        return (HANDLE)thread.native_handle();
+#endif
+    }
+#endif
+
+    void Join()
+    {
+        // Wait may be called from several threads, but a std::thread can only be joined by one
+        std::lock_guard<std::mutex> lock(join_mutex);
+
+        if (thread.joinable())
+            thread.join();
     }
 
 public:
 
     Thread(Runnable *runnable, bool auto_delete, unsigned int stack_size=0) : runnable(runnable), auto_delete(auto_delete)
     {
-        DWORD tid;
-        handle = CreateThread(nullptr, stack_size, ThreadProc, this, STACK_SIZE_PARAM_IS_A_RESERVATION|CREATE_SUSPENDED, &tid);
+        (void)stack_size;
         started = finished = running = false;
     }
 
@@ -96,12 +132,16 @@ public:
 
     void Start()
     {
-        if (IsStarted())
+        MutexLocker lock(&mutex);
+
+        if (started)
             return;
 
-        Resume();
+        started = running = true;
+        thread = std::thread(&Thread::Run, this);
     }
 
+    // A running thread can only be suspended on Windows. Elsewhere, this does nothing.
     void Suspend()
     {
         MutexLocker lock(&mutex);
@@ -109,54 +149,69 @@ public:
         if (!running || finished)
             return;
 
-        SuspendThread(handle);
+#ifdef _WIN32
+        SuspendThread(GetWindowsHandle());
         running = false;
+#endif
     }
 
     void Resume()
     {
-        MutexLocker lock(&mutex);
-
-        if (running || finished)
-            return;
+        {
+            MutexLocker lock(&mutex);
+
+            if (running || finished)
+                return;
+
+            if (started)
+            {
+#ifdef _WIN32
+                ResumeThread(GetWindowsHandle());
+#endif
+                running = true;
+                return;
+            }
+        }
 
-        ResumeThread(handle);
-        running = true;
-        started = true;
+        Start();
     }
 
     void Wait()
     {
-        HANDLE h = handle;
-        if (!h)
+        if (!IsStarted())
             return;
 
-        WaitForSingleObject(h, INFINITE);
-
-        MutexLocker lock(&mutex);
-        running = false;
-        finished = true;
+        Join();
     }
 
+    // Asks the runnable to stop, waits for it and releases it if auto_delete was set. A thread that was never started
+    // doesn't run at all.
     void Kill()
     {
-        if (IsFinished())
-            return;
+        bool stop;
+
+        {
+            MutexLocker lock(&mutex);
+            stop = (started && !finished);
+        }
+
+        if (stop)
+        {
+            runnable->Stop();
+            Resume();
+        }
 
-        runnable->Stop();
-        Resume();
-        Wait();
+        Join();
 
         MutexLocker lock(&mutex);
 
-        if (auto_delete)
+        if (auto_delete && runnable)
         {
             delete runnable;
             runnable = nullptr;
         }
 
-        CloseHandle(handle);
-        handle = nullptr;
+        running = false;
         finished = true;
     }
 
@@ -166,28 +221,103 @@ public:
 
 class PoolThread;
 
+// Work stealing pool. Each worker has its own deque: it pushes and pops its own tasks at the back and, when it runs
+// out of them, steals from the front of the others. Tasks submitted from outside the pool are spread among the deques.
+// Every wait (Wait, Get, ParallelFor) runs queued tasks while the awaited work isn't done, so the functions may be
+// called from inside tasks of the same pool without deadlocking.
 class ThreadPool
 {
 private:
 
     friend class PoolThread;
 
-    mutable Mutex mutex;
+    typedef std::function<void()> Task;
+
+    struct WorkerQueue
+    {
+        Mutex mutex;
+        std::deque<Task> tasks;
+    };
+
     std::vector<PoolThread *> threads;
-    std::vector<Runnable *> works;
-    std::vector<bool> running;
-    Event completion;
+    std::vector<WorkerQueue *> queues;
+    bool auto_delete;
+
+    std::atomic<size_t> next_queue;
+    std::atomic<int64_t> num_queued;
+    std::atomic<int64_t> num_works; // AddWork items not finished yet
+    std::atomic<int> num_sleeping;
+    std::atomic<bool> leave;
+
+    std::mutex sleep_mutex;
+    std::condition_variable sleep_cond;
+
+    ThreadPool(const ThreadPool &);
+    ThreadPool &operator=(const ThreadPool &);
 
-    void ProcessQueue();
-    void WorkDone(Runnable *work);
+    int CurrentWorker() const;
+    void Push(Task &&task);
+    bool Pop(int worker, Task &task);
+    void Sleep(const std::function<bool()> &done);
+    void NotifyWaiters();
+    void WaitUntil(const std::function<bool()> &done);
+    void WorkerLoop(int worker);
+    void ParallelForInternal(size_t begin, size_t end, size_t grain, const std::function<void(size_t)> &body, int max_threads);
 
 public:
 
     ThreadPool(int num_threads=0, bool auto_delete=true, unsigned int stack_size=0);
     ~ThreadPool();
 
+    inline int GetNumThreads() const { return (int)threads.size(); }
+
+    // Runs work->Run() in the pool, deleting work afterwards if the pool was created with auto_delete.
     void AddWork(Runnable *work);
+    // Waits for every AddWork item of the pool
     void Wait();
+
+    // Runs one queued task in the calling thread. Returns false if there was nothing to run.
+    bool RunPendingTask();
+
+    template<typename F>
+    auto Submit(F fn) -> std::future<decltype(fn())>
+    {
+        typedef decltype(fn()) R;
+
+        std::shared_ptr<std::packaged_task<R()>> task = std::make_shared<std::packaged_task<R()>>(std::move(fn));
+        std::future<R> ret = task->get_future();
+
+        Push([this, task]()
+        {
+            (*task)();
+            NotifyWaiters();
+        });
+
+        return ret;
+    }
+
+    // future.get() that runs queued tasks while the result isn't ready. Use it instead of get() for futures of
+    // this pool inside its own tasks.
+    template<typename T>
+    T Get(std::future<T> &future)
+    {
+        WaitUntil([&future]() { return future.wait_for(std::chrono::seconds(0)) == std::future_status::ready; });
+        return future.get();
+    }
+
+    // Calls fn(i) for every i in [begin, end), in chunks of grain indexes. The calling thread takes part and the
+    // function returns when all of them are done. max_threads limits the threads working on the loop, caller
+    // included (0: all of the pool).
+    template<typename F>
+    void ParallelFor(size_t begin, size_t end, size_t grain, F fn, int max_threads=0)
+    {
+        ParallelForInternal(begin, end, grain, [&fn](size_t i) { fn(i); }, max_threads);
+    }
+
+    // Pool shared by the whole program, with one thread less than the logical cores (the caller of ParallelFor or
+    // Wait makes up for it). Created on first use, never destroyed.
+    // AddWork/Wait count all the works of a pool, so code using this one should prefer Submit and ParallelFor.
+    static ThreadPool &GetGlobal();
 };
 
 #endif // __THREAD_H__
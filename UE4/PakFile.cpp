@@ -2,15 +2,6 @@
 #include "FixedMemoryStream.h"
 #include "debug.h"
 
-#ifndef NO_CRYPTO
-#include "crypto/sha1.h"
-#else
-#define SHA1_CTX int
-#define SHA1_Init(c)
-#define SHA1_Update(c, d, l)
-#define SHA1_Final(c, d)
-#endif
-
 #define STRING_LENGTH_LIMIT		1048576
 #define COPY_BUF_SIZE	(128*1024*1024)
 
@@ -265,7 +256,7 @@ bool PakFile::LoadCommon(Stream *stream)
 
     uint8_t sha1[20];
 
-    Utils::Sha1(index_data, (uint32_t)val64(footer.index_size), sha1);
+    Utils::Sha1(index_data, (size_t)val64(footer.index_size), sha1);
     delete index_data;
 
     if (memcmp(sha1, footer.index_sha1, sizeof(sha1)) != 0)
@@ -366,6 +357,7 @@ bool PakFile::LoadFromFile(const std::string &path, bool show_error)
     Reset();
 
     fstream = new FileStream("rb");
+    fstream->SetBuffered();
     if (!fstream->LoadFromFile(path, show_error))
         return false;
 
@@ -378,6 +370,36 @@ bool PakFile::SaveCommon(Stream *stream)
     uint32_t num_files;
     uint64_t written_size = 0;
 
+    // Hash the memory files up front, so that Utils::Sha1Multi can do several of them at once
+    std::vector<const void *> hash_bufs;
+    std::vector<size_t> hash_sizes;
+    std::vector<size_t> hash_entries;
+
+    for (size_t i = 0; i < files.size(); i++)
+    {
+        const PakFileEntry &entry = files[i];
+        uint64_t size;
+
+        if (entry.offset != INVALID_OFFSET || !entry.buf)
+            continue;
+
+        if (!entry.GetSize(&size))
+            return false;
+
+        hash_bufs.push_back(entry.buf);
+        hash_sizes.push_back((size_t)size);
+        hash_entries.push_back(i);
+    }
+
+    if (hash_entries.size() > 0)
+    {
+        std::vector<uint8_t> hashes(hash_entries.size() * sizeof(files[0].sha1));
+        Utils::Sha1Multi(hash_bufs.data(), hash_sizes.data(), hash_entries.size(), hashes.data());
+
+        for (size_t i = 0; i < hash_entries.size(); i++)
+            memcpy(files[hash_entries[i]].sha1, hashes.data() + i*sizeof(files[0].sha1), sizeof(files[0].sha1));
+    }
+
     // Write files
     for (size_t i = 0; i < files.size(); i++)
     {
@@ -437,11 +459,10 @@ bool PakFile::SaveCommon(Stream *stream)
             if (!entry.PakEntry::Write(stream, version, true))
                 return false;
 
+            // entry.sha1 was set before the loop
             if (!stream->Write(entry.buf, size))
                 return false;
 
-            Utils::Sha1(entry.buf, (uint32_t)size, entry.sha1);
-
             entry.uncompressed_size = entry.size;
             entry.compression_method = 0;
             entry.encrypted = 0;
@@ -547,7 +568,7 @@ bool PakFile::SaveCommon(Stream *stream)
         return false;
     }
 
-    Utils::Sha1(buf, (uint32_t)val64(footer.index_size), footer.index_sha1);
+    Utils::Sha1(buf, (size_t)val64(footer.index_size), footer.index_sha1);
     delete[] buf;
 
     if (!stream->Seek(0, SEEK_END))
@@ -576,18 +597,11 @@ bool PakFile::Uncompress(const PakFileEntry &entry, Stream *in, Stream *out, uin
         return false;
     }
 
-    SHA1_CTX ctx;
-
-#ifdef NO_CRYPTO
-    UNUSED(ctx);
-#endif
+    Utils::Sha1Hasher hasher;
 
     uint64_t remaining = entry.uncompressed_size;
     uint8_t *out_buf = new uint8_t[entry.compression_block_size];
 
-    if (sha1)
-        SHA1_Init(&ctx);
-
     for (const PakCompressedBlock &block : entry.comp_blocks)
     {
         int64_t comp_size = block.comp_end - block.comp_start;
@@ -618,7 +632,7 @@ bool PakFile::Uncompress(const PakFileEntry &entry, Stream *in, Stream *out, uin
             }
 
             if (sha1)
-                SHA1_Update(&ctx, in_buf, (uint32_t)comp_size);
+                hasher.Update(in_buf, (size_t)comp_size);
         }
         else
         {
@@ -638,7 +652,7 @@ bool PakFile::Uncompress(const PakFileEntry &entry, Stream *in, Stream *out, uin
             }
 
             if (sha1)
-                SHA1_Update(&ctx, in_buf, (uint32_t)read_size);
+                hasher.Update(in_buf, read_size);
 
             Utils::AesEcbDecrypt(in_buf, read_size, encryption_key, ENCRYPTION_KEY_SIZE);
         }
@@ -687,7 +701,7 @@ bool PakFile::Uncompress(const PakFileEntry &entry, Stream *in, Stream *out, uin
     }
 
     if (sha1)
-        SHA1_Final(&ctx, sha1);
+        hasher.Final(sha1);
 
     return true;
 }
@@ -718,11 +732,15 @@ bool PakFile::SaveToFile(const std::string &path, bool show_error, bool build_pa
 
     fclose(f);
     FileStream stream("w+b");
+    stream.SetBuffered();
 
     if (!stream.LoadFromFile(path, show_error))
         return false;
 
-    return SaveCommon(&stream);
+    if (!SaveCommon(&stream))
+        return false;
+
+    return stream.Close();
 }
 
 bool PakFile::ExtractCommon(const PakFileEntry &entry, Stream *stream, uint64_t size) const
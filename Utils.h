@@ -29,8 +29,6 @@
 
 #ifdef _MSC_VER
 
-#define FUNCNAME    __FUNCSIG__
-
 // WARNING: not safe
 #define snprintf    _snprintf
 #include "vs/dirent.h"
@@ -43,7 +41,6 @@
 #else
 
 #include <dirent.h>
-#define FUNCNAME    __PRETTY_FUNCTION__
 
 #define _rmdir rmdir
 
@@ -1,23 +1,86 @@
-#include "UtilsCrypto.h"
+#include "Utils.h"
+#include "common.h"
 
 #ifndef NO_CRYPTO
-#include "crypto/sha1.h"
 #include "crypto/md5.h"
 #include "crypto/rijndael.h"
 #endif
 
 #include "debug.h"
 
+#if defined(CPU_X86_64) && !defined(NO_CRYPTO)
+#include <immintrin.h>
+#define AES_NI
+
+// The 256 bits aes intrinsics need VS2019
+#if !defined(_MSC_VER) || _MSC_VER >= 1920
+#define AES_VAES
+#endif
+
+// The sha intrinsics need VS2015
+#if !defined(_MSC_VER) || _MSC_VER >= 1900
+#define SHA_NI
+#endif
+
+#define SHA_AVX2
+
+#ifdef _MSC_VER
+#define TARGET_AESNI
+#define TARGET_VAES
+#define TARGET_SHANI
+#define TARGET_AVX2
+#else
+#define TARGET_AESNI    __attribute__((target("aes")))
+#define TARGET_VAES     __attribute__((target("aes,vaes,avx2")))
+#define TARGET_SHANI    __attribute__((target("sha,ssse3,sse4.1")))
+#define TARGET_AVX2     __attribute__((target("avx2")))
+#endif
+
+#endif
+
 #define FILE_BUFFER_SIZE	(16*1024*1024)
 
 #ifdef NO_CRYPTO
 
-void Utils::Sha1(const void *, uint32_t, uint8_t *)
+void Utils::Sha1Hasher::Reset()
+{
+    length = 0;
+}
+
+// The hashers are fed in many small pieces, so only Final reports the missing crypto
+void Utils::Sha1Hasher::Update(const void *, size_t)
+{
+}
+
+void Utils::Sha1Hasher::Final(uint8_t *)
+{
+    DPRINTF("%s: Crypto is not enabled.\n", FUNCNAME);
+}
+
+void Utils::Md5Hasher::Reset()
+{
+}
+
+void Utils::Md5Hasher::Update(const void *, size_t)
+{
+}
+
+void Utils::Md5Hasher::Final(uint8_t *)
+{
+    DPRINTF("%s: Crypto is not enabled.\n", FUNCNAME);
+}
+
+void Utils::Sha1(const void *, size_t, uint8_t *)
+{
+    DPRINTF("%s: Crypto is not enabled.\n", FUNCNAME);
+}
+
+void Utils::Md5(const void *, size_t, uint8_t *)
 {
     DPRINTF("%s: Crypto is not enabled.\n", FUNCNAME);
 }
 
-void Utils::Md5(const void *, uint32_t, uint8_t *)
+void Utils::Sha1Multi(const void * const *, const size_t *, size_t, uint8_t *)
 {
     DPRINTF("%s: Crypto is not enabled.\n", FUNCNAME);
 }
@@ -51,87 +114,564 @@ void Utils::AesCtrEncrypt(void *, size_t, const uint8_t *, int, const uint8_t *)
 
 #else
 
-void Utils::Sha1(const void *buf, uint32_t size, uint8_t *result)
+#define SHA1_ROL(x, n)  (((x) << (n)) | ((x) >> (32-(n))))
+
+static const uint32_t sha1_iv[5] = { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 };
+
+// Message words are computed on the fly in a 16 entries ring
+#define SHA1_W(i)       (w[(i)&15] = SHA1_ROL(w[((i)-3)&15] ^ w[((i)-8)&15] ^ w[((i)-14)&15] ^ w[(i)&15], 1))
+
+// One round with the variables renamed instead of moved, five of them bring a..e back to their places
+#define SHA1_F0(b, c, d)    ((d) ^ ((b) & ((c) ^ (d))))
+#define SHA1_F1(b, c, d)    ((b) ^ (c) ^ (d))
+#define SHA1_F2(b, c, d)    (((b) & (c)) | ((d) & ((b) | (c))))
+
+#define SHA1_ROUND(a, b, c, d, e, f, k, wi) \
+    e += SHA1_ROL(a, 5) + f(b, c, d) + (k) + (wi); \
+    b = SHA1_ROL(b, 30);
+
+#define SHA1_ROUNDS5(f, k, wi, i) \
+    SHA1_ROUND(a, b, c, d, e, f, k, wi(i)); \
+    SHA1_ROUND(e, a, b, c, d, f, k, wi(i+1)); \
+    SHA1_ROUND(d, e, a, b, c, f, k, wi(i+2)); \
+    SHA1_ROUND(c, d, e, a, b, f, k, wi(i+3)); \
+    SHA1_ROUND(b, c, d, e, a, f, k, wi(i+4));
+
+#define SHA1_LOAD(i)    (w[i] = ((uint32_t)data[(i)*4] << 24) | ((uint32_t)data[(i)*4+1] << 16) | ((uint32_t)data[(i)*4+2] << 8) | data[(i)*4+3])
+
+static void Sha1CompressPortable(uint32_t *state, const uint8_t *data, size_t num_blocks)
+{
+    for (; num_blocks > 0; num_blocks--, data += 64)
+    {
+        uint32_t w[16];
+        uint32_t a = state[0], b = state[1], c = state[2], d = state[3], e = state[4];
+        SHA1_ROUNDS5(SHA1_F0, 0x5A827999, SHA1_LOAD, 0);
+        SHA1_ROUNDS5(SHA1_F0, 0x5A827999, SHA1_LOAD, 5);
+        SHA1_ROUNDS5(SHA1_F0, 0x5A827999, SHA1_LOAD, 10);
+        SHA1_ROUND(a, b, c, d, e, SHA1_F0, 0x5A827999, SHA1_LOAD(15));
+        SHA1_ROUND(e, a, b, c, d, SHA1_F0, 0x5A827999, SHA1_W(16));
+        SHA1_ROUND(d, e, a, b, c, SHA1_F0, 0x5A827999, SHA1_W(17));
+        SHA1_ROUND(c, d, e, a, b, SHA1_F0, 0x5A827999, SHA1_W(18));
+        SHA1_ROUND(b, c, d, e, a, SHA1_F0, 0x5A827999, SHA1_W(19));
+
+        SHA1_ROUNDS5(SHA1_F1, 0x6ED9EBA1, SHA1_W, 20);
+        SHA1_ROUNDS5(SHA1_F1, 0x6ED9EBA1, SHA1_W, 25);
+        SHA1_ROUNDS5(SHA1_F1, 0x6ED9EBA1, SHA1_W, 30);
+        SHA1_ROUNDS5(SHA1_F1, 0x6ED9EBA1, SHA1_W, 35);
+
+        SHA1_ROUNDS5(SHA1_F2, 0x8F1BBCDC, SHA1_W, 40);
+        SHA1_ROUNDS5(SHA1_F2, 0x8F1BBCDC, SHA1_W, 45);
+        SHA1_ROUNDS5(SHA1_F2, 0x8F1BBCDC, SHA1_W, 50);
+        SHA1_ROUNDS5(SHA1_F2, 0x8F1BBCDC, SHA1_W, 55);
+
+        SHA1_ROUNDS5(SHA1_F1, 0xCA62C1D6, SHA1_W, 60);
+        SHA1_ROUNDS5(SHA1_F1, 0xCA62C1D6, SHA1_W, 65);
+        SHA1_ROUNDS5(SHA1_F1, 0xCA62C1D6, SHA1_W, 70);
+        SHA1_ROUNDS5(SHA1_F1, 0xCA62C1D6, SHA1_W, 75);
+
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+        state[4] += e;
+    }
+}
+
+#ifdef SHA_NI
+
+// Rounds 4*g to 4*g+3 of the sha extensions schedule: e_in holds the e of these rounds, e_out gets the a of
+// the state entering them, for the next group. m is the message of these rounds, m1..m3 the following ones.
+#define SHANI_ROUNDS4(e_in, e_out, m, m1, m2, m3, f) \
+    e_in = _mm_sha1nexte_epu32(e_in, m); \
+    e_out = abcd; \
+    m1 = _mm_sha1msg2_epu32(m1, m); \
+    abcd = _mm_sha1rnds4_epu32(abcd, e_in, f); \
+    m3 = _mm_sha1msg1_epu32(m3, m); \
+    m2 = _mm_xor_si128(m2, m);
+
+TARGET_SHANI static void Sha1CompressShaNi(uint32_t *state, const uint8_t *data, size_t num_blocks)
 {
-    SHA1_CTX ctx;
+    const __m128i mask = _mm_set_epi64x(0x0001020304050607ULL, 0x08090A0B0C0D0E0FULL);
+    __m128i abcd, e0, e1, abcd_save, e0_save;
+    __m128i m0, m1, m2, m3;
+
+    abcd = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)state), 0x1B);
+    e0 = _mm_set_epi32((int)state[4], 0, 0, 0);
 
-    __SHA1_Init(&ctx);
-    __SHA1_Update(&ctx, (const uint8_t *)buf, size);
-    __SHA1_Final(&ctx, result);
+    for (; num_blocks > 0; num_blocks--, data += 64)
+    {
+        abcd_save = abcd;
+        e0_save = e0;
+
+        // Rounds 0-15 load the message
+        m0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)data), mask);
+        e0 = _mm_add_epi32(e0, m0);
+        e1 = abcd;
+        abcd = _mm_sha1rnds4_epu32(abcd, e0, 0);
+
+        m1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(data+16)), mask);
+        e1 = _mm_sha1nexte_epu32(e1, m1);
+        e0 = abcd;
+        abcd = _mm_sha1rnds4_epu32(abcd, e1, 0);
+        m0 = _mm_sha1msg1_epu32(m0, m1);
+
+        m2 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(data+32)), mask);
+        e0 = _mm_sha1nexte_epu32(e0, m2);
+        e1 = abcd;
+        abcd = _mm_sha1rnds4_epu32(abcd, e0, 0);
+        m1 = _mm_sha1msg1_epu32(m1, m2);
+        m0 = _mm_xor_si128(m0, m2);
+
+        m3 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(data+48)), mask);
+        SHANI_ROUNDS4(e1, e0, m3, m0, m1, m2, 0);
+
+        // Rounds 16-63
+        SHANI_ROUNDS4(e0, e1, m0, m1, m2, m3, 0);
+        SHANI_ROUNDS4(e1, e0, m1, m2, m3, m0, 1);
+        SHANI_ROUNDS4(e0, e1, m2, m3, m0, m1, 1);
+        SHANI_ROUNDS4(e1, e0, m3, m0, m1, m2, 1);
+        SHANI_ROUNDS4(e0, e1, m0, m1, m2, m3, 1);
+        SHANI_ROUNDS4(e1, e0, m1, m2, m3, m0, 1);
+        SHANI_ROUNDS4(e0, e1, m2, m3, m0, m1, 2);
+        SHANI_ROUNDS4(e1, e0, m3, m0, m1, m2, 2);
+        SHANI_ROUNDS4(e0, e1, m0, m1, m2, m3, 2);
+        SHANI_ROUNDS4(e1, e0, m1, m2, m3, m0, 2);
+        SHANI_ROUNDS4(e0, e1, m2, m3, m0, m1, 2);
+        SHANI_ROUNDS4(e1, e0, m3, m0, m1, m2, 3);
+
+        // Rounds 64-79, the message schedule winds down
+        e0 = _mm_sha1nexte_epu32(e0, m0);
+        e1 = abcd;
+        m1 = _mm_sha1msg2_epu32(m1, m0);
+        abcd = _mm_sha1rnds4_epu32(abcd, e0, 3);
+        m3 = _mm_sha1msg1_epu32(m3, m0);
+        m2 = _mm_xor_si128(m2, m0);
+
+        e1 = _mm_sha1nexte_epu32(e1, m1);
+        e0 = abcd;
+        m2 = _mm_sha1msg2_epu32(m2, m1);
+        abcd = _mm_sha1rnds4_epu32(abcd, e1, 3);
+        m3 = _mm_xor_si128(m3, m1);
+
+        e0 = _mm_sha1nexte_epu32(e0, m2);
+        e1 = abcd;
+        m3 = _mm_sha1msg2_epu32(m3, m2);
+        abcd = _mm_sha1rnds4_epu32(abcd, e0, 3);
+
+        e1 = _mm_sha1nexte_epu32(e1, m3);
+        e0 = abcd;
+        abcd = _mm_sha1rnds4_epu32(abcd, e1, 3);
+
+        e0 = _mm_sha1nexte_epu32(e0, e0_save);
+        abcd = _mm_add_epi32(abcd, abcd_save);
+    }
+
+    _mm_storeu_si128((__m128i *)state, _mm_shuffle_epi32(abcd, 0x1B));
+    state[4] = (uint32_t)_mm_extract_epi32(e0, 3);
 }
 
-void Utils::Md5(const void *buf, uint32_t size, uint8_t *result)
+#endif // SHA_NI
+
+static void Sha1Compress(uint32_t *state, const uint8_t *data, size_t num_blocks)
 {
-    MD5_CTX ctx;
+#ifdef SHA_NI
+    if (Utils::CpuHasShaNi())
+    {
+        Sha1CompressShaNi(state, data, num_blocks);
+        return;
+    }
+#endif
 
-    __MD5_Init(&ctx);
-    __MD5_Update(&ctx, buf, size);
-    __MD5_Final(result, &ctx);
+    Sha1CompressPortable(state, data, num_blocks);
 }
 
-bool Utils::FileSha1(const std::string &path, uint8_t *result)
+void Utils::Sha1Hasher::Reset()
 {
-    size_t remaining;
-    FILE *in;
-    SHA1_CTX ctx;
+    memcpy(state, sha1_iv, sizeof(state));
+    length = 0;
+}
 
-    remaining = GetFileSize(path);
-    if (remaining == (size_t)-1)
-        return false;
+void Utils::Sha1Hasher::Update(const void *buf, size_t size)
+{
+    const uint8_t *data = (const uint8_t *)buf;
+    size_t used = (size_t)(length & 63);
 
-    __SHA1_Init(&ctx);
+    length += size;
 
-    if (remaining == 0) // Special case, 0 bytes file
+    if (used != 0)
     {
-        __SHA1_Final(&ctx, result);
-        return true;
+        size_t n = 64 - used;
+
+        if (size < n)
+        {
+            memcpy(buffer+used, data, size);
+            return;
+        }
+
+        memcpy(buffer+used, data, n);
+        Sha1Compress(state, buffer, 1);
+        data += n;
+        size -= n;
     }
 
-    in = fopen(path.c_str(), "rb");
-    if (!in)
-        return false;
+    if (size >= 64)
+    {
+        Sha1Compress(state, data, size / 64);
+        data += size & ~(size_t)63;
+        size &= 63;
+    }
 
-    size_t buf_size = (remaining < FILE_BUFFER_SIZE) ? remaining : FILE_BUFFER_SIZE;
-    uint8_t *buf;
+    if (size != 0)
+        memcpy(buffer, data, size);
+}
 
-    buf = new uint8_t[buf_size];
+void Utils::Sha1Hasher::Final(uint8_t *result)
+{
+    size_t used = (size_t)(length & 63);
+    uint64_t bits = BE64(length << 3);
 
-    while (remaining > 0)
+    buffer[used++] = 0x80;
+
+    if (used > 56)
     {
-        size_t r = (remaining < buf_size) ? remaining : buf_size;
+        memset(buffer+used, 0, 64-used);
+        Sha1Compress(state, buffer, 1);
+        used = 0;
+    }
 
-        if (fread(buf, 1, r, in) != r)
+    memset(buffer+used, 0, 56-used);
+    memcpy(buffer+56, &bits, sizeof(bits));
+    Sha1Compress(state, buffer, 1);
+
+    for (int i = 0; i < 5; i++)
+    {
+        uint32_t w = BE32(state[i]);
+        memcpy(result + i*4, &w, sizeof(w));
+    }
+}
+
+void Utils::Md5Hasher::Reset()
+{
+    static_assert(sizeof(MD5_CTX) <= sizeof(ctx) && alignof(MD5_CTX) <= 8, "Md5Hasher::ctx is too small for MD5_CTX.");
+    __MD5_Init((MD5_CTX *)ctx);
+}
+
+void Utils::Md5Hasher::Update(const void *buf, size_t size)
+{
+    const uint8_t *data = (const uint8_t *)buf;
+
+    // unsigned long is 32 bits in Windows
+    while (size > 0)
+    {
+        size_t n = (size > 0x40000000) ? 0x40000000 : size;
+
+        __MD5_Update((MD5_CTX *)ctx, data, (unsigned long)n);
+        data += n;
+        size -= n;
+    }
+}
+
+void Utils::Md5Hasher::Final(uint8_t *result)
+{
+    __MD5_Final(result, (MD5_CTX *)ctx);
+}
+
+void Utils::Sha1(const void *buf, size_t size, uint8_t *result)
+{
+    Sha1Hasher hasher;
+
+    hasher.Update(buf, size);
+    hasher.Final(result);
+}
+
+void Utils::Md5(const void *buf, size_t size, uint8_t *result)
+{
+    Md5Hasher hasher;
+
+    hasher.Update(buf, size);
+    hasher.Final(result);
+}
+
+#ifdef SHA_AVX2
+
+// Eight independent SHA1 in the 32 bits lanes of ymm registers
+#define SHA1_LANES  8
+
+struct Sha1Lane
+{
+    const uint8_t *data;
+    size_t full_size; // Bytes hashed straight from data, a multiple of 64
+    size_t total; // full_size + tail_size
+    size_t pos;
+    size_t index;
+    uint8_t tail[128]; // Last partial block of data plus the padding
+};
+
+static void Sha1LaneStart(Sha1Lane &lane, const uint8_t *data, size_t size, size_t index)
+{
+    size_t rem = size & 63;
+    size_t tail_size = (rem < 56) ? 64 : 128;
+    uint64_t bits = BE64((uint64_t)size << 3);
+
+    lane.data = data;
+    lane.full_size = size - rem;
+    lane.total = lane.full_size + tail_size;
+    lane.pos = 0;
+    lane.index = index;
+
+    memcpy(lane.tail, data + lane.full_size, rem);
+    lane.tail[rem] = 0x80;
+    memset(lane.tail+rem+1, 0, tail_size-rem-1-8);
+    memcpy(lane.tail+tail_size-8, &bits, sizeof(bits));
+}
+
+static inline const uint8_t *Sha1LaneBlock(const Sha1Lane &lane)
+{
+    if (lane.pos < lane.full_size)
+        return lane.data + lane.pos;
+
+    return lane.tail + (lane.pos - lane.full_size);
+}
+
+// 8x8 transpose of 32 bits elements
+TARGET_AVX2 static inline void Transpose8x8(__m256i *r)
+{
+    __m256i t0 = _mm256_unpacklo_epi32(r[0], r[1]);
+    __m256i t1 = _mm256_unpackhi_epi32(r[0], r[1]);
+    __m256i t2 = _mm256_unpacklo_epi32(r[2], r[3]);
+    __m256i t3 = _mm256_unpackhi_epi32(r[2], r[3]);
+    __m256i t4 = _mm256_unpacklo_epi32(r[4], r[5]);
+    __m256i t5 = _mm256_unpackhi_epi32(r[4], r[5]);
+    __m256i t6 = _mm256_unpacklo_epi32(r[6], r[7]);
+    __m256i t7 = _mm256_unpackhi_epi32(r[6], r[7]);
+
+    __m256i u0 = _mm256_unpacklo_epi64(t0, t2);
+    __m256i u1 = _mm256_unpackhi_epi64(t0, t2);
+    __m256i u2 = _mm256_unpacklo_epi64(t1, t3);
+    __m256i u3 = _mm256_unpackhi_epi64(t1, t3);
+    __m256i u4 = _mm256_unpacklo_epi64(t4, t6);
+    __m256i u5 = _mm256_unpackhi_epi64(t4, t6);
+    __m256i u6 = _mm256_unpacklo_epi64(t5, t7);
+    __m256i u7 = _mm256_unpackhi_epi64(t5, t7);
+
+    r[0] = _mm256_permute2x128_si256(u0, u4, 0x20);
+    r[1] = _mm256_permute2x128_si256(u1, u5, 0x20);
+    r[2] = _mm256_permute2x128_si256(u2, u6, 0x20);
+    r[3] = _mm256_permute2x128_si256(u3, u7, 0x20);
+    r[4] = _mm256_permute2x128_si256(u0, u4, 0x31);
+    r[5] = _mm256_permute2x128_si256(u1, u5, 0x31);
+    r[6] = _mm256_permute2x128_si256(u2, u6, 0x31);
+    r[7] = _mm256_permute2x128_si256(u3, u7, 0x31);
+}
+
+#define SHA1X8_ROL(x, n) _mm256_or_si256(_mm256_slli_epi32(x, n), _mm256_srli_epi32(x, 32-(n)))
+
+// state is [5][SHA1_LANES], one block of each lane
+TARGET_AVX2 static void Sha1CompressAvx2(uint32_t *state, const uint8_t * const *blocks)
+{
+    const __m256i bswap = _mm256_set_epi8(12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3,
+                                          12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3);
+    __m256i w[16];
+
+    for (int half = 0; half < 2; half++)
+    {
+        __m256i *r = w + half*8;
+
+        for (int l = 0; l < SHA1_LANES; l++)
+            r[l] = _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i *)(blocks[l] + half*32)), bswap);
+
+        Transpose8x8(r);
+    }
+
+    __m256i a = _mm256_loadu_si256((const __m256i *)(state));
+    __m256i b = _mm256_loadu_si256((const __m256i *)(state + SHA1_LANES));
+    __m256i c = _mm256_loadu_si256((const __m256i *)(state + SHA1_LANES*2));
+    __m256i d = _mm256_loadu_si256((const __m256i *)(state + SHA1_LANES*3));
+    __m256i e = _mm256_loadu_si256((const __m256i *)(state + SHA1_LANES*4));
+    __m256i a0 = a, b0 = b, c0 = c, d0 = d, e0 = e;
+
+    for (int i = 0; i < 80; i++)
+    {
+        __m256i f, k, wi;
+
+        if (i < 16)
         {
-            fclose(in);
-            delete[] buf;
-            return false;
+            wi = w[i];
+        }
+        else
+        {
+            __m256i x = _mm256_xor_si256(_mm256_xor_si256(w[(i-3)&15], w[(i-8)&15]), _mm256_xor_si256(w[(i-14)&15], w[i&15]));
+            wi = w[i&15] = SHA1X8_ROL(x, 1);
         }
 
-        __SHA1_Update(&ctx, buf, (uint32_t)r);
-        remaining -= r;
+        if (i < 20)
+        {
+            f = _mm256_xor_si256(d, _mm256_and_si256(b, _mm256_xor_si256(c, d)));
+            k = _mm256_set1_epi32(0x5A827999);
+        }
+        else if (i < 40)
+        {
+            f = _mm256_xor_si256(_mm256_xor_si256(b, c), d);
+            k = _mm256_set1_epi32(0x6ED9EBA1);
+        }
+        else if (i < 60)
+        {
+            f = _mm256_or_si256(_mm256_and_si256(b, c), _mm256_and_si256(d, _mm256_or_si256(b, c)));
+            k = _mm256_set1_epi32((int)0x8F1BBCDC);
+        }
+        else
+        {
+            f = _mm256_xor_si256(_mm256_xor_si256(b, c), d);
+            k = _mm256_set1_epi32((int)0xCA62C1D6);
+        }
+
+        __m256i t = _mm256_add_epi32(_mm256_add_epi32(SHA1X8_ROL(a, 5), f), _mm256_add_epi32(_mm256_add_epi32(e, k), wi));
+        e = d;
+        d = c;
+        c = SHA1X8_ROL(b, 30);
+        b = a;
+        a = t;
     }
 
-    fclose(in);
-    __SHA1_Final(&ctx, result);
+    _mm256_storeu_si256((__m256i *)(state), _mm256_add_epi32(a, a0));
+    _mm256_storeu_si256((__m256i *)(state + SHA1_LANES), _mm256_add_epi32(b, b0));
+    _mm256_storeu_si256((__m256i *)(state + SHA1_LANES*2), _mm256_add_epi32(c, c0));
+    _mm256_storeu_si256((__m256i *)(state + SHA1_LANES*3), _mm256_add_epi32(d, d0));
+    _mm256_storeu_si256((__m256i *)(state + SHA1_LANES*4), _mm256_add_epi32(e, e0));
+}
 
-    return true;
+static void Sha1LaneResult(const uint32_t *state, int l, uint8_t *result)
+{
+    for (int i = 0; i < 5; i++)
+    {
+        uint32_t w = BE32(state[i*SHA1_LANES + l]);
+        memcpy(result + i*4, &w, sizeof(w));
+    }
 }
 
-bool Utils::FileMd5(const std::string &path, uint8_t *result)
+static void Sha1MultiAvx2(const void * const *bufs, const size_t *sizes, size_t count, uint8_t *results)
+{
+    static const uint8_t zero_block[64] = { 0 };
+    Sha1Lane lanes[SHA1_LANES];
+    bool active[SHA1_LANES];
+    uint32_t state[5*SHA1_LANES];
+    const uint8_t *blocks[SHA1_LANES];
+    size_t next = 0;
+    int num_active = 0;
+
+    for (int l = 0; l < SHA1_LANES; l++)
+    {
+        active[l] = (next < count);
+
+        if (active[l])
+        {
+            Sha1LaneStart(lanes[l], (const uint8_t *)bufs[next], sizes[next], next);
+            next++;
+            num_active++;
+        }
+
+        for (int i = 0; i < 5; i++)
+            state[i*SHA1_LANES + l] = sha1_iv[i];
+    }
+
+    // With only a few lanes busy and nothing left to feed them, the single buffer code is faster
+    while (num_active > SHA1_LANES/2 || (num_active > 0 && next < count))
+    {
+        for (int l = 0; l < SHA1_LANES; l++)
+            blocks[l] = (active[l]) ? Sha1LaneBlock(lanes[l]) : zero_block;
+
+        Sha1CompressAvx2(state, blocks);
+
+        for (int l = 0; l < SHA1_LANES; l++)
+        {
+            if (!active[l])
+                continue;
+
+            Sha1Lane &lane = lanes[l];
+
+            lane.pos += 64;
+            if (lane.pos != lane.total)
+                continue;
+
+            Sha1LaneResult(state, l, results + lane.index*20);
+
+            for (int i = 0; i < 5; i++)
+                state[i*SHA1_LANES + l] = sha1_iv[i];
+
+            if (next < count)
+            {
+                Sha1LaneStart(lane, (const uint8_t *)bufs[next], sizes[next], next);
+                next++;
+            }
+            else
+            {
+                active[l] = false;
+                num_active--;
+            }
+        }
+    }
+
+    for (int l = 0; l < SHA1_LANES; l++)
+    {
+        if (!active[l])
+            continue;
+
+        Sha1Lane &lane = lanes[l];
+        uint32_t st[5];
+
+        for (int i = 0; i < 5; i++)
+            st[i] = state[i*SHA1_LANES + l];
+
+        if (lane.pos < lane.full_size)
+        {
+            Sha1CompressPortable(st, lane.data + lane.pos, (lane.full_size - lane.pos) / 64);
+            lane.pos = lane.full_size;
+        }
+
+        Sha1CompressPortable(st, lane.tail + (lane.pos - lane.full_size), (lane.total - lane.pos) / 64);
+
+        for (int i = 0; i < 5; i++)
+            state[i*SHA1_LANES + l] = st[i];
+
+        Sha1LaneResult(state, l, results + lane.index*20);
+    }
+}
+
+#endif // SHA_AVX2
+
+void Utils::Sha1Multi(const void * const *bufs, const size_t *sizes, size_t count, uint8_t *results)
+{
+#ifdef SHA_AVX2
+    // The sha extensions do a single buffer faster than avx2 does eight
+    if (count > 1 && !CpuHasShaNi() && CpuHasAvx2())
+    {
+        Sha1MultiAvx2(bufs, sizes, count, results);
+        return;
+    }
+#endif
+
+    for (size_t i = 0; i < count; i++)
+        Sha1(bufs[i], sizes[i], results + i*20);
+}
+
+template <typename H>
+static bool HashFile(const std::string &path, H &hasher)
 {
     size_t remaining;
     FILE *in;
-    MD5_CTX ctx;
 
-    remaining = GetFileSize(path);
+    remaining = Utils::GetFileSize(path);
     if (remaining == (size_t)-1)
         return false;
 
-    __MD5_Init(&ctx);
-
     if (remaining == 0) // Special case, 0 bytes file
+        return true;
+
+    uint8_t *map = Utils::MapFile(path, &remaining, false);
+    if (map)
     {
-        __MD5_Final(result, &ctx);
+        hasher.Update(map, remaining);
+        Utils::UnmapFile(map, remaining);
         return true;
     }
 
@@ -155,64 +695,300 @@ bool Utils::FileMd5(const std::string &path, uint8_t *result)
             return false;
         }
 
-        __MD5_Update(&ctx, buf, (unsigned long)r);
+        hasher.Update(buf, r);
         remaining -= r;
     }
 
     fclose(in);
-    __MD5_Final(result, &ctx);
+    delete[] buf;
 
     return true;
 }
 
-void Utils::AesEcbDecrypt(void *buf, size_t size, const uint8_t *key, int key_size)
+bool Utils::FileSha1(const std::string &path, uint8_t *result)
 {
-    if (key_size != 256 && key_size != 128 && key_size != 192)
+    Sha1Hasher hasher;
+
+    if (!HashFile(path, hasher))
+        return false;
+
+    hasher.Final(result);
+    return true;
+}
+
+bool Utils::FileMd5(const std::string &path, uint8_t *result)
+{
+    Md5Hasher hasher;
+
+    if (!HashFile(path, hasher))
+        return false;
+
+    hasher.Final(result);
+    return true;
+}
+
+// Blocks per call to AesCryptBlocks in the chained modes. The kernels keep 8 of them in flight.
+#define AES_CHUNK_BLOCKS    32
+
+struct AesContext
+{
+    int nrounds;
+    bool decrypt;
+    uint32_t rk[RKLENGTH(256)]; // rijndael.c schedule, for the portable path
+
+#ifdef AES_NI
+    bool use_ni;
+    bool use_vaes;
+    // In aesenc/aesdec order. For decryption, the keys of the equivalent inverse cipher.
+    __m128i round_keys[NROUNDS(256)+1];
+#endif
+};
+
+#ifdef AES_NI
+
+TARGET_AESNI static void AesNiSetup(AesContext &ctx, const uint32_t *erk)
+{
+    // rijndael.c stores the words of the schedule as big endian numbers
+    for (int r = 0; r <= ctx.nrounds; r++)
+    {
+        uint8_t bytes[16];
+
+        for (int i = 0; i < 4; i++)
+        {
+            uint32_t w = erk[r*4+i];
+
+            bytes[i*4] = (uint8_t)(w >> 24);
+            bytes[i*4+1] = (uint8_t)(w >> 16);
+            bytes[i*4+2] = (uint8_t)(w >> 8);
+            bytes[i*4+3] = (uint8_t)w;
+        }
+
+        ctx.round_keys[r] = _mm_loadu_si128((const __m128i *)bytes);
+    }
+
+    if (!ctx.decrypt)
         return;
 
-    uint32_t rk[RKLENGTH(256)]; // Max size
-    static const size_t block_size = 16;
+    __m128i ek[NROUNDS(256)+1];
+    memcpy(ek, ctx.round_keys, sizeof(ek));
 
-    int nrounds = rijndaelSetupDecrypt(rk, key, key_size);
-    size_t num_blocks = size / block_size;
-    uint8_t *ptr = (uint8_t *)buf;
-    bool last_pass = false;
+    ctx.round_keys[0] = ek[ctx.nrounds];
 
-    if ((size % block_size) != 0)
+    for (int r = 1; r < ctx.nrounds; r++)
+        ctx.round_keys[r] = _mm_aesimc_si128(ek[ctx.nrounds-r]);
+
+    ctx.round_keys[ctx.nrounds] = ek[0];
+}
+
+#define AESNI_ROUNDS8(op, last) \
+    for (int r = 1; r < nrounds; r++) \
+    { \
+        const __m128i k = rk[r]; \
+        b0 = op(b0, k); b1 = op(b1, k); b2 = op(b2, k); b3 = op(b3, k); \
+        b4 = op(b4, k); b5 = op(b5, k); b6 = op(b6, k); b7 = op(b7, k); \
+    } \
+    { \
+        const __m128i k = rk[nrounds]; \
+        b0 = last(b0, k); b1 = last(b1, k); b2 = last(b2, k); b3 = last(b3, k); \
+        b4 = last(b4, k); b5 = last(b5, k); b6 = last(b6, k); b7 = last(b7, k); \
+    }
+
+TARGET_AESNI static void AesNiCryptBlocks(const AesContext &ctx, uint8_t *p, size_t num_blocks)
+{
+    const __m128i *rk = ctx.round_keys;
+    const int nrounds = ctx.nrounds;
+    size_t i = 0;
+
+    // Eight independent blocks hide the latency of aesenc/aesdec
+    for (; i + 8 <= num_blocks; i += 8)
     {
-        num_blocks++;
-        last_pass = true;
+        __m128i *q = (__m128i *)(p + i*16);
+        __m128i b0 = _mm_xor_si128(_mm_loadu_si128(q), rk[0]);
+        __m128i b1 = _mm_xor_si128(_mm_loadu_si128(q+1), rk[0]);
+        __m128i b2 = _mm_xor_si128(_mm_loadu_si128(q+2), rk[0]);
+        __m128i b3 = _mm_xor_si128(_mm_loadu_si128(q+3), rk[0]);
+        __m128i b4 = _mm_xor_si128(_mm_loadu_si128(q+4), rk[0]);
+        __m128i b5 = _mm_xor_si128(_mm_loadu_si128(q+5), rk[0]);
+        __m128i b6 = _mm_xor_si128(_mm_loadu_si128(q+6), rk[0]);
+        __m128i b7 = _mm_xor_si128(_mm_loadu_si128(q+7), rk[0]);
+
+        if (ctx.decrypt)
+        {
+            AESNI_ROUNDS8(_mm_aesdec_si128, _mm_aesdeclast_si128)
+        }
+        else
+        {
+            AESNI_ROUNDS8(_mm_aesenc_si128, _mm_aesenclast_si128)
+        }
+
+        _mm_storeu_si128(q, b0); _mm_storeu_si128(q+1, b1);
+        _mm_storeu_si128(q+2, b2); _mm_storeu_si128(q+3, b3);
+        _mm_storeu_si128(q+4, b4); _mm_storeu_si128(q+5, b5);
+        _mm_storeu_si128(q+6, b6); _mm_storeu_si128(q+7, b7);
     }
 
-    for (size_t i = 0; i < num_blocks; i++)
+    for (; i < num_blocks; i++)
     {
-        if ( (i == (num_blocks-1)) && last_pass )
+        __m128i *q = (__m128i *)(p + i*16);
+        __m128i b = _mm_xor_si128(_mm_loadu_si128(q), rk[0]);
+
+        if (ctx.decrypt)
         {
-            uint8_t temp[block_size];
-            rijndaelDecrypt(rk, nrounds, ptr, temp);
+            for (int r = 1; r < nrounds; r++)
+                b = _mm_aesdec_si128(b, rk[r]);
 
-            memcpy(ptr, temp, size % block_size);
+            b = _mm_aesdeclast_si128(b, rk[nrounds]);
         }
         else
         {
-            rijndaelDecrypt(rk, nrounds, ptr, ptr);
+            for (int r = 1; r < nrounds; r++)
+                b = _mm_aesenc_si128(b, rk[r]);
+
+            b = _mm_aesenclast_si128(b, rk[nrounds]);
         }
 
-        ptr += block_size;
+        _mm_storeu_si128(q, b);
     }
 }
 
-void Utils::AesEcbEncrypt(void *buf, size_t size, const uint8_t *key, int key_size)
+#ifdef AES_VAES
+
+#define VAES_ROUNDS4(op, last) \
+    for (int r = 1; r < nrounds; r++) \
+    { \
+        const __m256i k = _mm256_broadcastsi128_si256(rk[r]); \
+        b0 = op(b0, k); b1 = op(b1, k); b2 = op(b2, k); b3 = op(b3, k); \
+    } \
+    { \
+        const __m256i k = _mm256_broadcastsi128_si256(rk[nrounds]); \
+        b0 = last(b0, k); b1 = last(b1, k); b2 = last(b2, k); b3 = last(b3, k); \
+    }
+
+TARGET_VAES static void VaesCryptBlocks(const AesContext &ctx, uint8_t *p, size_t num_blocks)
+{
+    const __m128i *rk = ctx.round_keys;
+    const int nrounds = ctx.nrounds;
+    const __m256i k0 = _mm256_broadcastsi128_si256(rk[0]);
+    size_t i = 0;
+
+    // Two blocks per register, eight in flight
+    for (; i + 8 <= num_blocks; i += 8)
+    {
+        __m256i *q = (__m256i *)(p + i*16);
+        __m256i b0 = _mm256_xor_si256(_mm256_loadu_si256(q), k0);
+        __m256i b1 = _mm256_xor_si256(_mm256_loadu_si256(q+1), k0);
+        __m256i b2 = _mm256_xor_si256(_mm256_loadu_si256(q+2), k0);
+        __m256i b3 = _mm256_xor_si256(_mm256_loadu_si256(q+3), k0);
+
+        if (ctx.decrypt)
+        {
+            VAES_ROUNDS4(_mm256_aesdec_epi128, _mm256_aesdeclast_epi128)
+        }
+        else
+        {
+            VAES_ROUNDS4(_mm256_aesenc_epi128, _mm256_aesenclast_epi128)
+        }
+
+        _mm256_storeu_si256(q, b0); _mm256_storeu_si256(q+1, b1);
+        _mm256_storeu_si256(q+2, b2); _mm256_storeu_si256(q+3, b3);
+    }
+
+    _mm256_zeroupper();
+
+    if (i < num_blocks)
+        AesNiCryptBlocks(ctx, p + i*16, num_blocks - i);
+}
+
+#endif // AES_VAES
+
+#endif // AES_NI
+
+static bool AesSetup(AesContext &ctx, const uint8_t *key, int key_size, bool decrypt)
 {
     if (key_size != 256 && key_size != 128 && key_size != 192)
+        return false;
+
+    ctx.decrypt = decrypt;
+
+#ifdef AES_NI
+    ctx.use_ni = Utils::CpuHasAesNi();
+#ifdef AES_VAES
+    ctx.use_vaes = ctx.use_ni && Utils::CpuHasVaes();
+#else
+    ctx.use_vaes = false;
+#endif
+
+    if (ctx.use_ni)
+    {
+        // AES-NI derives the decryption keys from the encryption schedule
+        ctx.nrounds = rijndaelSetupEncrypt(ctx.rk, key, key_size);
+        AesNiSetup(ctx, ctx.rk);
+        return true;
+    }
+#endif
+
+    ctx.nrounds = (decrypt) ? rijndaelSetupDecrypt(ctx.rk, key, key_size) : rijndaelSetupEncrypt(ctx.rk, key, key_size);
+    return true;
+}
+
+// Encrypts or decrypts, as set up, num_blocks whole blocks in place
+static void AesCryptBlocks(const AesContext &ctx, uint8_t *p, size_t num_blocks)
+{
+#ifdef AES_NI
+#ifdef AES_VAES
+    if (ctx.use_vaes)
+    {
+        VaesCryptBlocks(ctx, p, num_blocks);
+        return;
+    }
+#endif
+
+    if (ctx.use_ni)
+    {
+        AesNiCryptBlocks(ctx, p, num_blocks);
         return;
+    }
+#endif
+
+    for (size_t i = 0; i < num_blocks; i++, p += 16)
+    {
+        if (ctx.decrypt)
+            rijndaelDecrypt(ctx.rk, ctx.nrounds, p, p);
+        else
+            rijndaelEncrypt(ctx.rk, ctx.nrounds, p, p);
+    }
+}
 
-    uint32_t rk[RKLENGTH(256)]; // Max size
+void Utils::AesEcbDecrypt(void *buf, size_t size, const uint8_t *key, int key_size)
+{
     static const size_t block_size = 16;
+    AesContext ctx;
+
+    if (!AesSetup(ctx, key, key_size, true))
+        return;
 
-    int nrounds = rijndaelSetupEncrypt(rk, key, key_size);
-    size_t num_blocks = size / block_size;
     uint8_t *ptr = (uint8_t *)buf;
+    size_t num_blocks = size / block_size;
+    size_t remaining = size % block_size;
+
+    AesCryptBlocks(ctx, ptr, num_blocks);
+
+    if (remaining != 0)
+    {
+        // A partial last block is decrypted as if it was padded with zeroes, only the bytes in the buffer are kept
+        uint8_t temp[block_size];
+
+        memset(temp, 0, block_size);
+        memcpy(temp, ptr + num_blocks*block_size, remaining);
+        AesCryptBlocks(ctx, temp, 1);
+        memcpy(ptr + num_blocks*block_size, temp, remaining);
+    }
+}
+
+void Utils::AesEcbEncrypt(void *buf, size_t size, const uint8_t *key, int key_size)
+{
+    static const size_t block_size = 16;
+    AesContext ctx;
 
     if ((size % block_size) != 0)
     {
@@ -220,83 +996,107 @@ void Utils::AesEcbEncrypt(void *buf, size_t size, const uint8_t *key, int key_si
         return;
     }
 
-    for (size_t i = 0; i < num_blocks; i++)
-    {
-        rijndaelEncrypt(rk, nrounds, ptr, ptr);
-        ptr += block_size;
-    }
+    if (!AesSetup(ctx, key, key_size, false))
+        return;
+
+    AesCryptBlocks(ctx, (uint8_t *)buf, size / block_size);
 }
 
 void Utils::AesCtrEncrypt(void *buf, size_t size, const uint8_t *key, int key_size, const uint8_t *iv)
 {
     static const size_t block_size = 16;
+    AesContext ctx;
+
+    if (!AesSetup(ctx, key, key_size, false))
+        return;
 
-    uint8_t ctr[block_size];
     uint8_t *inout = (uint8_t *)buf;
     size_t nblocks = size / block_size;
+    size_t tail = size & (block_size-1);
 
-    memcpy(ctr, iv, block_size);
+    // The counter is the iv as a 128 bits big endian number
+    uint64_t ctr_hi = 0, ctr_lo = 0;
 
-    for (size_t i = 0; i < nblocks; i++)
+    for (size_t i = 0; i < 8; i++)
     {
-        uint8_t temp[block_size];
-        size_t xor_size;
+        ctr_hi = (ctr_hi << 8) | iv[i];
+        ctr_lo = (ctr_lo << 8) | iv[i+8];
+    }
 
-        memcpy(temp, ctr, block_size);
-        Utils::AesEcbEncrypt(temp, block_size, key, key_size);
+    uint8_t keystream[AES_CHUNK_BLOCKS*block_size];
 
-        if (i == (nblocks-1) && (size&(block_size-1)))
-        {
-            xor_size = size&(block_size-1);
-        }
-        else
-        {
-            xor_size = block_size;
-        }
+    for (size_t i = 0; i < nblocks; )
+    {
+        size_t n = nblocks - i;
+        if (n > AES_CHUNK_BLOCKS)
+            n = AES_CHUNK_BLOCKS;
 
-        for (size_t j = 0; j < xor_size; j++)
+        for (size_t j = 0; j < n; j++)
         {
-            inout[i*block_size+j] ^= temp[j];
-        }
+            uint64_t be_hi = BE64(ctr_hi);
+            uint64_t be_lo = BE64(ctr_lo);
 
-        if (i != (nblocks-1))
-        {
-            for (int k = block_size-1, carry = 1; k >= 0 && carry; k--)
-                carry = !++ctr[k];
+            memcpy(keystream + j*block_size, &be_hi, 8);
+            memcpy(keystream + j*block_size + 8, &be_lo, 8);
+
+            if (++ctr_lo == 0)
+                ctr_hi++;
         }
+
+        AesCryptBlocks(ctx, keystream, n);
+
+        // Like it has always done, a size not multiple of block_size only gets size%block_size bytes of the last
+        // whole block xored, and the bytes after it are left alone
+        size_t xor_size = n*block_size;
+
+        if (tail != 0 && i + n == nblocks)
+            xor_size -= block_size - tail;
+
+        Utils::XorBuf(inout + i*block_size, keystream, xor_size);
+        i += n;
     }
 }
 
 void Utils::AesCbcDecrypt(void *buf, size_t size, const uint8_t *key, int key_size, const uint8_t *iv)
 {
     static const size_t block_size = 16;
+    AesContext ctx;
+
+    if (!AesSetup(ctx, key, key_size, true))
+        return;
 
-    uint8_t xblock[block_size];
     uint8_t *inout = (uint8_t *)buf;
     size_t nblocks = size / block_size;
+    // Previous ciphertext block followed by the ciphertext of the chunk
+    uint8_t cipher[(AES_CHUNK_BLOCKS+1)*block_size];
 
-    memcpy(xblock, iv, block_size);
+    memcpy(cipher, iv, block_size);
 
-    for (size_t i = 0; i < nblocks; i++)
+    // Unlike encryption, every block can be decrypted at the same time, they only need the ciphertext before them
+    for (size_t i = 0; i < nblocks; )
     {
-        uint8_t temp[block_size];
-        uint8_t *cb = inout + i*block_size;
+        size_t n = nblocks - i;
+        if (n > AES_CHUNK_BLOCKS)
+            n = AES_CHUNK_BLOCKS;
 
-        memcpy(temp, cb, block_size);
-        Utils::AesEcbDecrypt(cb, block_size, key, key_size);
+        uint8_t *cb = inout + i*block_size;
 
-        for (size_t j = 0; j < block_size; j++)
-        {
-            cb[j] ^= xblock[j];
-        }
+        memcpy(cipher + block_size, cb, n*block_size);
+        AesCryptBlocks(ctx, cb, n);
+        Utils::XorBuf(cb, cipher, n*block_size);
+        memcpy(cipher, cipher + n*block_size, block_size);
 
-        memcpy(xblock, temp, block_size);
+        i += n;
     }
 }
 
 void Utils::AesCbcEncrypt(void *buf, size_t size, const uint8_t *key, int key_size, const uint8_t *iv)
 {
     static const size_t block_size = 16;
+    AesContext ctx;
+
+    if (!AesSetup(ctx, key, key_size, false))
+        return;
 
     uint8_t xblock[block_size];
     uint8_t *inout = (uint8_t *)buf;
@@ -304,16 +1104,13 @@ void Utils::AesCbcEncrypt(void *buf, size_t size, const uint8_t *key, int key_si
 
     memcpy(xblock, iv, block_size);
 
+    // Each block depends on the previous one, there is nothing to run in parallel
     for (size_t i = 0; i < nblocks; i++)
     {
         uint8_t *cb = inout + i*block_size;
 
-        for (size_t j = 0; j < block_size; j++)
-        {
-            cb[j] ^= xblock[j];
-        }
-
-        Utils::AesEcbEncrypt(cb, block_size, key, key_size);
+        Utils::XorBuf(cb, xblock, block_size);
+        AesCryptBlocks(ctx, cb, 1);
         memcpy(xblock, cb, block_size);
     }
 }
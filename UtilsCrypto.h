@@ -1,15 +1,58 @@
 #ifndef UTILSCRYPTO_H
 #define UTILSCRYPTO_H
 
-#include "Utils.h"
+#include <stdint.h>
+#include <string.h>
+#include <string>
 
 namespace Utils
 {
     std::string Base64Encode(const uint8_t *buf, size_t size, bool add_new_line);
     uint8_t *Base64Decode(const std::string &data, size_t *ret_size);
 
-    void Sha1(const void *buf, uint32_t size, uint8_t *result);
-    void Md5(const void *buf, uint32_t size, uint8_t *result);
+    // Incremental SHA1, for data that comes in pieces or is bigger than memory. Lengths are 64 bits.
+    // Uses the SHA extensions when the cpu has them.
+    class Sha1Hasher
+    {
+    private:
+
+        uint32_t state[5];
+        uint64_t length;
+        uint8_t buffer[64];
+
+    public:
+
+        Sha1Hasher() { Reset(); }
+
+        void Reset();
+        void Update(const void *buf, size_t size);
+        // result gets 20 bytes. Reset before hashing something else.
+        void Final(uint8_t *result);
+    };
+
+    class Md5Hasher
+    {
+    private:
+
+        // Opaque MD5_CTX, so that crypto/md5.h (or openssl) stays out of this header. Size checked in UtilsCrypto.cpp.
+        alignas(8) uint8_t ctx[160];
+
+    public:
+
+        Md5Hasher() { Reset(); }
+
+        void Reset();
+        void Update(const void *buf, size_t size);
+        // result gets 16 bytes. Reset before hashing something else.
+        void Final(uint8_t *result);
+    };
+
+    void Sha1(const void *buf, size_t size, uint8_t *result);
+    void Md5(const void *buf, size_t size, uint8_t *result);
+
+    // SHA1 of count independent buffers, results gets 20 bytes per buffer.
+    // For many small buffers: without SHA extensions, eight of them are hashed at once with AVX2.
+    void Sha1Multi(const void * const *bufs, const size_t *sizes, size_t count, uint8_t *results);
 
     bool FileSha1(const std::string &path, uint8_t *result);
     bool FileMd5(const std::string &path, uint8_t *result);
@@ -30,8 +73,19 @@ namespace Utils
     {
         uint8_t *out8 = (uint8_t *)out;
         const uint8_t *in8 = (const uint8_t *)in;
+        size_t i = 0;
+
+        for (; i + 8 <= size; i += 8)
+        {
+            uint64_t a, b;
+
+            memcpy(&a, out8+i, 8);
+            memcpy(&b, in8+i, 8);
+            a ^= b;
+            memcpy(out8+i, &a, 8);
+        }
 
-        for (size_t i = 0; i < size; i++)
+        for (; i < size; i++)
         {
             out8[i] ^= in8[i];
         }
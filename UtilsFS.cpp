@@ -23,6 +23,10 @@
 
 #else
 
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+
 #define do_mkdir(a, b) mkdir(a, b)
 
 #endif
@@ -198,6 +202,106 @@ uint8_t *Utils::ReadFileFrom(const std::string &path, size_t from, size_t size,
     return buf;
 }
 
+uint8_t *Utils::MapFile(const std::string &path, size_t *psize, bool show_error)
+{
+#ifdef _WIN32
+
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        if (show_error)
+            DPRINTF("Cannot open file \"%s\" for mapping.\n", path.c_str());
+
+        return nullptr;
+    }
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0 || (uint64_t)size.QuadPart > (uint64_t)SIZE_MAX)
+    {
+        if (show_error)
+            DPRINTF("Cannot map file \"%s\" (empty or too big).\n", path.c_str());
+
+        CloseHandle(file);
+        return nullptr;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file);
+
+    if (!mapping)
+    {
+        if (show_error)
+            DPRINTF("CreateFileMapping failed on file \"%s\".\n", path.c_str());
+
+        return nullptr;
+    }
+
+    // The view keeps a reference to the mapping object, so the handle can be closed right away
+    uint8_t *buf = (uint8_t *)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+
+    if (!buf)
+    {
+        if (show_error)
+            DPRINTF("MapViewOfFile failed on file \"%s\".\n", path.c_str());
+
+        return nullptr;
+    }
+
+    *psize = (size_t)size.QuadPart;
+    return buf;
+
+#else
+
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        if (show_error)
+            DPRINTF("Cannot open file \"%s\" for mapping.\n", path.c_str());
+
+        return nullptr;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size == 0)
+    {
+        if (show_error)
+            DPRINTF("Cannot map file \"%s\" (empty or stat failed).\n", path.c_str());
+
+        close(fd);
+        return nullptr;
+    }
+
+    void *buf = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (buf == MAP_FAILED)
+    {
+        if (show_error)
+            DPRINTF("mmap failed on file \"%s\".\n", path.c_str());
+
+        return nullptr;
+    }
+
+    *psize = (size_t)info.st_size;
+    return (uint8_t *)buf;
+
+#endif
+}
+
+void Utils::UnmapFile(uint8_t *buf, size_t size)
+{
+    if (!buf)
+        return;
+
+#ifdef _WIN32
+    UNUSED(size);
+    UnmapViewOfFile(buf);
+#else
+    munmap(buf, size);
+#endif
+}
+
 bool Utils::ReadTextFile(const std::string &path, std::string &text, bool show_error)
 {
     FILE *f = fopen(path.c_str(), "rb");
@@ -21,6 +21,10 @@ namespace Utils
     uint8_t *ReadFile(const std::string &path, size_t *psize, bool show_error=true);
     uint8_t *ReadFileFrom(const std::string &path, size_t from, size_t size, bool show_error=true);
 
+    // Read-only memory mapping of a whole file. Release with UnmapFile, never with delete[]
+    uint8_t *MapFile(const std::string &path, size_t *psize, bool show_error=true);
+    void UnmapFile(uint8_t *buf, size_t size);
+
     bool ReadTextFile(const std::string &path, std::string &text, bool show_error=true);
     bool WriteTextFile(const std::string &path, const std::string &text, bool show_error=true, bool build_path=false);
 
@@ -1,9 +1,26 @@
 #include <ctime>
-#include <codecvt>
-#include <locale>
 
 #include "UtilsMisc.h"
 
+#if (defined(CPU_X86_64) || defined(CPU_X86)) && !defined(_MSC_VER)
+#include <cpuid.h>
+#endif
+
+#ifdef CPU_X86_64
+#include <immintrin.h>
+#define UTF_SIMD
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#define TARGET_SSSE3
+#define TARGET_AVX2
+#else
+#define TARGET_SSSE3    __attribute__((target("ssse3")))
+#define TARGET_AVX2     __attribute__((target("avx2")))
+#endif
+
+#endif
+
 #include "debug.h"
 
 uint32_t Utils::GetUnsigned(const std::string &str, uint32_t default_value)
@@ -205,7 +222,7 @@ float Utils::GetFloat(const std::string &str, float default_value)
 {
     float value;
 
-    if (sscanf(str.c_str(), "%f", &value) != 1)
+    if (CharsToFloat(str.c_str(), &value) == str.c_str())
         return default_value;
 
     return value;
@@ -363,130 +380,585 @@ std::string Utils::GetRandomString(size_t len)
     return s;
 }
 
-#ifdef _MSC_VER
-
-// Don't need this anymore
-static int utf8_to_ucs2(const unsigned char * input, const unsigned char ** end_ptr)
+// Scalar decoder, also the reference for the simd code. Stops at the first invalid or truncated sequence.
+// Returns the number of bytes consumed (len if everything was valid), out_len gets the number of utf-16 units written.
+static size_t utf8_to_utf16_scalar(const uint8_t *s, size_t len, char16_t *out, size_t *out_len)
 {
-    *end_ptr = input;
-    if (input[0] == 0) {
-        return -1;
-    }
-    if (input[0] < 0x80) {
-    // One byte (ASCII) case.
-        * end_ptr = input + 1;
-        return input[0];
-    }
-    if ((input[0] & 0xE0) == 0xE0) {
-    // Three byte case.
-        if (input[1] < 0x80 || input[1] > 0xBF ||
-        input[2] < 0x80 || input[2] > 0xBF) {
-            return -1;
-    }
-        * end_ptr = input + 3;
-        return
-            (input[0] & 0x0F)<<12 |
-            (input[1] & 0x3F)<<6  |
-            (input[2] & 0x3F);
-    }
-    if ((input[0] & 0xC0) == 0xC0) {
-    // Two byte case.
-        if (input[1] < 0x80 || input[1] > 0xBF) {
-            return -1;
+    size_t i = 0, o = 0;
+
+    while (i < len)
+    {
+        uint8_t c = s[i];
+
+        if (c < 0x80)
+        {
+            out[o++] = c;
+            i++;
+        }
+        else if (c >= 0xC2 && c <= 0xDF)
+        {
+            if (i+1 >= len || (s[i+1] & 0xC0) != 0x80)
+                break;
+
+            out[o++] = (char16_t)(((c & 0x1F) << 6) | (s[i+1] & 0x3F));
+            i += 2;
+        }
+        else if (c >= 0xE0 && c <= 0xEF)
+        {
+            if (i+2 >= len || (s[i+1] & 0xC0) != 0x80 || (s[i+2] & 0xC0) != 0x80)
+                break;
+
+            if ((c == 0xE0 && s[i+1] < 0xA0) || (c == 0xED && s[i+1] > 0x9F)) // Overlong, surrogate
+                break;
+
+            out[o++] = (char16_t)(((c & 0x0F) << 12) | ((s[i+1] & 0x3F) << 6) | (s[i+2] & 0x3F));
+            i += 3;
+        }
+        else if (c >= 0xF0 && c <= 0xF4)
+        {
+            if (i+3 >= len || (s[i+1] & 0xC0) != 0x80 || (s[i+2] & 0xC0) != 0x80 || (s[i+3] & 0xC0) != 0x80)
+                break;
+
+            if ((c == 0xF0 && s[i+1] < 0x90) || (c == 0xF4 && s[i+1] > 0x8F)) // Overlong, > 0x10FFFF
+                break;
+
+            uint32_t cp = ((c & 0x07) << 18) | ((s[i+1] & 0x3F) << 12) | ((s[i+2] & 0x3F) << 6) | (s[i+3] & 0x3F);
+            cp -= 0x10000;
+
+            out[o++] = (char16_t)(0xD800 | (cp >> 10));
+            out[o++] = (char16_t)(0xDC00 | (cp & 0x3FF));
+            i += 4;
+        }
+        else
+        {
+            break;
+        }
     }
-        * end_ptr = input + 2;
-        return
-            (input[0] & 0x1F)<<6  |
-            (input[1] & 0x3F);
+
+    *out_len = o;
+    return i;
+}
+
+// Returns the number of units consumed (len if everything was valid). out needs room for 3 bytes per unit.
+static size_t utf16_to_utf8_scalar(const char16_t *s, size_t len, char *out, size_t *out_len)
+{
+    size_t i = 0, o = 0;
+
+    while (i < len)
+    {
+        uint32_t c = s[i];
+
+        if (c < 0x80)
+        {
+            out[o++] = (char)c;
+            i++;
+        }
+        else if (c < 0x800)
+        {
+            out[o++] = (char)(0xC0 | (c >> 6));
+            out[o++] = (char)(0x80 | (c & 0x3F));
+            i++;
+        }
+        else if (c < 0xD800 || c > 0xDFFF)
+        {
+            out[o++] = (char)(0xE0 | (c >> 12));
+            out[o++] = (char)(0x80 | ((c >> 6) & 0x3F));
+            out[o++] = (char)(0x80 | (c & 0x3F));
+            i++;
+        }
+        else
+        {
+            // Only a high surrogate followed by a low one is valid
+            if (c > 0xDBFF || i+1 >= len || s[i+1] < 0xDC00 || s[i+1] > 0xDFFF)
+                break;
+
+            uint32_t cp = 0x10000 + (((c & 0x3FF) << 10) | (s[i+1] & 0x3FF));
+
+            out[o++] = (char)(0xF0 | (cp >> 18));
+            out[o++] = (char)(0x80 | ((cp >> 12) & 0x3F));
+            out[o++] = (char)(0x80 | ((cp >> 6) & 0x3F));
+            out[o++] = (char)(0x80 | (cp & 0x3F));
+            i += 2;
+        }
     }
-    return -1;
+
+    *out_len = o;
+    return i;
 }
 
+#ifdef UTF_SIMD
+
+static inline unsigned int ctz32(uint32_t v)
+{
+#ifdef _MSC_VER
+    unsigned long idx;
+    _BitScanForward(&idx, v);
+    return (unsigned int)idx;
+#else
+    return (unsigned int)__builtin_ctz(v);
 #endif
+}
 
-std::u16string Utils::Utf8ToUcs2(const std::string &utf8)
+// utf-8 validation with the lookup tables method of Keiser and Lemire ("Validating UTF-8 In Less Than One Instruction
+// Per Byte"). Each byte is classified together with the previous one by three 16 entries tables, the bits left set
+// in all three are errors. The 3rd/4th bytes of long sequences are checked apart from that, against the lead two/three bytes before.
+#define UTF8_TOO_SHORT      (1 << 0) // Lead byte or ascii followed by a lead byte or ascii
+#define UTF8_TOO_LONG       (1 << 1) // Ascii followed by continuation
+#define UTF8_OVERLONG_3     (1 << 2) // E0 80-9F
+#define UTF8_TOO_LARGE      (1 << 3) // F4 90-BF, F5-FF
+#define UTF8_SURROGATE      (1 << 4) // ED A0-BF
+#define UTF8_OVERLONG_2     (1 << 5) // C0-C1
+#define UTF8_TOO_LARGE_1000 (1 << 6) // F5-FF 80-8F
+#define UTF8_OVERLONG_4     (1 << 6) // F0 80-8F
+#define UTF8_TWO_CONTS      (1 << 7) // Continuation followed by continuation
+#define UTF8_CARRY          (UTF8_TOO_SHORT | UTF8_TOO_LONG | UTF8_TWO_CONTS)
+
+static const uint8_t utf8_byte1_high[16] =
+{
+    UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG,
+    UTF8_TWO_CONTS, UTF8_TWO_CONTS, UTF8_TWO_CONTS, UTF8_TWO_CONTS,
+    UTF8_TOO_SHORT | UTF8_OVERLONG_2,
+    UTF8_TOO_SHORT,
+    UTF8_TOO_SHORT | UTF8_OVERLONG_3 | UTF8_SURROGATE,
+    UTF8_TOO_SHORT | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000 | UTF8_OVERLONG_4
+};
+
+static const uint8_t utf8_byte1_low[16] =
+{
+    UTF8_CARRY | UTF8_OVERLONG_3 | UTF8_OVERLONG_2 | UTF8_OVERLONG_4,
+    UTF8_CARRY | UTF8_OVERLONG_2,
+    UTF8_CARRY,
+    UTF8_CARRY,
+    UTF8_CARRY | UTF8_TOO_LARGE,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000 | UTF8_SURROGATE,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000
+};
+
+static const uint8_t utf8_byte2_high[16] =
+{
+    UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT,
+    UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_OVERLONG_3 | UTF8_TOO_LARGE_1000 | UTF8_OVERLONG_4,
+    UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_OVERLONG_3 | UTF8_TOO_LARGE,
+    UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_SURROGATE | UTF8_TOO_LARGE,
+    UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_SURROGATE | UTF8_TOO_LARGE,
+    UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT
+};
+
+// Max value of the last three bytes of a block that don't need bytes from the next block
+static const uint8_t utf8_incomplete_max[32] =
 {
-    // New GCC version don't like the dirty implementation
-    // It compiled, but caused freeze, there is probably a bug in the *c_utf8 != 0 check
-    // I'll keep old implementation for VS because it's faster
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xEF, 0xDF, 0xBF
+};
 
-#ifdef _MSC_VER
+TARGET_SSSE3 static inline __m128i utf8_check_block_ssse3(__m128i input, __m128i prev_input)
+{
+    const __m128i low_nibble = _mm_set1_epi8(0x0F);
+    __m128i prev1 = _mm_alignr_epi8(input, prev_input, 15);
+
+    __m128i b1h = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)utf8_byte1_high), _mm_and_si128(_mm_srli_epi16(prev1, 4), low_nibble));
+    __m128i b1l = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)utf8_byte1_low), _mm_and_si128(prev1, low_nibble));
+    __m128i b2h = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)utf8_byte2_high), _mm_and_si128(_mm_srli_epi16(input, 4), low_nibble));
+    __m128i sc = _mm_and_si128(_mm_and_si128(b1h, b1l), b2h);
+
+    __m128i prev2 = _mm_alignr_epi8(input, prev_input, 14);
+    __m128i prev3 = _mm_alignr_epi8(input, prev_input, 13);
+    __m128i third = _mm_subs_epu8(prev2, _mm_set1_epi8((char)(0xE0-0x80)));
+    __m128i fourth = _mm_subs_epu8(prev3, _mm_set1_epi8((char)(0xF0-0x80)));
+    __m128i must23 = _mm_and_si128(_mm_or_si128(third, fourth), _mm_set1_epi8((char)0x80));
 
-    if (utf8.length() == 0)
+    return _mm_xor_si128(must23, sc);
+}
+
+TARGET_SSSE3 static bool utf8_validate_ssse3(const uint8_t *s, size_t len)
+{
+    const __m128i incomplete_max = _mm_loadu_si128((const __m128i *)(utf8_incomplete_max+16));
+    __m128i error = _mm_setzero_si128();
+    __m128i prev_input = _mm_setzero_si128();
+    __m128i prev_incomplete = _mm_setzero_si128();
+    uint8_t tail[16];
+    size_t i = 0;
+
+    for (; ; i += 16)
     {
-        return std::u16string(); // Empty string
+        __m128i input;
+
+        if (i + 16 <= len)
+        {
+            input = _mm_loadu_si128((const __m128i *)(s+i));
+        }
+        else if (i < len)
+        {
+            // Zero padding, the zeros are ascii so a truncated sequence at the end is an error
+            memset(tail, 0, sizeof(tail));
+            memcpy(tail, s+i, len-i);
+            input = _mm_loadu_si128((const __m128i *)tail);
+        }
+        else
+        {
+            break;
+        }
+
+        if (_mm_movemask_epi8(input) == 0)
+        {
+            error = _mm_or_si128(error, prev_incomplete);
+        }
+        else
+        {
+            error = _mm_or_si128(error, utf8_check_block_ssse3(input, prev_input));
+            prev_incomplete = _mm_subs_epu8(input, incomplete_max);
+        }
+
+        prev_input = input;
     }
 
-    const char *c_utf8 = utf8.c_str();
-    std::u16string ucs2;
-    int ret;
+    error = _mm_or_si128(error, prev_incomplete);
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(error, _mm_setzero_si128())) == 0xFFFF;
+}
+
+TARGET_AVX2 static inline __m256i utf8_check_block_avx2(__m256i input, __m256i prev_input)
+{
+    const __m256i low_nibble = _mm256_set1_epi8(0x0F);
+    // Previous block high lane + this block low lane, for the bytes that cross the lanes
+    __m256i cross = _mm256_permute2x128_si256(prev_input, input, 0x21);
+    __m256i prev1 = _mm256_alignr_epi8(input, cross, 15);
+
+    __m256i t_b1h = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)utf8_byte1_high));
+    __m256i t_b1l = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)utf8_byte1_low));
+    __m256i t_b2h = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)utf8_byte2_high));
+
+    __m256i b1h = _mm256_shuffle_epi8(t_b1h, _mm256_and_si256(_mm256_srli_epi16(prev1, 4), low_nibble));
+    __m256i b1l = _mm256_shuffle_epi8(t_b1l, _mm256_and_si256(prev1, low_nibble));
+    __m256i b2h = _mm256_shuffle_epi8(t_b2h, _mm256_and_si256(_mm256_srli_epi16(input, 4), low_nibble));
+    __m256i sc = _mm256_and_si256(_mm256_and_si256(b1h, b1l), b2h);
+
+    __m256i prev2 = _mm256_alignr_epi8(input, cross, 14);
+    __m256i prev3 = _mm256_alignr_epi8(input, cross, 13);
+    __m256i third = _mm256_subs_epu8(prev2, _mm256_set1_epi8((char)(0xE0-0x80)));
+    __m256i fourth = _mm256_subs_epu8(prev3, _mm256_set1_epi8((char)(0xF0-0x80)));
+    __m256i must23 = _mm256_and_si256(_mm256_or_si256(third, fourth), _mm256_set1_epi8((char)0x80));
+
+    return _mm256_xor_si256(must23, sc);
+}
+
+TARGET_AVX2 static bool utf8_validate_avx2(const uint8_t *s, size_t len)
+{
+    const __m256i incomplete_max = _mm256_loadu_si256((const __m256i *)utf8_incomplete_max);
+    __m256i error = _mm256_setzero_si256();
+    __m256i prev_input = _mm256_setzero_si256();
+    __m256i prev_incomplete = _mm256_setzero_si256();
+    uint8_t tail[32];
+    size_t i = 0;
 
-    while (*c_utf8 != 0 && (ret = utf8_to_ucs2((const unsigned char *)c_utf8, (const unsigned char **)&c_utf8)) != -1)
+    for (; ; i += 32)
     {
-        if (ret < 0x10000)
-            ucs2.push_back((char16_t)ret);
+        __m256i input;
+
+        if (i + 32 <= len)
+        {
+            input = _mm256_loadu_si256((const __m256i *)(s+i));
+        }
+        else if (i < len)
+        {
+            memset(tail, 0, sizeof(tail));
+            memcpy(tail, s+i, len-i);
+            input = _mm256_loadu_si256((const __m256i *)tail);
+        }
+        else
+        {
+            break;
+        }
+
+        if (_mm256_movemask_epi8(input) == 0)
+        {
+            error = _mm256_or_si256(error, prev_incomplete);
+        }
+        else
+        {
+            error = _mm256_or_si256(error, utf8_check_block_avx2(input, prev_input));
+            prev_incomplete = _mm256_subs_epu8(input, incomplete_max);
+        }
+
+        prev_input = input;
     }
 
-    return ucs2;
-#else
+    error = _mm256_or_si256(error, prev_incomplete);
+    return _mm256_testz_si256(error, error) != 0;
+}
 
-    // New implementation:
-    std::wstring_convert<std::codecvt_utf8_utf16<char16_t>, char16_t> convert;
-    return convert.from_bytes(utf8);
-#endif
+// Decoder for already validated input. Each 16 bytes window is tried as a run of ascii, of 2 bytes or of 3 bytes
+// sequences (the common cases of latin, cyrillic and cjk text), the part of the window that matches is converted at once.
+// The rest goes through the scalar decoder, one sequence at a time.
+TARGET_SSSE3 static size_t utf8_to_utf16_valid_ssse3(const uint8_t *s, size_t len, char16_t *out)
+{
+    const __m128i zero = _mm_setzero_si128();
+
+    const __m128i mask2 = _mm_set1_epi16((short)0xC0E0); // Lead 110xxxxx, then 10xxxxxx
+    const __m128i lead2 = _mm_set1_epi16((short)0x80C0);
+    const __m128i swap2 = _mm_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+
+    const __m128i mask3 = _mm_setr_epi8((char)0xF0, (char)0xC0, (char)0xC0, (char)0xF0, (char)0xC0, (char)0xC0, (char)0xF0, (char)0xC0,
+                                        (char)0xC0, (char)0xF0, (char)0xC0, (char)0xC0, 0, 0, 0, 0);
+    const __m128i lead3 = _mm_setr_epi8((char)0xE0, (char)0x80, (char)0x80, (char)0xE0, (char)0x80, (char)0x80, (char)0xE0, (char)0x80,
+                                        (char)0x80, (char)0xE0, (char)0x80, (char)0x80, 0, 0, 0, 0);
+    const __m128i spread3 = _mm_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1);
+    const __m128i pack3 = _mm_setr_epi8(0, 1, 4, 5, 8, 9, 12, 13, -1, -1, -1, -1, -1, -1, -1, -1);
+
+    size_t i = 0, o = 0;
+
+    while (i + 16 <= len)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)(s+i));
+        uint32_t ascii = (uint32_t)_mm_movemask_epi8(v);
+
+        if ((ascii & 1) == 0)
+        {
+            // Leading ascii bytes. All 16 are stored, only the ascii ones are kept.
+            // (o <= i, so there is always room for 16 units before len)
+            unsigned int n = (ascii == 0) ? 16 : ctz32(ascii);
+
+            _mm_storeu_si128((__m128i *)(out+o), _mm_unpacklo_epi8(v, zero));
+            _mm_storeu_si128((__m128i *)(out+o+8), _mm_unpackhi_epi8(v, zero));
+            i += n;
+            o += n;
+            continue;
+        }
+
+        uint32_t m2 = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(v, mask2), lead2)) ^ 0xFFFF;
+        unsigned int n2 = (m2 == 0) ? 16 : (ctz32(m2) & ~1u);
+
+        if (n2 >= 4)
+        {
+            __m128i w = _mm_shuffle_epi8(v, swap2); // lead << 8 | cont
+            __m128i r = _mm_or_si128(_mm_srli_epi16(_mm_and_si128(w, _mm_set1_epi16(0x1F00)), 2), _mm_and_si128(w, _mm_set1_epi16(0x3F)));
+
+            _mm_storeu_si128((__m128i *)(out+o), r);
+            i += n2;
+            o += n2 / 2;
+            continue;
+        }
+
+        uint32_t m3 = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(v, mask3), lead3)) ^ 0xFFFF;
+        unsigned int n3 = (m3 == 0) ? 12 : (ctz32(m3) / 3) * 3;
+
+        if (n3 > 12)
+            n3 = 12;
+
+        if (n3 >= 6)
+        {
+            __m128i w = _mm_shuffle_epi8(v, spread3); // lead << 16 | cont1 << 8 | cont2
+            __m128i r = _mm_or_si128(_mm_srli_epi32(_mm_and_si128(w, _mm_set1_epi32(0x0F0000)), 4),
+                        _mm_or_si128(_mm_srli_epi32(_mm_and_si128(w, _mm_set1_epi32(0x3F00)), 2), _mm_and_si128(w, _mm_set1_epi32(0x3F))));
+
+            _mm_storel_epi64((__m128i *)(out+o), _mm_shuffle_epi8(r, pack3));
+            i += n3;
+            o += n3 / 3;
+            continue;
+        }
+
+        // Mixed content, decode until the next sequence start after the first 8 bytes
+        size_t end = i + 8;
+
+        while (i < end)
+        {
+            size_t n, out_len;
+            uint8_t c = s[i];
+
+            n = (c < 0x80) ? 1 : ((c < 0xE0) ? 2 : ((c < 0xF0) ? 3 : 4));
+            utf8_to_utf16_scalar(s+i, n, out+o, &out_len);
+            i += n;
+            o += out_len;
+        }
+    }
+
+    size_t out_len;
+    utf8_to_utf16_scalar(s+i, len-i, out+o, &out_len);
+    return o + out_len;
 }
 
-static int ucs2_to_utf8 (int ucs2, unsigned char *utf8)
+// Ascii runs are narrowed 8 units at a time, the rest goes through the scalar encoder.
+static size_t utf16_to_utf8_sse2(const char16_t *s, size_t len, char *out, size_t *out_len)
 {
-    if (ucs2 < 0x80) {
-        utf8[0] = (unsigned char)ucs2;
-        utf8[1] = '\0';
-        return 1;
+    const __m128i non_ascii = _mm_set1_epi16((short)0xFF80);
+    const __m128i zero = _mm_setzero_si128();
+    size_t i = 0, o = 0;
+
+    while (i + 8 <= len)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)(s+i));
+        uint32_t m = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(v, non_ascii), zero)) ^ 0xFFFF;
+        unsigned int n = (m == 0) ? 8 : (ctz32(m) / 2);
+
+        if (n > 0)
+        {
+            // o <= 3*i, there is room for 8 bytes
+            _mm_storel_epi64((__m128i *)(out+o), _mm_packus_epi16(v, v));
+            i += n;
+            o += n;
+            continue;
+        }
+
+        // Up to the next ascii unit, or a surrogate pair
+        size_t end = i + 1;
+        size_t n_out;
+
+        while (end < i + 8 && s[end] >= 0x80)
+            end++;
+
+        size_t done = utf16_to_utf8_scalar(s+i, end-i, out+o, &n_out);
+
+        if (done != end-i)
+        {
+            // Pair split by the window, or invalid. Retry from the start of the pair with the rest of the string.
+            if (done+1 != end-i)
+            {
+                *out_len = o + n_out;
+                return i + done;
+            }
+
+            size_t n_pair;
+
+            if (utf16_to_utf8_scalar(s+i+done, (len-i-done < 2) ? len-i-done : 2, out+o+n_out, &n_pair) != 2)
+            {
+                *out_len = o + n_out;
+                return i + done;
+            }
+
+            end++;
+            n_out += n_pair;
+        }
+
+        i = end;
+        o += n_out;
     }
-    if (ucs2 >= 0x80  && ucs2 < 0x800) {
-        utf8[0] = (ucs2 >> 6)   | 0xC0;
-        utf8[1] = (ucs2 & 0x3F) | 0x80;
-        utf8[2] = '\0';
-        return 2;
+
+    size_t n_out;
+    size_t done = utf16_to_utf8_scalar(s+i, len-i, out+o, &n_out);
+
+    *out_len = o + n_out;
+    return i + done;
+}
+
+#endif // UTF_SIMD
+
+bool Utils::Utf8ToUtf16(const char *utf8, size_t len, char16_t *out, size_t *out_len, size_t *err_pos)
+{
+    const uint8_t *s = (const uint8_t *)utf8;
+
+#ifdef UTF_SIMD
+    static const bool has_avx2 = Utils::CpuHasAvx2();
+    static const bool has_ssse3 = Utils::CpuHasSsse3();
+
+    if (has_ssse3)
+    {
+        bool valid = (has_avx2) ? utf8_validate_avx2(s, len) : utf8_validate_ssse3(s, len);
+
+        if (valid)
+        {
+            *out_len = utf8_to_utf16_valid_ssse3(s, len, out);
+            return true;
+        }
     }
-    if (ucs2 >= 0x800 && ucs2 < 0xFFFF) {
-    if (ucs2 >= 0xD800 && ucs2 <= 0xDFFF) {
-        /* Ill-formed. */
-        return -1;
+#endif
+
+    size_t done = utf8_to_utf16_scalar(s, len, out, out_len);
+
+    if (done == len)
+        return true;
+
+    if (err_pos)
+        *err_pos = done;
+
+    return false;
+}
+
+bool Utils::Utf8ToUtf16(const char *utf8, size_t len, std::u16string &utf16, size_t *err_pos)
+{
+    // At most one unit per byte. Short strings (most of the msg and xml text) are converted on the stack,
+    // because resizing a std::u16string fills it one unit at a time, which costs more than the conversion.
+    char16_t stack_buf[512];
+    std::vector<char16_t> heap_buf;
+    char16_t *out = stack_buf;
+    size_t out_len;
+
+    if (len > sizeof(stack_buf)/sizeof(char16_t))
+    {
+        heap_buf.resize(len);
+        out = heap_buf.data();
     }
-        utf8[0] = ((ucs2 >> 12)       ) | 0xE0;
-        utf8[1] = ((ucs2 >> 6 ) & 0x3F) | 0x80;
-        utf8[2] = ((ucs2      ) & 0x3F) | 0x80;
-        utf8[3] = '\0';
-        return 3;
+
+    bool ret = Utf8ToUtf16(utf8, len, out, &out_len, err_pos);
+    utf16.assign(out, out_len);
+    return ret;
+}
+
+bool Utils::Utf16ToUtf8(const char16_t *utf16, size_t len, std::string &utf8, size_t *err_pos)
+{
+    // At most 3 bytes per unit (surrogate pairs are 4 bytes for 2 units). Converted apart and then copied,
+    // so that the string doesn't keep 3 times the capacity it needs.
+    char stack_buf[1536];
+    std::vector<char> heap_buf;
+    char *out = stack_buf;
+    size_t out_len;
+
+    if (len*3 > sizeof(stack_buf))
+    {
+        heap_buf.resize(len*3);
+        out = heap_buf.data();
     }
-    if (ucs2 >= 0x10000 && ucs2 < 0x10FFFF) {
-    /* http://tidy.sourceforge.net/cgi-bin/lxr/source/src/utf8.c#L380 */
-    utf8[0] = 0xF0 | (ucs2 >> 18);
-    utf8[1] = 0x80 | ((ucs2 >> 12) & 0x3F);
-    utf8[2] = 0x80 | ((ucs2 >> 6) & 0x3F);
-    utf8[3] = 0x80 | ((ucs2 & 0x3F));
-        utf8[4] = '\0';
-        return 4;
+
+#ifdef UTF_SIMD
+    size_t done = utf16_to_utf8_sse2(utf16, len, out, &out_len);
+#else
+    size_t done = utf16_to_utf8_scalar(utf16, len, out, &out_len);
+#endif
+
+    utf8.assign(out, out_len);
+
+    if (done == len)
+        return true;
+
+    if (err_pos)
+        *err_pos = done;
+
+    return false;
+}
+
+std::u16string Utils::Utf8ToUcs2(const std::string &utf8)
+{
+    std::u16string ucs2;
+    size_t err_pos;
+
+    if (!Utf8ToUtf16(utf8.c_str(), utf8.length(), ucs2, &err_pos))
+    {
+        DPRINTF("%s: Invalid utf-8 sequence at byte %u, the string was cut there.\n", FUNCNAME, (uint32_t)err_pos);
     }
-    return -1;;
+
+    return ucs2;
 }
 
 std::string Utils::Ucs2ToUtf8(const std::u16string &ucs2)
 {
-    if (ucs2.length() == 0)
-        return "";
+    return Ucs2ToUtf8(ucs2.c_str(), ucs2.length());
+}
 
+std::string Utils::Ucs2ToUtf8(const char16_t *ucs2, size_t len)
+{
     std::string utf8;
+    size_t err_pos;
 
-    for (char16_t c : ucs2)
+    if (!Utf16ToUtf8(ucs2, len, utf8, &err_pos))
     {
-        char c_utf8[5];
-
-        if (ucs2_to_utf8(c, (unsigned char *)c_utf8) < 0)
-            break;
-
-        utf8 += c_utf8;
+        DPRINTF("%s: Unpaired surrogate at position %u, the string was cut there.\n", FUNCNAME, (uint32_t)err_pos);
     }
 
     return utf8;
@@ -1124,3 +1596,119 @@ float Utils::HalfToFloat(uint16_t h)
 #ifdef __GNUC__
 #pragma GCC diagnostic pop
 #endif
+
+#if defined(CPU_X86_64) || defined(CPU_X86)
+
+static void cpuid(uint32_t leaf, uint32_t subleaf, uint32_t regs[4])
+{
+#ifdef _MSC_VER
+    __cpuidex((int *)regs, (int)leaf, (int)subleaf);
+#else
+    __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+static uint64_t xgetbv0()
+{
+#ifdef _MSC_VER
+    return _xgetbv(0);
+#else
+    uint32_t eax, edx;
+    __asm__ __volatile__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return ((uint64_t)edx << 32) | eax;
+#endif
+}
+
+static const struct CpuFeatures
+{
+    bool ssse3;
+    bool avx2;
+    bool aes;
+    bool vaes;
+    bool sha;
+
+    CpuFeatures()
+    {
+        uint32_t regs[4];
+
+        ssse3 = avx2 = aes = vaes = sha = false;
+
+        cpuid(0, 0, regs);
+        uint32_t max_leaf = regs[0];
+
+        if (max_leaf < 1)
+            return;
+
+        cpuid(1, 0, regs);
+        ssse3 = (regs[2] & (1 << 9)) != 0;
+        aes = (regs[2] & (1 << 25)) != 0;
+        bool sse41 = (regs[2] & (1 << 19)) != 0;
+
+        // AVX state must be enabled by the OS (OSXSAVE + XMM/YMM in XCR0)
+        bool os_avx = (regs[2] & (1 << 27)) && (regs[2] & (1 << 28)) && ((xgetbv0() & 6) == 6);
+
+        if (max_leaf >= 7)
+        {
+            cpuid(7, 0, regs);
+            avx2 = os_avx && (regs[1] & (1 << 5)) != 0;
+            // The 256 bits forms of aesenc/aesdec
+            vaes = aes && avx2 && (regs[2] & (1 << 9)) != 0;
+            // The sha1/sha256 code also uses pshufb and pextrd
+            sha = ssse3 && sse41 && (regs[1] & (1 << 29)) != 0;
+        }
+    }
+} cpu_features;
+
+bool Utils::CpuHasSsse3()
+{
+    return cpu_features.ssse3;
+}
+
+bool Utils::CpuHasAvx2()
+{
+    return cpu_features.avx2;
+}
+
+bool Utils::CpuHasAesNi()
+{
+    return cpu_features.aes;
+}
+
+bool Utils::CpuHasVaes()
+{
+    return cpu_features.vaes;
+}
+
+bool Utils::CpuHasShaNi()
+{
+    return cpu_features.sha;
+}
+
+#else
+
+bool Utils::CpuHasSsse3()
+{
+    return false;
+}
+
+bool Utils::CpuHasAvx2()
+{
+    return false;
+}
+
+bool Utils::CpuHasAesNi()
+{
+    return false;
+}
+
+bool Utils::CpuHasVaes()
+{
+    return false;
+}
+
+bool Utils::CpuHasShaNi()
+{
+    return false;
+}
+
+#endif
@@ -2,6 +2,7 @@
 #define UTILSMISC_H
 
 #include "Utils.h"
+#include "CpuFeatures.h"
 
 namespace Utils
 {
@@ -42,8 +43,17 @@ namespace Utils
     std::string GetRandomString(size_t len);
     void GetRandomData(void *buf, size_t len);
 
+    // utf-8 <-> utf-16 (surrogate pairs included). On invalid input they return false, the output has what was
+    // converted before the bad sequence and err_pos its position in the input.
+    bool Utf8ToUtf16(const char *utf8, size_t len, std::u16string &utf16, size_t *err_pos=nullptr);
+    bool Utf16ToUtf8(const char16_t *utf16, size_t len, std::string &utf8, size_t *err_pos=nullptr);
+    // Into caller storage, which must have room for len units (never more than one per byte)
+    bool Utf8ToUtf16(const char *utf8, size_t len, char16_t *out, size_t *out_len, size_t *err_pos=nullptr);
+
+    // Same, invalid input is logged and the string is cut there
     std::u16string Utf8ToUcs2(const std::string &utf8);
     std::string Ucs2ToUtf8(const std::u16string &ucs2);
+    std::string Ucs2ToUtf8(const char16_t *ucs2, size_t len);
 
     std::string GetAppData();
     std::u16string GetAppData16();
@@ -153,274 +153,695 @@ std::string Utils::SignedToString(int64_t value)
 #pragma GCC diagnostic pop
 #endif
 
-std::string Utils::FloatToString(float value)
+// Shortest round trip float to decimal, after the Ryu algorithm by Ulf Adams (f2s).
+// The tables are 2^k / 5^q (rounded up) and 5^q / 2^k, truncated to about 60 bits.
+
+#define FLOAT_MANTISSA_BITS     23
+#define FLOAT_EXPONENT_BITS     8
+#define FLOAT_BIAS              127
+#define FLOAT_POW5_INV_BITCOUNT 59
+#define FLOAT_POW5_BITCOUNT     61
+
+static const uint64_t float_pow5_inv_split[31] =
 {
-    char temp[32];
-    std::string str;
+    0x0800000000000001ULL, 0x0666666666666667ULL, 0x051EB851EB851EB9ULL, 0x04189374BC6A7EFAULL,
+    0x068DB8BAC710CB2AULL, 0x053E2D6238DA3C22ULL, 0x0431BDE82D7B634EULL, 0x06B5FCA6AF2BD216ULL,
+    0x055E63B88C230E78ULL, 0x044B82FA09B5A52DULL, 0x06DF37F675EF6EAEULL, 0x057F5FF85E592558ULL,
+    0x0465E6604B7A8447ULL, 0x0709709A125DA071ULL, 0x05A126E1A84AE6C1ULL, 0x0480EBE7B9D58567ULL,
+    0x0734ACA5F6226F0BULL, 0x05C3BD5191B525A3ULL, 0x049C97747490EAE9ULL, 0x0760F253EDB4AB0EULL,
+    0x05E72843249088D8ULL, 0x04B8ED0283A6D3E0ULL, 0x078E480405D7B966ULL, 0x060B6CD004AC9452ULL,
+    0x04D5F0A66A23A9DBULL, 0x07BCB43D769F762BULL, 0x063090312BB2C4EFULL, 0x04F3A68DBC8F03F3ULL,
+    0x07EC3DAF94180651ULL, 0x065697BFA9ACD1DAULL, 0x051212FFBAF0A7E2ULL
+};
+
+static const uint64_t float_pow5_split[47] =
+{
+    0x1000000000000000ULL, 0x1400000000000000ULL, 0x1900000000000000ULL, 0x1F40000000000000ULL,
+    0x1388000000000000ULL, 0x186A000000000000ULL, 0x1E84800000000000ULL, 0x1312D00000000000ULL,
+    0x17D7840000000000ULL, 0x1DCD650000000000ULL, 0x12A05F2000000000ULL, 0x174876E800000000ULL,
+    0x1D1A94A200000000ULL, 0x12309CE540000000ULL, 0x16BCC41E90000000ULL, 0x1C6BF52634000000ULL,
+    0x11C37937E0800000ULL, 0x16345785D8A00000ULL, 0x1BC16D674EC80000ULL, 0x1158E460913D0000ULL,
+    0x15AF1D78B58C4000ULL, 0x1B1AE4D6E2EF5000ULL, 0x10F0CF064DD59200ULL, 0x152D02C7E14AF680ULL,
+    0x1A784379D99DB420ULL, 0x108B2A2C28029094ULL, 0x14ADF4B7320334B9ULL, 0x19D971E4FE8401E7ULL,
+    0x1027E72F1F128130ULL, 0x1431E0FAE6D7217CULL, 0x193E5939A08CE9DBULL, 0x1F8DEF8808B02452ULL,
+    0x13B8B5B5056E16B3ULL, 0x18A6E32246C99C60ULL, 0x1ED09BEAD87C0378ULL, 0x13426172C74D822BULL,
+    0x1812F9CF7920E2B6ULL, 0x1E17B84357691B64ULL, 0x12CED32A16A1B11EULL, 0x178287F49C4A1D66ULL,
+    0x1D6329F1C35CA4BFULL, 0x125DFA371A19E6F7ULL, 0x16F578C4E0A060B5ULL, 0x1CB2D6F618C878E3ULL,
+    0x11EFC659CF7D4B8DULL, 0x166BB7F0435C9E71ULL, 0x1C06A5EC5433C60DULL
+};
+
+static inline int32_t pow5bits(int32_t e)
+{
+    return (int32_t)(((uint32_t)e * 1217359) >> 19) + 1;
+}
 
-    sprintf(temp, "%.9g", value);
-    str = temp;
+static inline uint32_t log10_pow2(int32_t e)
+{
+    return ((uint32_t)e * 78913) >> 18;
+}
+
+static inline uint32_t log10_pow5(int32_t e)
+{
+    return ((uint32_t)e * 732923) >> 20;
+}
+
+static inline uint32_t pow5_factor(uint32_t value)
+{
+    uint32_t count = 0;
 
-    if (str.find('.') == std::string::npos && str.find('e') == std::string::npos)
+    while (value % 5 == 0)
     {
-        str = str + ".0";
+        value /= 5;
+        count++;
     }
 
-    return str;
+    return count;
 }
 
-std::string Utils::Vectors2DToString(const float *vectors, size_t count)
+static inline bool multiple_of_pow5(uint32_t value, uint32_t p)
 {
-    std::string str;
-    const float *ptr = vectors;
+    return (pow5_factor(value) >= p);
+}
 
-    for (size_t i = 0; i < count; i++)
-    {
-        str += "{ ";
-        str += FloatToString(*ptr++);
-        str += ", ";
-        str += FloatToString(*ptr++);
-        str += " }";
+static inline bool multiple_of_pow2(uint32_t value, uint32_t p)
+{
+    return ((value & ((1u << p) - 1)) == 0);
+}
 
-        if (i != (count-1))
-            str += ", ";
-    }
+static inline uint32_t mul_shift(uint32_t m, uint64_t factor, int32_t shift)
+{
+    const uint64_t bits0 = (uint64_t)m * (uint32_t)factor;
+    const uint64_t bits1 = (uint64_t)m * (uint32_t)(factor >> 32);
+    const uint64_t sum = (bits0 >> 32) + bits1;
 
-    return str;
+    return (uint32_t)(sum >> (shift - 32));
 }
 
-size_t Utils::GetVectors2DFromString(const std::string &str, std::vector<float> &vectors)
+// Returns the shortest decimal digits and their exponent (value = digits * 10^exp) for a finite, non zero float
+static uint32_t float_to_decimal(uint32_t ieee_mantissa, uint32_t ieee_exponent, int32_t *exp)
 {
-    size_t count = 0;
-    int state = 0; // 0 -> waiting '{'; 1 -> waiting number; 2 -> in number; 3 -> waiting ',' (between '}' and '{')
+    int32_t e2;
+    uint32_t m2;
 
-    std::string number_str;
-    vectors.clear();
+    if (ieee_exponent == 0)
+    {
+        e2 = 1 - FLOAT_BIAS - FLOAT_MANTISSA_BITS - 2;
+        m2 = ieee_mantissa;
+    }
+    else
+    {
+        e2 = (int32_t)ieee_exponent - FLOAT_BIAS - FLOAT_MANTISSA_BITS - 2;
+        m2 = (1u << FLOAT_MANTISSA_BITS) | ieee_mantissa;
+    }
+
+    const bool accept_bounds = ((m2 & 1) == 0);
+
+    // The value and the two halfway points to the neighbours, times 4
+    const uint32_t mv = 4 * m2;
+    const uint32_t mp = 4 * m2 + 2;
+    const uint32_t mm_shift = (ieee_mantissa != 0 || ieee_exponent <= 1);
+    const uint32_t mm = 4 * m2 - 1 - mm_shift;
 
-    for (char ch : str)
+    uint32_t vr, vp, vm;
+    int32_t e10;
+    bool vm_trailing_zeros = false;
+    bool vr_trailing_zeros = false;
+    uint8_t last_removed_digit = 0;
+
+    if (e2 >= 0)
     {
-        if (ch <= ' ')
-            continue;
+        const uint32_t q = log10_pow2(e2);
+        const int32_t k = FLOAT_POW5_INV_BITCOUNT + pow5bits((int32_t)q) - 1;
+        const int32_t i = -e2 + (int32_t)q + k;
 
-        if (state == 0)
+        e10 = (int32_t)q;
+        vr = mul_shift(mv, float_pow5_inv_split[q], i);
+        vp = mul_shift(mp, float_pow5_inv_split[q], i);
+        vm = mul_shift(mm, float_pow5_inv_split[q], i);
+
+        if (q != 0 && (vp - 1) / 10 <= vm / 10)
         {
-            if (ch != '{')
-                return (size_t)-1;
+            // The last removed digit is needed for the rounding, it comes from one more digit of precision
+            const int32_t l = FLOAT_POW5_INV_BITCOUNT + pow5bits((int32_t)(q - 1)) - 1;
+            last_removed_digit = (uint8_t)(mul_shift(mv, float_pow5_inv_split[q - 1], -e2 + (int32_t)q - 1 + l) % 10);
+        }
 
-            state = 1;
+        if (q <= 9)
+        {
+            // Only one of mp, mv and mm can be a multiple of 5, if any
+            if (mv % 5 == 0)
+                vr_trailing_zeros = multiple_of_pow5(mv, q);
+            else if (accept_bounds)
+                vm_trailing_zeros = multiple_of_pow5(mm, q);
+            else
+                vp -= multiple_of_pow5(mp, q);
         }
-        else if (state == 1)
+    }
+    else
+    {
+        const uint32_t q = log10_pow5(-e2);
+        const int32_t i = -e2 - (int32_t)q;
+        const int32_t k = pow5bits(i) - FLOAT_POW5_BITCOUNT;
+        int32_t j = (int32_t)q - k;
+
+        e10 = (int32_t)q + e2;
+        vr = mul_shift(mv, float_pow5_split[i], j);
+        vp = mul_shift(mp, float_pow5_split[i], j);
+        vm = mul_shift(mm, float_pow5_split[i], j);
+
+        if (q != 0 && (vp - 1) / 10 <= vm / 10)
         {
-            if (ch == '{' || ch == ',' || ch == '}')
-                return (size_t)-1;
+            j = (int32_t)q - 1 - (pow5bits(i + 1) - FLOAT_POW5_BITCOUNT);
+            last_removed_digit = (uint8_t)(mul_shift(mv, float_pow5_split[i + 1], j) % 10);
+        }
 
-            number_str.clear();
-            number_str.push_back(ch);
-            state = 2;
+        if (q <= 1)
+        {
+            // mv has at least q trailing zero bits, so vr (and vm or vp) are exact
+            vr_trailing_zeros = true;
+
+            if (accept_bounds)
+                vm_trailing_zeros = (mm_shift == 1);
+            else
+                vp--;
         }
-        else if (state == 2)
+        else if (q < 31)
         {
-            bool num_finished = false;
+            vr_trailing_zeros = multiple_of_pow2(mv, q - 1);
+        }
+    }
 
-            if (ch == ',')
-            {
-                if (vectors.size() & 1)
-                    return (size_t)-1;
+    // Remove the digits that still leave the number inside the (vm, vp) interval
+    int32_t removed = 0;
+    uint32_t output;
 
-                num_finished = true;
-            }
-            else if (ch == '}')
-            {
-                if (!(vectors.size() & 1))
-                    return (size_t)-1;
+    if (vm_trailing_zeros || vr_trailing_zeros)
+    {
+        while (vp / 10 > vm / 10)
+        {
+            vm_trailing_zeros &= (vm % 10 == 0);
+            vr_trailing_zeros &= (last_removed_digit == 0);
+            last_removed_digit = (uint8_t)(vr % 10);
+            vr /= 10;
+            vp /= 10;
+            vm /= 10;
+            removed++;
+        }
 
-                num_finished = true;
+        if (vm_trailing_zeros)
+        {
+            while (vm % 10 == 0)
+            {
+                vr_trailing_zeros &= (last_removed_digit == 0);
+                last_removed_digit = (uint8_t)(vr % 10);
+                vr /= 10;
+                vp /= 10;
+                vm /= 10;
+                removed++;
             }
+        }
 
-            if (num_finished)
-            {
-                float value;
+        // Exactly halfway: round to even
+        if (vr_trailing_zeros && last_removed_digit == 5 && vr % 2 == 0)
+            last_removed_digit = 4;
 
-                if (sscanf(number_str.c_str(), "%f", &value) != 1)
-                    return (size_t)-1;
+        output = vr + ((vr == vm && (!accept_bounds || !vm_trailing_zeros)) || last_removed_digit >= 5);
+    }
+    else
+    {
+        while (vp / 10 > vm / 10)
+        {
+            last_removed_digit = (uint8_t)(vr % 10);
+            vr /= 10;
+            vp /= 10;
+            vm /= 10;
+            removed++;
+        }
 
-                vectors.push_back(value);
+        output = vr + (vr == vm || last_removed_digit >= 5);
+    }
 
-                if (vectors.size() & 1)
-                {
-                    state = 1;
-                }
-                else
-                {
-                    state = 3;
-                    count++;
-                }
-            }
-            else
-            {
-                number_str.push_back(ch);
-            }
+    *exp = e10 + removed;
+    return output;
+}
+
+static inline uint32_t decimal_length(uint32_t v)
+{
+    uint32_t len = 1;
+
+    while (v >= 10)
+    {
+        v /= 10;
+        len++;
+    }
+
+    return len;
+}
+
+// Same layout as "%.9g" followed by ".0" for integers, but with the shortest digits that read back to the same float
+char *Utils::FloatToChars(char *out, float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(float));
+
+    const uint32_t ieee_mantissa = bits & ((1u << FLOAT_MANTISSA_BITS) - 1);
+    const uint32_t ieee_exponent = (bits >> FLOAT_MANTISSA_BITS) & ((1u << FLOAT_EXPONENT_BITS) - 1);
+
+    if (ieee_exponent == ((1u << FLOAT_EXPONENT_BITS) - 1))
+    {
+        // inf and nan, as they were printed before
+        int len = sprintf(out, "%.9g", value);
+
+        // Some CRTs give "1.#INF" and the like
+        if (!memchr(out, '.', len) && !memchr(out, 'e', len))
+        {
+            memcpy(out + len, ".0", 2);
+            len += 2;
         }
-        else if (state == 3)
+
+        return out + len;
+    }
+
+    if (bits >> 31)
+        *out++ = '-';
+
+    if (ieee_exponent == 0 && ieee_mantissa == 0)
+    {
+        memcpy(out, "0.0", 3);
+        return out + 3;
+    }
+
+    int32_t exp;
+    uint32_t output = float_to_decimal(ieee_mantissa, ieee_exponent, &exp);
+
+    char digits[10] = { 0 };
+    const uint32_t olength = decimal_length(output);
+
+    for (uint32_t i = olength; i > 0; i--)
+    {
+        digits[i-1] = (char)('0' + output % 10);
+        output /= 10;
+    }
+
+    const int32_t sci_exp = exp + (int32_t)olength - 1;
+
+    if (sci_exp < -4 || sci_exp >= 9)
+    {
+        *out++ = digits[0];
+
+        if (olength > 1)
         {
-            if (ch != ',')
-                return (size_t)-1;
+            *out++ = '.';
+            memcpy(out, digits + 1, olength - 1);
+            out += olength - 1;
+        }
 
-            state = 0;
+        int32_t e = sci_exp;
+
+        *out++ = 'e';
+
+        if (e < 0)
+        {
+            *out++ = '-';
+            e = -e;
+        }
+        else
+        {
+            *out++ = '+';
+        }
+
+        if (e >= 10)
+        {
+            *out++ = (char)('0' + e / 10);
         }
+        else
+        {
+            *out++ = '0';
+        }
+
+        *out++ = (char)('0' + e % 10);
+    }
+    else if (exp >= 0)
+    {
+        memcpy(out, digits, olength);
+        out += olength;
+        memset(out, '0', exp);
+        out += exp;
+        memcpy(out, ".0", 2);
+        out += 2;
     }
+    else if (sci_exp >= 0)
+    {
+        const uint32_t int_len = (uint32_t)(sci_exp + 1);
 
-    if (state != 0 && state != 3)
-        return (size_t)-1;
+        memcpy(out, digits, int_len);
+        out += int_len;
+        *out++ = '.';
+        memcpy(out, digits + int_len, olength - int_len);
+        out += olength - int_len;
+    }
+    else
+    {
+        const uint32_t zeros = (uint32_t)(-sci_exp - 1);
+
+        memcpy(out, "0.", 2);
+        out += 2;
+        memset(out, '0', zeros);
+        out += zeros;
+        memcpy(out, digits, olength);
+        out += olength;
+    }
 
-    return count;
+    return out;
 }
 
-std::string Utils::Vectors3DToString(const float *vectors, size_t count)
+std::string Utils::FloatToString(float value)
 {
-    std::string str;
-    const float *ptr = vectors;
+    char temp[FLOAT_CHARS_MAX];
+    return std::string(temp, FloatToChars(temp, value));
+}
 
-    for (size_t i = 0; i < count; i++)
-    {
-        str += "{ ";
-        str += FloatToString(*ptr++);
-        str += ", ";
-        str += FloatToString(*ptr++);
-        str += ", ";
-        str += FloatToString(*ptr++);
-        str += " }";
+static const double exact_pow10[23] =
+{
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
 
-        if (i != (count-1))
-            str += ", ";
+static const char *chars_to_float_slow(const char *start, const char *end, const char *str, float *value)
+{
+    char temp[64];
+    std::string long_str;
+    const char *num;
+    char *num_end;
+
+    // The number is copied so that strtof doesn't parse past what was already validated
+    if (end && (size_t)(end - start) < sizeof(temp))
+    {
+        memcpy(temp, start, end - start);
+        temp[end - start] = 0;
+        num = temp;
+    }
+    else if (end)
+    {
+        long_str.assign(start, end);
+        num = long_str.c_str();
+    }
+    else
+    {
+        num = start;
     }
 
-    return str;
+    float f = strtof(num, &num_end);
+
+    if (num_end == num)
+        return str;
+
+    *value = f;
+    return start + (num_end - num);
 }
 
-size_t Utils::GetVectors3DFromString(const std::string &str, std::vector<float> &vectors)
+// Decimal numbers with up to 15 significant digits and a power of ten up to 22 are read with one double operation,
+// which is correctly rounded; the rounding to float is then correct unless the double is exactly halfway between
+// two floats. Everything else (inf, nan, hexadecimal, long or extreme numbers) goes to strtof.
+const char *Utils::CharsToFloat(const char *str, float *value)
 {
-    size_t count = 0;
-    int state = 0; // 0 -> waiting '{'; 1 -> waiting number; 2 -> in number; 3 -> waiting ',' (between '}' and '{')
+    const char *p = str;
 
-    std::string number_str;
-    vectors.clear();
+    while (*p == ' ' || (*p >= '\t' && *p <= '\r'))
+        p++;
+
+    const char *start = p;
+    bool negative = false;
 
-    for (char ch : str)
+    if (*p == '-' || *p == '+')
     {
-        if (ch <= ' ')
-            continue;
+        negative = (*p == '-');
+        p++;
+    }
 
-        if (state == 0)
-        {
-            if (ch != '{')
-                return (size_t)-1;
+    if (p[0] == '0' && (p[1] == 'x' || p[1] == 'X'))
+        return chars_to_float_slow(start, nullptr, str, value);
 
-            state = 1;
+    uint64_t mantissa = 0;
+    int num_digits = 0;
+    int32_t exp10 = 0;
+    bool any_digit = false;
+    bool truncated = false;
+
+    for (; *p >= '0' && *p <= '9'; p++)
+    {
+        any_digit = true;
+
+        if (num_digits < 19)
+        {
+            mantissa = mantissa*10 + (uint64_t)(*p - '0');
+            if (mantissa != 0)
+                num_digits++;
         }
-        else if (state == 1)
+        else
         {
-            if (ch == '{' || ch == ',' || ch == '}')
-                return (size_t)-1;
-
-            number_str.clear();
-            number_str.push_back(ch);
-            state = 2;
+            exp10++;
+            truncated |= (*p != '0');
         }
-        else if (state == 2)
+    }
+
+    if (*p == '.')
+    {
+        p++;
+
+        for (; *p >= '0' && *p <= '9'; p++)
         {
-            bool num_finished = false;
+            any_digit = true;
 
-            if (ch == ',')
+            if (num_digits < 19)
             {
-                if ((vectors.size() % 3) == 2)
-                    return (size_t)-1;
+                mantissa = mantissa*10 + (uint64_t)(*p - '0');
+                if (mantissa != 0)
+                    num_digits++;
 
-                num_finished = true;
+                exp10--;
             }
-            else if (ch == '}')
+            else
             {
-                if ((vectors.size() % 3) != 2)
-                    return (size_t)-1;
-
-                num_finished = true;
+                truncated |= (*p != '0');
             }
+        }
+    }
 
-            if (num_finished)
-            {
-                float value;
+    if (!any_digit)
+        return chars_to_float_slow(start, nullptr, str, value);
 
-                if (sscanf(number_str.c_str(), "%f", &value) != 1)
-                    return (size_t)-1;
+    if (*p == 'e' || *p == 'E')
+    {
+        const char *q = p + 1;
+        bool exp_negative = false;
 
-                vectors.push_back(value);
+        if (*q == '-' || *q == '+')
+        {
+            exp_negative = (*q == '-');
+            q++;
+        }
 
-                if ((vectors.size() % 3) != 0)
-                {
-                    state = 1;
-                }
-                else
-                {
-                    state = 3;
-                    count++;
-                }
-            }
-            else
+        if (*q >= '0' && *q <= '9')
+        {
+            int32_t e = 0;
+
+            for (; *q >= '0' && *q <= '9'; q++)
             {
-                number_str.push_back(ch);
+                if (e < 100000)
+                    e = e*10 + (*q - '0');
             }
+
+            exp10 += (exp_negative) ? -e : e;
+            p = q;
         }
-        else if (state == 3)
+    }
+
+    if (mantissa == 0 && !truncated)
+    {
+        *value = (negative) ? -0.0f : 0.0f;
+        return p;
+    }
+
+    if (!truncated && mantissa <= (1ULL << 53) && exp10 >= -22 && exp10 <= 22)
+    {
+        double d = (double)mantissa;
+
+        if (exp10 < 0)
+            d /= exact_pow10[-exp10];
+        else
+            d *= exact_pow10[exp10];
+
+        uint64_t d_bits;
+        memcpy(&d_bits, &d, sizeof(double));
+
+        // 29 bits are dropped going to float, halfway is 1 followed by zeros
+        if ((d_bits & ((1ULL << 29) - 1)) != (1ULL << 28))
         {
-            if (ch != ',')
+            float f = (float)d;
+            *value = (negative) ? -f : f;
+            return p;
+        }
+    }
+
+    return chars_to_float_slow(start, p, str, value);
+}
+
+void Utils::AppendFloats(std::string &str, const float *values, size_t count, const char *separator)
+{
+    if (count == 0)
+        return;
+
+    const size_t sep_len = strlen(separator);
+    const size_t pos = str.length();
+
+    str.resize(pos + count*(FLOAT_CHARS_MAX + sep_len));
+
+    char *start = &str[0];
+    char *p = start + pos;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        if (i != 0)
+        {
+            memcpy(p, separator, sep_len);
+            p += sep_len;
+        }
+
+        p = FloatToChars(p, values[i]);
+    }
+
+    str.resize(p - start);
+}
+
+size_t Utils::GetMultipleFloats(const char *str, float *values, size_t max_count)
+{
+    if (*str == 0 || strcmp(str, "NULL") == 0)
+        return 0;
+
+    size_t count = 0;
+    const char *p = str;
+
+    while (true)
+    {
+        const char *sep = strchr(p, ',');
+        const char *item_end = (sep) ? sep : p + strlen(p);
+
+        while (p < item_end && *p > 0 && *p <= ' ')
+            p++;
+
+        // Items with only spaces are skipped, like GetMultipleStrings does
+        if (p != item_end)
+        {
+            if (count == max_count)
                 return (size_t)-1;
 
-            state = 0;
+            const char *end = CharsToFloat(p, &values[count]);
+
+            if (end == p)
+                return (size_t)-1;
+
+            count++;
         }
+
+        if (!sep)
+            break;
+
+        p = sep + 1;
     }
 
-    if (state != 0 && state != 3)
-        return (size_t)-1;
+    return count;
+}
+
+size_t Utils::GetMultipleFloats(const char *str, std::vector<float> &values)
+{
+    size_t max_count = 1;
+
+    for (const char *p = str; *p; p++)
+    {
+        if (*p == ',')
+            max_count++;
+    }
 
+    values.resize(max_count);
+
+    size_t count = GetMultipleFloats(str, values.data(), max_count);
+
+    if (count == (size_t)-1)
+    {
+        values.clear();
+        return count;
+    }
+
+    values.resize(count);
     return count;
 }
 
-std::string Utils::Vectors4DToString(const float *vectors, size_t count)
+// "{ x, y }, { x, y }..." written in a buffer sized once
+static std::string VectorsToString(const float *vectors, size_t count, size_t dim)
 {
     std::string str;
-    const float *ptr = vectors;
+    str.resize(count * (dim*(FLOAT_CHARS_MAX + 2) + 6));
+
+    char *start = &str[0];
+    char *p = start;
 
     for (size_t i = 0; i < count; i++)
     {
-        str += "{ ";
-        str += FloatToString(*ptr++);
-        str += ", ";
-        str += FloatToString(*ptr++);
-        str += ", ";
-        str += FloatToString(*ptr++);
-        str += ", ";
-        str += FloatToString(*ptr++);
-        str += " }";
+        memcpy(p, "{ ", 2);
+        p += 2;
+
+        for (size_t j = 0; j < dim; j++)
+        {
+            if (j != 0)
+            {
+                memcpy(p, ", ", 2);
+                p += 2;
+            }
+
+            p = Utils::FloatToChars(p, *vectors++);
+        }
+
+        memcpy(p, " }", 2);
+        p += 2;
 
         if (i != (count-1))
-            str += ", ";
+        {
+            memcpy(p, ", ", 2);
+            p += 2;
+        }
     }
 
+    str.resize(p - start);
     return str;
 }
 
-size_t Utils::GetVectors4DFromString(const std::string &str, std::vector<float> &vectors)
+// Parses "{ x, y }, { x, y }...". Spaces are ignored anywhere (even inside a number, like it always was), numbers are
+// read in place and only copied when they have spaces in the middle.
+static size_t GetVectorsFromString(const std::string &str, std::vector<float> &vectors, size_t dim)
 {
     size_t count = 0;
     int state = 0; // 0 -> waiting '{'; 1 -> waiting number; 2 -> in number; 3 -> waiting ',' (between '}' and '{')
+    size_t num_comps = 0;
+
+    const char *number = nullptr;
+    bool space_in_number = false;
+    bool compact = false;
 
-    std::string number_str;
     vectors.clear();
+    vectors.reserve(str.length() / (dim*4 + 4));
 
-    for (char ch : str)
+    for (const char *p = str.c_str(), *end = p + str.length(); p < end; p++)
     {
+        const char ch = *p;
+
         if (ch <= ' ')
+        {
+            if (state == 2)
+                space_in_number = true;
+
             continue;
+        }
 
         if (state == 0)
         {
@@ -434,51 +855,54 @@ size_t Utils::GetVectors4DFromString(const std::string &str, std::vector<float>
             if (ch == '{' || ch == ',' || ch == '}')
                 return (size_t)-1;
 
-            number_str.clear();
-            number_str.push_back(ch);
+            number = p;
+            space_in_number = false;
+            compact = false;
             state = 2;
         }
         else if (state == 2)
         {
-            bool num_finished = false;
-
-            if (ch == ',')
+            if (ch == ',' || ch == '}')
             {
-                if ((vectors.size() % 4) == 3)
+                if ((ch == ',') == (num_comps == dim-1))
                     return (size_t)-1;
 
-                num_finished = true;
-            }
-            else if (ch == '}')
-            {
-                if ((vectors.size() % 4) != 3)
-                    return (size_t)-1;
+                float value;
 
-                num_finished = true;
-            }
+                if (compact)
+                {
+                    std::string number_str;
 
-            if (num_finished)
-            {
-                float value;
+                    for (const char *n = number; n < p; n++)
+                    {
+                        if (*n > ' ')
+                            number_str.push_back(*n);
+                    }
 
-                if (sscanf(number_str.c_str(), "%f", &value) != 1)
+                    if (Utils::CharsToFloat(number_str.c_str(), &value) == number_str.c_str())
+                        return (size_t)-1;
+                }
+                else if (Utils::CharsToFloat(number, &value) == number)
+                {
                     return (size_t)-1;
+                }
 
                 vectors.push_back(value);
 
-                if ((vectors.size() % 4) != 0)
+                if (++num_comps != dim)
                 {
                     state = 1;
                 }
                 else
                 {
+                    num_comps = 0;
                     state = 3;
                     count++;
                 }
             }
-            else
+            else if (space_in_number)
             {
-                number_str.push_back(ch);
+                compact = true;
             }
         }
         else if (state == 3)
@@ -496,6 +920,36 @@ size_t Utils::GetVectors4DFromString(const std::string &str, std::vector<float>
     return count;
 }
 
+std::string Utils::Vectors2DToString(const float *vectors, size_t count)
+{
+    return VectorsToString(vectors, count, 2);
+}
+
+size_t Utils::GetVectors2DFromString(const std::string &str, std::vector<float> &vectors)
+{
+    return GetVectorsFromString(str, vectors, 2);
+}
+
+std::string Utils::Vectors3DToString(const float *vectors, size_t count)
+{
+    return VectorsToString(vectors, count, 3);
+}
+
+size_t Utils::GetVectors3DFromString(const std::string &str, std::vector<float> &vectors)
+{
+    return GetVectorsFromString(str, vectors, 3);
+}
+
+std::string Utils::Vectors4DToString(const float *vectors, size_t count)
+{
+    return VectorsToString(vectors, count, 4);
+}
+
+size_t Utils::GetVectors4DFromString(const std::string &str, std::vector<float> &vectors)
+{
+    return GetVectorsFromString(str, vectors, 4);
+}
+
 void Utils::TrimString(std::string & str, bool trim_left, bool trim_right)
 {
     size_t pos = 0;
@@ -840,14 +1294,7 @@ std::string Utils::ToSingleString(const std::vector<float> &list)
 {
     std::string ret;
 
-    for (float f: list)
-    {
-        if (ret.length() != 0)
-            ret += ", ";
-
-        ret += FloatToString(f);
-    }
-
+    AppendFloats(ret, list.data(), list.size());
     return ret;
 }
 
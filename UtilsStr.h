@@ -3,6 +3,8 @@
 
 #include "Utils.h"
 
+#define FLOAT_CHARS_MAX 24
+
 namespace Utils
 {
     void TrimString(std::string &str, bool trim_left=true, bool trim_right=true);
@@ -40,8 +42,20 @@ namespace Utils
 
     std::string SignedToString(int64_t value);
 
+    // Shortest text that reads back to the same float, in the "%.9g" style (plus ".0" for integers).
+    // FloatToChars writes up to FLOAT_CHARS_MAX chars without terminator and returns the end.
+    char *FloatToChars(char *out, float value);
     std::string FloatToString(float value);
 
+    // Like strtof (leading spaces skipped, returns str if there is no number), with a fast path for plain decimals
+    const char *CharsToFloat(const char *str, float *value);
+
+    // Whole arrays. AppendFloats sizes the string once; GetMultipleFloats follows the rules of GetMultipleStrings
+    // with ',' and returns the count, or (size_t)-1 on an item that isn't a number or more than max_count items.
+    void AppendFloats(std::string &str, const float *values, size_t count, const char *separator=", ");
+    size_t GetMultipleFloats(const char *str, float *values, size_t max_count);
+    size_t GetMultipleFloats(const char *str, std::vector<float> &values);
+
     std::string Vectors2DToString(const float *vectors, size_t count);
     size_t GetVectors2DFromString(const std::string &str, std::vector<float> &vectors);
 
@@ -1,13 +1,26 @@
 #include "UtilsXML.h"
+#include "XmlReader.h"
+#include "XmlWriter.h"
 #include "debug.h"
 
 TiXmlElement *Utils::FindRoot(TiXmlHandle *handle, const std::string &root_name)
 {
     for (TiXmlElement *elem = handle->FirstChildElement().Element(); elem != nullptr; elem = elem->NextSiblingElement())
     {
-        std::string name = elem->ValueStr();
+        if (elem->ValueStr() == root_name)
+        {
+            return elem;
+        }
+    }
 
-        if (name == root_name)
+    return nullptr;
+}
+
+const XmlElement *Utils::FindRoot(const XmlDocument *doc, const std::string &root_name)
+{
+    for (const XmlElement *elem = doc->FirstChildElement(); elem != nullptr; elem = elem->NextSiblingElement())
+    {
+        if (elem->ValueStr() == root_name)
         {
             return elem;
         }
@@ -16,11 +29,22 @@ TiXmlElement *Utils::FindRoot(TiXmlHandle *handle, const std::string &root_name)
     return nullptr;
 }
 
-size_t Utils::GetElemCount(const TiXmlElement *root, const char *name, const TiXmlElement **first)
+// The "value" attribute of the first child element with that name, nothing is copied.
+// FirstChildElement uses the child index of tinyxml (or the sorted children of XmlElement), so reading all the
+// params of a big element is linear.
+template<typename E>
+static const char *GetParamValue(const E *root, const char *name)
+{
+    const E *elem = root->FirstChildElement(name);
+    return (elem) ? elem->Attribute("value") : nullptr;
+}
+
+template<typename E>
+size_t Utils::GetElemCount(const E *root, const char *name, const E **first)
 {
     size_t count = 0;
 
-    for (const TiXmlElement *elem = root->FirstChildElement(); elem; elem = elem->NextSiblingElement())
+    for (const E *elem = root->FirstChildElement(); elem; elem = elem->NextSiblingElement())
     {
         if (elem->ValueStr() == name)
         {
@@ -122,7 +146,77 @@ void Utils::WriteParamBoolean(TiXmlElement *root, const char *name, bool value)
     root->LinkEndChild(param);
 }
 
-bool Utils::ReadAttrString(const TiXmlElement *root, const char *name, std::string & value)
+static void WriteParamValue(XmlWriter *writer, const char *name, const char *value)
+{
+    writer->StartElement(name);
+    writer->Attribute("value", value);
+    writer->EndElement();
+}
+
+void Utils::WriteParamString(XmlWriter *writer, const char *name, const std::string &value)
+{
+    WriteParamValue(writer, name, value.c_str());
+}
+
+void Utils::WriteParamMultipleStrings(XmlWriter *writer, const char *name, const std::vector<std::string> &values)
+{
+    WriteParamValue(writer, name, ToSingleString(values).c_str());
+}
+
+void Utils::WriteParamUnsigned(XmlWriter *writer, const char *name, uint64_t value, bool hexadecimal)
+{
+    WriteParamValue(writer, name, UnsignedToString(value, hexadecimal).c_str());
+}
+
+void Utils::WriteParamSigned(XmlWriter *writer, const char *name, int64_t value)
+{
+    WriteParamValue(writer, name, SignedToString(value).c_str());
+}
+
+void Utils::WriteParamMultipleUnsigned(XmlWriter *writer, const char *name, const std::vector<uint32_t> &values, bool hexadecimal)
+{
+    WriteParamValue(writer, name, ToSingleString(values, hexadecimal).c_str());
+}
+
+void Utils::WriteParamMultipleUnsigned(XmlWriter *writer, const char *name, const std::vector<uint16_t> &values, bool hexadecimal)
+{
+    WriteParamValue(writer, name, ToSingleString(values, hexadecimal).c_str());
+}
+
+void Utils::WriteParamMultipleUnsigned(XmlWriter *writer, const char *name, const std::vector<uint8_t> &values, bool hexadecimal)
+{
+    WriteParamValue(writer, name, ToSingleString(values, hexadecimal).c_str());
+}
+
+void Utils::WriteParamFloat(XmlWriter *writer, const char *name, float value)
+{
+    WriteParamValue(writer, name, FloatToString(value).c_str());
+}
+
+void Utils::WriteParamMultipleFloats(XmlWriter *writer, const char *name, const std::vector<float> &values)
+{
+    WriteParamValue(writer, name, ToSingleString(values).c_str());
+}
+
+void Utils::WriteParamGUID(XmlWriter *writer, const char *name, const uint8_t *value)
+{
+    WriteParamValue(writer, name, Utils::GUID2String(value).c_str());
+}
+
+void Utils::WriteParamBlob(XmlWriter *writer, const char *name, const uint8_t *value, size_t size)
+{
+    writer->StartElement(name);
+    writer->CData(Base64Encode(value, size, true));
+    writer->EndElement();
+}
+
+void Utils::WriteParamBoolean(XmlWriter *writer, const char *name, bool value)
+{
+    WriteParamValue(writer, name, (value) ? "true" : "false");
+}
+
+template<typename E>
+bool Utils::ReadAttrString(const E *root, const char *name, std::string & value)
 {
     if (root->QueryStringAttribute(name, &value) != TIXML_SUCCESS)
         return false;
@@ -130,7 +224,8 @@ bool Utils::ReadAttrString(const TiXmlElement *root, const char *name, std::stri
     return true;
 }
 
-bool Utils::ReadAttrMultipleStrings(const TiXmlElement *root, const char *name, std::vector<std::string> &values, char separator, bool omit_empty)
+template<typename E>
+bool Utils::ReadAttrMultipleStrings(const E *root, const char *name, std::vector<std::string> &values, char separator, bool omit_empty)
 {
     std::string str;
 
@@ -141,7 +236,8 @@ bool Utils::ReadAttrMultipleStrings(const TiXmlElement *root, const char *name,
     return true;
 }
 
-bool Utils::ReadAttrUnsigned(const TiXmlElement *root,  const char *name, uint32_t *value)
+template<typename E>
+bool Utils::ReadAttrUnsigned(const E *root,  const char *name, uint32_t *value)
 {
     std::string str;
 
@@ -152,7 +248,8 @@ bool Utils::ReadAttrUnsigned(const TiXmlElement *root,  const char *name, uint32
     return true;
 }
 
-bool Utils::ReadAttrUnsigned(const TiXmlElement *root,  const char *name, uint64_t *value)
+template<typename E>
+bool Utils::ReadAttrUnsigned(const E *root,  const char *name, uint64_t *value)
 {
     std::string str;
 
@@ -163,7 +260,8 @@ bool Utils::ReadAttrUnsigned(const TiXmlElement *root,  const char *name, uint64
     return true;
 }
 
-bool Utils::ReadAttrUnsigned(const TiXmlElement *root, const char *name, uint16_t *value)
+template<typename E>
+bool Utils::ReadAttrUnsigned(const E *root, const char *name, uint16_t *value)
 {
     std::string str;
 
@@ -178,7 +276,8 @@ bool Utils::ReadAttrUnsigned(const TiXmlElement *root, const char *name, uint16_
     return true;
 }
 
-bool Utils::ReadAttrUnsigned(const TiXmlElement *root, const char *name, uint8_t *value)
+template<typename E>
+bool Utils::ReadAttrUnsigned(const E *root, const char *name, uint8_t *value)
 {
     std::string str;
 
@@ -193,7 +292,8 @@ bool Utils::ReadAttrUnsigned(const TiXmlElement *root, const char *name, uint8_t
     return true;
 }
 
-bool Utils::ReadAttrSigned(const TiXmlElement *root,  const char *name, int32_t *value)
+template<typename E>
+bool Utils::ReadAttrSigned(const E *root,  const char *name, int32_t *value)
 {
     std::string str;
 
@@ -204,7 +304,8 @@ bool Utils::ReadAttrSigned(const TiXmlElement *root,  const char *name, int32_t
     return true;
 }
 
-bool Utils::ReadAttrSigned(const TiXmlElement *root,  const char *name, int16_t *value)
+template<typename E>
+bool Utils::ReadAttrSigned(const E *root,  const char *name, int16_t *value)
 {
     int32_t value32;
 
@@ -218,7 +319,8 @@ bool Utils::ReadAttrSigned(const TiXmlElement *root,  const char *name, int16_t
     return true;
 }
 
-bool Utils::ReadAttrSigned(const TiXmlElement *root,  const char *name, int8_t *value)
+template<typename E>
+bool Utils::ReadAttrSigned(const E *root,  const char *name, int8_t *value)
 {
     int32_t value32;
 
@@ -232,7 +334,8 @@ bool Utils::ReadAttrSigned(const TiXmlElement *root,  const char *name, int8_t *
     return true;
 }
 
-bool Utils::ReadAttrMultipleUnsigned(const TiXmlElement *root, const char *name, std::vector<uint8_t> &values)
+template<typename E>
+bool Utils::ReadAttrMultipleUnsigned(const E *root, const char *name, std::vector<uint8_t> &values)
 {
     std::vector<std::string> values_str;
 
@@ -256,7 +359,8 @@ bool Utils::ReadAttrMultipleUnsigned(const TiXmlElement *root, const char *name,
     return true;
 }
 
-bool Utils::ReadAttrMultipleUnsigned(const TiXmlElement *root, const char *name, uint8_t *values, size_t count)
+template<typename E>
+bool Utils::ReadAttrMultipleUnsigned(const E *root, const char *name, uint8_t *values, size_t count)
 {
     std::vector<uint8_t> vec;
 
@@ -270,7 +374,8 @@ bool Utils::ReadAttrMultipleUnsigned(const TiXmlElement *root, const char *name,
     return true;
 }
 
-bool Utils::ReadAttrMultipleSigned(const TiXmlElement *root, const char *name, std::vector<int32_t> &values)
+template<typename E>
+bool Utils::ReadAttrMultipleSigned(const E *root, const char *name, std::vector<int32_t> &values)
 {
     std::vector<std::string> values_str;
 
@@ -289,7 +394,8 @@ bool Utils::ReadAttrMultipleSigned(const TiXmlElement *root, const char *name, s
     return true;
 }
 
-bool Utils::ReadAttrMultipleSigned(const TiXmlElement *root, const char *name, int32_t *values, size_t count)
+template<typename E>
+bool Utils::ReadAttrMultipleSigned(const E *root, const char *name, int32_t *values, size_t count)
 {
     std::vector<int32_t> vec;
 
@@ -303,7 +409,8 @@ bool Utils::ReadAttrMultipleSigned(const TiXmlElement *root, const char *name, i
     return true;
 }
 
-bool Utils::ReadAttrFloat(const TiXmlElement *root, const char *name, float *value)
+template<typename E>
+bool Utils::ReadAttrFloat(const E *root, const char *name, float *value)
 {
     std::string str;
 
@@ -313,45 +420,32 @@ bool Utils::ReadAttrFloat(const TiXmlElement *root, const char *name, float *val
     return true;
 }
 
-bool Utils::ReadAttrMultipleFloats(const TiXmlElement *root, const char *name, std::vector<float> &values)
+template<typename E>
+bool Utils::ReadAttrMultipleFloats(const E *root, const char *name, std::vector<float> &values)
 {
-    std::vector<std::string> values_str;
+    const char *str = root->Attribute(name);
 
     values.clear();
 
-    if (!ReadAttrMultipleStrings(root, name, values_str))
+    if (!str)
         return false;
 
-    values.reserve(values_str.size());
-
-    for (const std::string &s : values_str)
-    {
-        float value;
-
-        if (sscanf(s.c_str(), "%f", &value) != 1)
-            return false;
-
-        values.push_back(value);
-    }
-
-    return true;
+    return (GetMultipleFloats(str, values) != (size_t)-1);
 }
 
-bool Utils::ReadAttrMultipleFloats(const TiXmlElement *root, const char *name, float *values, size_t count)
+template<typename E>
+bool Utils::ReadAttrMultipleFloats(const E *root, const char *name, float *values, size_t count)
 {
-    std::vector<float> vec;
+    const char *str = root->Attribute(name);
 
-    if (!ReadAttrMultipleFloats(root, name, vec))
+    if (!str)
         return false;
 
-    if (vec.size() != count)
-         return false;
-
-    memcpy(values, vec.data(), count*sizeof(float));
-    return true;
+    return (GetMultipleFloats(str, values, count) == count);
 }
 
-bool Utils::ReadAttrBoolean(const TiXmlElement *root, const char *name, bool *value)
+template<typename E>
+bool Utils::ReadAttrBoolean(const E *root, const char *name, bool *value)
 {
     std::string str;
     if (!ReadAttrString(root, name, str))
@@ -370,33 +464,22 @@ bool Utils::ReadAttrBoolean(const TiXmlElement *root, const char *name, bool *va
     return true;
 }
 
-bool Utils::ReadParamString(const TiXmlElement *root, const char *name, std::string &value, const TiXmlElement **ret)
+template<typename E>
+bool Utils::ReadParamString(const E *root, const char *name, std::string &value, const E **ret)
 {
-    bool found = false;
+    const E *elem = root->FirstChildElement(name);
 
-    for (const TiXmlElement *elem = root->FirstChildElement(); elem != nullptr; elem = elem->NextSiblingElement())
-    {
-        std::string str;
-
-        str = elem->ValueStr();
-
-        if (str == name)
-        {
-            if (elem->QueryStringAttribute("value", &value) != TIXML_SUCCESS)
-                return false;
-
-            found = true;
-            if (ret)
-                *ret = elem;
+    if (!elem || elem->QueryStringAttribute("value", &value) != TIXML_SUCCESS)
+        return false;
 
-            break;
-        }
-    }
+    if (ret)
+        *ret = elem;
 
-    return found;
+    return true;
 }
 
-bool Utils::ReadParamMultipleStrings(const TiXmlElement *root, const char *name, std::vector<std::string> & values, const TiXmlElement **ret)
+template<typename E>
+bool Utils::ReadParamMultipleStrings(const E *root, const char *name, std::vector<std::string> & values, const E **ret)
 {
     std::string str;
 
@@ -407,29 +490,32 @@ bool Utils::ReadParamMultipleStrings(const TiXmlElement *root, const char *name,
     return true;
 }
 
-bool Utils::ReadParamUnsigned(const TiXmlElement *root, const char *name, uint32_t *value)
+template<typename E>
+bool Utils::ReadParamUnsigned(const E *root, const char *name, uint32_t *value)
 {
-    std::string str;
+    const char *str = GetParamValue(root, name);
 
-    if (!ReadParamString(root, name, str))
+    if (!str)
         return false;
 
-    *value = GetUnsigned(str.c_str());
+    *value = GetUnsigned(str);
     return true;
 }
 
-bool Utils::ReadParamUnsigned(const TiXmlElement *root, const char *name, uint64_t *value)
+template<typename E>
+bool Utils::ReadParamUnsigned(const E *root, const char *name, uint64_t *value)
 {
-    std::string str;
+    const char *str = GetParamValue(root, name);
 
-    if (!ReadParamString(root, name, str))
+    if (!str)
         return false;
 
-    *value = GetUnsigned64(str.c_str());
+    *value = GetUnsigned64(str);
     return true;
 }
 
-bool Utils::ReadParamUnsigned(const TiXmlElement *root, const char *name, uint16_t *value)
+template<typename E>
+bool Utils::ReadParamUnsigned(const E *root, const char *name, uint16_t *value)
 {
     uint32_t temp;
 
@@ -443,7 +529,8 @@ bool Utils::ReadParamUnsigned(const TiXmlElement *root, const char *name, uint16
     return true;
 }
 
-bool Utils::ReadParamUnsigned(const TiXmlElement *root, const char *name, uint8_t *value)
+template<typename E>
+bool Utils::ReadParamUnsigned(const E *root, const char *name, uint8_t *value)
 {
     uint32_t temp;
 
@@ -457,7 +544,8 @@ bool Utils::ReadParamUnsigned(const TiXmlElement *root, const char *name, uint8_
     return true;
 }
 
-bool Utils::ReadParamMultipleUnsigned(const TiXmlElement *root, const char *name, std::vector<uint32_t> &values)
+template<typename E>
+bool Utils::ReadParamMultipleUnsigned(const E *root, const char *name, std::vector<uint32_t> &values)
 {
     std::vector<std::string> values_str;
 
@@ -476,7 +564,8 @@ bool Utils::ReadParamMultipleUnsigned(const TiXmlElement *root, const char *name
     return true;
 }
 
-bool Utils::ReadParamMultipleUnsigned(const TiXmlElement *root, const char *name, std::vector<uint16_t> &values)
+template<typename E>
+bool Utils::ReadParamMultipleUnsigned(const E *root, const char *name, std::vector<uint16_t> &values)
 {
     std::vector<std::string> values_str;
 
@@ -500,7 +589,8 @@ bool Utils::ReadParamMultipleUnsigned(const TiXmlElement *root, const char *name
     return true;
 }
 
-bool Utils::ReadParamMultipleUnsigned(const TiXmlElement *root, const char *name, std::vector<uint8_t> &values)
+template<typename E>
+bool Utils::ReadParamMultipleUnsigned(const E *root, const char *name, std::vector<uint8_t> &values)
 {
     std::vector<std::string> values_str;
 
@@ -524,7 +614,8 @@ bool Utils::ReadParamMultipleUnsigned(const TiXmlElement *root, const char *name
     return true;
 }
 
-bool Utils::ReadParamMultipleUnsigned(const TiXmlElement *root, const char *name, uint32_t *values, size_t count)
+template<typename E>
+bool Utils::ReadParamMultipleUnsigned(const E *root, const char *name, uint32_t *values, size_t count)
 {
     std::vector<uint32_t> vec;
 
@@ -538,7 +629,8 @@ bool Utils::ReadParamMultipleUnsigned(const TiXmlElement *root, const char *name
     return true;
 }
 
-bool Utils::ReadParamMultipleUnsigned(const TiXmlElement *root, const char *name, uint16_t *values, size_t count)
+template<typename E>
+bool Utils::ReadParamMultipleUnsigned(const E *root, const char *name, uint16_t *values, size_t count)
 {
     std::vector<uint16_t> vec;
 
@@ -552,7 +644,8 @@ bool Utils::ReadParamMultipleUnsigned(const TiXmlElement *root, const char *name
     return true;
 }
 
-bool Utils::ReadParamMultipleUnsigned(const TiXmlElement *root, const char *name, uint8_t *values, size_t count)
+template<typename E>
+bool Utils::ReadParamMultipleUnsigned(const E *root, const char *name, uint8_t *values, size_t count)
 {
     std::vector<uint8_t> vec;
 
@@ -566,79 +659,52 @@ bool Utils::ReadParamMultipleUnsigned(const TiXmlElement *root, const char *name
     return true;
 }
 
-bool Utils::ReadParamSigned(const TiXmlElement *root, const char *name, int32_t *value)
+template<typename E>
+bool Utils::ReadParamSigned(const E *root, const char *name, int32_t *value)
 {
-    std::string str;
+    const char *str = GetParamValue(root, name);
 
-    if (!ReadParamString(root, name, str))
+    if (!str)
         return false;
 
-    *value = GetSigned(str.c_str());
+    *value = GetSigned(str);
     return true;
 }
 
-bool Utils::ReadParamFloat(const TiXmlElement *root, const char *name, float *value)
+template<typename E>
+bool Utils::ReadParamFloat(const E *root, const char *name, float *value)
 {
-    bool found = false;
-
-    for (const TiXmlElement *elem = root->FirstChildElement(); elem != NULL; elem = elem->NextSiblingElement())
-    {
-        std::string str;
-
-        str = elem->ValueStr();
+    const E *elem = root->FirstChildElement(name);
 
-        if (str == name)
-        {
-            if (elem->QueryFloatAttribute("value", value) != TIXML_SUCCESS)
-                return false;
-
-            found = true;
-            break;
-        }
-    }
-
-    return found;
+    return (elem && elem->QueryFloatAttribute("value", value) == TIXML_SUCCESS);
 }
 
-bool Utils::ReadParamMultipleFloats(const TiXmlElement *root, const char *name, std::vector<float> &values)
+template<typename E>
+bool Utils::ReadParamMultipleFloats(const E *root, const char *name, std::vector<float> &values)
 {
-    std::vector<std::string> values_str;
+    const char *str = GetParamValue(root, name);
 
     values.clear();
 
-    if (!ReadParamMultipleStrings(root, name, values_str))
+    if (!str)
         return false;
 
-    values.reserve(values_str.size());
-
-    for (const std::string &s : values_str)
-    {
-        float value;
-
-        if (sscanf(s.c_str(), "%f", &value) != 1)
-            return false;
-
-        values.push_back(value);
-    }
-
-    return true;
+    return (GetMultipleFloats(str, values) != (size_t)-1);
 }
 
-bool Utils::ReadParamMultipleFloats(const TiXmlElement *root, const char *name, float *values, size_t count)
+template<typename E>
+bool Utils::ReadParamMultipleFloats(const E *root, const char *name, float *values, size_t count)
 {
-    std::vector<float> vec;
+    const char *str = GetParamValue(root, name);
 
-    if (!ReadParamMultipleFloats(root, name, vec))
+    if (!str)
         return false;
 
-    if (vec.size() != count)
-        return false;
-
-    memcpy(values, vec.data(), count*sizeof(float));
-    return true;
+    return (GetMultipleFloats(str, values, count) == count);
 }
 
-bool Utils::ReadParamGUID(const TiXmlElement *root, const char *name, uint8_t *value)
+template<typename E>
+bool Utils::ReadParamGUID(const E *root, const char *name, uint8_t *value)
 {
     std::string guid;
 
@@ -697,25 +763,20 @@ bool Utils::ReadParamGUID(const TiXmlElement *root, const char *name, uint8_t *v
     return true;
 }
 
-uint8_t *Utils::ReadParamBlob(const TiXmlElement *root, const char *name, size_t *psize)
+template<typename E>
+uint8_t *Utils::ReadParamBlob(const E *root, const char *name, size_t *psize)
 {
-    for (const TiXmlElement *elem = root->FirstChildElement(); elem != NULL; elem = elem->NextSiblingElement())
-    {
-        std::string str;
+    const E *elem = root->FirstChildElement(name);
 
-        str = elem->ValueStr();
+    if (!elem)
+        return nullptr;
 
-        if (str == name)
-        {
-            std::string base64_data = elem->GetText();
-            return Base64Decode(base64_data, psize);
-        }
-    }
-
-    return nullptr;
+    std::string base64_data = elem->GetText();
+    return Base64Decode(base64_data, psize);
 }
 
-bool Utils::ReadParamBlob(const TiXmlElement *root, const char *name, std::vector<uint8_t> &value)
+template<typename E>
+bool Utils::ReadParamBlob(const E *root, const char *name, std::vector<uint8_t> &value)
 {
     size_t size;
     uint8_t *buf = ReadParamBlob(root, name, &size);
@@ -728,7 +789,8 @@ bool Utils::ReadParamBlob(const TiXmlElement *root, const char *name, std::vecto
     return true;
 }
 
-bool Utils::ReadParamUnsignedWithMultipleNames(const TiXmlElement *root, uint32_t *value, const char *name1, const char *name2, const char *name3, const char *name4, const char *name5)
+template<typename E>
+bool Utils::ReadParamUnsignedWithMultipleNames(const E *root, uint32_t *value, const char *name1, const char *name2, const char *name3, const char *name4, const char *name5)
 {
     if (ReadParamUnsigned(root, name1, value))
         return true;
@@ -745,7 +807,8 @@ bool Utils::ReadParamUnsignedWithMultipleNames(const TiXmlElement *root, uint32_
     return (name5 && ReadParamUnsigned(root, name5, value));
 }
 
-bool Utils::ReadParamUnsignedWithMultipleNames(const TiXmlElement *root, uint16_t *value, const char *name1, const char *name2, const char *name3, const char *name4, const char *name5)
+template<typename E>
+bool Utils::ReadParamUnsignedWithMultipleNames(const E *root, uint16_t *value, const char *name1, const char *name2, const char *name3, const char *name4, const char *name5)
 {
     if (ReadParamUnsigned(root, name1, value))
         return true;
@@ -762,7 +825,8 @@ bool Utils::ReadParamUnsignedWithMultipleNames(const TiXmlElement *root, uint16_
     return (name5 && ReadParamUnsigned(root, name5, value));
 }
 
-bool Utils::ReadParamFloatWithMultipleNames(const TiXmlElement *root, float *value, const char *name1, const char *name2, const char *name3, const char *name4, const char *name5)
+template<typename E>
+bool Utils::ReadParamFloatWithMultipleNames(const E *root, float *value, const char *name1, const char *name2, const char *name3, const char *name4, const char *name5)
 {
     if (ReadParamFloat(root, name1, value))
         return true;
@@ -779,7 +843,8 @@ bool Utils::ReadParamFloatWithMultipleNames(const TiXmlElement *root, float *val
     return (name5 && ReadParamFloat(root, name5, value));
 }
 
-bool Utils::ReadParamBoolean(const TiXmlElement *root, const char *name, bool *value)
+template<typename E>
+bool Utils::ReadParamBoolean(const E *root, const char *name, bool *value)
 {
     std::string str;
 
@@ -799,7 +864,8 @@ bool Utils::ReadParamBoolean(const TiXmlElement *root, const char *name, bool *v
     return true;
 }
 
-bool Utils::GetParamString(const TiXmlElement *root, const char *name, std::string &value, const TiXmlElement **ret)
+template<typename E>
+bool Utils::GetParamString(const E *root, const char *name, std::string &value, const E **ret)
 {
     if (!ReadParamString(root, name, value, ret))
     {
@@ -810,7 +876,8 @@ bool Utils::GetParamString(const TiXmlElement *root, const char *name, std::stri
     return true;
 }
 
-bool Utils::GetParamMultipleStrings(const TiXmlElement *root, const char *name, std::vector<std::string> & values, const TiXmlElement **ret)
+template<typename E>
+bool Utils::GetParamMultipleStrings(const E *root, const char *name, std::vector<std::string> & values, const E **ret)
 {
     if (!ReadParamMultipleStrings(root, name, values, ret))
     {
@@ -821,7 +888,8 @@ bool Utils::GetParamMultipleStrings(const TiXmlElement *root, const char *name,
     return true;
 }
 
-bool Utils::GetParamUnsigned(const TiXmlElement *root, const char *name, uint32_t *value)
+template<typename E>
+bool Utils::GetParamUnsigned(const E *root, const char *name, uint32_t *value)
 {
     if (!ReadParamUnsigned(root, name, value))
     {
@@ -832,7 +900,8 @@ bool Utils::GetParamUnsigned(const TiXmlElement *root, const char *name, uint32_
     return true;
 }
 
-bool Utils::GetParamUnsigned(const TiXmlElement *root, const char *name, uint64_t *value)
+template<typename E>
+bool Utils::GetParamUnsigned(const E *root, const char *name, uint64_t *value)
 {
     if (!ReadParamUnsigned(root, name, value))
     {
@@ -843,7 +912,8 @@ bool Utils::GetParamUnsigned(const TiXmlElement *root, const char *name, uint64_
     return true;
 }
 
-bool Utils::GetParamUnsigned(const TiXmlElement *root, const char *name, uint16_t *value)
+template<typename E>
+bool Utils::GetParamUnsigned(const E *root, const char *name, uint16_t *value)
 {
     uint32_t temp;
 
@@ -860,7 +930,8 @@ bool Utils::GetParamUnsigned(const TiXmlElement *root, const char *name, uint16_
     return true;
 }
 
-bool Utils::GetParamUnsigned(const TiXmlElement *root, const char *name, uint8_t *value)
+template<typename E>
+bool Utils::GetParamUnsigned(const E *root, const char *name, uint8_t *value)
 {
     uint32_t temp;
 
@@ -877,7 +948,8 @@ bool Utils::GetParamUnsigned(const TiXmlElement *root, const char *name, uint8_t
     return true;
 }
 
-bool Utils::GetParamMultipleUnsigned(const TiXmlElement *root, const char *name, std::vector<uint32_t> &values)
+template<typename E>
+bool Utils::GetParamMultipleUnsigned(const E *root, const char *name, std::vector<uint32_t> &values)
 {
     if (!ReadParamMultipleUnsigned(root, name, values))
     {
@@ -888,7 +960,8 @@ bool Utils::GetParamMultipleUnsigned(const TiXmlElement *root, const char *name,
     return true;
 }
 
-bool Utils::GetParamMultipleUnsigned(const TiXmlElement *root, const char *name, std::vector<uint16_t> &values)
+template<typename E>
+bool Utils::GetParamMultipleUnsigned(const E *root, const char *name, std::vector<uint16_t> &values)
 {
     if (!ReadParamMultipleUnsigned(root, name, values))
     {
@@ -899,7 +972,8 @@ bool Utils::GetParamMultipleUnsigned(const TiXmlElement *root, const char *name,
     return true;
 }
 
-bool Utils::GetParamMultipleUnsigned(const TiXmlElement *root, const char *name, std::vector<uint8_t> &values)
+template<typename E>
+bool Utils::GetParamMultipleUnsigned(const E *root, const char *name, std::vector<uint8_t> &values)
 {
     if (!ReadParamMultipleUnsigned(root, name, values))
     {
@@ -910,7 +984,8 @@ bool Utils::GetParamMultipleUnsigned(const TiXmlElement *root, const char *name,
     return true;
 }
 
-bool Utils::GetParamMultipleUnsigned(const TiXmlElement *root, const char *name, uint32_t *values, size_t count)
+template<typename E>
+bool Utils::GetParamMultipleUnsigned(const E *root, const char *name, uint32_t *values, size_t count)
 {
     if (!ReadParamMultipleUnsigned(root, name, values, count))
     {
@@ -921,7 +996,8 @@ bool Utils::GetParamMultipleUnsigned(const TiXmlElement *root, const char *name,
     return true;
 }
 
-bool Utils::GetParamMultipleUnsigned(const TiXmlElement *root, const char *name, uint16_t *values, size_t count)
+template<typename E>
+bool Utils::GetParamMultipleUnsigned(const E *root, const char *name, uint16_t *values, size_t count)
 {
     if (!ReadParamMultipleUnsigned(root, name, values, count))
     {
@@ -932,7 +1008,8 @@ bool Utils::GetParamMultipleUnsigned(const TiXmlElement *root, const char *name,
     return true;
 }
 
-bool Utils::GetParamMultipleUnsigned(const TiXmlElement *root, const char *name, uint8_t *values, size_t count)
+template<typename E>
+bool Utils::GetParamMultipleUnsigned(const E *root, const char *name, uint8_t *values, size_t count)
 {
     if (!ReadParamMultipleUnsigned(root, name, values, count))
     {
@@ -943,7 +1020,8 @@ bool Utils::GetParamMultipleUnsigned(const TiXmlElement *root, const char *name,
     return true;
 }
 
-bool Utils::GetParamSigned(const TiXmlElement *root, const char *name, int32_t *value)
+template<typename E>
+bool Utils::GetParamSigned(const E *root, const char *name, int32_t *value)
 {
     if (!ReadParamSigned(root, name, value))
     {
@@ -954,7 +1032,8 @@ bool Utils::GetParamSigned(const TiXmlElement *root, const char *name, int32_t *
     return true;
 }
 
-bool Utils::GetParamFloat(const TiXmlElement *root, const char *name, float *value)
+template<typename E>
+bool Utils::GetParamFloat(const E *root, const char *name, float *value)
 {
     if (!ReadParamFloat(root, name, value))
     {
@@ -965,7 +1044,8 @@ bool Utils::GetParamFloat(const TiXmlElement *root, const char *name, float *val
     return true;
 }
 
-bool Utils::GetParamMultipleFloats(const TiXmlElement *root, const char *name, std::vector<float> &values)
+template<typename E>
+bool Utils::GetParamMultipleFloats(const E *root, const char *name, std::vector<float> &values)
 {
     if (!ReadParamMultipleFloats(root, name, values))
     {
@@ -976,7 +1056,8 @@ bool Utils::GetParamMultipleFloats(const TiXmlElement *root, const char *name, s
     return true;
 }
 
-bool Utils::GetParamMultipleFloats(const TiXmlElement *root, const char *name, float *values, size_t count)
+template<typename E>
+bool Utils::GetParamMultipleFloats(const E *root, const char *name, float *values, size_t count)
 {
     if (!ReadParamMultipleFloats(root, name, values, count))
     {
@@ -987,7 +1068,8 @@ bool Utils::GetParamMultipleFloats(const TiXmlElement *root, const char *name, f
     return true;
 }
 
-bool Utils::GetParamGUID(const TiXmlElement *root, const char *name, uint8_t *value)
+template<typename E>
+bool Utils::GetParamGUID(const E *root, const char *name, uint8_t *value)
 {
     if (!ReadParamGUID(root, name, value))
     {
@@ -998,7 +1080,8 @@ bool Utils::GetParamGUID(const TiXmlElement *root, const char *name, uint8_t *va
     return true;
 }
 
-uint8_t *Utils::GetParamBlob(const TiXmlElement *root, const char *name, size_t *psize)
+template<typename E>
+uint8_t *Utils::GetParamBlob(const E *root, const char *name, size_t *psize)
 {
     uint8_t *ret = ReadParamBlob(root, name, psize);
     if (!ret)
@@ -1009,7 +1092,8 @@ uint8_t *Utils::GetParamBlob(const TiXmlElement *root, const char *name, size_t
     return ret;
 }
 
-bool Utils::GetParamBlob(const TiXmlElement *root, const char *name, std::vector<uint8_t> &value)
+template<typename E>
+bool Utils::GetParamBlob(const E *root, const char *name, std::vector<uint8_t> &value)
 {
     if (!ReadParamBlob(root, name, value))
     {
@@ -1020,7 +1104,8 @@ bool Utils::GetParamBlob(const TiXmlElement *root, const char *name, std::vector
     return true;
 }
 
-bool Utils::GetParamUnsignedWithMultipleNames(const TiXmlElement *root, uint32_t *value, const char *name1, const char *name2, const char *name3, const char *name4, const char *name5)
+template<typename E>
+bool Utils::GetParamUnsignedWithMultipleNames(const E *root, uint32_t *value, const char *name1, const char *name2, const char *name3, const char *name4, const char *name5)
 {
     if (!ReadParamUnsignedWithMultipleNames(root, value, name1, name2, name3, name4, name5))
     {
@@ -1031,7 +1116,8 @@ bool Utils::GetParamUnsignedWithMultipleNames(const TiXmlElement *root, uint32_t
     return true;
 }
 
-bool Utils::GetParamUnsignedWithMultipleNames(const TiXmlElement *root, uint16_t *value, const char *name1, const char *name2, const char *name3, const char *name4, const char *name5)
+template<typename E>
+bool Utils::GetParamUnsignedWithMultipleNames(const E *root, uint16_t *value, const char *name1, const char *name2, const char *name3, const char *name4, const char *name5)
 {
     if (!ReadParamUnsignedWithMultipleNames(root, value, name1, name2, name3, name4, name5))
     {
@@ -1042,7 +1128,8 @@ bool Utils::GetParamUnsignedWithMultipleNames(const TiXmlElement *root, uint16_t
     return true;
 }
 
-bool Utils::GetParamFloatWithMultipleNames(const TiXmlElement *root, float *value, const char *name1, const char *name2, const char *name3, const char *name4, const char *name5)
+template<typename E>
+bool Utils::GetParamFloatWithMultipleNames(const E *root, float *value, const char *name1, const char *name2, const char *name3, const char *name4, const char *name5)
 {
     if (!ReadParamFloatWithMultipleNames(root, value, name1, name2, name3, name4, name5))
     {
@@ -1060,3 +1147,77 @@ void Utils::WriteComment(TiXmlElement *root, const std::string & comment)
     tx_comment->SetValue(comment);
     root->LinkEndChild(tx_comment);
 }
+
+void Utils::WriteComment(XmlWriter *writer, const std::string & comment)
+{
+    writer->Comment(comment);
+}
+
+// Element types the readers are built for
+#define INSTANTIATE_XML_READERS(E) \
+    template size_t Utils::GetElemCount(const E *, const char *, const E **); \
+    template bool Utils::ReadAttrString(const E *, const char *, std::string &); \
+    template bool Utils::ReadAttrMultipleStrings(const E *, const char *, std::vector<std::string> &, char, bool); \
+    template bool Utils::ReadAttrUnsigned(const E *, const char *, uint32_t *); \
+    template bool Utils::ReadAttrUnsigned(const E *, const char *, uint64_t *); \
+    template bool Utils::ReadAttrUnsigned(const E *, const char *, uint16_t *); \
+    template bool Utils::ReadAttrUnsigned(const E *, const char *, uint8_t *); \
+    template bool Utils::ReadAttrSigned(const E *, const char *, int32_t *); \
+    template bool Utils::ReadAttrSigned(const E *, const char *, int16_t *); \
+    template bool Utils::ReadAttrSigned(const E *, const char *, int8_t *); \
+    template bool Utils::ReadAttrMultipleUnsigned(const E *, const char *, std::vector<uint8_t> &); \
+    template bool Utils::ReadAttrMultipleUnsigned(const E *, const char *, uint8_t *, size_t); \
+    template bool Utils::ReadAttrMultipleSigned(const E *, const char *, std::vector<int32_t> &); \
+    template bool Utils::ReadAttrMultipleSigned(const E *, const char *, int32_t *, size_t); \
+    template bool Utils::ReadAttrFloat(const E *, const char *, float *); \
+    template bool Utils::ReadAttrMultipleFloats(const E *, const char *, std::vector<float> &); \
+    template bool Utils::ReadAttrMultipleFloats(const E *, const char *, float *, size_t); \
+    template bool Utils::ReadAttrBoolean(const E *, const char *, bool *); \
+    template bool Utils::ReadParamString(const E *, const char *, std::string &, const E **); \
+    template bool Utils::ReadParamMultipleStrings(const E *, const char *, std::vector<std::string> &, const E **); \
+    template bool Utils::ReadParamUnsigned(const E *, const char *, uint32_t *); \
+    template bool Utils::ReadParamUnsigned(const E *, const char *, uint64_t *); \
+    template bool Utils::ReadParamUnsigned(const E *, const char *, uint16_t *); \
+    template bool Utils::ReadParamUnsigned(const E *, const char *, uint8_t *); \
+    template bool Utils::ReadParamMultipleUnsigned(const E *, const char *, std::vector<uint32_t> &); \
+    template bool Utils::ReadParamMultipleUnsigned(const E *, const char *, std::vector<uint16_t> &); \
+    template bool Utils::ReadParamMultipleUnsigned(const E *, const char *, std::vector<uint8_t> &); \
+    template bool Utils::ReadParamMultipleUnsigned(const E *, const char *, uint32_t *, size_t); \
+    template bool Utils::ReadParamMultipleUnsigned(const E *, const char *, uint16_t *, size_t); \
+    template bool Utils::ReadParamMultipleUnsigned(const E *, const char *, uint8_t *, size_t); \
+    template bool Utils::ReadParamSigned(const E *, const char *, int32_t *); \
+    template bool Utils::ReadParamFloat(const E *, const char *, float *); \
+    template bool Utils::ReadParamMultipleFloats(const E *, const char *, std::vector<float> &); \
+    template bool Utils::ReadParamMultipleFloats(const E *, const char *, float *, size_t); \
+    template bool Utils::ReadParamGUID(const E *, const char *, uint8_t *); \
+    template uint8_t *Utils::ReadParamBlob(const E *, const char *, size_t *); \
+    template bool Utils::ReadParamBlob(const E *, const char *, std::vector<uint8_t> &); \
+    template bool Utils::ReadParamUnsignedWithMultipleNames(const E *, uint32_t *, const char *, const char *, const char *, const char *, const char *); \
+    template bool Utils::ReadParamUnsignedWithMultipleNames(const E *, uint16_t *, const char *, const char *, const char *, const char *, const char *); \
+    template bool Utils::ReadParamFloatWithMultipleNames(const E *, float *, const char *, const char *, const char *, const char *, const char *); \
+    template bool Utils::ReadParamBoolean(const E *, const char *, bool *); \
+    template bool Utils::GetParamString(const E *, const char *, std::string &, const E **); \
+    template bool Utils::GetParamMultipleStrings(const E *, const char *, std::vector<std::string> &, const E **); \
+    template bool Utils::GetParamUnsigned(const E *, const char *, uint32_t *); \
+    template bool Utils::GetParamUnsigned(const E *, const char *, uint64_t *); \
+    template bool Utils::GetParamUnsigned(const E *, const char *, uint16_t *); \
+    template bool Utils::GetParamUnsigned(const E *, const char *, uint8_t *); \
+    template bool Utils::GetParamMultipleUnsigned(const E *, const char *, std::vector<uint32_t> &); \
+    template bool Utils::GetParamMultipleUnsigned(const E *, const char *, std::vector<uint16_t> &); \
+    template bool Utils::GetParamMultipleUnsigned(const E *, const char *, std::vector<uint8_t> &); \
+    template bool Utils::GetParamMultipleUnsigned(const E *, const char *, uint32_t *, size_t); \
+    template bool Utils::GetParamMultipleUnsigned(const E *, const char *, uint16_t *, size_t); \
+    template bool Utils::GetParamMultipleUnsigned(const E *, const char *, uint8_t *, size_t); \
+    template bool Utils::GetParamSigned(const E *, const char *, int32_t *); \
+    template bool Utils::GetParamFloat(const E *, const char *, float *); \
+    template bool Utils::GetParamMultipleFloats(const E *, const char *, std::vector<float> &); \
+    template bool Utils::GetParamMultipleFloats(const E *, const char *, float *, size_t); \
+    template bool Utils::GetParamGUID(const E *, const char *, uint8_t *); \
+    template uint8_t *Utils::GetParamBlob(const E *, const char *, size_t *); \
+    template bool Utils::GetParamBlob(const E *, const char *, std::vector<uint8_t> &); \
+    template bool Utils::GetParamUnsignedWithMultipleNames(const E *, uint32_t *, const char *, const char *, const char *, const char *, const char *); \
+    template bool Utils::GetParamUnsignedWithMultipleNames(const E *, uint16_t *, const char *, const char *, const char *, const char *, const char *); \
+    template bool Utils::GetParamFloatWithMultipleNames(const E *, float *, const char *, const char *, const char *, const char *, const char *);
+
+INSTANTIATE_XML_READERS(TiXmlElement)
+INSTANTIATE_XML_READERS(XmlElement)
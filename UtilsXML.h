@@ -3,9 +3,17 @@
 
 #include "Utils.h"
 
+class XmlElement;
+class XmlDocument;
+class XmlWriter;
+
+// The readers are templates over the element type, instantiated for TiXmlElement and for XmlElement (XmlReader.h)
+// The writers have an XmlWriter (XmlWriter.h) version for the streamed Decompile paths, with the same output
+
 namespace Utils
 {
     TiXmlElement *FindRoot(TiXmlHandle *handle, const std::string &root_name);
+    const XmlElement *FindRoot(const XmlDocument *doc, const std::string &root_name);
 
     uint32_t GetUnsigned(const std::string &str, uint32_t default_value=0);
     uint64_t GetUnsigned64(const std::string &str, uint64_t default_value=0);
@@ -16,7 +24,7 @@ namespace Utils
     uint32_t GetShortVersion(uint32_t version);
     uint32_t GetLongVersion(uint32_t version);
 
-    size_t GetElemCount(const TiXmlElement *root, const char *name, const TiXmlElement **first=nullptr);
+    template<typename E> size_t GetElemCount(const E *root, const char *name, const E **first=nullptr);
 
     void WriteParamString(TiXmlElement *root, const char *name, const std::string &value);
     void WriteParamMultipleStrings(TiXmlElement *root, const char *name, const std::vector<std::string> &values);
@@ -40,87 +48,110 @@ namespace Utils
 
     void WriteParamBoolean(TiXmlElement *root, const char *name, bool value);
 
-    bool ReadAttrString(const TiXmlElement *root, const char *name, std::string &value);
-    bool ReadAttrMultipleStrings(const TiXmlElement *root, const char *name, std::vector<std::string> &values, char separator=',', bool omit_empty=true);
-    bool ReadAttrUnsigned(const TiXmlElement *root,  const char *name, uint32_t *value);
-    bool ReadAttrUnsigned(const TiXmlElement *root, const char *name, uint64_t *value);
-    bool ReadAttrUnsigned(const TiXmlElement *root,  const char *name, uint16_t *value);
-    bool ReadAttrUnsigned(const TiXmlElement *root,  const char *name, uint8_t *value);
-    bool ReadAttrSigned(const TiXmlElement *root,  const char *name, int32_t *value);
-    bool ReadAttrSigned(const TiXmlElement *root,  const char *name, int16_t *value);
-    bool ReadAttrSigned(const TiXmlElement *root,  const char *name, int8_t *value);
-    bool ReadAttrMultipleUnsigned(const TiXmlElement *root, const char *name, std::vector<uint8_t> &values);
-    bool ReadAttrMultipleUnsigned(const TiXmlElement *root, const char *name, uint8_t *values, size_t count);
-    bool ReadAttrMultipleSigned(const TiXmlElement *root, const char *name, std::vector<int32_t> &values);
-    bool ReadAttrMultipleSigned(const TiXmlElement *root, const char *name, int32_t *values, size_t count);
-    bool ReadAttrFloat(const TiXmlElement *root,  const char *name, float *value);
-    bool ReadAttrMultipleFloats(const TiXmlElement *root, const char *name, std::vector<float> &values);
-    bool ReadAttrMultipleFloats(const TiXmlElement *root, const char *name, float *values, size_t count);
-    bool ReadAttrBoolean(const TiXmlElement *root, const char *name, bool *value);
-
-    bool ReadParamString(const TiXmlElement *root, const char *name, std::string & value, const TiXmlElement **ret=nullptr);
-    bool ReadParamMultipleStrings(const TiXmlElement *root, const char *name, std::vector<std::string> &values, const TiXmlElement **ret=nullptr);
-
-    bool ReadParamUnsigned(const TiXmlElement *root, const char *name, uint32_t *value);
-    bool ReadParamUnsigned(const TiXmlElement *root, const char *name, uint64_t *value);
-    bool ReadParamUnsigned(const TiXmlElement *root, const char *name, uint16_t *value);
-    bool ReadParamUnsigned(const TiXmlElement *root, const char *name, uint8_t *value);
-
-    bool ReadParamMultipleUnsigned(const TiXmlElement *root, const char *name, std::vector<uint32_t> &values);
-    bool ReadParamMultipleUnsigned(const TiXmlElement *root, const char *name, std::vector<uint16_t> &values);
-    bool ReadParamMultipleUnsigned(const TiXmlElement *root, const char *name, std::vector<uint8_t> &values);
-
-    bool ReadParamMultipleUnsigned(const TiXmlElement *root, const char *name, uint32_t *values, size_t count);
-    bool ReadParamMultipleUnsigned(const TiXmlElement *root, const char *name, uint16_t *values, size_t count);
-    bool ReadParamMultipleUnsigned(const TiXmlElement *root, const char *name, uint8_t *values, size_t count);
-
-    bool ReadParamSigned(const TiXmlElement *root, const char *name, int32_t *value);
-
-    bool ReadParamFloat(const TiXmlElement *root, const char *name, float *value);
-    bool ReadParamMultipleFloats(const TiXmlElement *root, const char *name, std::vector<float> &values);
-    bool ReadParamMultipleFloats(const TiXmlElement *root, const char *name, float *values, size_t count);
-
-    bool ReadParamGUID(const TiXmlElement *root, const char *name, uint8_t *value);
-    uint8_t *ReadParamBlob(const TiXmlElement *root, const char *name, size_t *psize);
-    bool ReadParamBlob(const TiXmlElement *root, const char *name, std::vector<uint8_t> &value);
-
-    bool ReadParamUnsignedWithMultipleNames(const TiXmlElement *root, uint32_t *value, const char *name1, const char *name2, const char *name3=nullptr, const char *name4=nullptr, const char *name5=nullptr);
-    bool ReadParamUnsignedWithMultipleNames(const TiXmlElement *root, uint16_t *value, const char *name1, const char *name2, const char *name3=nullptr, const char *name4=nullptr, const char *name5=nullptr);
-    bool ReadParamFloatWithMultipleNames(const TiXmlElement *root, float *value, const char *name1, const char *name2, const char *name3=nullptr, const char *name4=nullptr, const char *name5=nullptr);
-
-    bool ReadParamBoolean(const TiXmlElement *root, const char *name, bool *value);
-
-    bool GetParamString(const TiXmlElement *root, const char *name, std::string &value, const TiXmlElement **ret=nullptr);
-    bool GetParamMultipleStrings(const TiXmlElement *root, const char *name, std::vector<std::string> &values, const TiXmlElement **ret=nullptr);
-
-    bool GetParamUnsigned(const TiXmlElement *root, const char *name, uint32_t *value);
-    bool GetParamUnsigned(const TiXmlElement *root, const char *name, uint64_t *value);
-    bool GetParamUnsigned(const TiXmlElement *root, const char *name, uint16_t *value);
-    bool GetParamUnsigned(const TiXmlElement *root, const char *name, uint8_t *value);
-
-    bool GetParamMultipleUnsigned(const TiXmlElement *root, const char *name, std::vector<uint32_t> &values);
-    bool GetParamMultipleUnsigned(const TiXmlElement *root, const char *name, std::vector<uint16_t> &values);
-    bool GetParamMultipleUnsigned(const TiXmlElement *root, const char *name, std::vector<uint8_t> &values);
-
-    bool GetParamMultipleUnsigned(const TiXmlElement *root, const char *name, uint32_t *values, size_t count);
-    bool GetParamMultipleUnsigned(const TiXmlElement *root, const char *name, uint16_t *values, size_t count);
-    bool GetParamMultipleUnsigned(const TiXmlElement *root, const char *name, uint8_t *values, size_t count);
-
-    bool GetParamSigned(const TiXmlElement *root, const char *name, int32_t *value);
-
-    bool GetParamFloat(const TiXmlElement *root, const char *name, float *value);
-    bool GetParamMultipleFloats(const TiXmlElement *root, const char *name, std::vector<float> &values);
-    bool GetParamMultipleFloats(const TiXmlElement *root, const char *name, float *values, size_t count);
-
-    bool GetParamGUID(const TiXmlElement *root, const char *name, uint8_t *value);
-    uint8_t *GetParamBlob(const TiXmlElement *root, const char *name, size_t *psize);
-    bool GetParamBlob(const TiXmlElement *root, const char *name, std::vector<uint8_t> &value);
-
-    bool GetParamUnsignedWithMultipleNames(const TiXmlElement *root, uint32_t *value, const char *name1, const char *name2, const char *name3=nullptr, const char *name4=nullptr, const char *name5=nullptr);
-    bool GetParamUnsignedWithMultipleNames(const TiXmlElement *root, uint16_t *value, const char *name1, const char *name2, const char *name3=nullptr, const char *name4=nullptr, const char *name5=nullptr);
-    bool GetParamFloatWithMultipleNames(const TiXmlElement *root, float *value, const char *name1, const char *name2, const char *name3=nullptr, const char *name4=nullptr, const char *name5=nullptr);
+    void WriteParamString(XmlWriter *writer, const char *name, const std::string &value);
+    void WriteParamMultipleStrings(XmlWriter *writer, const char *name, const std::vector<std::string> &values);
+
+    void WriteParamUnsigned(XmlWriter *writer, const char *name, uint64_t value, bool hexadecimal=false);
+    void WriteParamMultipleUnsigned(XmlWriter *writer, const char *name, const std::vector<uint32_t> &values, bool hexadecimal=false);
+    void WriteParamMultipleUnsigned(XmlWriter *writer, const char *name, const std::vector<uint16_t> &values, bool hexadecimal=false);
+    void WriteParamMultipleUnsigned(XmlWriter *writer, const char *name, const std::vector<uint8_t> &values, bool hexadecimal=false);
+
+    void WriteParamSigned(XmlWriter *writer, const char *name, int64_t value);
+
+    void WriteParamFloat(XmlWriter *writer, const char *name, float value);
+    void WriteParamMultipleFloats(XmlWriter *writer, const char *name, const std::vector<float> &values);
+
+    void WriteParamGUID(XmlWriter *writer, const char *name, const uint8_t *value);
+    void WriteParamBlob(XmlWriter *writer, const char *name, const uint8_t *value, size_t size);
+    inline void WriteParamBlob(XmlWriter *writer, const char *name, const std::vector<uint8_t> &value)
+    {
+        return WriteParamBlob(writer, name, value.data(), value.size());
+    }
+
+    void WriteParamBoolean(XmlWriter *writer, const char *name, bool value);
+
+    template<typename E> bool ReadAttrString(const E *root, const char *name, std::string &value);
+    template<typename E> bool ReadAttrMultipleStrings(const E *root, const char *name, std::vector<std::string> &values, char separator=',', bool omit_empty=true);
+    template<typename E> bool ReadAttrUnsigned(const E *root,  const char *name, uint32_t *value);
+    template<typename E> bool ReadAttrUnsigned(const E *root, const char *name, uint64_t *value);
+    template<typename E> bool ReadAttrUnsigned(const E *root,  const char *name, uint16_t *value);
+    template<typename E> bool ReadAttrUnsigned(const E *root,  const char *name, uint8_t *value);
+    template<typename E> bool ReadAttrSigned(const E *root,  const char *name, int32_t *value);
+    template<typename E> bool ReadAttrSigned(const E *root,  const char *name, int16_t *value);
+    template<typename E> bool ReadAttrSigned(const E *root,  const char *name, int8_t *value);
+    template<typename E> bool ReadAttrMultipleUnsigned(const E *root, const char *name, std::vector<uint8_t> &values);
+    template<typename E> bool ReadAttrMultipleUnsigned(const E *root, const char *name, uint8_t *values, size_t count);
+    template<typename E> bool ReadAttrMultipleSigned(const E *root, const char *name, std::vector<int32_t> &values);
+    template<typename E> bool ReadAttrMultipleSigned(const E *root, const char *name, int32_t *values, size_t count);
+    template<typename E> bool ReadAttrFloat(const E *root,  const char *name, float *value);
+    template<typename E> bool ReadAttrMultipleFloats(const E *root, const char *name, std::vector<float> &values);
+    template<typename E> bool ReadAttrMultipleFloats(const E *root, const char *name, float *values, size_t count);
+    template<typename E> bool ReadAttrBoolean(const E *root, const char *name, bool *value);
+
+    template<typename E> bool ReadParamString(const E *root, const char *name, std::string & value, const E **ret=nullptr);
+    template<typename E> bool ReadParamMultipleStrings(const E *root, const char *name, std::vector<std::string> &values, const E **ret=nullptr);
+
+    template<typename E> bool ReadParamUnsigned(const E *root, const char *name, uint32_t *value);
+    template<typename E> bool ReadParamUnsigned(const E *root, const char *name, uint64_t *value);
+    template<typename E> bool ReadParamUnsigned(const E *root, const char *name, uint16_t *value);
+    template<typename E> bool ReadParamUnsigned(const E *root, const char *name, uint8_t *value);
+
+    template<typename E> bool ReadParamMultipleUnsigned(const E *root, const char *name, std::vector<uint32_t> &values);
+    template<typename E> bool ReadParamMultipleUnsigned(const E *root, const char *name, std::vector<uint16_t> &values);
+    template<typename E> bool ReadParamMultipleUnsigned(const E *root, const char *name, std::vector<uint8_t> &values);
+
+    template<typename E> bool ReadParamMultipleUnsigned(const E *root, const char *name, uint32_t *values, size_t count);
+    template<typename E> bool ReadParamMultipleUnsigned(const E *root, const char *name, uint16_t *values, size_t count);
+    template<typename E> bool ReadParamMultipleUnsigned(const E *root, const char *name, uint8_t *values, size_t count);
+
+    template<typename E> bool ReadParamSigned(const E *root, const char *name, int32_t *value);
+
+    template<typename E> bool ReadParamFloat(const E *root, const char *name, float *value);
+    template<typename E> bool ReadParamMultipleFloats(const E *root, const char *name, std::vector<float> &values);
+    template<typename E> bool ReadParamMultipleFloats(const E *root, const char *name, float *values, size_t count);
+
+    template<typename E> bool ReadParamGUID(const E *root, const char *name, uint8_t *value);
+    template<typename E> uint8_t *ReadParamBlob(const E *root, const char *name, size_t *psize);
+    template<typename E> bool ReadParamBlob(const E *root, const char *name, std::vector<uint8_t> &value);
+
+    template<typename E> bool ReadParamUnsignedWithMultipleNames(const E *root, uint32_t *value, const char *name1, const char *name2, const char *name3=nullptr, const char *name4=nullptr, const char *name5=nullptr);
+    template<typename E> bool ReadParamUnsignedWithMultipleNames(const E *root, uint16_t *value, const char *name1, const char *name2, const char *name3=nullptr, const char *name4=nullptr, const char *name5=nullptr);
+    template<typename E> bool ReadParamFloatWithMultipleNames(const E *root, float *value, const char *name1, const char *name2, const char *name3=nullptr, const char *name4=nullptr, const char *name5=nullptr);
+
+    template<typename E> bool ReadParamBoolean(const E *root, const char *name, bool *value);
+
+    template<typename E> bool GetParamString(const E *root, const char *name, std::string &value, const E **ret=nullptr);
+    template<typename E> bool GetParamMultipleStrings(const E *root, const char *name, std::vector<std::string> &values, const E **ret=nullptr);
+
+    template<typename E> bool GetParamUnsigned(const E *root, const char *name, uint32_t *value);
+    template<typename E> bool GetParamUnsigned(const E *root, const char *name, uint64_t *value);
+    template<typename E> bool GetParamUnsigned(const E *root, const char *name, uint16_t *value);
+    template<typename E> bool GetParamUnsigned(const E *root, const char *name, uint8_t *value);
+
+    template<typename E> bool GetParamMultipleUnsigned(const E *root, const char *name, std::vector<uint32_t> &values);
+    template<typename E> bool GetParamMultipleUnsigned(const E *root, const char *name, std::vector<uint16_t> &values);
+    template<typename E> bool GetParamMultipleUnsigned(const E *root, const char *name, std::vector<uint8_t> &values);
+
+    template<typename E> bool GetParamMultipleUnsigned(const E *root, const char *name, uint32_t *values, size_t count);
+    template<typename E> bool GetParamMultipleUnsigned(const E *root, const char *name, uint16_t *values, size_t count);
+    template<typename E> bool GetParamMultipleUnsigned(const E *root, const char *name, uint8_t *values, size_t count);
+
+    template<typename E> bool GetParamSigned(const E *root, const char *name, int32_t *value);
+
+    template<typename E> bool GetParamFloat(const E *root, const char *name, float *value);
+    template<typename E> bool GetParamMultipleFloats(const E *root, const char *name, std::vector<float> &values);
+    template<typename E> bool GetParamMultipleFloats(const E *root, const char *name, float *values, size_t count);
+
+    template<typename E> bool GetParamGUID(const E *root, const char *name, uint8_t *value);
+    template<typename E> uint8_t *GetParamBlob(const E *root, const char *name, size_t *psize);
+    template<typename E> bool GetParamBlob(const E *root, const char *name, std::vector<uint8_t> &value);
+
+    template<typename E> bool GetParamUnsignedWithMultipleNames(const E *root, uint32_t *value, const char *name1, const char *name2, const char *name3=nullptr, const char *name4=nullptr, const char *name5=nullptr);
+    template<typename E> bool GetParamUnsignedWithMultipleNames(const E *root, uint16_t *value, const char *name1, const char *name2, const char *name3=nullptr, const char *name4=nullptr, const char *name5=nullptr);
+    template<typename E> bool GetParamFloatWithMultipleNames(const E *root, float *value, const char *name1, const char *name2, const char *name3=nullptr, const char *name4=nullptr, const char *name5=nullptr);
 
     void WriteComment(TiXmlElement *root, const std::string & comment);
+    void WriteComment(XmlWriter *writer, const std::string & comment);
 }
 
 
@@ -1,11 +1,26 @@
+#include <string.h>
+
 #include "UtilsZlib.h"
+#include "Stream.h"
+#include "Thread.h"
 
 #ifndef NO_ZLIB
 #include <zlib.h>
 #endif
 
+#ifdef USE_LIBDEFLATE
+#include <libdeflate.h>
+#endif
+
 #include "debug.h"
 
+// Intermediate buffers of the streaming functions
+#define ZLIB_STREAM_BUFFER_SIZE (256*1024)
+// Most input given to zlib per call, avail_in is 32 bits
+#define ZLIB_MAX_AVAIL          (1024*1024*1024)
+// Deflate window, the part of the previous block that primes the next one in CompressZlibParallel
+#define ZLIB_DICT_SIZE          (32*1024)
+
 #ifdef NO_ZLIB
 
 bool Utils::UncompressZlib(void *, uint32_t *, const void *, uint32_t, int)
@@ -14,6 +29,68 @@ bool Utils::UncompressZlib(void *, uint32_t *, const void *, uint32_t, int)
     return false;
 }
 
+bool Utils::CompressZlib(Stream *, Stream *, uint64_t, uint64_t *, int, int)
+{
+    DPRINTF("%s: zlib is not enabled.\n", FUNCNAME);
+    return false;
+}
+
+bool Utils::UncompressZlib(Stream *, Stream *, uint64_t, uint64_t *, int)
+{
+    DPRINTF("%s: zlib is not enabled.\n", FUNCNAME);
+    return false;
+}
+
+uint8_t *Utils::CompressZlibParallel(const void *, size_t, size_t *, int, size_t)
+{
+    DPRINTF("%s: zlib is not enabled.\n", FUNCNAME);
+    return nullptr;
+}
+
+Utils::ZlibInflater::ZlibInflater(int window) : window(window), initialized(false), finished(false), total_in(0), total_out(0), out_limit((uint64_t)-1), buf(nullptr)
+{
+}
+
+Utils::ZlibInflater::~ZlibInflater()
+{
+}
+
+bool Utils::ZlibInflater::Reset()
+{
+    return false;
+}
+
+bool Utils::ZlibInflater::Inflate(const void *, size_t, Stream *, size_t *)
+{
+    DPRINTF("%s: zlib is not enabled.\n", FUNCNAME);
+    return false;
+}
+
+Utils::ZlibDeflater::ZlibDeflater(int level, int window) : level(level), window(window), initialized(false), total_in(0), total_out(0), buf(nullptr)
+{
+}
+
+Utils::ZlibDeflater::~ZlibDeflater()
+{
+}
+
+bool Utils::ZlibDeflater::Reset()
+{
+    return false;
+}
+
+bool Utils::ZlibDeflater::Deflate(const void *, size_t, Stream *)
+{
+    DPRINTF("%s: zlib is not enabled.\n", FUNCNAME);
+    return false;
+}
+
+bool Utils::ZlibDeflater::Finish(Stream *)
+{
+    DPRINTF("%s: zlib is not enabled.\n", FUNCNAME);
+    return false;
+}
+
 #else
 
 static void *zalloc(void *opaque, unsigned int size, unsigned int num)
@@ -48,8 +125,70 @@ uint8_t *Utils::CompressZlib(const void *uncomp_buf, size_t uncomp_size, size_t
     return buf;
 }
 
+#ifdef USE_LIBDEFLATE
+
+// One decompressor per thread, reused by every call. Freed when the thread exits.
+struct LibdeflateDecompressor
+{
+    struct libdeflate_decompressor *decompressor;
+
+    LibdeflateDecompressor() : decompressor(nullptr) { }
+
+    ~LibdeflateDecompressor()
+    {
+        if (decompressor)
+            libdeflate_free_decompressor(decompressor);
+    }
+
+    struct libdeflate_decompressor *Get()
+    {
+        if (!decompressor)
+            decompressor = libdeflate_alloc_decompressor();
+
+        return decompressor;
+    }
+};
+
+static thread_local LibdeflateDecompressor thread_decompressor;
+
+static bool LibdeflateUncompress(void *uncomp_buf, uint32_t *uncomp_size, const void *comp_buf, uint32_t comp_size, int window)
+{
+    struct libdeflate_decompressor *decompressor;
+    enum libdeflate_result res;
+    size_t in_size, out_size;
+
+    // Automatic header detection (window+32) is left to zlib
+    if (window > 31)
+        return false;
+
+    decompressor = thread_decompressor.Get();
+    if (!decompressor)
+        return false;
+
+    if (window < 0)
+        res = libdeflate_deflate_decompress_ex(decompressor, comp_buf, comp_size, uncomp_buf, *uncomp_size, &in_size, &out_size);
+    else if (window > 15)
+        res = libdeflate_gzip_decompress_ex(decompressor, comp_buf, comp_size, uncomp_buf, *uncomp_size, &in_size, &out_size);
+    else
+        res = libdeflate_zlib_decompress_ex(decompressor, comp_buf, comp_size, uncomp_buf, *uncomp_size, &in_size, &out_size);
+
+    if (res != LIBDEFLATE_SUCCESS)
+        return false;
+
+    *uncomp_size = (uint32_t)out_size;
+    return true;
+}
+
+#endif
+
 bool Utils::UncompressZlib(void *uncomp_buf, uint32_t *uncomp_size, const void *comp_buf, uint32_t comp_size, int window)
 {
+#ifdef USE_LIBDEFLATE
+    // libdeflate gives nothing on a too small output buffer or bad data, zlib decodes what it can, so it does those
+    if (LibdeflateUncompress(uncomp_buf, uncomp_size, comp_buf, comp_size, window))
+        return true;
+#endif
+
     z_stream stream;
 
     stream.zalloc = &zalloc;
@@ -73,4 +212,421 @@ bool Utils::UncompressZlib(void *uncomp_buf, uint32_t *uncomp_size, const void *
     return (ret == Z_OK);
 }
 
+Utils::ZlibInflater::ZlibInflater(int window) : window(window), initialized(false), out_limit((uint64_t)-1)
+{
+    buf = new uint8_t[ZLIB_STREAM_BUFFER_SIZE];
+    Reset();
+}
+
+Utils::ZlibInflater::~ZlibInflater()
+{
+    if (initialized)
+        inflateEnd(&strm);
+
+    delete[] buf;
+}
+
+bool Utils::ZlibInflater::Reset()
+{
+    finished = false;
+    total_in = total_out = 0;
+
+    if (initialized)
+        return (inflateReset(&strm) == Z_OK);
+
+    memset(&strm, 0, sizeof(strm));
+    strm.zalloc = &zalloc;
+    strm.zfree = &zfree;
+    strm.opaque = Z_NULL;
+
+    if (inflateInit2(&strm, window) != Z_OK)
+    {
+        DPRINTF("%s: inflateInit2 failed.\n", FUNCNAME);
+        return false;
+    }
+
+    initialized = true;
+    return true;
+}
+
+bool Utils::ZlibInflater::Inflate(const void *in, size_t in_size, Stream *out, size_t *consumed)
+{
+    const uint8_t *ptr = (const uint8_t *)in;
+    size_t remaining = in_size;
+    bool buf_full;
+
+    if (!initialized)
+        return false;
+
+    // A full output buffer means zlib may still have output pending even when there is no more input
+    do
+    {
+        uInt avail_in = (uInt)((remaining < ZLIB_MAX_AVAIL) ? remaining : ZLIB_MAX_AVAIL);
+
+        if (finished)
+            break;
+
+        strm.next_in = (Bytef *)ptr;
+        strm.avail_in = avail_in;
+        strm.next_out = buf;
+        strm.avail_out = ZLIB_STREAM_BUFFER_SIZE;
+
+        int ret = inflate(&strm, Z_NO_FLUSH);
+        size_t used = avail_in - strm.avail_in;
+        size_t produced = ZLIB_STREAM_BUFFER_SIZE - strm.avail_out;
+
+        if (ret == Z_STREAM_END)
+        {
+            finished = true;
+        }
+        else if (ret == Z_BUF_ERROR)
+        {
+            // No progress possible, more input is needed
+            if (used == 0 && produced == 0)
+                break;
+        }
+        else if (ret != Z_OK)
+        {
+            DPRINTF("%s: inflate failed (%d).\n", FUNCNAME, ret);
+            return false;
+        }
+
+        ptr += used;
+        remaining -= used;
+        total_in += used;
+
+        if (produced > out_limit - total_out)
+        {
+            DPRINTF("%s: uncompressed data is bigger than expected (0x%I64x).\n", FUNCNAME, out_limit);
+            return false;
+        }
+
+        if (produced > 0 && !out->Write(buf, produced))
+            return false;
+
+        total_out += produced;
+        buf_full = (produced == ZLIB_STREAM_BUFFER_SIZE);
+
+    } while (remaining > 0 || buf_full);
+
+    if (consumed)
+        *consumed = in_size - remaining;
+
+    return true;
+}
+
+Utils::ZlibDeflater::ZlibDeflater(int level, int window) : level(level), window(window), initialized(false)
+{
+    buf = new uint8_t[ZLIB_STREAM_BUFFER_SIZE];
+    Reset();
+}
+
+Utils::ZlibDeflater::~ZlibDeflater()
+{
+    if (initialized)
+        deflateEnd(&strm);
+
+    delete[] buf;
+}
+
+bool Utils::ZlibDeflater::Reset()
+{
+    total_in = total_out = 0;
+
+    if (initialized)
+        return (deflateReset(&strm) == Z_OK);
+
+    memset(&strm, 0, sizeof(strm));
+    strm.zalloc = &zalloc;
+    strm.zfree = &zfree;
+    strm.opaque = Z_NULL;
+
+    if (deflateInit2(&strm, level, Z_DEFLATED, window, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+    {
+        DPRINTF("%s: deflateInit2 failed.\n", FUNCNAME);
+        return false;
+    }
+
+    initialized = true;
+    return true;
+}
+
+bool Utils::ZlibDeflater::Run(Stream *out, int flush)
+{
+    int ret;
+
+    // Loop until zlib stops filling the whole buffer (or, when finishing, until it reports the end)
+    do
+    {
+        strm.next_out = buf;
+        strm.avail_out = ZLIB_STREAM_BUFFER_SIZE;
+
+        ret = deflate(&strm, flush);
+        if (ret == Z_STREAM_ERROR)
+        {
+            DPRINTF("%s: deflate failed.\n", FUNCNAME);
+            return false;
+        }
+
+        size_t produced = ZLIB_STREAM_BUFFER_SIZE - strm.avail_out;
+
+        if (produced > 0 && !out->Write(buf, produced))
+            return false;
+
+        total_out += produced;
+
+    } while (strm.avail_out == 0 || (flush == Z_FINISH && ret != Z_STREAM_END));
+
+    return true;
+}
+
+bool Utils::ZlibDeflater::Deflate(const void *in, size_t in_size, Stream *out)
+{
+    const uint8_t *ptr = (const uint8_t *)in;
+
+    if (!initialized)
+        return false;
+
+    while (in_size > 0)
+    {
+        uInt avail_in = (uInt)((in_size < ZLIB_MAX_AVAIL) ? in_size : ZLIB_MAX_AVAIL);
+
+        strm.next_in = (Bytef *)ptr;
+        strm.avail_in = avail_in;
+
+        if (!Run(out, Z_NO_FLUSH))
+            return false;
+
+        ptr += avail_in;
+        in_size -= avail_in;
+        total_in += avail_in;
+    }
+
+    return true;
+}
+
+bool Utils::ZlibDeflater::Finish(Stream *out)
+{
+    if (!initialized)
+        return false;
+
+    strm.next_in = Z_NULL;
+    strm.avail_in = 0;
+
+    return Run(out, Z_FINISH);
+}
+
+bool Utils::CompressZlib(Stream *in, Stream *out, uint64_t uncomp_size, uint64_t *comp_size, int level, int window)
+{
+    ZlibDeflater deflater(level, window);
+    size_t buf_size = (uncomp_size < ZLIB_STREAM_BUFFER_SIZE) ? (size_t)uncomp_size : ZLIB_STREAM_BUFFER_SIZE;
+    uint8_t *buf = new uint8_t[buf_size+1];
+    bool ret = true;
+
+    while (uncomp_size > 0)
+    {
+        size_t r = (uncomp_size < buf_size) ? (size_t)uncomp_size : buf_size;
+
+        if (!in->Read(buf, r) || !deflater.Deflate(buf, r, out))
+        {
+            ret = false;
+            break;
+        }
+
+        uncomp_size -= r;
+    }
+
+    delete[] buf;
+
+    if (!ret || !deflater.Finish(out))
+        return false;
+
+    if (comp_size)
+        *comp_size = deflater.GetTotalOut();
+
+    return true;
+}
+
+bool Utils::UncompressZlib(Stream *in, Stream *out, uint64_t comp_size, uint64_t *uncomp_size, int window)
+{
+    ZlibInflater inflater(window);
+    uint64_t limit = (uncomp_size) ? *uncomp_size : (uint64_t)-1;
+    size_t buf_size = (comp_size < ZLIB_STREAM_BUFFER_SIZE) ? (size_t)comp_size : ZLIB_STREAM_BUFFER_SIZE;
+    uint8_t *buf = new uint8_t[buf_size+1];
+    bool ret = true;
+
+    inflater.SetOutputLimit(limit);
+
+    while (comp_size > 0 && !inflater.IsFinished())
+    {
+        size_t r = (comp_size < buf_size) ? (size_t)comp_size : buf_size;
+
+        if (!in->Read(buf, r) || !inflater.Inflate(buf, r, out))
+        {
+            ret = false;
+            break;
+        }
+
+        comp_size -= r;
+    }
+
+    delete[] buf;
+
+    if (!ret)
+        return false;
+
+    // Like the buffer version, data without a stream end is fine when it gave all that was expected
+    if (!inflater.IsFinished() && inflater.GetTotalOut() != limit)
+    {
+        DPRINTF("%s: premature end of compressed data.\n", FUNCNAME);
+        return false;
+    }
+
+    if (comp_size > 0 && !in->Seek((off64_t)comp_size, SEEK_CUR))
+        return false;
+
+    if (uncomp_size)
+        *uncomp_size = inflater.GetTotalOut();
+
+    return true;
+}
+
+struct ZlibParallelBlock
+{
+    uint8_t *buf;
+    size_t size;
+    uLong adler;
+    bool ok;
+};
+
+uint8_t *Utils::CompressZlibParallel(const void *uncomp_buf, size_t uncomp_size, size_t *ret_size, int level, size_t block_size)
+{
+    const uint8_t *in = (const uint8_t *)uncomp_buf;
+
+    if (block_size < ZLIB_DICT_SIZE)
+        block_size = ZLIB_DICT_SIZE;
+    else if (block_size > ZLIB_MAX_AVAIL)
+        block_size = ZLIB_MAX_AVAIL;
+
+    size_t num_blocks = (uncomp_size + block_size - 1) / block_size;
+    if (num_blocks <= 1)
+        return CompressZlib(uncomp_buf, uncomp_size, ret_size, level);
+
+    std::vector<ZlibParallelBlock> blocks(num_blocks);
+
+    // Raw deflate per block. All but the last end with a sync flush, so they are byte aligned and not final.
+    ThreadPool::GetGlobal().ParallelFor(0, num_blocks, 1, [&](size_t i)
+    {
+        ZlibParallelBlock &block = blocks[i];
+        const uint8_t *start = in + i*block_size;
+        size_t size = (i == num_blocks-1) ? uncomp_size - i*block_size : block_size;
+        bool last = (i == num_blocks-1);
+        z_stream strm;
+
+        block.buf = nullptr;
+        block.size = 0;
+        block.ok = false;
+        block.adler = adler32(adler32(0, Z_NULL, 0), start, (uInt)size);
+
+        memset(&strm, 0, sizeof(strm));
+        strm.zalloc = &zalloc;
+        strm.zfree = &zfree;
+        strm.opaque = Z_NULL;
+
+        if (deflateInit2(&strm, level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+            return;
+
+        if (i > 0 && deflateSetDictionary(&strm, start - ZLIB_DICT_SIZE, ZLIB_DICT_SIZE) != Z_OK)
+        {
+            deflateEnd(&strm);
+            return;
+        }
+
+        // Plus the empty stored block of the flush
+        uLong bound = deflateBound(&strm, (uLong)size) + 16;
+
+        block.buf = new uint8_t[bound];
+        strm.next_in = (Bytef *)start;
+        strm.avail_in = (uInt)size;
+        strm.next_out = block.buf;
+        strm.avail_out = (uInt)bound;
+
+        int ret = deflate(&strm, (last) ? Z_FINISH : Z_SYNC_FLUSH);
+
+        block.size = (size_t)(bound - strm.avail_out);
+        block.ok = (last) ? (ret == Z_STREAM_END) : (ret == Z_OK && strm.avail_in == 0 && strm.avail_out != 0);
+        deflateEnd(&strm);
+    });
+
+    size_t total = 2 + 4;
+    uLong adler = blocks[0].adler;
+    bool ok = true;
+
+    for (size_t i = 0; i < num_blocks; i++)
+    {
+        ok = ok && blocks[i].ok;
+        total += blocks[i].size;
+
+        if (i > 0)
+        {
+            size_t size = (i == num_blocks-1) ? uncomp_size - i*block_size : block_size;
+            adler = adler32_combine(adler, blocks[i].adler, (z_off_t)size);
+        }
+    }
+
+    uint8_t *ret = nullptr;
+
+    if (ok)
+    {
+        // Same header as deflate writes for this level
+        int level_flags;
+
+        if (level == Z_DEFAULT_COMPRESSION)
+            level = 6;
+
+        if (level < 2)
+            level_flags = 0;
+        else if (level < 6)
+            level_flags = 1;
+        else if (level == 6)
+            level_flags = 2;
+        else
+            level_flags = 3;
+
+        unsigned int header = (0x78 << 8) | (level_flags << 6);
+        header += 31 - (header % 31);
+
+        ret = new uint8_t[total];
+        ret[0] = (uint8_t)(header >> 8);
+        ret[1] = (uint8_t)header;
+
+        uint8_t *ptr = ret + 2;
+
+        for (const ZlibParallelBlock &block : blocks)
+        {
+            memcpy(ptr, block.buf, block.size);
+            ptr += block.size;
+        }
+
+        ptr[0] = (uint8_t)(adler >> 24);
+        ptr[1] = (uint8_t)(adler >> 16);
+        ptr[2] = (uint8_t)(adler >> 8);
+        ptr[3] = (uint8_t)adler;
+
+        *ret_size = total;
+    }
+    else
+    {
+        DPRINTF("%s: deflate of some block failed.\n", FUNCNAME);
+    }
+
+    for (ZlibParallelBlock &block : blocks)
+    {
+        if (block.buf)
+            delete[] block.buf;
+    }
+
+    return ret;
+}
+
 #endif
@@ -3,11 +3,99 @@
 
 #include "Utils.h"
 
+class Stream;
+
+// Build with USE_LIBDEFLATE to do the one-shot inflate of UncompressZlib with libdeflate (stock zlib is still used
+// for the streaming classes and as fallback). zlib-ng needs nothing here, build against it in zlib compat mode.
+
+// Uncompressed bytes per block of CompressZlibParallel
+#define ZLIB_PARALLEL_BLOCK_SIZE    (1024*1024)
+
 namespace Utils
 {
     bool CompressZlib(void *comp_buf, long unsigned int *comp_size, const void *uncomp_buf, size_t uncomp_size, int level=Z_DEFAULT_COMPRESSION);
     uint8_t *CompressZlib(const void *uncomp_buf, size_t uncomp_size, size_t *ret_size, int level=Z_DEFAULT_COMPRESSION);
     bool UncompressZlib(void* uncomp_buf, uint32_t *uncomp_size, const void* comp_buf, uint32_t comp_size, int window=15);
+
+    // Stream to stream versions, comp_size/uncomp_size bytes are read from in.
+    // The window parameter is the one of zlib: 8..15 zlib header, -8..-15 raw deflate, +16 gzip.
+    bool CompressZlib(Stream *in, Stream *out, uint64_t uncomp_size, uint64_t *comp_size=nullptr, int level=Z_DEFAULT_COMPRESSION, int window=15);
+    // in is left at the end of the comp_size bytes, even when the compressed data ends before.
+    // When given, *uncomp_size is also the output limit on input, like in the buffer version: more output fails,
+    // and data without a stream end is accepted if it gave exactly that much. (uint64_t)-1 for no limit.
+    bool UncompressZlib(Stream *in, Stream *out, uint64_t comp_size, uint64_t *uncomp_size=nullptr, int window=15);
+
+    // Same output format as CompressZlib, but the input is split in blocks compressed in parallel, like pigz does.
+    // Each block is primed with the last 32 KB of the previous one, so the ratio is barely worse.
+    uint8_t *CompressZlibParallel(const void *uncomp_buf, size_t uncomp_size, size_t *ret_size, int level=Z_DEFAULT_COMPRESSION, size_t block_size=ZLIB_PARALLEL_BLOCK_SIZE);
+
+    // Incremental inflate, the output goes to a Stream. Totals are 64 bits.
+    class ZlibInflater
+    {
+    private:
+
+#ifndef NO_ZLIB
+        z_stream strm;
+#endif
+        int window;
+        bool initialized;
+        bool finished;
+        uint64_t total_in, total_out;
+        uint64_t out_limit;
+        uint8_t *buf;
+
+        ZlibInflater(const ZlibInflater &);
+        ZlibInflater &operator=(const ZlibInflater &);
+
+    public:
+
+        ZlibInflater(int window=15);
+        ~ZlibInflater();
+
+        bool Reset();
+
+        // Stops early when the compressed stream ends, *consumed gets the number of input bytes used
+        bool Inflate(const void *in, size_t in_size, Stream *out, size_t *consumed=nullptr);
+        // Inflate fails, without writing it, on output that would go past limit bytes in total
+        inline void SetOutputLimit(uint64_t limit) { out_limit = limit; }
+
+        inline bool IsFinished() const { return finished; }
+        inline uint64_t GetTotalIn() const { return total_in; }
+        inline uint64_t GetTotalOut() const { return total_out; }
+    };
+
+    // Incremental deflate, the output goes to a Stream. Totals are 64 bits.
+    class ZlibDeflater
+    {
+    private:
+
+#ifndef NO_ZLIB
+        z_stream strm;
+#endif
+        int level, window;
+        bool initialized;
+        uint64_t total_in, total_out;
+        uint8_t *buf;
+
+        bool Run(Stream *out, int flush);
+
+        ZlibDeflater(const ZlibDeflater &);
+        ZlibDeflater &operator=(const ZlibDeflater &);
+
+    public:
+
+        ZlibDeflater(int level=Z_DEFAULT_COMPRESSION, int window=15);
+        ~ZlibDeflater();
+
+        bool Reset();
+
+        bool Deflate(const void *in, size_t in_size, Stream *out);
+        // Writes the end of the compressed stream. Reset before compressing something else.
+        bool Finish(Stream *out);
+
+        inline uint64_t GetTotalIn() const { return total_in; }
+        inline uint64_t GetTotalOut() const { return total_out; }
+    };
 }
 
 #endif // UTILSZLIB_H
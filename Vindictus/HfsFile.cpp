@@ -1,10 +1,67 @@
+#include <atomic>
+
 #include "HfsFile.h"
 #include "HfsXorTable.h"
 #include "FixedMemoryStream.h"
+#include "Thread.h"
 #include "debug.h"
 
+// After the repo headers, which define CPU_X86_64
+#ifdef CPU_X86_64
+#include <emmintrin.h>
+#endif
+
 #define COMP_SIGNATURE  0x706D6F63
 
+// The table twice in a row, so that any 4 KiB run starting anywhere in the table is contiguous
+static struct HfsXorTable2
+{
+    uint8_t data[sizeof(hfs_xor_table)*2];
+
+    HfsXorTable2()
+    {
+        memcpy(data, hfs_xor_table, sizeof(hfs_xor_table));
+        memcpy(data+sizeof(hfs_xor_table), hfs_xor_table, sizeof(hfs_xor_table));
+    }
+} hfs_xor_table2;
+
+static inline void XorChunk(uint8_t *out, const uint8_t *in, const uint8_t *key, size_t size)
+{
+    size_t i = 0;
+
+#ifdef CPU_X86_64
+    for (; i+64 <= size; i += 64)
+    {
+        __m128i d0 = _mm_loadu_si128((const __m128i *)(in+i));
+        __m128i d1 = _mm_loadu_si128((const __m128i *)(in+i+16));
+        __m128i d2 = _mm_loadu_si128((const __m128i *)(in+i+32));
+        __m128i d3 = _mm_loadu_si128((const __m128i *)(in+i+48));
+
+        d0 = _mm_xor_si128(d0, _mm_loadu_si128((const __m128i *)(key+i)));
+        d1 = _mm_xor_si128(d1, _mm_loadu_si128((const __m128i *)(key+i+16)));
+        d2 = _mm_xor_si128(d2, _mm_loadu_si128((const __m128i *)(key+i+32)));
+        d3 = _mm_xor_si128(d3, _mm_loadu_si128((const __m128i *)(key+i+48)));
+
+        _mm_storeu_si128((__m128i *)(out+i), d0);
+        _mm_storeu_si128((__m128i *)(out+i+16), d1);
+        _mm_storeu_si128((__m128i *)(out+i+32), d2);
+        _mm_storeu_si128((__m128i *)(out+i+48), d3);
+    }
+
+    for (; i+16 <= size; i += 16)
+    {
+        __m128i d = _mm_loadu_si128((const __m128i *)(in+i));
+        d = _mm_xor_si128(d, _mm_loadu_si128((const __m128i *)(key+i)));
+        _mm_storeu_si128((__m128i *)(out+i), d);
+    }
+#endif
+
+    for (; i < size; i++)
+    {
+        out[i] = in[i] ^ key[i];
+    }
+}
+
 std::string HfsEntry::GetName() const
 {
     if (Utils::EndsWith(name, ".comp", false))
@@ -15,72 +72,184 @@ std::string HfsEntry::GetName() const
     return name;
 }
 
-bool HfsEntry::Write(Stream *stream) const
+const std::vector<uint8_t> &HfsEntry::GetData() const
 {
-    if (Utils::EndsWith(name, ".comp", false))
+    if (!data_cached)
     {
-        if (data.size() < 8)
-            return false;
+        GetData(data);
+        data_cached = true;
+    }
 
-        uint8_t *comp_data = (uint8_t *)data.data();
-        uint32_t signature = *(uint32_t *)comp_data;
-        uint32_t uncomp_size = *(uint32_t *)&comp_data[4];
+    return data;
+}
 
-        if (signature != COMP_SIGNATURE)
-            return false;
+bool HfsEntry::GetData(std::vector<uint8_t> &out) const
+{
+    if (data_cached)
+    {
+        out = data;
+        return true;
+    }
 
-        uint8_t *uncomp_data = new uint8_t[uncomp_size];
+    if (!owner || !owner->src)
+        return false;
 
-        if (!Utils::UncompressZlib(uncomp_data, &uncomp_size, comp_data+8, (uint32_t)data.size()-8))
-        {
-            DPRINTF("%s: Uncompress failed.\n", FUNCNAME);
+    out.resize(comp_size);
+    HfsFile::Decrypt(out.data(), owner->src+data_offset, comp_size, (size_t)data_offset);
+    return true;
+}
+
+void HfsEntry::ReleaseData() const
+{
+    data.clear();
+    data.shrink_to_fit();
+    data_cached = false;
+}
+
+bool HfsEntry::GetContent(std::vector<uint8_t> &out) const
+{
+    if (!Utils::EndsWith(name, ".comp", false))
+        return GetData(out);
+
+    std::vector<uint8_t> temp;
+    const std::vector<uint8_t> *comp;
+
+    if (data_cached)
+    {
+        comp = &data;
+    }
+    else
+    {
+        if (!GetData(temp))
             return false;
-        }
 
-        bool ret = stream->Write(uncomp_data, uncomp_size);
-        delete[] uncomp_data;
-        return ret;
+        comp = &temp;
+    }
+
+    if (comp->size() < 8)
+        return false;
+
+    const uint8_t *comp_data = comp->data();
+    uint32_t signature = *(const uint32_t *)comp_data;
+    uint32_t uncomp_size = *(const uint32_t *)&comp_data[4];
+
+    if (signature != COMP_SIGNATURE)
+        return false;
+
+    out.resize(uncomp_size);
+
+    if (!Utils::UncompressZlib(out.data(), &uncomp_size, comp_data+8, (uint32_t)comp->size()-8))
+    {
+        DPRINTF("%s: Uncompress failed.\n", FUNCNAME);
+        return false;
     }
 
-    return stream->Write(data.data(), data.size());
+    out.resize(uncomp_size);
+    return true;
+}
+
+bool HfsEntry::Write(Stream *stream) const
+{
+    std::vector<uint8_t> content;
+
+    if (!GetContent(content))
+        return false;
+
+    return stream->Write(content.data(), content.size());
 }
 
 HfsFile::HfsFile()
 {
     this->big_endian = false;
+    src = nullptr;
+    src_size = 0;
+    src_mapped = false;
 }
 
 HfsFile::~HfsFile()
 {
-
+    Reset();
 }
 
 void HfsFile::Reset()
 {
     entries.clear();
+
+    if (src)
+    {
+        if (src_mapped)
+            Utils::UnmapFile(src, src_size);
+        else
+            delete[] src;
+
+        src = nullptr;
+    }
+
+    src_size = 0;
+    src_mapped = false;
 }
 
-void HfsFile::Decrypt(std::vector<uint8_t> &data, size_t start_pos)
+void HfsFile::Decrypt(uint8_t *out, const uint8_t *in, size_t size, size_t start_pos)
 {
-    for (size_t i = 0; i < data.size(); i++)
+    size_t pos = start_pos & 0xFFF;
+
+    while (size > 0)
     {
-        data[i] ^= hfs_xor_table[(start_pos+i)&0xFFF];
+        size_t chunk = (size > sizeof(hfs_xor_table)) ? sizeof(hfs_xor_table) : size;
+
+        XorChunk(out, in, hfs_xor_table2.data+pos, chunk);
+
+        out += chunk;
+        in += chunk;
+        size -= chunk;
+        pos = (pos + chunk) & 0xFFF;
     }
 }
 
 void HfsFile::Decrypt(std::string &string, size_t start_pos)
 {
-    for (size_t i = 0; i < string.size(); i++)
+    Decrypt((uint8_t *)&string[0], (const uint8_t *)string.data(), string.size(), start_pos);
+}
+
+bool HfsFile::Load(const uint8_t *buf, size_t size)
+{
+    Reset();
+
+    src = new uint8_t[size];
+    src_size = size;
+    memcpy(src, buf, size);
+
+    if (!Parse())
     {
-        string[i] ^= hfs_xor_table[(start_pos+i)&0xFFF];
+        Reset();
+        return false;
     }
+
+    return true;
 }
 
-bool HfsFile::Load(const uint8_t *buf, size_t size)
+bool HfsFile::LoadFromFile(const std::string &path, bool show_error)
 {
     Reset();
 
-    FixedMemoryStream fs(const_cast<uint8_t *>(buf), size);
+    src = Utils::MapFile(path, &src_size, show_error);
+    if (!src)
+        return false;
+
+    src_mapped = true;
+
+    if (!Parse())
+    {
+        Reset();
+        return false;
+    }
+
+    return true;
+}
+
+bool HfsFile::Parse()
+{
+    FixedMemoryStream fs(src, src_size);
 
     if (!fs.Seek(-(int64_t)sizeof(HFSCentralDirHeader), SEEK_END))
         return false;
@@ -106,6 +275,7 @@ bool HfsFile::Load(const uint8_t *buf, size_t size)
         HfsEntry &entry = entries[i];
         HFSCentralDirEntry *cd_entry;
         HFSLocalHeader *lh;
+        char *name;
 
         if (!fs.FastRead((uint8_t **)&cd_entry, sizeof(HFSCentralDirEntry)))
             return false;
@@ -120,7 +290,9 @@ bool HfsFile::Load(const uint8_t *buf, size_t size)
             return false;
 
         uint64_t ret_addr = fs.Tell();
-        fs.Seek(cd_entry->offset, SEEK_SET);
+
+        if (!fs.Seek(cd_entry->offset, SEEK_SET))
+            return false;
 
         if (!fs.FastRead((uint8_t **)&lh, sizeof(HFSLocalHeader)))
             return false;
@@ -131,29 +303,24 @@ bool HfsFile::Load(const uint8_t *buf, size_t size)
             return false;
         }
 
-        entry.name.reserve(lh->name_len);
-
-        for (uint16_t i = 0; i < lh->name_len; i++)
-        {
-            char *c;
-
-            if (!fs.FastRead((uint8_t **)&c, 1))
-                return false;
-
-            entry.name.push_back(*c);
-        }
+        if (!fs.FastRead((uint8_t **)&name, lh->name_len))
+            return false;
 
+        entry.name.assign(name, lh->name_len);
         Decrypt(entry.name, fs.Tell() - entry.name.length());
 
         if (!fs.Seek(lh->extra_len, SEEK_CUR))
             return false;
 
-        entry.data.resize(lh->comp_size);
+        entry.owner = this;
+        entry.data_offset = fs.Tell();
+        entry.comp_size = lh->comp_size;
 
-        if (!fs.Read(entry.data.data(), entry.data.size()))
+        if (entry.data_offset + entry.comp_size > src_size)
+        {
+            DPRINTF("%s: Data of \"%s\" is out of bounds.\n", FUNCNAME, entry.name.c_str());
             return false;
-
-        Decrypt(entry.data, fs.Tell() - entry.data.size());
+        }
 
         //DPRINTF("%s  %Id\n", entry.name.c_str(), entry.GetSize());
 
@@ -163,4 +330,75 @@ bool HfsFile::Load(const uint8_t *buf, size_t size)
     return true;
 }
 
+class HfsExtractor : public Runnable
+{
+private:
+
+    const HfsFile *hfs;
+    std::string dir_path;
+    std::atomic<size_t> *next;
+    std::atomic<bool> *error;
+
+public:
+
+    HfsExtractor(const HfsFile *hfs, const std::string &dir_path, std::atomic<size_t> *next, std::atomic<bool> *error) :
+        hfs(hfs), dir_path(dir_path), next(next), error(error)
+    {
+    }
+
+    virtual uint32_t Run() override
+    {
+        std::vector<uint8_t> content;
 
+        while (!*error)
+        {
+            size_t idx = next->fetch_add(1);
+            if (idx >= hfs->GetNumEntries())
+                break;
+
+            const HfsEntry &entry = (*hfs)[idx];
+            std::string path = Utils::MakePathString(dir_path, entry.GetName());
+
+            if (!entry.GetContent(content))
+            {
+                DPRINTF("%s: Failed to get content of \"%s\".\n", FUNCNAME, entry.GetName().c_str());
+                *error = true;
+                return (uint32_t)-1;
+            }
+
+            if (!Utils::WriteFileBool(path, content.data(), content.size(), true, true))
+            {
+                *error = true;
+                return (uint32_t)-1;
+            }
+        }
+
+        return 0;
+    }
+};
+
+bool HfsFile::ExtractAll(const std::string &dir_path, int max_threads) const
+{
+    if (entries.size() == 0)
+        return true;
+
+    if (max_threads <= 0)
+        max_threads = Thread::LogicalCoresCount();
+
+    if ((size_t)max_threads > entries.size())
+        max_threads = (int)entries.size();
+
+    std::atomic<size_t> next(0);
+    std::atomic<bool> error(false);
+
+    // Every worker pulls entries from the shared counter until there are none left
+    ThreadPool pool(max_threads);
+
+    for (int i = 0; i < max_threads; i++)
+    {
+        pool.AddWork(new HfsExtractor(this, dir_path, &next, &error));
+    }
+
+    pool.Wait();
+    return !error;
+}
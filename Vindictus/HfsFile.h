@@ -70,20 +70,35 @@ STATIC_ASSERT_STRUCT(HFSLocalHeader, 0x1E);
 
 class HfsFile;
 
+// Entries are index-only: the data stays encrypted in the hfs source and is only decrypted
+// (and cached, in the case of GetData) when it is requested.
 class HfsEntry
 {
 private:
 
     friend class HfsFile;
 
-    std::string name;   
-    std::vector<uint8_t> data;
+    const HfsFile *owner = nullptr;
+    std::string name;
+    uint64_t data_offset = 0;
+    uint32_t comp_size = 0;
+
+    mutable std::vector<uint8_t> data;
+    mutable bool data_cached = false;
 
 public:
 
     std::string GetName() const;
-    inline size_t GetSize() const { return data.size(); }
-    inline const std::vector<uint8_t> &GetData() const { return data; }
+    inline size_t GetSize() const { return comp_size; }
+
+    // Decrypted (but still compressed) data. The result is cached until ReleaseData
+    const std::vector<uint8_t> &GetData() const;
+    // Same, but into a caller buffer and without caching anything
+    bool GetData(std::vector<uint8_t> &out) const;
+    void ReleaseData() const;
+
+    // Decrypted and, in the case of .comp entries, uncompressed content
+    bool GetContent(std::vector<uint8_t> &out) const;
 
     bool Write(Stream *stream) const;
 
@@ -93,19 +108,36 @@ class HfsFile : public BaseFile
 {
 private:
 
+    friend class HfsEntry;
+
     std::vector<HfsEntry> entries;
 
+    uint8_t *src;
+    size_t src_size;
+    bool src_mapped;
+
     void Reset();
+    bool Parse();
 
-    void Decrypt(std::vector<uint8_t> &data, size_t start_pos);
     void Decrypt(std::string &string, size_t start_pos);
 
+    HfsFile(const HfsFile &);
+    HfsFile &operator=(const HfsFile &);
+
 public:
 
     HfsFile();
     virtual ~HfsFile();
 
+    // Vectorized xor of the 4 KiB hfs table. in and out may be the same buffer
+    static void Decrypt(uint8_t *out, const uint8_t *in, size_t size, size_t start_pos);
+
     virtual bool Load(const uint8_t *buf, size_t size) override;
+    // Maps the file instead of reading it, which makes opening big archives instant
+    virtual bool LoadFromFile(const std::string &path, bool show_error=true) override;
+
+    // max_threads <= 0: use the number of logical cores
+    bool ExtractAll(const std::string &dir_path, int max_threads=0) const;
 
     size_t GetNumEntries() const { return entries.size(); }
 
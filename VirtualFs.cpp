@@ -0,0 +1,413 @@
+#include <algorithm>
+
+#include "VirtualFs.h"
+#include "debug.h"
+
+VfsDirBackend::VfsDirBackend(const std::string &root)
+{
+    this->root = Utils::NormalizePath(root);
+
+    if (this->root.length() > 0 && !Utils::EndsWith(this->root, "/"))
+        this->root += '/';
+
+    std::vector<std::string> files;
+    Utils::ListFiles(this->root, true, false, true, files);
+
+    paths.reserve(files.size());
+
+    for (const std::string &file : files)
+    {
+        std::string path = Utils::NormalizePath(file);
+
+        if (Utils::BeginsWith(path, this->root, false))
+            paths.push_back(path.substr(this->root.length()));
+    }
+}
+
+uint64_t VfsDirBackend::GetEntrySize(size_t idx) const
+{
+    size_t size = Utils::GetFileSize(root + paths[idx]);
+    return (size == (size_t)-1) ? (uint64_t)-1 : (uint64_t)size;
+}
+
+uint8_t *VfsDirBackend::ReadEntry(size_t idx, size_t *psize)
+{
+    return Utils::ReadFile(root + paths[idx], psize, false);
+}
+
+// Lives as long as the mount or the last view into it, whatever lasts more
+struct VfsMountedBackend
+{
+    VfsBackend *backend;
+    bool owned;
+    Mutex mutex; // Serializes the calls into the backend
+
+    VfsMountedBackend(VfsBackend *backend, bool owned) : backend(backend), owned(owned) { }
+
+    ~VfsMountedBackend()
+    {
+        if (owned)
+            delete backend;
+    }
+};
+
+VirtualFs::VirtualFs(size_t cache_size)
+{
+    next_id = 1;
+    index_dirty = false;
+    cache_capacity = cache_size;
+    cache_used = 0;
+}
+
+VirtualFs::~VirtualFs()
+{
+}
+
+std::string VirtualFs::MakeKey(const std::string &path)
+{
+    std::string key = Utils::ToLowerCase(Utils::NormalizePath(path));
+
+    size_t start = key.find_first_not_of('/');
+    if (start == std::string::npos)
+        return std::string();
+
+    if (start != 0)
+        key = key.substr(start);
+
+    return key;
+}
+
+void VirtualFs::BuildIndex()
+{
+    index.clear();
+
+    // Lowest priority first, so that higher ones overwrite. stable_sort keeps the mount order on ties.
+    std::vector<size_t> order(mounts.size());
+    for (size_t i = 0; i < order.size(); i++)
+        order[i] = i;
+
+    std::stable_sort(order.begin(), order.end(), [this](size_t a, size_t b)
+    {
+        return mounts[a].priority < mounts[b].priority;
+    });
+
+    for (size_t m : order)
+    {
+        const MountEntry &mount = mounts[m];
+        VfsBackend *backend = mount.backend->backend;
+        size_t num = backend->GetNumEntries();
+
+        for (size_t i = 0; i < num; i++)
+        {
+            IndexEntry entry;
+
+            entry.path = mount.mount_point + Utils::NormalizePath(backend->GetEntryPath(i));
+            entry.mount = m;
+            entry.idx = i;
+
+            std::string key = MakeKey(entry.path);
+            index[key] = std::move(entry);
+        }
+    }
+
+    index_dirty = false;
+}
+
+const VirtualFs::IndexEntry *VirtualFs::Find(const std::string &path)
+{
+    if (index_dirty)
+        BuildIndex();
+
+    auto it = index.find(MakeKey(path));
+    if (it == index.end())
+        return nullptr;
+
+    return &it->second;
+}
+
+bool VirtualFs::IsMounted(uint32_t id) const
+{
+    for (const MountEntry &mount : mounts)
+    {
+        if (mount.id == id)
+            return true;
+    }
+
+    return false;
+}
+
+void VirtualFs::CacheInsert(uint64_t key, const std::shared_ptr<uint8_t> &buf, size_t size)
+{
+    // Another thread may have read the same entry meanwhile
+    if (size > cache_capacity || cache.find(key) != cache.end())
+        return;
+
+    while (cache_used + size > cache_capacity && lru.size() > 0)
+    {
+        auto it = cache.find(lru.back());
+        cache_used -= it->second.size;
+        cache.erase(it);
+        lru.pop_back();
+    }
+
+    lru.push_front(key);
+
+    CacheItem &item = cache[key];
+    item.buf = buf;
+    item.size = size;
+    item.lru_it = lru.begin();
+    cache_used += size;
+}
+
+void VirtualFs::CacheRemoveMount(uint32_t id)
+{
+    for (auto it = cache.begin(); it != cache.end(); )
+    {
+        if ((uint32_t)(it->first >> 32) == id)
+        {
+            cache_used -= it->second.size;
+            lru.erase(it->second.lru_it);
+            it = cache.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
+
+uint32_t VirtualFs::Mount(VfsBackend *backend, const std::string &mount_point, int priority, bool take_ownership)
+{
+    MutexLocker lock(&mutex);
+
+    MountEntry mount;
+
+    mount.id = next_id++;
+    mount.backend = std::make_shared<VfsMountedBackend>(backend, take_ownership);
+    mount.mount_point = Utils::NormalizePath(mount_point);
+    mount.priority = priority;
+
+    while (Utils::BeginsWith(mount.mount_point, "/"))
+        mount.mount_point = mount.mount_point.substr(1);
+
+    if (mount.mount_point.length() > 0 && !Utils::EndsWith(mount.mount_point, "/"))
+        mount.mount_point += '/';
+
+    mounts.push_back(mount);
+    index_dirty = true;
+
+    return mount.id;
+}
+
+bool VirtualFs::Unmount(uint32_t id)
+{
+    MutexLocker lock(&mutex);
+
+    for (size_t i = 0; i < mounts.size(); i++)
+    {
+        if (mounts[i].id == id)
+        {
+            // An owned backend is deleted here, or later by the last view still using it
+            mounts.erase(mounts.begin()+i);
+            CacheRemoveMount(id);
+            index_dirty = true;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool VirtualFs::FileExists(const std::string &path)
+{
+    MutexLocker lock(&mutex);
+    return (Find(path) != nullptr);
+}
+
+uint64_t VirtualFs::GetFileSize(const std::string &path)
+{
+    std::shared_ptr<VfsMountedBackend> backend;
+    size_t idx;
+    uint64_t key;
+
+    {
+        MutexLocker lock(&mutex);
+
+        const IndexEntry *entry = Find(path);
+        if (!entry)
+            return (uint64_t)-1;
+
+        const MountEntry &mount = mounts[entry->mount];
+
+        backend = mount.backend;
+        idx = entry->idx;
+        key = ((uint64_t)mount.id << 32) | entry->idx;
+    }
+
+    uint64_t size;
+
+    {
+        MutexLocker lock(&backend->mutex);
+        size = backend->backend->GetEntrySize(idx);
+    }
+
+    if (size == (uint64_t)-1)
+    {
+        // The cache may know it
+        MutexLocker lock(&mutex);
+
+        auto it = cache.find(key);
+        if (it != cache.end())
+            size = it->second.size;
+    }
+
+    return size;
+}
+
+VfsFile VirtualFs::GetFile(const std::string &path)
+{
+    VfsFile file;
+    std::shared_ptr<VfsMountedBackend> backend;
+    size_t idx;
+    uint64_t key;
+
+    {
+        MutexLocker lock(&mutex);
+
+        const IndexEntry *entry = Find(path);
+        if (!entry)
+            return file;
+
+        const MountEntry &mount = mounts[entry->mount];
+
+        backend = mount.backend;
+        idx = entry->idx;
+        key = ((uint64_t)mount.id << 32) | entry->idx;
+
+        // Entries that have a view are never cached
+        auto it = cache.find(key);
+
+        if (it != cache.end())
+        {
+            lru.splice(lru.begin(), lru, it->second.lru_it);
+
+            file.owned = it->second.buf;
+            file.data = file.owned.get();
+            file.size = it->second.size;
+            file.valid = true;
+            return file;
+        }
+    }
+
+    // The backend is kept alive by our reference even if it is unmounted now
+    size_t size;
+    uint8_t *buf;
+
+    {
+        MutexLocker lock(&backend->mutex);
+
+        const uint8_t *view = backend->backend->GetEntryView(idx, &size);
+        if (view)
+        {
+            file.data = view;
+            file.size = size;
+            file.backend = backend;
+            file.valid = true;
+            return file;
+        }
+
+        buf = backend->backend->ReadEntry(idx, &size);
+        if (!buf)
+            return file;
+    }
+
+    file.owned = std::shared_ptr<uint8_t>(buf, std::default_delete<uint8_t[]>());
+    file.data = buf;
+    file.size = size;
+    file.valid = true;
+
+    MutexLocker lock(&mutex);
+
+    // Nothing would remove the entry of a mount that is gone
+    if (IsMounted((uint32_t)(key >> 32)))
+        CacheInsert(key, file.owned, size);
+
+    return file;
+}
+
+uint8_t *VirtualFs::ReadFile(const std::string &path, size_t *psize)
+{
+    VfsFile file = GetFile(path);
+    if (!file.IsValid())
+        return nullptr;
+
+    uint8_t *buf = new uint8_t[file.GetSize()];
+
+    if (file.GetSize() > 0)
+        memcpy(buf, file.GetData(), file.GetSize());
+
+    *psize = file.GetSize();
+    return buf;
+}
+
+bool VirtualFs::LoadFile(BaseFile *file, const std::string &path)
+{
+    VfsFile vfile = GetFile(path);
+    if (!vfile.IsValid())
+        return false;
+
+    return file->Load(vfile.GetData(), vfile.GetSize());
+}
+
+void VirtualFs::ListFiles(const std::string &dir_path, bool recursive, std::vector<std::string> &paths)
+{
+    MutexLocker lock(&mutex);
+
+    if (index_dirty)
+        BuildIndex();
+
+    std::string prefix = MakeKey(dir_path);
+    if (prefix.length() > 0 && !Utils::EndsWith(prefix, "/"))
+        prefix += '/';
+
+    paths.clear();
+
+    for (auto &it : index)
+    {
+        const std::string &key = it.first;
+
+        if (key.length() <= prefix.length() || key.compare(0, prefix.length(), prefix) != 0)
+            continue;
+
+        if (!recursive && key.find('/', prefix.length()) != std::string::npos)
+            continue;
+
+        paths.push_back(it.second.path);
+    }
+
+    std::sort(paths.begin(), paths.end());
+}
+
+void VirtualFs::SetCacheSize(size_t size)
+{
+    MutexLocker lock(&mutex);
+
+    cache_capacity = size;
+
+    while (cache_used > cache_capacity && lru.size() > 0)
+    {
+        auto it = cache.find(lru.back());
+        cache_used -= it->second.size;
+        cache.erase(it);
+        lru.pop_back();
+    }
+}
+
+void VirtualFs::ClearCache()
+{
+    MutexLocker lock(&mutex);
+
+    cache.clear();
+    lru.clear();
+    cache_used = 0;
+}
@@ -0,0 +1,157 @@
+#ifndef __VIRTUALFS_H__
+#define __VIRTUALFS_H__
+
+#include <list>
+#include <memory>
+#include <unordered_map>
+
+#include "BaseFile.h"
+#include "Mutex.h"
+
+// Interface to plug an archive format (or a directory) into VirtualFs.
+// Paths returned by GetEntryPath are relative to the mount point, with '/' as separator.
+class VfsBackend
+{
+public:
+
+    virtual ~VfsBackend() { }
+
+    virtual size_t GetNumEntries() const = 0;
+    virtual std::string GetEntryPath(size_t idx) const = 0;
+    // (uint64_t)-1 if the backend cannot know it without reading the entry
+    virtual uint64_t GetEntrySize(size_t idx) const { UNUSED(idx); return (uint64_t)-1; }
+
+    // Zero-copy access for formats whose entries are already in memory, plain and uncompressed.
+    // The pointer must stay valid for the life of the backend. nullptr if not possible for this entry.
+    virtual const uint8_t *GetEntryView(size_t idx, size_t *psize) { UNUSED(idx); UNUSED(psize); return nullptr; }
+    // new[] allocated
+    virtual uint8_t *ReadEntry(size_t idx, size_t *psize) = 0;
+};
+
+// Loose files under a directory
+class VfsDirBackend : public VfsBackend
+{
+private:
+
+    std::string root;
+    std::vector<std::string> paths;
+
+public:
+
+    VfsDirBackend(const std::string &root);
+
+    virtual size_t GetNumEntries() const override { return paths.size(); }
+    virtual std::string GetEntryPath(size_t idx) const override { return paths[idx]; }
+    virtual uint64_t GetEntrySize(size_t idx) const override;
+    virtual uint8_t *ReadEntry(size_t idx, size_t *psize) override;
+};
+
+struct VfsMountedBackend;
+
+// A read-only file obtained from VirtualFs: either a view into memory owned by a backend,
+// or a buffer shared with the cache. The data is valid while this object is alive; a view
+// keeps its backend alive, even if it is unmounted meanwhile.
+class VfsFile
+{
+private:
+
+    friend class VirtualFs;
+
+    const uint8_t *data;
+    size_t size;
+    std::shared_ptr<uint8_t> owned;
+    std::shared_ptr<VfsMountedBackend> backend; // Views only
+    bool valid;
+
+public:
+
+    VfsFile() : data(nullptr), size(0), valid(false) { }
+
+    inline bool IsValid() const { return valid; }
+    inline bool IsZeroCopy() const { return valid && !owned; }
+    inline const uint8_t *GetData() const { return data; }
+    inline size_t GetSize() const { return size; }
+};
+
+#define VFS_DEFAULT_CACHE_SIZE  (64*1024*1024)
+
+// Mount table over any number of backends, with a single merged path index and a shared buffer cache.
+// When the same path exists in several mounts, the one with the highest priority wins; on equal priority,
+// the one mounted last wins. Path lookups are case insensitive.
+// The mount table lock is only held to resolve paths and for the cache, reads happen without it. Calls into
+// the same backend are still serialized, since the archive objects share a single stream.
+class VirtualFs
+{
+private:
+
+    struct MountEntry
+    {
+        uint32_t id;
+        std::shared_ptr<VfsMountedBackend> backend; // Shared with the views handed out
+        std::string mount_point;
+        int priority;
+    };
+
+    struct IndexEntry
+    {
+        std::string path; // As given by the backend, with the mount point
+        size_t mount;
+        size_t idx;
+    };
+
+    struct CacheItem
+    {
+        std::shared_ptr<uint8_t> buf;
+        size_t size;
+        std::list<uint64_t>::iterator lru_it;
+    };
+
+    std::vector<MountEntry> mounts;
+    uint32_t next_id;
+
+    std::unordered_map<std::string, IndexEntry> index;
+    bool index_dirty;
+
+    std::unordered_map<uint64_t, CacheItem> cache;
+    std::list<uint64_t> lru; // Front = most recent
+    size_t cache_capacity;
+    size_t cache_used;
+
+    mutable Mutex mutex;
+
+    static std::string MakeKey(const std::string &path);
+    void BuildIndex();
+    const IndexEntry *Find(const std::string &path);
+    bool IsMounted(uint32_t id) const;
+
+    void CacheInsert(uint64_t key, const std::shared_ptr<uint8_t> &buf, size_t size);
+    void CacheRemoveMount(uint32_t id);
+
+    VirtualFs(const VirtualFs &);
+    VirtualFs &operator=(const VirtualFs &);
+
+public:
+
+    VirtualFs(size_t cache_size=VFS_DEFAULT_CACHE_SIZE);
+    ~VirtualFs();
+
+    // Returns a mount id, to be used with Unmount. With take_ownership, the backend is deleted on unmount,
+    // or when the last VfsFile viewing into it goes away.
+    uint32_t Mount(VfsBackend *backend, const std::string &mount_point="", int priority=0, bool take_ownership=true);
+    bool Unmount(uint32_t id);
+
+    bool FileExists(const std::string &path);
+    uint64_t GetFileSize(const std::string &path);
+
+    VfsFile GetFile(const std::string &path);
+    uint8_t *ReadFile(const std::string &path, size_t *psize);
+    bool LoadFile(BaseFile *file, const std::string &path);
+
+    // All files under dir_path ("" for all), recursively or not
+    void ListFiles(const std::string &dir_path, bool recursive, std::vector<std::string> &paths);
+
+    void SetCacheSize(size_t size);
+    void ClearCache();
+};
+
+#endif // __VIRTUALFS_H__
@@ -0,0 +1,181 @@
+#include "VirtualFsArchives.h"
+#include "MemoryStream.h"
+#include "debug.h"
+
+static inline uint8_t *ToSizeT(uint8_t *buf, uint64_t size, size_t *psize)
+{
+    if (buf)
+        *psize = (size_t)size;
+
+    return buf;
+}
+
+VfsCpkBackend::VfsCpkBackend(CpkFile *cpk, bool take_ownership) : VfsArchiveBackend(cpk, take_ownership)
+{
+    uint32_t num = archive->GetNumFiles();
+    paths.resize(num);
+
+    for (uint32_t i = 0; i < num; i++)
+    {
+        archive->GetFilePath(i, paths[i]);
+    }
+}
+
+uint64_t VfsCpkBackend::GetEntrySize(size_t idx) const
+{
+    uint64_t size;
+
+    if (!archive->GetFileSize((uint32_t)idx, &size))
+        return (uint64_t)-1;
+
+    return size;
+}
+
+uint8_t *VfsCpkBackend::ReadEntry(size_t idx, size_t *psize)
+{
+    uint64_t size;
+    return ToSizeT(archive->ExtractFile((uint32_t)idx, &size), size, psize);
+}
+
+VfsPakBackend::VfsPakBackend(PakFile *pak, bool take_ownership) : VfsArchiveBackend(pak, take_ownership)
+{
+    std::string mount_point = Utils::NormalizePath(archive->GetMountPoint());
+
+    // Mount points are usually like "../../../Game/", the vfs wants paths relative to the pak
+    while (Utils::BeginsWith(mount_point, "../"))
+        mount_point = mount_point.substr(3);
+
+    if (mount_point.length() > 0 && !Utils::EndsWith(mount_point, "/"))
+        mount_point += '/';
+
+    paths.resize(archive->GetNumFiles());
+
+    for (size_t i = 0; i < paths.size(); i++)
+    {
+        paths[i] = mount_point + archive->GetFilePath(i);
+    }
+}
+
+uint64_t VfsPakBackend::GetEntrySize(size_t idx) const
+{
+    uint64_t size;
+
+    if (!archive->GetFileSize(idx, &size))
+        return (uint64_t)-1;
+
+    return size;
+}
+
+uint8_t *VfsPakBackend::ReadEntry(size_t idx, size_t *psize)
+{
+    uint64_t size;
+    return ToSizeT(archive->ExtractFile((uint32_t)idx, &size), size, psize);
+}
+
+VfsRdbBackend::VfsRdbBackend(RdbFile *rdb, bool take_ownership) : VfsArchiveBackend(rdb, take_ownership)
+{
+    paths.resize(archive->GetNumFiles());
+
+    for (size_t i = 0; i < paths.size(); i++)
+    {
+        archive->GetFileName(i, paths[i]);
+    }
+}
+
+uint64_t VfsRdbBackend::GetEntrySize(size_t idx) const
+{
+    return archive->GetEntry(idx).file_size;
+}
+
+uint8_t *VfsRdbBackend::ReadEntry(size_t idx, size_t *psize)
+{
+    MemoryStream out;
+
+    if (!archive->ExtractFile(idx, &out))
+        return nullptr;
+
+    *psize = (size_t)out.GetSize();
+    return out.GetMemory(true);
+}
+
+bool VfsApkBackend::ListVisitor(const std::string &path, void *param1, void *, void *)
+{
+    VfsApkBackend *pthis = (VfsApkBackend *)param1;
+    std::string vfs_path = path;
+
+    size_t sc = vfs_path.find(":/");
+    if (sc != std::string::npos)
+        vfs_path.erase(sc, 1);
+
+    pthis->apk_paths.push_back(path);
+    pthis->paths.push_back(vfs_path);
+    return true;
+}
+
+VfsApkBackend::VfsApkBackend(ApkFile *apk, bool take_ownership) : VfsArchiveBackend(apk, take_ownership)
+{
+    archive->VisitFiles(ListVisitor, "", this);
+}
+
+uint8_t *VfsApkBackend::ReadEntry(size_t idx, size_t *psize)
+{
+    return archive->Extract(apk_paths[idx], psize);
+}
+
+const uint8_t *VfsDatBackend::GetEntryView(size_t idx, size_t *psize)
+{
+    const DatFileEntry &entry = (*archive)[idx];
+
+    *psize = entry.GetSize();
+    return entry.GetData();
+}
+
+uint8_t *VfsDatBackend::ReadEntry(size_t idx, size_t *psize)
+{
+    const DatFileEntry &entry = (*archive)[idx];
+    uint8_t *buf = new uint8_t[entry.GetSize()];
+
+    // An empty entry may have no data pointer at all
+    if (entry.GetSize() > 0)
+        memcpy(buf, entry.GetData(), entry.GetSize());
+    *psize = entry.GetSize();
+    return buf;
+}
+
+uint8_t *VfsHfsBackend::ReadEntry(size_t idx, size_t *psize)
+{
+    std::vector<uint8_t> content;
+
+    if (!(*archive)[idx].GetContent(content))
+        return nullptr;
+
+    uint8_t *buf = new uint8_t[content.size()];
+    memcpy(buf, content.data(), content.size());
+
+    *psize = content.size();
+    return buf;
+}
+
+std::string VfsAfs2Backend::GetEntryPath(size_t idx) const
+{
+    char temp[32];
+
+    snprintf(temp, sizeof(temp), "%04u.bin", (uint32_t)idx+1);
+    return temp;
+}
+
+uint64_t VfsAfs2Backend::GetEntrySize(size_t idx) const
+{
+    uint64_t size;
+
+    if (!archive->GetFileSize((uint32_t)idx, &size))
+        return (uint64_t)-1;
+
+    return size;
+}
+
+uint8_t *VfsAfs2Backend::ReadEntry(size_t idx, size_t *psize)
+{
+    uint64_t size;
+    return ToSizeT(archive->ExtractFile((uint32_t)idx, &size), size, psize);
+}
@@ -0,0 +1,143 @@
+#ifndef __VIRTUALFSARCHIVES_H__
+#define __VIRTUALFSARCHIVES_H__
+
+// VirtualFs backends for the archive formats. The archive objects must be already loaded.
+// With take_ownership, the backend deletes the archive object when it is destroyed.
+
+#include "VirtualFs.h"
+
+#include "Criware/CpkFile.h"
+#include "Criware/Afs2File.h"
+#include "UE4/PakFile.h"
+#include "DOA6/RdbFile.h"
+#include "BattlePentagram/ApkFile.h"
+#include "NierAutomata/DatFile.h"
+#include "Vindictus/HfsFile.h"
+
+template <typename T>
+class VfsArchiveBackend : public VfsBackend
+{
+protected:
+
+    T *archive;
+    bool owned;
+
+public:
+
+    VfsArchiveBackend(T *archive, bool take_ownership) : archive(archive), owned(take_ownership) { }
+
+    virtual ~VfsArchiveBackend() override
+    {
+        if (owned)
+            delete archive;
+    }
+
+    inline T *GetArchive() { return archive; }
+};
+
+class VfsCpkBackend : public VfsArchiveBackend<CpkFile>
+{
+private:
+
+    std::vector<std::string> paths;
+
+public:
+
+    VfsCpkBackend(CpkFile *cpk, bool take_ownership=false);
+
+    virtual size_t GetNumEntries() const override { return paths.size(); }
+    virtual std::string GetEntryPath(size_t idx) const override { return paths[idx]; }
+    virtual uint64_t GetEntrySize(size_t idx) const override;
+    virtual uint8_t *ReadEntry(size_t idx, size_t *psize) override;
+};
+
+class VfsPakBackend : public VfsArchiveBackend<PakFile>
+{
+private:
+
+    std::vector<std::string> paths;
+
+public:
+
+    VfsPakBackend(PakFile *pak, bool take_ownership=false);
+
+    virtual size_t GetNumEntries() const override { return paths.size(); }
+    virtual std::string GetEntryPath(size_t idx) const override { return paths[idx]; }
+    virtual uint64_t GetEntrySize(size_t idx) const override;
+    virtual uint8_t *ReadEntry(size_t idx, size_t *psize) override;
+};
+
+class VfsRdbBackend : public VfsArchiveBackend<RdbFile>
+{
+private:
+
+    std::vector<std::string> paths;
+
+public:
+
+    VfsRdbBackend(RdbFile *rdb, bool take_ownership=false);
+
+    virtual size_t GetNumEntries() const override { return paths.size(); }
+    virtual std::string GetEntryPath(size_t idx) const override { return paths[idx]; }
+    virtual uint64_t GetEntrySize(size_t idx) const override;
+    virtual uint8_t *ReadEntry(size_t idx, size_t *psize) override;
+};
+
+// Files inside fshds are listed as "fshd_name/path"
+class VfsApkBackend : public VfsArchiveBackend<ApkFile>
+{
+private:
+
+    std::vector<std::string> paths;
+    std::vector<std::string> apk_paths; // As understood by ApkFile::Extract
+
+    static bool ListVisitor(const std::string &path, void *param1, void *, void *);
+
+public:
+
+    VfsApkBackend(ApkFile *apk, bool take_ownership=false);
+
+    virtual size_t GetNumEntries() const override { return paths.size(); }
+    virtual std::string GetEntryPath(size_t idx) const override { return paths[idx]; }
+    virtual uint8_t *ReadEntry(size_t idx, size_t *psize) override;
+};
+
+// Zero-copy: entries are handed out straight from the dat (in lazy mode, from its mapping)
+class VfsDatBackend : public VfsArchiveBackend<DatFile>
+{
+public:
+
+    VfsDatBackend(DatFile *dat, bool take_ownership=false) : VfsArchiveBackend(dat, take_ownership) { }
+
+    virtual size_t GetNumEntries() const override { return archive->GetNumFiles(); }
+    virtual std::string GetEntryPath(size_t idx) const override { return (*archive)[idx].name; }
+    virtual uint64_t GetEntrySize(size_t idx) const override { return (*archive)[idx].GetSize(); }
+    virtual const uint8_t *GetEntryView(size_t idx, size_t *psize) override;
+    virtual uint8_t *ReadEntry(size_t idx, size_t *psize) override;
+};
+
+class VfsHfsBackend : public VfsArchiveBackend<HfsFile>
+{
+public:
+
+    VfsHfsBackend(HfsFile *hfs, bool take_ownership=false) : VfsArchiveBackend(hfs, take_ownership) { }
+
+    virtual size_t GetNumEntries() const override { return archive->GetNumEntries(); }
+    virtual std::string GetEntryPath(size_t idx) const override { return (*archive)[idx].GetName(); }
+    virtual uint8_t *ReadEntry(size_t idx, size_t *psize) override;
+};
+
+// Afs2 has no names, entries are listed as "0001.bin", "0002.bin"...
+class VfsAfs2Backend : public VfsArchiveBackend<Afs2File>
+{
+public:
+
+    VfsAfs2Backend(Afs2File *afs2, bool take_ownership=false) : VfsArchiveBackend(afs2, take_ownership) { }
+
+    virtual size_t GetNumEntries() const override { return archive->GetNumFiles(); }
+    virtual std::string GetEntryPath(size_t idx) const override;
+    virtual uint64_t GetEntrySize(size_t idx) const override;
+    virtual uint8_t *ReadEntry(size_t idx, size_t *psize) override;
+};
+
+#endif // __VIRTUALFSARCHIVES_H__
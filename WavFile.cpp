@@ -655,29 +655,22 @@ bool WavFile::FromFiles(const std::vector<AudioFile *> &files, int format, bool
     else
         samples->Resize(total_samples*3);
 
-    if (max_threads <= 0)
-    {
-        int cores_count = Thread::LogicalCoresCount();
-        max_threads = (files.size() > (unsigned)cores_count) ? cores_count : (int)files.size();
-    }
-
     this->sample_rate = sample_rate;
     this->num_channels = num_channels*(uint16_t)files.size();
     this->format = (format == AUDIO_FORMAT_FLOAT) ? 3 : 1;
     this->bit_depth = (format == AUDIO_FORMAT_FLOAT) ? 32 : format;
 
-    ThreadPool pool(max_threads);
     bool error = false;
 
     MemoryStream *memory = dynamic_cast<MemoryStream *>(samples);
     uint8_t *buf = memory->GetMemory(false);
 
-    for (size_t i = 0; i < files.size(); i++)
+    // One file per task, at most max_threads at once (0: as many as the shared pool allows)
+    ThreadPool::GetGlobal().ParallelFor(0, files.size(), 1, [&](size_t i)
     {
-        pool.AddWork(new MultipleAudioDecoder(files[i], buf, (int)i, (int)files.size(), format, &error));
-    }
-
-    pool.Wait();
+        MultipleAudioDecoder decoder(files[i], buf, (int)i, (int)files.size(), format, &error);
+        decoder.Run();
+    }, max_threads);
 
     if (error)
     {
@@ -722,13 +715,6 @@ bool WavFile::ToFiles(const std::vector<AudioFile *> &files, uint16_t split_chan
     if (!MoveToMemory())
         return false;
 
-    if (max_threads <= 0)
-    {
-        int cores_count = Thread::LogicalCoresCount();
-        max_threads = (files.size() > (unsigned)cores_count) ? cores_count : (int)files.size();
-    }
-
-    ThreadPool pool(max_threads);
     bool error = false;
 
     MemoryStream *memory = dynamic_cast<MemoryStream *>(samples);
@@ -736,13 +722,13 @@ bool WavFile::ToFiles(const std::vector<AudioFile *> &files, uint16_t split_chan
 
     int format = (this->format == 1) ? bit_depth : (int)AUDIO_FORMAT_FLOAT;
 
-    for (uint16_t i = 0; i < (uint16_t)files.size(); i++)
+    // One file per task, at most max_threads at once (0: as many as the shared pool allows)
+    ThreadPool::GetGlobal().ParallelFor(0, (uint16_t)files.size(), 1, [&](size_t i)
     {
-        pool.AddWork(new MultipleAudioEncoder(files[i], i*split_channels >= num_channels ? nullptr : buf, i, format,
-                                         split_channels, sample_rate, GetNumSamples(), num_channels, &error));
-    }
-
-    pool.Wait();
+        MultipleAudioEncoder encoder(files[i], i*split_channels >= num_channels ? nullptr : buf, (int)i, format,
+                                     split_channels, sample_rate, GetNumSamples(), num_channels, &error);
+        encoder.Run();
+    }, max_threads);
 
     if (preserve_loop && HasLoop() && !error)
     {
@@ -0,0 +1,786 @@
+#include <stdio.h>
+#include <algorithm>
+#include <vector>
+
+#include "XmlReader.h"
+#include "Utils.h"
+#include "debug.h"
+
+// Same texts as tinyxml, indexed by the TiXmlBase error codes
+static const char *error_strings[TiXmlBase::TIXML_ERROR_STRING_COUNT] =
+{
+    "No error",
+    "Error",
+    "Failed to open file",
+    "Error parsing Element.",
+    "Failed to read Element name",
+    "Error reading Element value.",
+    "Error reading Attributes.",
+    "Error: empty tag.",
+    "Error reading end tag.",
+    "Error parsing Unknown.",
+    "Error parsing Comment.",
+    "Error parsing Declaration.",
+    "Error document empty.",
+    "Error null (0) or unexpected EOF found in input stream.",
+    "Error parsing CDATA.",
+    "Error when TiXmlDocument added to document, because TiXmlDocument can only be at the root.",
+};
+
+static inline bool IsSpace(char c)
+{
+    return (c == ' ' || c == '\t' || c == '\n' || c == '\r');
+}
+
+// Chars that end an element or attribute name
+static inline bool IsNameEnd(char c)
+{
+    return (IsSpace(c) || c == '>' || c == '/' || c == '=' || c == 0);
+}
+
+static bool EqualNoCase(const char *str, const char *lower)
+{
+    for (; *lower; str++, lower++)
+    {
+        char c = *str;
+
+        if (c >= 'A' && c <= 'Z')
+            c += 'a' - 'A';
+
+        if (c != *lower)
+            return false;
+    }
+
+    return (*str == 0);
+}
+
+// Decodes the entity at p (a '&') to *pw. Unknown entities are left as they are.
+// The output is never longer than the entity, so it can be written over the input.
+static char *DecodeEntity(char *p, char *end, char **pw)
+{
+    char *w = *pw;
+    char *semi = (char *)memchr(p, ';', std::min<size_t>(end - p, 12));
+
+    if (semi)
+    {
+        const char *ent = p + 1;
+        size_t len = semi - ent;
+
+        if (len >= 2 && ent[0] == '#')
+        {
+            uint32_t ucs = 0;
+            bool ok = true;
+
+            if (ent[1] == 'x' || ent[1] == 'X')
+            {
+                ok = (len > 2);
+
+                for (const char *q = ent + 2; q < semi && ok; q++)
+                {
+                    char c = *q;
+
+                    if (c >= '0' && c <= '9')
+                        ucs = (ucs << 4) | (c - '0');
+                    else if (c >= 'a' && c <= 'f')
+                        ucs = (ucs << 4) | (c - 'a' + 10);
+                    else if (c >= 'A' && c <= 'F')
+                        ucs = (ucs << 4) | (c - 'A' + 10);
+                    else
+                        ok = false;
+
+                    if (ucs > 0x10FFFF)
+                        ok = false;
+                }
+            }
+            else
+            {
+                for (const char *q = ent + 1; q < semi && ok; q++)
+                {
+                    if (*q < '0' || *q > '9')
+                        ok = false;
+                    else
+                        ucs = ucs*10 + (*q - '0');
+
+                    if (ucs > 0x10FFFF)
+                        ok = false;
+                }
+            }
+
+            if (ok && ucs != 0)
+            {
+                if (ucs < 0x80)
+                {
+                    *w++ = (char)ucs;
+                }
+                else if (ucs < 0x800)
+                {
+                    *w++ = (char)(0xC0 | (ucs >> 6));
+                    *w++ = (char)(0x80 | (ucs & 0x3F));
+                }
+                else if (ucs < 0x10000)
+                {
+                    *w++ = (char)(0xE0 | (ucs >> 12));
+                    *w++ = (char)(0x80 | ((ucs >> 6) & 0x3F));
+                    *w++ = (char)(0x80 | (ucs & 0x3F));
+                }
+                else
+                {
+                    *w++ = (char)(0xF0 | (ucs >> 18));
+                    *w++ = (char)(0x80 | ((ucs >> 12) & 0x3F));
+                    *w++ = (char)(0x80 | ((ucs >> 6) & 0x3F));
+                    *w++ = (char)(0x80 | (ucs & 0x3F));
+                }
+
+                *pw = w;
+                return semi + 1;
+            }
+        }
+        else
+        {
+            char c = 0;
+
+            if (len == 2 && memcmp(ent, "lt", 2) == 0)
+                c = '<';
+            else if (len == 2 && memcmp(ent, "gt", 2) == 0)
+                c = '>';
+            else if (len == 3 && memcmp(ent, "amp", 3) == 0)
+                c = '&';
+            else if (len == 4 && memcmp(ent, "quot", 4) == 0)
+                c = '"';
+            else if (len == 4 && memcmp(ent, "apos", 4) == 0)
+                c = '\'';
+
+            if (c)
+            {
+                *w++ = c;
+                *pw = w;
+                return semi + 1;
+            }
+        }
+    }
+
+    *w++ = '&';
+    *pw = w;
+    return p + 1;
+}
+
+int XmlAttribute::QueryIntValue(int *ival) const
+{
+    if (sscanf(value, "%d", ival) == 1)
+        return TIXML_SUCCESS;
+
+    return TIXML_WRONG_TYPE;
+}
+
+int XmlAttribute::QueryUnsignedValue(unsigned int *uval) const
+{
+    if (sscanf(value, "%u", uval) == 1)
+        return TIXML_SUCCESS;
+
+    return TIXML_WRONG_TYPE;
+}
+
+int XmlAttribute::QueryDoubleValue(double *dval) const
+{
+    if (sscanf(value, "%lf", dval) == 1)
+        return TIXML_SUCCESS;
+
+    return TIXML_WRONG_TYPE;
+}
+
+const XmlAttribute *XmlElement::FindAttribute(const char *attr_name) const
+{
+    for (const XmlAttribute *attr = first_attr; attr; attr = attr->next)
+    {
+        if (strcmp(attr->name, attr_name) == 0)
+            return attr;
+    }
+
+    return nullptr;
+}
+
+const XmlElement *XmlElement::FirstChildElement(const char *child_name) const
+{
+    if (index)
+    {
+        // Equal names are in document order in the index, so this is the first one
+        const XmlElement **it = std::lower_bound(index, index + num_children, child_name, [](const XmlElement *elem, const char *str)
+        {
+            return (strcmp(elem->name, str) < 0);
+        });
+
+        if (it != index + num_children && strcmp((*it)->name, child_name) == 0)
+            return *it;
+
+        return nullptr;
+    }
+
+    for (const XmlElement *elem = first_child; elem; elem = elem->next_sibling)
+    {
+        if (strcmp(elem->name, child_name) == 0)
+            return elem;
+    }
+
+    return nullptr;
+}
+
+const XmlElement *XmlElement::NextSiblingElement(const char *sibling_name) const
+{
+    for (const XmlElement *elem = next_sibling; elem; elem = elem->next_sibling)
+    {
+        if (strcmp(elem->name, sibling_name) == 0)
+            return elem;
+    }
+
+    return nullptr;
+}
+
+int XmlElement::QueryStringAttribute(const char *attr_name, std::string *value) const
+{
+    const XmlAttribute *attr = FindAttribute(attr_name);
+    if (!attr)
+        return TIXML_NO_ATTRIBUTE;
+
+    *value = attr->value;
+    return TIXML_SUCCESS;
+}
+
+int XmlElement::QueryIntAttribute(const char *attr_name, int *value) const
+{
+    const XmlAttribute *attr = FindAttribute(attr_name);
+    if (!attr)
+        return TIXML_NO_ATTRIBUTE;
+
+    return attr->QueryIntValue(value);
+}
+
+int XmlElement::QueryUnsignedAttribute(const char *attr_name, unsigned int *value) const
+{
+    const XmlAttribute *attr = FindAttribute(attr_name);
+    if (!attr)
+        return TIXML_NO_ATTRIBUTE;
+
+    return attr->QueryUnsignedValue(value);
+}
+
+int XmlElement::QueryBoolAttribute(const char *attr_name, bool *value) const
+{
+    const XmlAttribute *attr = FindAttribute(attr_name);
+    if (!attr)
+        return TIXML_NO_ATTRIBUTE;
+
+    if (EqualNoCase(attr->value, "true") || EqualNoCase(attr->value, "yes") || strcmp(attr->value, "1") == 0)
+    {
+        *value = true;
+        return TIXML_SUCCESS;
+    }
+
+    if (EqualNoCase(attr->value, "false") || EqualNoCase(attr->value, "no") || strcmp(attr->value, "0") == 0)
+    {
+        *value = false;
+        return TIXML_SUCCESS;
+    }
+
+    return TIXML_WRONG_TYPE;
+}
+
+int XmlElement::QueryDoubleAttribute(const char *attr_name, double *value) const
+{
+    const XmlAttribute *attr = FindAttribute(attr_name);
+    if (!attr)
+        return TIXML_NO_ATTRIBUTE;
+
+    return attr->QueryDoubleValue(value);
+}
+
+int XmlElement::QueryFloatAttribute(const char *attr_name, float *value) const
+{
+    const XmlAttribute *attr = FindAttribute(attr_name);
+
+    if (!attr)
+        return TIXML_NO_ATTRIBUTE;
+
+    if (Utils::CharsToFloat(attr->value, value) == attr->value)
+        return TIXML_WRONG_TYPE;
+
+    return TIXML_SUCCESS;
+}
+
+XmlDocument::XmlDocument() : buf(nullptr)
+{
+    Reset();
+}
+
+XmlDocument::~XmlDocument()
+{
+    if (buf)
+        delete[] buf;
+}
+
+void XmlDocument::Reset()
+{
+    if (buf)
+    {
+        delete[] buf;
+        buf = nullptr;
+    }
+
+    buf_size = 0;
+    arena.Release();
+    first_element = nullptr;
+
+    error_id = TiXmlBase::TIXML_NO_ERROR;
+    error_desc = error_strings[error_id];
+    error_row = error_col = 0;
+
+    line_pos = line_start = nullptr;
+    line = 1;
+}
+
+void XmlDocument::Locate(const char *p)
+{
+    while (line_pos < p)
+    {
+        const char *nl = (const char *)memchr(line_pos, '\n', p - line_pos);
+
+        if (!nl)
+        {
+            line_pos = p;
+            break;
+        }
+
+        line++;
+        line_pos = line_start = nl + 1;
+    }
+}
+
+bool XmlDocument::SetError(int id, const char *p)
+{
+    error_id = id;
+    error_desc = error_strings[id];
+
+    if (p)
+    {
+        Locate(p);
+        error_row = line;
+        error_col = (int)(std::max(p, line_start) - line_start) + 1;
+    }
+
+    return false;
+}
+
+// Decodes the entities of [p, end) in place and null terminates the result, which may be at end.
+// Callers must have located end first, newlines in the range are overwritten.
+char *XmlDocument::DecodeText(char *p, char *end, bool condense)
+{
+    char *w = p;
+    char *r = p;
+    bool space = false;
+
+    if (condense)
+    {
+        while (r < end && IsSpace(*r))
+            r++;
+    }
+
+    while (r < end)
+    {
+        char c = *r;
+
+        if (condense && IsSpace(c))
+        {
+            space = true;
+            r++;
+            continue;
+        }
+
+        if (space)
+        {
+            *w++ = ' ';
+            space = false;
+        }
+
+        if (c == '&')
+        {
+            r = DecodeEntity(r, end, &w);
+        }
+        else
+        {
+            *w++ = c;
+            r++;
+        }
+    }
+
+    *w = 0;
+    return p;
+}
+
+static void BuildIndex(XmlElement **index, XmlElement *first_child, size_t count)
+{
+    XmlElement *elem = first_child;
+
+    for (size_t i = 0; i < count; i++, elem = (XmlElement *)elem->NextSiblingElement())
+        index[i] = elem;
+
+    std::stable_sort(index, index + count, [](const XmlElement *a, const XmlElement *b)
+    {
+        return (strcmp(a->Value(), b->Value()) < 0);
+    });
+}
+
+// The buffer must be null terminated at end
+bool XmlDocument::ParseBuffer(char *p, char *end)
+{
+    // Open elements and the last child of each, the nodes don't keep them
+    struct OpenElement
+    {
+        XmlElement *elem;
+        XmlElement *last_child;
+    };
+
+    std::vector<OpenElement> stack;
+    XmlElement *parent = nullptr;
+    XmlElement *last_child = nullptr;
+
+    line_pos = line_start = p;
+    line = 1;
+
+    // UTF-8 BOM
+    if (end - p >= 3 && (uint8_t)p[0] == 0xEF && (uint8_t)p[1] == 0xBB && (uint8_t)p[2] == 0xBF)
+        p += 3;
+
+    for (;;)
+    {
+        char *lt = (char *)memchr(p, '<', end - p);
+        char *text_end = (lt) ? lt : end;
+        char *text = p;
+
+        while (text < text_end && IsSpace(*text))
+            text++;
+
+        if (text != text_end)
+        {
+            // Like tinyxml, whatever comes after the top level elements is ignored
+            if (!parent)
+                break;
+
+            Locate(text_end);
+            DecodeText(text, text_end, true);
+
+            if (!parent->first_child && !parent->text)
+                parent->text = text;
+        }
+
+        if (!lt)
+            break;
+
+        p = lt + 1;
+
+        if (*p == '/')
+        {
+            if (!parent)
+                return SetError(TiXmlBase::TIXML_ERROR_READING_END_TAG, lt);
+
+            char *r = p + 1;
+
+            if ((size_t)(end - r) < parent->name_len || memcmp(r, parent->name, parent->name_len) != 0)
+                return SetError(TiXmlBase::TIXML_ERROR_READING_END_TAG, lt);
+
+            r += parent->name_len;
+            while (IsSpace(*r))
+                r++;
+
+            if (*r != '>')
+                return SetError(TiXmlBase::TIXML_ERROR_READING_END_TAG, lt);
+
+            if (parent->num_children > XML_INDEX_MIN_CHILDREN)
+            {
+                XmlElement **index = arena.AllocateArray<XmlElement *>(parent->num_children);
+
+                BuildIndex(index, parent->first_child, parent->num_children);
+                parent->index = (const XmlElement **)index;
+            }
+
+            parent = stack.back().elem;
+            last_child = stack.back().last_child;
+            stack.pop_back();
+
+            p = r + 1;
+            continue;
+        }
+        else if (*p == '?')
+        {
+            char *r = strstr(p, "?>");
+            if (!r)
+                return SetError(TiXmlBase::TIXML_ERROR_PARSING_DECLARATION, lt);
+
+            p = r + 2;
+            continue;
+        }
+        else if (*p == '!')
+        {
+            if (strncmp(p, "!--", 3) == 0)
+            {
+                char *r = strstr(p + 3, "-->");
+                if (!r)
+                    return SetError(TiXmlBase::TIXML_ERROR_PARSING_COMMENT, lt);
+
+                p = r + 3;
+            }
+            else if (strncmp(p, "![CDATA[", 8) == 0)
+            {
+                char *data = p + 8;
+                char *r = strstr(data, "]]>");
+
+                if (!r || !parent)
+                    return SetError(TiXmlBase::TIXML_ERROR_PARSING_CDATA, lt);
+
+                Locate(r);
+                *r = 0;
+
+                if (!parent->first_child && !parent->text)
+                    parent->text = data;
+
+                p = r + 3;
+            }
+            else
+            {
+                // DOCTYPE and the like
+                char *r = strchr(p, '>');
+                if (!r)
+                    return SetError(TiXmlBase::TIXML_ERROR_PARSING_UNKNOWN, lt);
+
+                p = r + 1;
+            }
+
+            continue;
+        }
+
+        char *name = p;
+
+        while (!IsNameEnd(*p))
+            p++;
+
+        if (p == name)
+            return SetError(TiXmlBase::TIXML_ERROR_FAILED_TO_READ_ELEMENT_NAME, lt);
+
+        Locate(lt);
+
+        XmlElement *elem = arena.AllocateArray<XmlElement>(1);
+        elem->name = name;
+        elem->name_len = (uint32_t)(p - name);
+        elem->text = nullptr;
+        elem->row = line;
+        elem->num_children = 0;
+        elem->first_attr = nullptr;
+        elem->first_child = elem->next_sibling = nullptr;
+        elem->index = nullptr;
+
+        if (last_child)
+            last_child->next_sibling = elem;
+        else if (parent)
+            parent->first_child = elem;
+        else
+            first_element = elem;
+
+        if (parent)
+            parent->num_children++;
+
+        last_child = elem;
+
+        // The name is terminated in place, c is the char that was there and r the next one
+        char *r = p;
+        char c = *r;
+
+        Locate(r + 1);
+        *r++ = 0;
+
+        XmlAttribute *last_attr = nullptr;
+
+        for (;;)
+        {
+            while (IsSpace(c))
+                c = *r++;
+
+            if (c == '>')
+            {
+                OpenElement open;
+
+                open.elem = parent;
+                open.last_child = last_child;
+                stack.push_back(open);
+
+                parent = elem;
+                last_child = nullptr;
+                break;
+            }
+            else if (c == '/')
+            {
+                if (*r != '>')
+                    return SetError(TiXmlBase::TIXML_ERROR_PARSING_EMPTY, r - 1);
+
+                r++;
+                break;
+            }
+            else if (c == 0)
+            {
+                return SetError(TiXmlBase::TIXML_ERROR_EMBEDDED_NULL, r - 1);
+            }
+            else if (c == '=')
+            {
+                return SetError(TiXmlBase::TIXML_ERROR_READING_ATTRIBUTES, r - 1);
+            }
+
+            char *attr_name = r - 1;
+
+            while (!IsNameEnd(*r))
+                r++;
+
+            char *attr_name_end = r;
+
+            while (IsSpace(*r))
+                r++;
+
+            if (*r != '=')
+                return SetError(TiXmlBase::TIXML_ERROR_READING_ATTRIBUTES, attr_name);
+
+            r++;
+            while (IsSpace(*r))
+                r++;
+
+            char quote = *r;
+            char *value, *value_end;
+
+            if (quote == '"' || quote == '\'')
+            {
+                value = r + 1;
+                value_end = (char *)memchr(value, quote, end - value);
+
+                if (!value_end)
+                    return SetError(TiXmlBase::TIXML_ERROR_READING_ATTRIBUTES, attr_name);
+
+                r = value_end + 1;
+                c = *r++;
+            }
+            else
+            {
+                // Unquoted, tinyxml takes it up to the next space or the end of the tag
+                value = r;
+
+                while (*r && !IsSpace(*r) && *r != '>' && !(r[0] == '/' && r[1] == '>'))
+                    r++;
+
+                if (r == value)
+                    return SetError(TiXmlBase::TIXML_ERROR_READING_ATTRIBUTES, attr_name);
+
+                value_end = r;
+                c = *r++;
+            }
+
+            Locate(value_end + 1);
+            *attr_name_end = 0;
+            DecodeText(value, value_end, false);
+
+            XmlAttribute *attr = arena.AllocateArray<XmlAttribute>(1);
+            attr->name = attr_name;
+            attr->value = value;
+            attr->next = nullptr;
+
+            if (last_attr)
+                last_attr->next = attr;
+            else
+                elem->first_attr = attr;
+
+            last_attr = attr;
+        }
+
+        p = r;
+    }
+
+    if (parent)
+        return SetError(TiXmlBase::TIXML_ERROR_EMBEDDED_NULL, end);
+
+    if (!first_element)
+        return SetError(TiXmlBase::TIXML_ERROR_DOCUMENT_EMPTY, nullptr);
+
+    return true;
+}
+
+bool XmlDocument::LoadFile(const std::string &path)
+{
+    Reset();
+
+    FILE *f = fopen(path.c_str(), "rb");
+    if (!f)
+        return SetError(TiXmlBase::TIXML_ERROR_OPENING_FILE, nullptr);
+
+    if (fseeko64(f, 0, SEEK_END) != 0)
+    {
+        fclose(f);
+        return SetError(TiXmlBase::TIXML_ERROR_OPENING_FILE, nullptr);
+    }
+
+    off64_t file_size = ftello64(f);
+
+    if (file_size < 0 || (uint64_t)file_size >= (size_t)-1 || fseeko64(f, 0, SEEK_SET) != 0)
+    {
+        fclose(f);
+        return SetError(TiXmlBase::TIXML_ERROR_OPENING_FILE, nullptr);
+    }
+
+    size_t size = (size_t)file_size;
+
+    buf = new char[size+1];
+    buf_size = size+1;
+
+    size_t rd = fread(buf, 1, size, f);
+    fclose(f);
+
+    if (rd != size)
+        return SetError(TiXmlBase::TIXML_ERROR_OPENING_FILE, nullptr);
+
+    buf[size] = 0;
+    return ParseBuffer(buf, buf + size);
+}
+
+bool XmlDocument::Parse(const char *text, size_t len)
+{
+    Reset();
+
+    buf = new char[len+1];
+    buf_size = len+1;
+    memcpy(buf, text, len);
+    buf[len] = 0;
+
+    return ParseBuffer(buf, buf + len);
+}
+
+bool XmlDocument::ParseInSitu(char *text, size_t len)
+{
+    Reset();
+    return ParseBuffer(text, text + len);
+}
+
+bool XmlDocument::LoadTinyXml(const TiXmlDocument *doc)
+{
+    TiXmlPrinter printer;
+
+    doc->Accept(&printer);
+    return Parse(printer.CStr(), printer.Size());
+}
+
+const XmlElement *XmlDocument::FirstChildElement(const char *name) const
+{
+    for (const XmlElement *elem = first_element; elem; elem = elem->NextSiblingElement())
+    {
+        if (elem->ValueStr() == name)
+            return elem;
+    }
+
+    return nullptr;
+}
+
+size_t XmlDocument::GetMemoryUsage() const
+{
+    return buf_size + arena.GetCapacity();
+}
@@ -0,0 +1,194 @@
+#ifndef __XMLREADER_H__
+#define __XMLREADER_H__
+
+#include <stdint.h>
+#include <string.h>
+#include <string>
+
+#include "Arena.h"
+#include "tinyxml/tinyxml.h"
+
+// Elements with more children than this get them sorted by name at parse time, for FirstChildElement(name)
+#define XML_INDEX_MIN_CHILDREN  16
+
+// Read only XML DOM for the Compile paths. The document is parsed in place: names, attribute values and texts are
+// null terminated strings inside the (modified) input buffer, with the entities already decoded, and the nodes are
+// allocated from an arena, so a load is one read of the file, one pass over it and a handful of big allocations.
+// Elements and attributes expose the subset of the TiXmlElement / TiXmlAttribute interface used by UtilsXML and the
+// compilers, so a format can move from tinyxml by changing the element type in its Compile functions.
+// Comments, declarations and DOCTYPE are skipped. Texts are whitespace condensed like tinyxml does by default.
+
+// A name or value in the parsed buffer. Compares with C and std strings like the std::string returned by
+// TiXmlNode::ValueStr, without copying.
+class XmlStr
+{
+private:
+
+    const char *str;
+    size_t len;
+
+public:
+
+    inline XmlStr() : str(""), len(0) { }
+    inline XmlStr(const char *str, size_t len) : str(str), len(len) { }
+
+    inline const char *c_str() const { return str; }
+    inline const char *data() const { return str; }
+    inline size_t length() const { return len; }
+    inline size_t size() const { return len; }
+    inline bool empty() const { return (len == 0); }
+
+    inline operator std::string() const { return std::string(str, len); }
+
+    inline bool operator==(const char *s) const { return (strcmp(str, s) == 0); }
+    inline bool operator!=(const char *s) const { return (strcmp(str, s) != 0); }
+    inline bool operator==(const std::string &s) const { return (s.length() == len && memcmp(str, s.data(), len) == 0); }
+    inline bool operator!=(const std::string &s) const { return !(*this == s); }
+};
+
+inline bool operator==(const char *s, const XmlStr &x) { return (x == s); }
+inline bool operator!=(const char *s, const XmlStr &x) { return (x != s); }
+inline bool operator==(const std::string &s, const XmlStr &x) { return (x == s); }
+inline bool operator!=(const std::string &s, const XmlStr &x) { return (x != s); }
+
+class XmlAttribute
+{
+private:
+
+    friend class XmlDocument;
+    friend class XmlElement;
+
+    const char *name;
+    const char *value;
+    XmlAttribute *next;
+
+public:
+
+    inline const char *Name() const { return name; }
+    inline const char *Value() const { return value; }
+    inline const XmlAttribute *Next() const { return next; }
+
+    // Same results as the TiXmlAttribute ones (TIXML_SUCCESS or TIXML_WRONG_TYPE)
+    int QueryIntValue(int *ival) const;
+    int QueryUnsignedValue(unsigned int *uval) const;
+    int QueryDoubleValue(double *dval) const;
+};
+
+class XmlElement
+{
+private:
+
+    friend class XmlDocument;
+
+    const char *name;
+    const char *text; // First child when it is a text or CDATA, like TiXmlElement::GetText
+    uint32_t name_len;
+    uint32_t num_children;
+    int row;
+
+    XmlAttribute *first_attr;
+    XmlElement *first_child;
+    XmlElement *next_sibling;
+    const XmlElement **index; // Children sorted by name, only with more than XML_INDEX_MIN_CHILDREN
+
+    const XmlAttribute *FindAttribute(const char *attr_name) const;
+
+public:
+
+    inline const char *Value() const { return name; }
+    inline XmlStr ValueStr() const { return XmlStr(name, name_len); }
+    inline int Row() const { return row; }
+
+    inline size_t GetNumChildren() const { return num_children; }
+
+    inline const XmlElement *FirstChildElement() const { return first_child; }
+    const XmlElement *FirstChildElement(const char *child_name) const;
+    inline const XmlElement *FirstChildElement(const std::string &child_name) const { return FirstChildElement(child_name.c_str()); }
+
+    inline const XmlElement *NextSiblingElement() const { return next_sibling; }
+    const XmlElement *NextSiblingElement(const char *sibling_name) const;
+    inline const XmlElement *NextSiblingElement(const std::string &sibling_name) const { return NextSiblingElement(sibling_name.c_str()); }
+
+    inline const XmlAttribute *FirstAttribute() const { return first_attr; }
+
+    inline const char *Attribute(const char *attr_name) const
+    {
+        const XmlAttribute *attr = FindAttribute(attr_name);
+        return (attr) ? attr->value : nullptr;
+    }
+
+    inline const char *GetText() const { return text; }
+
+    // Same results as the TiXmlElement ones (TIXML_SUCCESS, TIXML_NO_ATTRIBUTE or TIXML_WRONG_TYPE)
+    int QueryStringAttribute(const char *attr_name, std::string *value) const;
+    int QueryIntAttribute(const char *attr_name, int *value) const;
+    int QueryUnsignedAttribute(const char *attr_name, unsigned int *value) const;
+    int QueryBoolAttribute(const char *attr_name, bool *value) const;
+    int QueryDoubleAttribute(const char *attr_name, double *value) const;
+    int QueryFloatAttribute(const char *attr_name, float *value) const;
+};
+
+class XmlDocument
+{
+private:
+
+    Arena arena;
+
+    char *buf; // Owned copy of the input, nullptr when parsing a buffer of the caller in place
+    size_t buf_size;
+    XmlElement *first_element;
+
+    int error_id;
+    const char *error_desc;
+    int error_row, error_col;
+
+    // Line tracking. Newlines are counted up to a position before anything there is overwritten.
+    const char *line_pos;
+    const char *line_start;
+    int line;
+
+    XmlDocument(const XmlDocument &);
+    XmlDocument &operator=(const XmlDocument &);
+
+    void Locate(const char *p);
+    bool SetError(int id, const char *p);
+
+    char *DecodeText(char *p, char *end, bool condense);
+    bool ParseBuffer(char *p, char *end);
+
+public:
+
+    XmlDocument();
+    ~XmlDocument();
+
+    void Reset();
+
+    bool LoadFile(const std::string &path);
+
+    // Copies the text
+    bool Parse(const char *text, size_t len);
+    inline bool Parse(const char *text) { return Parse(text, strlen(text)); }
+    inline bool Parse(const std::string &text) { return Parse(text.c_str(), text.length()); }
+
+    // Parses the null terminated text in place. It is modified, and it must outlive the document.
+    bool ParseInSitu(char *text, size_t len);
+
+    // For Compile(TiXmlDocument *) of formats ported to this class, it goes through the printed text
+    bool LoadTinyXml(const TiXmlDocument *doc);
+
+    inline bool Error() const { return (error_id != TiXmlBase::TIXML_NO_ERROR); }
+    // TiXmlBase error codes
+    inline int ErrorId() const { return error_id; }
+    inline const char *ErrorDesc() const { return error_desc; }
+    inline int ErrorRow() const { return error_row; }
+    inline int ErrorCol() const { return error_col; }
+
+    inline const XmlElement *RootElement() const { return first_element; }
+    inline const XmlElement *FirstChildElement() const { return first_element; }
+    const XmlElement *FirstChildElement(const char *name) const;
+
+    // Input buffer plus arena blocks
+    size_t GetMemoryUsage() const;
+};
+
+#endif // __XMLREADER_H__
@@ -0,0 +1,373 @@
+#include <string.h>
+
+#include "XmlWriter.h"
+#include "Utils.h"
+#include "debug.h"
+
+static const char *indent_spaces = "                                                                ";
+
+XmlWriter::XmlWriter() : file(nullptr), error(false), tag_open(false), dom_node(nullptr)
+{
+}
+
+XmlWriter::XmlWriter(TiXmlNode *root) : file(nullptr), error(false), tag_open(false), dom_node(root)
+{
+}
+
+XmlWriter::~XmlWriter()
+{
+    if (file)
+        fclose(file);
+}
+
+bool XmlWriter::Open(const std::string &path)
+{
+    if (file || dom_node)
+        return false;
+
+    file = fopen(path.c_str(), "wb");
+    if (!file)
+    {
+        error = true;
+        return false;
+    }
+
+    buf.reserve(XML_WRITER_BUFFER_SIZE + 4096);
+    return true;
+}
+
+bool XmlWriter::Close()
+{
+    if (!levels.empty())
+    {
+        DPRINTF("%s: %u element(s) not closed.\n", FUNCNAME, (uint32_t)levels.size());
+        error = true;
+    }
+
+    if (file)
+    {
+        if (!buf.empty() && fwrite(buf.data(), 1, buf.length(), file) != buf.length())
+            error = true;
+
+        buf.clear();
+
+        if (fclose(file) != 0)
+            error = true;
+
+        file = nullptr;
+    }
+
+    return !error;
+}
+
+void XmlWriter::FlushIfFull()
+{
+    if (file && buf.length() >= XML_WRITER_BUFFER_SIZE)
+    {
+        if (fwrite(buf.data(), 1, buf.length(), file) != buf.length())
+            error = true;
+
+        buf.clear();
+    }
+}
+
+void XmlWriter::Indent(size_t depth)
+{
+    size_t n = depth*4;
+
+    while (n > 0)
+    {
+        size_t chunk = (n > 64) ? 64 : n;
+
+        buf.append(indent_spaces, chunk);
+        n -= chunk;
+    }
+}
+
+// Same escaping as TiXmlBase::EncodeString (including its pass through of "&#x" references)
+void XmlWriter::Escape(const char *str, size_t len)
+{
+    size_t run = 0;
+    size_t i = 0;
+
+    while (i < len)
+    {
+        uint8_t c = (uint8_t)str[i];
+
+        if (c >= 32 && c != '&' && c != '<' && c != '>' && c != '"' && c != '\'')
+        {
+            i++;
+            continue;
+        }
+
+        buf.append(str + run, i - run);
+
+        if (c == '&' && len >= 2 && i < len - 2 && str[i+1] == '#' && str[i+2] == 'x')
+        {
+            while (i < len - 1)
+            {
+                buf += str[i++];
+
+                if (str[i] == ';')
+                    break;
+            }
+
+            run = i;
+            continue;
+        }
+
+        switch (c)
+        {
+            case '&': buf += "&amp;"; break;
+            case '<': buf += "&lt;"; break;
+            case '>': buf += "&gt;"; break;
+            case '"': buf += "&quot;"; break;
+            case '\'': buf += "&apos;"; break;
+
+            default:
+            {
+                char ref[8];
+                snprintf(ref, sizeof(ref), "&#x%02X;", c);
+                buf += ref;
+            }
+        }
+
+        i++;
+        run = i;
+    }
+
+    buf.append(str + run, len - run);
+}
+
+// Closes the start tag of the parent if needed and counts the child. Text can't be at the top level.
+bool XmlWriter::BeginChild(bool text)
+{
+    if (levels.empty())
+    {
+        if (text)
+        {
+            DPRINTF("%s: Text outside of the root element.\n", FUNCNAME);
+            error = true;
+            return false;
+        }
+
+        return true;
+    }
+
+    Level &parent = levels.back();
+
+    if (tag_open)
+    {
+        if (!dom_node)
+            buf += '>';
+
+        tag_open = false;
+    }
+
+    if (parent.num_children++ == 0)
+        parent.text_first = text;
+
+    if (!text && !dom_node)
+        buf += '\n';
+
+    return true;
+}
+
+void XmlWriter::Declaration(const char *version, const char *encoding)
+{
+    if (!levels.empty())
+    {
+        error = true;
+        return;
+    }
+
+    if (dom_node)
+    {
+        dom_node->LinkEndChild(new TiXmlDeclaration(version, encoding, ""));
+        return;
+    }
+
+    buf += "<?xml ";
+
+    if (version && *version)
+    {
+        buf += "version=\"";
+        buf += version;
+        buf += "\" ";
+    }
+
+    if (encoding && *encoding)
+    {
+        buf += "encoding=\"";
+        buf += encoding;
+        buf += "\" ";
+    }
+
+    buf += "?>\n";
+}
+
+void XmlWriter::StartElement(const char *name)
+{
+    if (!BeginChild(false))
+        return;
+
+    Level level;
+    level.name_pos = names.length();
+    level.num_children = 0;
+    level.text_first = false;
+
+    names += name;
+    names += '\0';
+    levels.push_back(level);
+    tag_open = true;
+
+    if (dom_node)
+    {
+        TiXmlElement *elem = new TiXmlElement(name);
+
+        dom_node->LinkEndChild(elem);
+        dom_node = elem;
+        return;
+    }
+
+    Indent(levels.size() - 1);
+    buf += '<';
+    buf += name;
+}
+
+void XmlWriter::EndElement()
+{
+    if (levels.empty())
+    {
+        DPRINTF("%s: No element to close.\n", FUNCNAME);
+        error = true;
+        return;
+    }
+
+    const Level &level = levels.back();
+
+    if (dom_node)
+    {
+        dom_node = dom_node->Parent();
+    }
+    else
+    {
+        const char *name = names.c_str() + level.name_pos;
+
+        if (tag_open)
+        {
+            buf += " />";
+        }
+        else
+        {
+            if (level.num_children != 1 || !level.text_first)
+            {
+                buf += '\n';
+                Indent(levels.size() - 1);
+            }
+
+            buf += "</";
+            buf += name;
+            buf += '>';
+        }
+    }
+
+    names.resize(level.name_pos);
+    levels.pop_back();
+    tag_open = false;
+
+    if (levels.empty() && !dom_node)
+        buf += '\n';
+
+    FlushIfFull();
+}
+
+void XmlWriter::Attribute(const char *name, const char *value)
+{
+    if (!tag_open)
+    {
+        DPRINTF("%s: Attribute \"%s\" written after the content of the element.\n", FUNCNAME, name);
+        error = true;
+        return;
+    }
+
+    if (dom_node)
+    {
+        dom_node->ToElement()->SetAttribute(name, value);
+        return;
+    }
+
+    char quote = (strchr(value, '"')) ? '\'' : '"';
+
+    buf += ' ';
+    Escape(name, strlen(name));
+    buf += '=';
+    buf += quote;
+    Escape(value, strlen(value));
+    buf += quote;
+}
+
+void XmlWriter::Attribute(const char *name, int value)
+{
+    char str[16];
+
+    snprintf(str, sizeof(str), "%d", value);
+    Attribute(name, str);
+}
+
+void XmlWriter::Text(const char *text)
+{
+    if (!BeginChild(true))
+        return;
+
+    if (dom_node)
+    {
+        dom_node->LinkEndChild(new TiXmlText(text));
+        return;
+    }
+
+    Escape(text, strlen(text));
+}
+
+void XmlWriter::CData(const char *text)
+{
+    if (!BeginChild(true))
+        return;
+
+    if (dom_node)
+    {
+        TiXmlText *node = new TiXmlText(text);
+
+        node->SetCDATA(true);
+        dom_node->LinkEndChild(node);
+        return;
+    }
+
+    buf += '\n';
+    Indent(levels.size());
+    buf += "<![CDATA[";
+    buf += text;
+    buf += "]]>\n";
+
+    FlushIfFull();
+}
+
+void XmlWriter::Comment(const char *comment)
+{
+    if (!BeginChild(false))
+        return;
+
+    if (dom_node)
+    {
+        dom_node->LinkEndChild(new TiXmlComment(comment));
+        return;
+    }
+
+    Indent(levels.size());
+    buf += "<!--";
+    buf += comment;
+    buf += "-->";
+
+    if (levels.empty())
+        buf += '\n';
+}
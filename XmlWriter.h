@@ -0,0 +1,85 @@
+#ifndef __XMLWRITER_H__
+#define __XMLWRITER_H__
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "tinyxml/tinyxml.h"
+
+#define XML_WRITER_BUFFER_SIZE  (256*1024)
+
+// Forward only XML output for the Decompile paths. Nodes are written as they are generated, so the memory used
+// doesn't depend on the size of the document. The layout is the one of TiXmlDocument::SaveFile (4 spaces indentation,
+// "<x />" for empty elements, same escaping), so a format switching to it produces the same files.
+// It can also build TinyXML nodes under an existing node instead, for the callers that still want a DOM.
+// Attributes must be written right after StartElement, before any child, and only once per name (no replacement).
+class XmlWriter
+{
+private:
+
+    struct Level
+    {
+        size_t name_pos; // In names
+        uint32_t num_children;
+        bool text_first;
+    };
+
+    FILE *file;
+    std::string buf;
+    bool error;
+    bool tag_open; // Start tag written up to the attributes, waiting for ">" or " />"
+
+    std::string names; // Names of the open elements, null separated
+    std::vector<Level> levels;
+
+    TiXmlNode *dom_node; // Current node in DOM mode, nullptr in text mode
+
+    XmlWriter(const XmlWriter &);
+    XmlWriter &operator=(const XmlWriter &);
+
+    void Indent(size_t depth);
+    void Escape(const char *str, size_t len);
+    bool BeginChild(bool text);
+    void FlushIfFull();
+
+public:
+
+    // Text mode. The output is kept in memory (GetString) unless Open is called.
+    XmlWriter();
+    // DOM mode, nodes are linked under root
+    XmlWriter(TiXmlNode *root);
+    ~XmlWriter();
+
+    // Streams the text to a file, through a buffer of XML_WRITER_BUFFER_SIZE
+    bool Open(const std::string &path);
+    // Flushes and closes the file. False if there was any error or if elements were left open.
+    bool Close();
+
+    void Declaration(const char *version="1.0", const char *encoding="utf-8");
+
+    void StartElement(const char *name);
+    inline void StartElement(const std::string &name) { StartElement(name.c_str()); }
+    void EndElement();
+
+    void Attribute(const char *name, const char *value);
+    inline void Attribute(const char *name, const std::string &value) { Attribute(name, value.c_str()); }
+    // Same format as TiXmlElement::SetAttribute(name, int)
+    void Attribute(const char *name, int value);
+
+    void Text(const char *text);
+    inline void Text(const std::string &text) { Text(text.c_str()); }
+    void CData(const char *text);
+    inline void CData(const std::string &text) { CData(text.c_str()); }
+    void Comment(const char *comment);
+    inline void Comment(const std::string &comment) { Comment(comment.c_str()); }
+
+    inline bool Error() const { return error; }
+    inline size_t GetDepth() const { return levels.size(); }
+
+    // Text written so far (in memory text mode, the whole document)
+    inline const std::string &GetString() const { return buf; }
+};
+
+#endif // __XMLWRITER_H__
@@ -1,34 +1,79 @@
 #include <stdexcept>
+#include <atomic>
 #include "ZipFile.h"
+#include "Thread.h"
 #include "debug.h"
 
 
+#define ZIP_STREAM_BUFFER_SIZE  (1024*1024)
+
 ZipFile::ZipFile()
 {
-    int error;
-    archive = nullptr;    
+    archive = nullptr;
+    source = nullptr;
+
+    if (!Open(nullptr, 0, false, ZIP_CREATE | ZIP_TRUNCATE))
+        throw std::runtime_error("Internal error in ZipFile ctor");
+}
 
-    for (int retries = 0; retries < 5 && !archive; retries++)
+ZipFile::~ZipFile()
+{
+    if (archive)
+        zip_discard(archive);
+
+    if (source)
+        zip_source_free(source);
+}
+
+bool ZipFile::Open(void *buf, size_t size, bool free_buf, int flags)
+{
+    zip_error_t error;
+    zip_error_init(&error);
+
+    if (!source)
     {
-        temp_file = Utils::GetTempFileLocal(".tmp");
-        archive = zip_open(temp_file.c_str(), ZIP_CREATE | ZIP_EXCL, &error);
+        source = zip_source_buffer_create(buf, size, (free_buf) ? 1 : 0, &error);
+        if (!source)
+        {
+            DPRINTF("%s: zip_source_buffer_create failed: %s\n", FUNCNAME, zip_error_strerror(&error));
+            zip_error_fini(&error);
+            return false;
+        }
     }
 
+    // zip_open_from_source takes ownership of one reference, ours is kept for Commit
+    zip_source_keep(source);
+
+    archive = zip_open_from_source(source, flags, &error);
     if (!archive)
     {
-        DPRINTF("Internal error in ZipFile ctor: %d %d %s  %s\n", error, errno, strerror(errno), temp_file.c_str());
-        throw std::runtime_error("Internal error in ZipFile ctor");
+        //DPRINTF("%s: zip_open_from_source failed: %s\n", FUNCNAME, zip_error_strerror(&error));
+        zip_source_free(source); // The reference we just gave away
+        zip_error_fini(&error);
+        return false;
     }
+
+    zip_error_fini(&error);
+    return true;
 }
 
-ZipFile::~ZipFile()
+// Writes the pending changes into the buffer source, leaving the archive closed.
+// libzip copies the compressed data of unchanged entries as is.
+bool ZipFile::Commit()
 {
-    if (archive)
-        zip_discard(archive);
+    if (!archive)
+        return (source != nullptr);
 
-    Utils::RemoveFile(temp_file);
+    if (zip_close(archive) != 0)
+    {
+        DPRINTF("%s: zip_close failed, libzip reports: %s\n", FUNCNAME, zip_strerror(archive));
+        zip_discard(archive);
+        archive = nullptr;
+        return false;
+    }
 
-    //_rmdir("temp");
+    archive = nullptr;
+    return true;
 }
 
 void ZipFile::Reload()
@@ -36,14 +81,10 @@ void ZipFile::Reload()
     if (!archive)
         return;
 
-    zip_close(archive);
-    int error;
-    archive = zip_open(temp_file.c_str(), 0, &error);
-
-    if (!archive)
+    if (!Commit() || !Open(nullptr, 0, false, ZIP_CREATE))
     {
-        DPRINTF("Internal error in ZipFile::Reload: %d %d %s  %s\n", error, errno, strerror(errno), temp_file.c_str());
-        throw std::runtime_error("Internal error in ZipFile ctor");
+        DPRINTF("Internal error in ZipFile::Reload\n");
+        throw std::runtime_error("Internal error in ZipFile::Reload");
     }
 }
 
@@ -55,12 +96,26 @@ bool ZipFile::Load(const uint8_t *buf, size_t size)
         archive = nullptr;
     }
 
-    if (!Utils::WriteFileBool(temp_file, buf, size, false))
+    if (source)
+    {
+        zip_source_free(source);
+        source = nullptr;
+    }
+
+    // The buffer source frees with free()
+    void *copy = malloc(size);
+    if (!copy)
         return false;
 
-    archive = zip_open(temp_file.c_str(), 0, nullptr);
-    if (!archive)
+    memcpy(copy, buf, size);
+
+    if (!Open(copy, size, true, 0))
+    {
+        zip_source_free(source);
+        source = nullptr;
+        Open(nullptr, 0, false, ZIP_CREATE | ZIP_TRUNCATE);
         return false;
+    }
 
     return true;
 }
@@ -70,20 +125,88 @@ uint8_t *ZipFile::Save(size_t *psize)
     if (IsEmpty())
         return nullptr;
 
-    zip_close(archive);
-    archive = nullptr;
+    if (!Commit())
+        throw std::runtime_error("Internal error in ZipFile::Save");
+
+    uint8_t *buf = nullptr;
+    zip_stat_t zstat;
 
-    uint8_t *buf = Utils::ReadFile(temp_file, psize);
+    zip_stat_init(&zstat);
 
+    if (zip_source_stat(source, &zstat) == 0 && (zstat.valid & ZIP_STAT_SIZE) && zip_source_open(source) == 0)
     {
-        archive = zip_open(temp_file.c_str(), 0, nullptr);
-        if (!archive)
-            throw std::runtime_error("Internal error in ZipFile::Save");
+        buf = new uint8_t[zstat.size];
+
+        if (zip_source_read(source, buf, zstat.size) != (zip_int64_t)zstat.size)
+        {
+            delete[] buf;
+            buf = nullptr;
+        }
+        else
+        {
+            *psize = (size_t)zstat.size;
+        }
+
+        zip_source_close(source);
     }
 
+    if (!Open(nullptr, 0, false, ZIP_CREATE))
+        throw std::runtime_error("Internal error in ZipFile::Save");
+
     return buf;
 }
 
+bool ZipFile::SaveToFile(const std::string &path, bool show_error, bool build_path)
+{
+    if (IsEmpty())
+        return false;
+
+    if (!Commit())
+        throw std::runtime_error("Internal error in ZipFile::SaveToFile");
+
+    bool ret = false;
+    FILE *f = (build_path) ? Utils::fopen_create_path(path, "wb") : fopen(path.c_str(), "wb");
+
+    if (!f)
+    {
+        if (show_error)
+            DPRINTF("Cannot open/create file \"%s\"\n", path.c_str());
+    }
+    else if (zip_source_open(source) == 0)
+    {
+        uint8_t *buf = new uint8_t[ZIP_STREAM_BUFFER_SIZE];
+        zip_int64_t rd;
+
+        ret = true;
+
+        while ((rd = zip_source_read(source, buf, ZIP_STREAM_BUFFER_SIZE)) > 0)
+        {
+            if (fwrite(buf, 1, (size_t)rd, f) != (size_t)rd)
+            {
+                ret = false;
+                break;
+            }
+        }
+
+        if (rd < 0)
+            ret = false;
+
+        delete[] buf;
+        zip_source_close(source);
+
+        if (!ret && show_error)
+            DPRINTF("Write failure on file \"%s\"\n", path.c_str());
+    }
+
+    if (f)
+        fclose(f);
+
+    if (!Open(nullptr, 0, false, ZIP_CREATE))
+        throw std::runtime_error("Internal error in ZipFile::SaveToFile");
+
+    return ret;
+}
+
 size_t ZipFile::GetNumEntries() const
 {
     if (!archive)
@@ -191,11 +314,183 @@ uint8_t *ZipFile::ReadFile(const std::string &path, size_t *psize)
     return buf;
 }
 
+struct ZipReadJob
+{
+    std::vector<uint8_t> comp;
+    uint16_t method;
+    uint32_t crc;
+    std::vector<uint8_t> *out;
+};
+
+class ZipInflater : public Runnable
+{
+private:
+
+    std::vector<ZipReadJob> *jobs;
+    std::atomic<size_t> *next;
+    std::atomic<bool> *error;
+
+public:
+
+    ZipInflater(std::vector<ZipReadJob> *jobs, std::atomic<size_t> *next, std::atomic<bool> *error) : jobs(jobs), next(next), error(error)
+    {
+    }
+
+    virtual uint32_t Run() override
+    {
+        while (!*error)
+        {
+            size_t idx = next->fetch_add(1);
+            if (idx >= jobs->size())
+                break;
+
+            ZipReadJob &job = (*jobs)[idx];
+            std::vector<uint8_t> &out = *job.out;
+
+            if (job.method == ZIP_CM_DEFLATE)
+            {
+                uint32_t size = (uint32_t)out.size();
+
+                if (!Utils::UncompressZlib(out.data(), &size, job.comp.data(), (uint32_t)job.comp.size(), -15) || size != out.size())
+                {
+                    *error = true;
+                    return (uint32_t)-1;
+                }
+            }
+            else
+            {
+                if (job.comp.size() != out.size())
+                {
+                    *error = true;
+                    return (uint32_t)-1;
+                }
+
+                memcpy(out.data(), job.comp.data(), out.size());
+            }
+
+            if ((uint32_t)crc32(0, out.data(), (uInt)out.size()) != job.crc)
+            {
+                DPRINTF("%s: crc mismatch.\n", FUNCNAME);
+                *error = true;
+                return (uint32_t)-1;
+            }
+
+            job.comp.clear();
+            job.comp.shrink_to_fit();
+        }
+
+        return 0;
+    }
+};
+
+bool ZipFile::ReadFiles(const std::vector<std::string> &paths, std::vector<std::vector<uint8_t>> &contents, int max_threads)
+{
+    if (!archive)
+        return false;
+
+    std::vector<ZipReadJob> jobs;
+    contents.resize(paths.size());
+
+    // Pass 1 (serial, libzip handles aren't thread safe): get the raw compressed data.
+    // Whatever can't be read raw (modified entries, encryption, other methods) goes through ReadFile.
+    for (size_t i = 0; i < paths.size(); i++)
+    {
+        const std::string &path = paths[i];
+        std::vector<uint8_t> &out = contents[i];
+        zip_stat_t zstat;
+        bool raw = false;
+
+        if (zip_stat(archive, path.c_str(), ZIP_FL_NOCASE, &zstat) == -1)
+            return false;
+
+        const zip_uint64_t needed = ZIP_STAT_SIZE | ZIP_STAT_COMP_SIZE | ZIP_STAT_CRC | ZIP_STAT_COMP_METHOD | ZIP_STAT_ENCRYPTION_METHOD;
+
+        if ((zstat.valid & needed) == needed && zstat.encryption_method == ZIP_EM_NONE && zstat.size < 0xFFFFFFFF &&
+            (zstat.comp_method == ZIP_CM_DEFLATE || zstat.comp_method == ZIP_CM_STORE))
+        {
+            zip_file_t *fd = zip_fopen_index(archive, zstat.index, ZIP_FL_COMPRESSED);
+            if (fd)
+            {
+                ZipReadJob job;
+
+                job.comp.resize(zstat.comp_size);
+                job.method = zstat.comp_method;
+                job.crc = zstat.crc;
+                job.out = &out;
+
+                if (zip_fread(fd, job.comp.data(), zstat.comp_size) == (zip_int64_t)zstat.comp_size)
+                {
+                    out.resize(zstat.size);
+                    jobs.push_back(std::move(job));
+                    raw = true;
+                }
+
+                zip_fclose(fd);
+            }
+        }
+
+        if (!raw)
+        {
+            size_t size;
+            uint8_t *buf = ReadFile(path, &size);
+
+            if (!buf)
+                return false;
+
+            out.assign(buf, buf+size);
+            delete[] buf;
+        }
+    }
+
+    if (jobs.size() == 0)
+        return true;
+
+    // Pass 2: inflate in parallel
+    if (max_threads <= 0)
+        max_threads = Thread::LogicalCoresCount();
+
+    if ((size_t)max_threads > jobs.size())
+        max_threads = (int)jobs.size();
+
+    std::atomic<size_t> next(0);
+    std::atomic<bool> error(false);
+
+    {
+        ThreadPool pool(max_threads);
+
+        for (int i = 0; i < max_threads; i++)
+        {
+            pool.AddWork(new ZipInflater(&jobs, &next, &error));
+        }
+
+        pool.Wait();
+    }
+
+    return !error;
+}
+
 bool ZipFile::WriteFile(const std::string &path, const void *buf, size_t size)
 {
     if (!archive)
         return false;
 
+    // If the entry already has this exact content, leave it untouched, so that
+    // its compressed data is copied as is on save instead of being recompressed
+    zip_stat_t zstat;
+
+    if (zip_stat(archive, path.c_str(), ZIP_FL_NOCASE, &zstat) == 0 && (zstat.valid & ZIP_STAT_SIZE) &&
+        (zstat.valid & ZIP_STAT_CRC) && zstat.size == size)
+    {
+        zip_stat_t orig;
+
+        if (zip_stat_index(archive, zstat.index, ZIP_FL_UNCHANGED, &orig) == 0 && (orig.valid & ZIP_STAT_CRC) &&
+            orig.crc == zstat.crc && orig.size == zstat.size &&
+            (uint32_t)crc32(0, (const Bytef *)buf, (uInt)size) == zstat.crc)
+        {
+            return true;
+        }
+    }
+
     void *copy = malloc(size);
     memcpy(copy, buf, size);
 
@@ -8,7 +8,12 @@ class ZipFile : public BaseFile
 {
 private:
 
-    std::string temp_file;
+    // The archive lives in a libzip buffer source, no temp file is involved.
+    // We keep our own reference to the source so that it survives zip_close.
+    zip_source_t *source;
+
+    bool Open(void *buf, size_t size, bool free_buf, int flags);
+    bool Commit();
 
     std::string temp_param1, temp_param2;
     static bool AddDirVisitor(const std::string &path, bool, void *param);
@@ -27,6 +32,9 @@ public:
     virtual bool Load(const uint8_t *buf, size_t size) override;
     virtual uint8_t *Save(size_t *psize) override;
 
+    // Streams the archive to the file, without building it in memory first
+    virtual bool SaveToFile(const std::string &path, bool show_error=true, bool build_path=false) override;
+
     size_t GetNumEntries() const;
     inline bool IsEmpty() const { return (GetNumEntries() == 0); }
 
@@ -35,6 +43,9 @@ public:
     uint64_t GetFileSize(const std::string &path) const;
 
     uint8_t *ReadFile(const std::string &path, size_t *psize);
+    // Reads several files at once: the compressed data is read serially, and inflated in parallel.
+    // contents is resized to paths.size(). max_threads <= 0: use the number of logical cores
+    bool ReadFiles(const std::vector<std::string> &paths, std::vector<std::vector<uint8_t>> &contents, int max_threads=0);
     bool WriteFile(const std::string &path, const void *buf, size_t size);
 
     char *ReadTextFile(const std::string &path);
@@ -13,6 +13,12 @@
 #define FPRINTF		FilePrintf
 #define FTPRINTF	FatalPrintf
 
+#ifdef _MSC_VER
+#define FUNCNAME    __FUNCSIG__
+#else
+#define FUNCNAME    __PRETTY_FUNCTION__
+#endif
+
 #ifdef _MSC_VER
 #define FORMAT_PRINTF
 #define FORMAT_PRINTF2
@@ -45,6 +51,11 @@ void *get_caller(uint8_t level);
 
 #define BRA	__builtin_return_address
 
+// MinGW defines it, other gcc targets don't
+#ifndef __forceinline
+#define __forceinline inline __attribute__((always_inline))
+#endif
+
 #else
 
 #include <intrin.h>
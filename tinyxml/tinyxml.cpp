@@ -23,6 +23,8 @@ distribution.
 */
 
 #include <ctype.h>
+#include <vector>
+#include <algorithm>
 
 #ifdef TIXML_USE_STL
 #include <sstream>
@@ -31,6 +33,45 @@ distribution.
 
 #include "tinyxml.h"
 
+// Lookups that walk over more children than this build the child index
+const int TIXML_CHILD_INDEX_MIN = 16;
+
+// Child elements sorted by name, elements with the same name keep the document order
+struct TiXmlChildIndex
+{
+	struct Entry
+	{
+		const char* name;
+		const TiXmlElement* element;
+
+		bool operator<( const Entry& other ) const { return strcmp( name, other.name ) < 0; }
+	};
+
+	std::vector< Entry > entries;
+
+	TiXmlChildIndex( const TiXmlNode* node )
+	{
+		for ( const TiXmlElement* element = node->FirstChildElement(); element; element = element->NextSiblingElement() )
+		{
+			Entry entry = { element->Value(), element };
+			entries.push_back( entry );
+		}
+
+		std::stable_sort( entries.begin(), entries.end() );
+	}
+
+	const TiXmlElement* Find( const char* name ) const
+	{
+		Entry key = { name, 0 };
+		std::vector< Entry >::const_iterator it = std::lower_bound( entries.begin(), entries.end(), key );
+
+		if ( it != entries.end() && strcmp( it->name, name ) == 0 )
+			return it->element;
+
+		return 0;
+	}
+};
+
 FILE* TiXmlFOpen( const char* filename, const char* mode );
 
 bool TiXmlBase::condenseWhiteSpace = true;
@@ -141,6 +182,7 @@ TiXmlNode::TiXmlNode( NodeType _type ) : TiXmlBase()
 	lastChild = 0;
 	prev = 0;
 	next = 0;
+	childIndex = 0;
 }
 
 
@@ -149,6 +191,8 @@ TiXmlNode::~TiXmlNode()
 	TiXmlNode* node = firstChild;
 	TiXmlNode* temp = 0;
 
+	delete childIndex;
+
 	while ( node )
 	{
 		temp = node;
@@ -166,11 +210,20 @@ void TiXmlNode::CopyTo( TiXmlNode* target ) const
 }
 
 
+void TiXmlNode::InvalidateChildIndex() const
+{
+	delete childIndex;
+	childIndex = 0;
+}
+
+
 void TiXmlNode::Clear()
 {
 	TiXmlNode* node = firstChild;
 	TiXmlNode* temp = 0;
 
+	InvalidateChildIndex();
+
 	while ( node )
 	{
 		temp = node;
@@ -197,6 +250,7 @@ TiXmlNode* TiXmlNode::LinkEndChild( TiXmlNode* node )
 	}
 
 	node->parent = this;
+	InvalidateChildIndex();
 
 	node->prev = lastChild;
 	node->next = 0;
@@ -243,6 +297,7 @@ TiXmlNode* TiXmlNode::InsertBeforeChild( TiXmlNode* beforeThis, const TiXmlNode&
 	if ( !node )
 		return 0;
 	node->parent = this;
+	InvalidateChildIndex();
 
 	node->next = beforeThis;
 	node->prev = beforeThis->prev;
@@ -276,6 +331,7 @@ TiXmlNode* TiXmlNode::InsertAfterChild( TiXmlNode* afterThis, const TiXmlNode& a
 	if ( !node )
 		return 0;
 	node->parent = this;
+	InvalidateChildIndex();
 
 	node->prev = afterThis;
 	node->next = afterThis->next;
@@ -313,6 +369,7 @@ TiXmlNode* TiXmlNode::ReplaceChild( TiXmlNode* replaceThis, const TiXmlNode& wit
 	if ( !node )
 		return 0;
 
+	InvalidateChildIndex();
 	node->next = replaceThis->next;
 	node->prev = replaceThis->prev;
 
@@ -344,6 +401,8 @@ bool TiXmlNode::RemoveChild( TiXmlNode* removeThis )
 		return false;
 	}
 
+	InvalidateChildIndex();
+
 	if ( removeThis->next )
 		removeThis->next->prev = removeThis->prev;
 	else
@@ -466,16 +525,22 @@ const TiXmlElement* TiXmlNode::FirstChildElement() const
 
 const TiXmlElement* TiXmlNode::FirstChildElement( const char * _value ) const
 {
+	if ( childIndex )
+		return childIndex->Find( _value );
+
 	const TiXmlNode* node;
+	int walked = 0;
 
-	for (	node = FirstChild( _value );
-			node;
-			node = node->NextSibling( _value ) )
+	for ( node = firstChild; node; node = node->next, ++walked )
 	{
-		if ( node->ToElement() )
-			return node->ToElement();
+		if ( node->ToElement() && strcmp( node->Value(), _value ) == 0 )
+			break;
 	}
-	return 0;
+
+	if ( walked > TIXML_CHILD_INDEX_MIN )
+		childIndex = new TiXmlChildIndex( this );
+
+	return ( node ) ? node->ToElement() : 0;
 }
 
 
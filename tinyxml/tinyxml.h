@@ -88,6 +88,7 @@ class TiXmlAttribute;
 class TiXmlText;
 class TiXmlDeclaration;
 class TiXmlParsingData;
+struct TiXmlChildIndex;
 
 const int TIXML_MAJOR_VERSION = 2;
 const int TIXML_MINOR_VERSION = 6;
@@ -505,11 +506,11 @@ public:
 		Text:		the text string
 		@endverbatim
 	*/
-	void SetValue(const char * _value) { value = _value;}
+	void SetValue(const char * _value) { value = _value; if ( parent ) parent->InvalidateChildIndex(); }
 
     #ifdef TIXML_USE_STL
 	/// STL std::string form.
-	void SetValue( const std::string& _value )	{ value = _value; }
+	void SetValue( const std::string& _value )	{ value = _value; if ( parent ) parent->InvalidateChildIndex(); }
 	#endif
 
 	/// Delete all the children of this node. Does not affect 'this'.
@@ -666,7 +667,11 @@ public:
 		return const_cast< TiXmlElement* >( (const_cast< const TiXmlNode* >(this))->FirstChildElement() );
 	}
 
-	/// Convenience function to get through elements.
+	/** Convenience function to get through elements. Nodes with many children get an index of
+		their child elements by name on the first lookup that has to walk far, so reading every
+		child of a big element by name isn't quadratic. The index is dropped when the children
+		change. Building it modifies the node, so concurrent lookups need a lock like any write.
+	*/
 	const TiXmlElement* FirstChildElement( const char * _value ) const;
 	TiXmlElement* FirstChildElement( const char * _value ) {
 		return const_cast< TiXmlElement* >( (const_cast< const TiXmlNode* >(this))->FirstChildElement( _value ) );
@@ -763,6 +768,11 @@ protected:
 	TiXmlNode*		prev;
 	TiXmlNode*		next;
 
+	// Built by FirstChildElement( const char* ), null until then
+	mutable TiXmlChildIndex*	childIndex;
+
+	void InvalidateChildIndex() const;
+
 private:
 	TiXmlNode( const TiXmlNode& );				// not implemented.
 	void operator=( const TiXmlNode& base );	// not allowed.